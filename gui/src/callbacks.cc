@@ -32,6 +32,7 @@
 
 #include <scroom/assertions.hh>
 #include <scroom/bookkeeping.hh>
+#include <scroom/threadpool.hh>
 
 #include "loader.hh"
 #include "pluginmanager.hh"
@@ -45,8 +46,9 @@
 #  include <boost/dll.hpp>
 #endif
 
-static const std::string SCROOM_DEV_MODE = "SCROOM_DEV_MODE";
-const std::string        REGULAR_FILES   = "Regular files";
+static const std::string SCROOM_DEV_MODE              = "SCROOM_DEV_MODE";
+static const std::string SCROOM_THREADPOOL_STATISTICS = "SCROOM_THREADPOOL_STATISTICS";
+const std::string        REGULAR_FILES                = "Regular files";
 
 static std::string xmlFileName;
 static GtkBuilder* aboutDialogXml = nullptr;
@@ -415,6 +417,37 @@ gboolean on_open_scroom_website(GtkAboutDialog*, gchar* uri, gpointer)
 
 bool in_devmode() { return nullptr != getenv(SCROOM_DEV_MODE.c_str()); }
 
+static gboolean on_dump_threadpool_statistics(gpointer /*unused*/)
+{
+  ThreadPool::dumpStatistics();
+  return true;
+}
+
+/** If requested, log the ThreadPool statistics every so many seconds */
+static void dumpThreadPoolStatisticsPeriodically()
+{
+  const char* value = getenv(SCROOM_THREADPOOL_STATISTICS.c_str()); // NOLINT(concurrency-mt-unsafe)
+  if(value == nullptr)
+  {
+    return;
+  }
+
+  try
+  {
+    const auto seconds = std::stoul(value);
+    if(seconds > 0)
+    {
+      spdlog::info("Logging threadpool statistics every {} seconds", seconds);
+      g_timeout_add_seconds(static_cast<guint>(seconds), on_dump_threadpool_statistics, nullptr);
+      return;
+    }
+  }
+  catch(std::exception&)
+  {
+  }
+  spdlog::warn("{}: Expected a number of seconds, not {}", SCROOM_THREADPOOL_STATISTICS, value);
+}
+
 void on_scroom_bootstrap(const FileNameMap& newFilenames)
 {
   spdlog::info("Bootstrapping Scroom...");
@@ -433,6 +466,7 @@ void on_scroom_bootstrap(const FileNameMap& newFilenames)
   }
 
   startPluginManager(devMode);
+  dumpThreadPoolStatisticsPeriodically();
 
   if(devMode)
   {
@@ -18,6 +18,8 @@
 
 #include <gtk/gtk.h>
 
+#include <scroom/memorybudget.hh>
+
 #ifdef _WIN32
 #  include <spdlog/sinks/basic_file_sink.h>
 #  include <unistd.h>
@@ -70,7 +72,10 @@ int main(int argc, char* argv[])
 
   po::options_description desc("Available options");
   desc.add_options()("help,h", "Show this help message")("load,l", po::value<std::vector<std::string>>(), "Load given filenames")(
-    "transparent-overlay", po::value<std::vector<std::string>>()->multitoken(), "Show given files in transparent overlay");
+    "transparent-overlay", po::value<std::vector<std::string>>()->multitoken(), "Show given files in transparent overlay")(
+    "memory-budget",
+    po::value<size_t>(),
+    "Memory (in MiB) to spend on decompressed tiles and pre-drawn bitmaps. Overrides SCROOM_MEMORY_BUDGET");
 
   po::positional_options_description p;
   p.add("load", -1);
@@ -98,6 +103,11 @@ int main(int argc, char* argv[])
       const auto& names = vm["transparent-overlay"].as<std::vector<std::string>>();
       filenames["Transparent Overlay"].assign(names.begin(), names.end());
     }
+
+    if(vm.count("memory-budget"))
+    {
+      Scroom::Utils::MemoryBudget::instance()->setLimit(vm["memory-budget"].as<size_t>() * 1024 * 1024);
+    }
   }
   catch(std::exception& ex)
   {
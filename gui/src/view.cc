@@ -10,6 +10,7 @@
 #include <array>
 #include <sstream>
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
 #include <boost/lexical_cast.hpp>
@@ -19,7 +20,11 @@
 #include <scroom/assertions.hh>
 #include <scroom/cairo-helpers.hh>
 #include <scroom/format_stuff.hh>
+#include <scroom/memoryaccounting.hh>
+#include <scroom/memorybudget.hh>
 #include <scroom/rounding.hh>
+#include <scroom/threadpool.hh>
+#include <scroom/trace.hh>
 
 #include "callbacks.hh"
 #include "pluginmanager.hh"
@@ -277,6 +282,30 @@ static Scroom::Utils::Point<double> eventToPoint(GdkEventButton* event) { return
 static Scroom::Utils::Point<double> eventToPoint(GdkEventMotion* event) { return {event->x, event->y}; }
 
 // This one has too much View-internal knowledge to hide in callbacks.cc
+static gboolean on_update_memory_usage(gpointer data)
+{
+  View* view = static_cast<View*>(data);
+  view->updateMemoryUsage();
+  view->updateThreadPoolStatistics();
+  view->updateMemoryAccounting();
+  return true;
+}
+
+static GtkLabel* createStatisticsLabel()
+{
+  GtkLabel* label = GTK_LABEL(gtk_label_new(nullptr));
+  gtk_label_set_xalign(label, 0.0);
+  gtk_label_set_selectable(label, true);
+  return label;
+}
+
+static void setStatisticsText(GtkLabel* label, const std::string& text)
+{
+  gchar* markup = g_markup_printf_escaped("<tt>%s</tt>", text.c_str());
+  gtk_label_set_markup(label, markup);
+  g_free(markup);
+}
+
 static void on_newWindow_activate(GtkMenuItem* /*unused*/, gpointer user_data)
 {
   PresentationInterface::WeakPtr const& wp = *static_cast<PresentationInterface::WeakPtr*>(user_data); // Yuk!
@@ -331,10 +360,24 @@ View::View(GtkBuilder* scroomXml_)
   progressBarManager = ProgressBarManager::create(progressBar);
   statusBar          = GTK_STATUSBAR(GTK_WIDGET(gtk_builder_get_object(scroomXml_, "statusbar")));
   statusBarContextId = gtk_statusbar_get_context_id(statusBar, "View");
+  memoryUsageLabel   = GTK_LABEL(GTK_WIDGET(gtk_builder_get_object(scroomXml_, "memory_usage_label")));
+  memoryUsageTimer   = g_timeout_add_seconds(1, on_update_memory_usage, this);
+  updateMemoryUsage();
 
   GtkWidget* panelWindow = GTK_WIDGET(gtk_builder_get_object(scroomXml_, "panelWindow"));
   GtkBox*    panel       = GTK_BOX(GTK_WIDGET(gtk_builder_get_object(scroomXml_, "panel")));
   sidebarManager.setWidgets(panelWindow, panel);
+  if(in_devmode())
+  {
+    threadPoolStatisticsLabel = createStatisticsLabel();
+    addSideWidget("Thread pools", GTK_WIDGET(threadPoolStatisticsLabel));
+    updateThreadPoolStatistics();
+
+    memoryAccountingLabel = createStatisticsLabel();
+    previousAccounting    = Scroom::MemoryBlobs::Accounting::getStatistics();
+    addSideWidget("Memory", GTK_WIDGET(memoryAccountingLabel));
+    updateMemoryAccounting();
+  }
   toolBar          = GTK_TOOLBAR(GTK_WIDGET(gtk_builder_get_object(scroomXml_, "toolbar")));
   toolBarSeparator = nullptr;
   toolBarCount     = 0;
@@ -360,23 +403,28 @@ View::Ptr View::create(GtkBuilder* scroomXml, const PresentationInterface::Ptr&
 View::~View()
 {
   spdlog::debug("Destroying view...");
+  g_source_remove(memoryUsageTimer);
   gtk_widget_destroy(GTK_WIDGET(window));
 }
 
 void View::redraw(cairo_t* cr)
 {
+  Scroom::Utils::Trace::Span const span("View::redraw", {-1, -1, -1, static_cast<ViewInterface*>(this)});
+
   if(presentation)
   {
-    const double                       pixelSize         = pixelSizeFromZoom(zoom);
-    Scroom::Utils::Point<double> const visibleRegionSize = drawingAreaSize.to<double>() / pixelSize;
-
-    auto rect = Scroom::Utils::make_rect(tweakedPosition(), visibleRegionSize);
-
-    presentation->redraw(shared_from_this<View>(), cr, rect, zoom);
-    for(const auto& renderer: postRenderers)
-    {
-      renderer->render(shared_from_this<View>(), cr, rect, zoom);
-    }
+    backingStore.redraw(cr,
+                        tweakedPosition(),
+                        drawingAreaSize,
+                        zoom,
+                        [this](cairo_t* store_cr, Scroom::Utils::Rectangle<double> rect)
+                        {
+                          presentation->redraw(shared_from_this<View>(), store_cr, rect, zoom);
+                          for(const auto& renderer: postRenderers)
+                          {
+                            renderer->render(shared_from_this<View>(), store_cr, rect, zoom);
+                          }
+                        });
   }
   else
   {
@@ -504,6 +552,56 @@ void View::updateTextbox()
   }
 }
 
+void View::updateMemoryUsage()
+{
+  const size_t                             MiB   = 1024 * 1024;
+  Scroom::Utils::MemoryBudget::Usage const usage = Scroom::Utils::MemoryBudget::instance()->getUsage();
+
+  const std::string text    = fmt::format("Memory: {} / {} MiB", usage.total() / MiB, usage.limit / MiB);
+  const std::string tooltip =
+    fmt::format("{} MiB in use by the current views, {} MiB cached", usage.pinned / MiB, usage.cached / MiB);
+  gtk_label_set_text(memoryUsageLabel, text.c_str());
+  gtk_widget_set_tooltip_text(GTK_WIDGET(memoryUsageLabel), tooltip.c_str());
+}
+
+void View::updateThreadPoolStatistics()
+{
+  if(threadPoolStatisticsLabel == nullptr)
+  {
+    return;
+  }
+
+  std::string text;
+  for(const ThreadPool::Statistics& statistics: ThreadPool::getAllStatistics())
+  {
+    text += (text.empty() ? "" : "\n") + statistics.toString();
+  }
+
+  setStatisticsText(threadPoolStatisticsLabel, text);
+}
+
+void View::updateMemoryAccounting()
+{
+  if(memoryAccountingLabel == nullptr)
+  {
+    return;
+  }
+
+  namespace Accounting = Scroom::MemoryBlobs::Accounting;
+
+  const double                        MiB        = 1024.0 * 1024.0;
+  Accounting::Statistics const        statistics = Accounting::getStatistics();
+  Accounting::Statistics::Rates const rates      = statistics.ratesSince(previousAccounting);
+
+  previousAccounting = statistics;
+
+  setStatisticsText(memoryAccountingLabel,
+                    fmt::format("{}\nCompressing {:.1f} MiB/s, decompressing {:.1f} MiB/s",
+                                statistics.toString(),
+                                rates.compressed / MiB,
+                                rates.decompressed / MiB));
+}
+
 void View::updateZoom()
 {
   if(presentation)
@@ -572,6 +670,9 @@ void View::toolButtonToggled(GtkToggleButton* button)
     }
     gtk_widget_set_sensitive(GTK_WIDGET(button), false);
     tools[button]->onEnable();
+
+    // Disabled tools may no longer draw what they drew before
+    invalidate();
   }
 }
 
@@ -768,7 +869,6 @@ void View::on_buttonRelease(GdkEventButton* event)
       const auto tweakedSelection = tweaker->tweakSelection(*selection);
       listener->onSelectionEnd(tweakedSelection, shared_from_this<ViewInterface>());
     }
-    invalidate();
   }
 }
 
@@ -794,7 +894,6 @@ void View::on_motion_notify(GdkEventMotion* event)
       const auto tweakedSelection = tweaker->tweakSelection(*selection);
       listener->onSelectionUpdate(tweakedSelection, shared_from_this<ViewInterface>());
     }
-    invalidate();
   }
 }
 
@@ -815,7 +914,23 @@ void View::unsetFullScreen()
 ////////////////////////////////////////////////////////////////////////
 // ViewInterface
 
-void View::invalidate() { gdk_window_invalidate_rect(gtk_widget_get_window(drawingArea), nullptr, false); }
+void View::invalidate()
+{
+  backingStore.invalidate();
+  gdk_window_invalidate_rect(gtk_widget_get_window(drawingArea), nullptr, false);
+}
+
+void View::invalidateArea(Scroom::Utils::Rectangle<double> presentationArea)
+{
+  backingStore.invalidate(presentationArea);
+
+  const auto viewArea = (presentationArea - tweakedPosition()) * pixelSizeFromZoom(zoom);
+  const auto rect     = Scroom::GtkHelpers::createCairoIntRectangle(static_cast<int>(std::floor(viewArea.x())),
+                                                                static_cast<int>(std::floor(viewArea.y())),
+                                                                static_cast<int>(std::ceil(viewArea.width())) + 1,
+                                                                static_cast<int>(std::ceil(viewArea.height())) + 1);
+  gdk_window_invalidate_rect(gtk_widget_get_window(drawingArea), &rect, false);
+}
 
 ProgressInterface::Ptr View::getProgressInterface() { return progressBarManager; }
 
@@ -1005,7 +1120,8 @@ void View::updateXY(const Scroom::Utils::Point<double>& newPos, const View::Loca
       updateTextbox();
     }
 
-    invalidate();
+    // The content didn't change, so the backing store can be reused
+    gdk_window_invalidate_rect(gtk_widget_get_window(drawingArea), nullptr, false);
   }
 }
 
@@ -19,6 +19,8 @@
 
 #include <cairo.h>
 
+#include <scroom/backing-store.hh>
+#include <scroom/memoryaccounting.hh>
 #include <scroom/presentationinterface.hh>
 #include <scroom/scroominterface.hh>
 #include <scroom/stuff.hh>
@@ -121,6 +123,11 @@ private:
   GtkListStore*                                           zoomItems;
   GtkProgressBar*                                         progressBar;
   GtkStatusbar*                                           statusBar;
+  GtkLabel*                                               memoryUsageLabel;
+  guint                                                   memoryUsageTimer{0};
+  GtkLabel*                                               threadPoolStatisticsLabel{nullptr}; /**< Only in dev mode */
+  GtkLabel*                                               memoryAccountingLabel{nullptr};     /**< Only in dev mode */
+  Scroom::MemoryBlobs::Accounting::Statistics             previousAccounting;                 /**< For computing rates */
   GtkToolbar*                                             toolBar;
   GtkToolItem*                                            toolBarSeparator;
   GtkEntry*                                               xTextBox;
@@ -148,6 +155,9 @@ private:
 
   Scroom::Utils::WeakKeyMap<PresentationInterface::WeakPtr, GtkWidget*> presentations;
 
+  /** What was drawn previously, such that scrolling only needs to draw the newly exposed parts */
+  BackingStore backingStore;
+
 private:
   enum LocationChangeCause
   {
@@ -184,6 +194,9 @@ public:
   void        updateZoom();
   void        updateRulers();
   void        updateTextbox();
+  void        updateMemoryUsage();
+  void        updateThreadPoolStatistics();
+  void        updateMemoryAccounting();
   void        toolButtonToggled(GtkToggleButton* button);
 
   ////////////////////////////////////////////////////////////////////////
@@ -208,6 +221,7 @@ public:
   // ViewInterface
 
   void                       invalidate() override;
+  void                       invalidateArea(Scroom::Utils::Rectangle<double> presentationArea) override;
   ProgressInterface::Ptr     getProgressInterface() override;
   void                       addSideWidget(std::string title, GtkWidget* w) override;
   void                       removeSideWidget(GtkWidget* w) override;
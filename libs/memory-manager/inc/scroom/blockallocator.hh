@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include <scroom/interface.hh>
@@ -63,6 +64,21 @@ namespace Scroom::MemoryBlocks
 
   BlockFactoryInterface::Ptr getBlockFactoryInterface();
 
+  /**
+   * Make part of a file available as pages, without reading it
+   *
+   * The file is memory-mapped. Pages are copy-on-write, so changing
+   * their contents does not change the file.
+   *
+   * @param fileName The file to map
+   * @param offset Offset in the file of the first page
+   * @param count Number of pages
+   * @param size Size of each page
+   *
+   * @return @c nullptr if the file could not be mapped
+   */
+  BlockInterface::Ptr mapFile(const std::string& fileName, size_t offset, size_t count, size_t size);
+
   ////////////////////////////////////////////////////////////////////////
   // implementation
 
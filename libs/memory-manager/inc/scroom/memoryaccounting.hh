@@ -0,0 +1,126 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Scroom::MemoryBlobs::Accounting
+{
+  /**
+   * Where the memory of a group of Blobs goes
+   *
+   * Cumulative counters (compressions, decompressions and their byte
+   * counts) only ever increase. Use Statistics::ratesSince() to turn
+   * them into rates.
+   */
+  struct Usage
+  {
+    std::string name;
+    size_t      blobs{0};
+    size_t      resident{0};     /**< Bytes of uncompressed data in memory */
+    size_t      referenced{0};   /**< Part of resident that is referenced through RawPageData */
+    size_t      uncompressed{0}; /**< Bytes of uncompressed data represented by compressed */
+    size_t      compressed{0};   /**< Bytes of the pages holding compressed data */
+
+    uint64_t compressions{0};
+    uint64_t decompressions{0};
+    uint64_t bytesCompressed{0};   /**< Uncompressed bytes that went into compressions */
+    uint64_t bytesDecompressed{0}; /**< Uncompressed bytes that came out of decompressions */
+
+    /** Uncompressed size divided by compressed size, or zero if nothing is compressed */
+    [[nodiscard]] double compressionRatio() const;
+  };
+
+  /**
+   * Counters for one Category of Blobs
+   *
+   * Updated by the Blobs themselves. All counters are relaxed atomics,
+   * so a snapshot may be slightly inconsistent.
+   */
+  class Category
+  {
+  public:
+    using Ptr = std::shared_ptr<Category>;
+
+  private:
+    const std::string name;
+
+    std::atomic<size_t>   blobs{0};
+    std::atomic<size_t>   resident{0};
+    std::atomic<size_t>   referenced{0};
+    std::atomic<size_t>   uncompressed{0};
+    std::atomic<size_t>   compressed{0};
+    std::atomic<uint64_t> compressions{0};
+    std::atomic<uint64_t> decompressions{0};
+    std::atomic<uint64_t> bytesCompressed{0};
+    std::atomic<uint64_t> bytesDecompressed{0};
+
+  public:
+    explicit Category(std::string name);
+
+    void blobCreated();
+    void blobDestroyed();
+
+    /** @param delta Change in the number of bytes, negative for memory being released */
+    void addResident(ptrdiff_t delta);
+    void addReferenced(ptrdiff_t delta);
+    void addCompressed(ptrdiff_t uncompressedDelta, ptrdiff_t compressedDelta);
+
+    /** @param bytes Uncompressed size of the data that was (de)compressed */
+    void recordCompression(size_t bytes);
+    void recordDecompression(size_t bytes);
+
+    [[nodiscard]] Usage getUsage() const;
+  };
+
+  struct Statistics
+  {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point  timestamp;
+    std::vector<Usage> categories; /**< Sorted by name */
+    Usage              total;
+
+    size_t pages{0};     /**< Pages allocated by all PageProviders */
+    size_t freePages{0}; /**< Allocated pages not holding compressed data */
+    size_t pageBytes{0}; /**< Size of all allocated pages */
+
+    struct Rates
+    {
+      double compressed{0};   /**< Uncompressed bytes per second */
+      double decompressed{0}; /**< Uncompressed bytes per second */
+    };
+
+    /** Compression and decompression rates since an @p earlier snapshot */
+    [[nodiscard]] Rates ratesSince(const Statistics& earlier) const;
+
+    /** Multi-line, human readable summary */
+    [[nodiscard]] std::string toString() const;
+  };
+
+  /**
+   * Get the Category with the given name, creating it if needed
+   *
+   * Categories live as long as the process, so their counters can be
+   * used to detect Blobs or RawPageData references that were never
+   * released.
+   */
+  Category::Ptr getCategory(const std::string& name);
+
+  /** Category of Blobs created without one */
+  Category::Ptr defaultCategory();
+
+  /** Accounting of all Blobs and PageProviders in the process */
+  Statistics getStatistics();
+} // namespace Scroom::MemoryBlobs::Accounting
@@ -7,14 +7,19 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
 #include <scroom/blockallocator.hh>
+#include <scroom/memoryaccounting.hh>
 #include <scroom/utilities.hh>
 
 class ThreadPool;
@@ -34,6 +39,34 @@ namespace Scroom::MemoryBlobs
   }
   using PageList = std::list<Page::Ptr>;
 
+  /**
+   * Method used to compress the contents of a Blob
+   *
+   * LZ4 and ZSTD are only available if Scroom was built with
+   * ENABLE_LZ4 and ENABLE_ZSTD, respectively. If an unavailable codec
+   * is requested, ZLIB is used instead.
+   */
+  enum class Codec
+  {
+    AUTO, /**< Pick a codec for each Blob, based on a quick entropy estimate of its contents */
+    RAW,  /**< Store the data uncompressed */
+    ZLIB,
+    LZ4,
+    ZSTD
+  };
+
+  bool                   isAvailable(Codec codec);
+  std::string            to_string(Codec codec);
+  boost::optional<Codec> codecFromString(const std::string& name);
+
+  /**
+   * Codec to be used by new PageProvider instances
+   *
+   * This is AUTO, unless overridden by the SCROOM_BLOB_CODEC
+   * environment variable (i.e. "zlib", "lz4", "zstd", "raw" or "auto")
+   */
+  Codec getDefaultCodec();
+
   class PageProvider : virtual public Scroom::Utils::Base
   {
   public:
@@ -46,6 +79,7 @@ namespace Scroom::MemoryBlobs
     Scroom::MemoryBlocks::PageList                   allPages;
     std::list<Scroom::MemoryBlocks::Page*>           freePages;
     boost::mutex                                     mut;
+    std::atomic<Codec>                               codec;
 
   private:
     class MarkPageFree
@@ -69,6 +103,22 @@ namespace Scroom::MemoryBlobs
     static Ptr create(size_t blockCount, size_t blockSize);
     Page::Ptr  getFreePage();
     size_t     getPageSize() const;
+
+    /** Number of pages allocated so far, including free ones */
+    size_t getPageCount();
+    size_t getFreePageCount();
+
+    /** All PageProvider objects that currently exist */
+    static std::vector<Ptr> all();
+
+    /**
+     * Set the codec used for Blobs that are compressed from now on
+     *
+     * Blobs that are already compressed remember their codec, so
+     * switching codecs is always safe.
+     */
+    void  setCodec(Codec codec);
+    Codec getCodec() const;
   };
 
   class Blob : virtual public Scroom::Utils::Base
@@ -105,20 +155,56 @@ namespace Scroom::MemoryBlobs
     boost::mutex                mut;
     RawPageData::WeakPtr        weakData;
     PageList                    pages;
+    Codec                       codec{Codec::RAW};
     std::shared_ptr<ThreadPool> cpuBound;
     int                         refcount{0}; // Yuk
+    Accounting::Category::Ptr   category;
 
   private:
-    Blob(PageProvider::Ptr provider, size_t size);
+    Blob(PageProvider::Ptr provider, size_t size, Accounting::Category::Ptr category);
+    Blob(PageProvider::Ptr provider, size_t size, Codec codec, PageList pages, Accounting::Category::Ptr category);
     void             unload();
     RawPageData::Ptr load();
     void             compress();
+    void             setPages(PageList newPages);
+    void             freeData();
 
   public:
-    static Ptr            create(PageProvider::Ptr provider, size_t size);
+    /**
+     * @param category Where the memory of this Blob is accounted for. If
+     *    not given, Accounting::defaultCategory() is used.
+     */
+    static Ptr create(PageProvider::Ptr provider, size_t size, Accounting::Category::Ptr category = {});
+
+    /**
+     * Create a Blob from data that was compressed earlier
+     *
+     * @param provider Provides pages when the Blob is modified. The
+     *    @c pages must be of its page size.
+     * @param size The size of the uncompressed data
+     * @param codec The codec the data was compressed with
+     * @param pages The compressed data, as obtained from getCompressed()
+     */
+    static Ptr
+      create(PageProvider::Ptr provider, size_t size, Codec codec, PageList pages, Accounting::Category::Ptr category = {});
+
+    ~Blob() override;
+    Blob(const Blob&)            = delete;
+    Blob(Blob&&)                 = delete;
+    Blob& operator=(const Blob&) = delete;
+    Blob& operator=(Blob&&)      = delete;
+
     RawPageData::Ptr      get();
     RawPageData::ConstPtr getConst();
     RawPageData::Ptr      initialize(uint8_t value);
+
+    /**
+     * Get the compressed data, compressing it if necessary
+     *
+     * @return The codec used, and the pages containing the compressed
+     *    data. If the Blob was never initialized, there are no pages.
+     */
+    std::pair<Codec, PageList> getCompressed();
   };
 
   ////////////////////////////////////////////////////////////////////////
@@ -7,12 +7,30 @@
 
 #include "blob-compression.hh"
 
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include <fmt/format.h>
+#include <spdlog/spdlog.h>
 #include <zlib.h>
 
+#ifdef ENABLE_LZ4
+#  include <lz4frame.h>
+#endif
+
+#ifdef ENABLE_ZSTD
+#  include <zstd.h>
+#endif
+
 #include <scroom/assertions.hh>
 #include <scroom/memoryblobs.hh>
 
@@ -25,6 +43,265 @@
                  __FILE__,                                                                                  \
                  __LINE__))
 
+#define codec_verify(condition, function_name, message)                  \
+  ((condition) ? ((void)0)                                               \
+               : Scroom::Utils::Detail::assertionFailed(                 \
+                 "assertion",                                            \
+                 fmt::format("{} said: {}", (function_name), (message)), \
+                 static_cast<const char*>(__PRETTY_FUNCTION__),          \
+                 __FILE__,                                               \
+                 __LINE__))
+
+namespace
+{
+  using namespace Scroom::MemoryBlobs;
+
+  /** Data with more bits of entropy per byte than this is not worth compressing */
+  const double INCOMPRESSIBLE_ENTROPY = 7.5;
+
+  /** estimateEntropy() inspects this many evenly spaced chunks of this many bytes */
+  const size_t SAMPLE_COUNT = 64;
+  const size_t SAMPLE_SIZE  = 1024;
+
+  const char* const SCROOM_BLOB_CODEC = "SCROOM_BLOB_CODEC";
+
+  double entropyOf(const std::array<size_t, 256>& histogram, size_t total)
+  {
+    double result = 0;
+    for(const size_t count: histogram)
+    {
+      if(count > 0)
+      {
+        const double p = static_cast<double>(count) / static_cast<double>(total);
+        result -= p * std::log2(p);
+      }
+    }
+    return result;
+  }
+
+  PageList copyToPages(const uint8_t* in, size_t size, const PageProvider::Ptr& provider)
+  {
+    PageList     result;
+    const size_t pageSize = provider->getPageSize();
+
+    for(size_t offset = 0; offset < size; offset += pageSize)
+    {
+      Page::Ptr const currentPage = provider->getFreePage();
+      result.push_back(currentPage);
+
+      memcpy(currentPage->get().get(), in + offset, std::min(pageSize, size - offset));
+    }
+
+    return result;
+  }
+
+  void copyFromPages(uint8_t* out, size_t size, const PageList& list, const PageProvider::Ptr& provider)
+  {
+    const size_t pageSize = provider->getPageSize();
+    size_t       offset   = 0;
+
+    for(const Page::Ptr& currentPage: list)
+    {
+      verify(offset < size);
+
+      memcpy(out + offset, currentPage->get().get(), std::min(pageSize, size - offset));
+      offset += pageSize;
+    }
+    verify(offset >= size);
+  }
+
+#ifdef ENABLE_LZ4
+  PageList compressLz4(const uint8_t* in, size_t size, const PageProvider::Ptr& provider)
+  {
+    LZ4F_preferences_t preferences{};
+    preferences.frameInfo.contentSize = size;
+
+    std::vector<uint8_t> compressed(LZ4F_compressFrameBound(size, &preferences));
+    const size_t         r = LZ4F_compressFrame(compressed.data(), compressed.size(), in, size, &preferences);
+    codec_verify(!LZ4F_isError(r), "LZ4F_compressFrame", LZ4F_getErrorName(r));
+
+    return copyToPages(compressed.data(), r, provider);
+  }
+
+  void decompressLz4(uint8_t* out, size_t size, PageList list, const PageProvider::Ptr& provider)
+  {
+    const size_t pageSize = provider->getPageSize();
+    size_t       outPos   = 0;
+
+    LZ4F_dctx*   context = nullptr;
+    const size_t created = LZ4F_createDecompressionContext(&context, LZ4F_VERSION);
+    codec_verify(!LZ4F_isError(created), "LZ4F_createDecompressionContext", LZ4F_getErrorName(created));
+
+    // LZ4F_decompress() returns 0 once the frame is complete
+    size_t r = 1;
+    while(!list.empty() && r != 0)
+    {
+      Page::Ptr const currentPage = list.front();
+      list.pop_front();
+
+      RawPageData::Ptr const currentPageRaw = currentPage->get();
+
+      const uint8_t* src     = currentPageRaw.get();
+      size_t         srcLeft = pageSize;
+      while(srcLeft > 0 && r != 0)
+      {
+        size_t dstSize = size - outPos;
+        size_t srcSize = srcLeft;
+
+        r = LZ4F_decompress(context, out + outPos, &dstSize, src, &srcSize, nullptr);
+        codec_verify(!LZ4F_isError(r), "LZ4F_decompress", LZ4F_getErrorName(r));
+
+        outPos += dstSize;
+        src += srcSize;
+        srcLeft -= srcSize;
+      }
+    }
+    verify(r == 0);
+
+    LZ4F_freeDecompressionContext(context);
+  }
+#endif
+
+#ifdef ENABLE_ZSTD
+  PageList compressZstd(const uint8_t* in, size_t size, const PageProvider::Ptr& provider)
+  {
+    PageList     result;
+    const size_t pageSize = provider->getPageSize();
+
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    size_t     r       = ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, 1);
+    codec_verify(!ZSTD_isError(r), "ZSTD_CCtx_setParameter", ZSTD_getErrorName(r));
+
+    ZSTD_inBuffer input{in, size, 0};
+    do
+    {
+      Page::Ptr const currentPage = provider->getFreePage();
+      result.push_back(currentPage);
+
+      RawPageData::Ptr const currentPageRaw = currentPage->get();
+
+      ZSTD_outBuffer output{currentPageRaw.get(), pageSize, 0};
+      r = ZSTD_compressStream2(context, &output, &input, ZSTD_e_end);
+      codec_verify(!ZSTD_isError(r), "ZSTD_compressStream2", ZSTD_getErrorName(r));
+    } while(r != 0);
+
+    ZSTD_freeCCtx(context);
+
+    return result;
+  }
+
+  void decompressZstd(uint8_t* out, size_t size, PageList list, const PageProvider::Ptr& provider)
+  {
+    const size_t pageSize = provider->getPageSize();
+
+    ZSTD_DCtx*     context = ZSTD_createDCtx();
+    ZSTD_outBuffer output{out, size, 0};
+    size_t         r = 1;
+
+    while(!list.empty() && r != 0)
+    {
+      Page::Ptr const currentPage = list.front();
+      list.pop_front();
+
+      RawPageData::Ptr const currentPageRaw = currentPage->get();
+
+      ZSTD_inBuffer input{currentPageRaw.get(), pageSize, 0};
+      while(input.pos < input.size && r != 0)
+      {
+        r = ZSTD_decompressStream(context, &output, &input);
+        codec_verify(!ZSTD_isError(r), "ZSTD_decompressStream", ZSTD_getErrorName(r));
+      }
+    }
+    verify(r == 0);
+
+    ZSTD_freeDCtx(context);
+  }
+#endif
+} // namespace
+
+namespace Scroom::MemoryBlobs
+{
+  bool isAvailable(Codec codec)
+  {
+    switch(codec)
+    {
+    case Codec::AUTO:
+    case Codec::RAW:
+    case Codec::ZLIB:
+      return true;
+    case Codec::LZ4:
+#ifdef ENABLE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    case Codec::ZSTD:
+#ifdef ENABLE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    }
+    defect();
+  }
+
+  std::string to_string(Codec codec)
+  {
+    switch(codec)
+    {
+    case Codec::AUTO:
+      return "auto";
+    case Codec::RAW:
+      return "raw";
+    case Codec::ZLIB:
+      return "zlib";
+    case Codec::LZ4:
+      return "lz4";
+    case Codec::ZSTD:
+      return "zstd";
+    }
+    defect();
+  }
+
+  boost::optional<Codec> codecFromString(const std::string& name)
+  {
+    for(const Codec codec: {Codec::AUTO, Codec::RAW, Codec::ZLIB, Codec::LZ4, Codec::ZSTD})
+    {
+      if(name == to_string(codec))
+      {
+        return codec;
+      }
+    }
+    return {};
+  }
+
+  Codec getDefaultCodec()
+  {
+    static const Codec defaultCodec = []
+    {
+      const char* name = getenv(SCROOM_BLOB_CODEC); // NOLINT(concurrency-mt-unsafe)
+      if(name == nullptr)
+      {
+        return Codec::AUTO;
+      }
+
+      auto codec = codecFromString(name);
+      if(!codec)
+      {
+        spdlog::warn("{}: Unknown codec {}. Using {}", SCROOM_BLOB_CODEC, name, to_string(Codec::AUTO));
+        return Codec::AUTO;
+      }
+      if(!isAvailable(*codec))
+      {
+        spdlog::warn("{}: Codec {} is not available in this build", SCROOM_BLOB_CODEC, name);
+      }
+      return *codec;
+    }();
+
+    return defaultCodec;
+  }
+} // namespace Scroom::MemoryBlobs
+
 namespace Scroom::MemoryBlobs::Detail
 {
   PageList compressBlob(const uint8_t* in, size_t size, const PageProvider::Ptr& provider)
@@ -103,4 +380,120 @@ namespace Scroom::MemoryBlobs::Detail
     r = inflateEnd(&stream);
     zlib_verify(r == Z_OK, "inflateEnd", r, stream);
   }
+
+  double estimateEntropy(const uint8_t* in, size_t size)
+  {
+    // Besides the distribution of the bytes themselves, look at the
+    // distribution of the differences between subsequent bytes. This
+    // recognizes gradients and other regular patterns as compressible,
+    // even though they use all byte values equally often.
+    std::array<size_t, 256> bytes{};
+    std::array<size_t, 256> deltas{};
+    size_t                  total = 0;
+
+    const size_t sampleSize = std::min(SAMPLE_SIZE, size);
+    const size_t stride     = std::max(sampleSize, size / SAMPLE_COUNT);
+    for(size_t start = 0; start + sampleSize <= size; start += stride)
+    {
+      uint8_t previous = in[start];
+      for(size_t i = start; i < start + sampleSize; i++)
+      {
+        bytes[in[i]]++;
+        deltas[static_cast<uint8_t>(in[i] - previous)]++;
+        previous = in[i];
+      }
+      total += sampleSize;
+    }
+
+    if(total == 0)
+    {
+      return 0;
+    }
+
+    return std::min(entropyOf(bytes, total), entropyOf(deltas, total));
+  }
+
+  Codec chooseCodec(const uint8_t* in, size_t size, Codec requested)
+  {
+    if(requested != Codec::AUTO)
+    {
+      return isAvailable(requested) ? requested : Codec::ZLIB;
+    }
+
+    if(estimateEntropy(in, size) > INCOMPRESSIBLE_ENTROPY)
+    {
+      return Codec::RAW;
+    }
+
+    // Prefer the codec that decompresses fastest
+    for(const Codec codec: {Codec::LZ4, Codec::ZSTD})
+    {
+      if(isAvailable(codec))
+      {
+        return codec;
+      }
+    }
+    return Codec::ZLIB;
+  }
+
+  std::pair<Codec, PageList> compressBlob(const uint8_t* in, size_t size, const PageProvider::Ptr& provider, Codec codec)
+  {
+    codec = chooseCodec(in, size, codec);
+
+    PageList result;
+    switch(codec)
+    {
+    case Codec::RAW:
+      return {Codec::RAW, copyToPages(in, size, provider)};
+    case Codec::ZLIB:
+      result = compressBlob(in, size, provider);
+      break;
+#ifdef ENABLE_LZ4
+    case Codec::LZ4:
+      result = compressLz4(in, size, provider);
+      break;
+#endif
+#ifdef ENABLE_ZSTD
+    case Codec::ZSTD:
+      result = compressZstd(in, size, provider);
+      break;
+#endif
+    default:
+      defect_message(fmt::format("Codec {} can't be used for compression", to_string(codec)));
+    }
+
+    const size_t rawPageCount = (size + provider->getPageSize() - 1) / provider->getPageSize();
+    if(result.size() >= rawPageCount)
+    {
+      // Compression didn't help. Don't waste time decompressing later
+      return {Codec::RAW, copyToPages(in, size, provider)};
+    }
+
+    return {codec, result};
+  }
+
+  void decompressBlob(uint8_t* out, size_t size, PageList list, const PageProvider::Ptr& provider, Codec codec)
+  {
+    switch(codec)
+    {
+    case Codec::RAW:
+      copyFromPages(out, size, list, provider);
+      break;
+    case Codec::ZLIB:
+      decompressBlob(out, size, std::move(list), provider);
+      break;
+#ifdef ENABLE_LZ4
+    case Codec::LZ4:
+      decompressLz4(out, size, std::move(list), provider);
+      break;
+#endif
+#ifdef ENABLE_ZSTD
+    case Codec::ZSTD:
+      decompressZstd(out, size, std::move(list), provider);
+      break;
+#endif
+    default:
+      defect_message(fmt::format("Codec {} can't be used for decompression", to_string(codec)));
+    }
+  }
 } // namespace Scroom::MemoryBlobs::Detail
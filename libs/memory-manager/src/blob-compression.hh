@@ -9,6 +9,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 
 #include <scroom/memoryblobs.hh>
 
@@ -16,4 +17,28 @@ namespace Scroom::MemoryBlobs::Detail
 {
   PageList compressBlob(const uint8_t* in, size_t size, const PageProvider::Ptr& provider);
   void     decompressBlob(uint8_t* out, size_t size, PageList list, const PageProvider::Ptr& provider);
+
+  /**
+   * Compress the given data into pages
+   *
+   * @return The codec that was actually used, and the resulting
+   *    pages. The codec differs from the requested one if the
+   *    requested codec is AUTO or not available, or if the data turned
+   *    out not to be compressible.
+   */
+  std::pair<Codec, PageList> compressBlob(const uint8_t* in, size_t size, const PageProvider::Ptr& provider, Codec codec);
+  void decompressBlob(uint8_t* out, size_t size, PageList list, const PageProvider::Ptr& provider, Codec codec);
+
+  /**
+   * Estimate the entropy of the given data, in bits per byte
+   *
+   * Only a sample of the data is inspected, so this is cheap enough to
+   * be done for every Blob that is compressed.
+   */
+  double estimateEntropy(const uint8_t* in, size_t size);
+
+  /**
+   * Resolve AUTO and unavailable codecs into a codec that can actually be used
+   */
+  Codec chooseCodec(const uint8_t* in, size_t size, Codec requested);
 } // namespace Scroom::MemoryBlobs::Detail
@@ -0,0 +1,340 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "filebackedblockallocator.hh"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <boost/lexical_cast.hpp>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+
+#  include <sys/mman.h>
+#endif
+
+#include <scroom/assertions.hh>
+
+namespace Scroom::MemoryBlocks::Detail
+{
+  const char* const FileBackedBlockFactory::ENVIRONMENT_VARIABLE = "SCROOM_SPILL_LIMIT";
+
+#ifndef _WIN32
+  namespace
+  {
+    size_t systemPageSize() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
+
+    size_t roundDown(size_t value, size_t multiple) { return value / multiple * multiple; }
+
+    size_t roundUp(size_t value, size_t multiple) { return roundDown(value + multiple - 1, multiple); }
+  } // namespace
+
+  class FileBackedBlockAllocator
+    : public BlockInterface
+    , public virtual Scroom::Utils::Base
+  {
+  private:
+    struct PageState
+    {
+      size_t                               users{0};
+      bool                                 resident{false};
+      FileBackedBlockFactory::Lru::iterator position; /**< Valid if resident, but not in use */
+    };
+
+    FileBackedBlockFactory::Ptr factory;
+    size_t                      count;
+    size_t                      size;
+    size_t                      offset;
+    size_t                      mappedSize;
+    uint8_t*                    data;
+    std::vector<PageState>      pages; /**< Protected by factory->mut */
+
+  private:
+    FileBackedBlockAllocator(FileBackedBlockFactory::Ptr factory, size_t count, size_t size, size_t offset, uint8_t* data);
+
+  protected:
+    RawPageData::Ptr get(size_t id) override;
+
+  public:
+    static BlockInterface::Ptr create(FileBackedBlockFactory::Ptr factory, size_t count, size_t size, size_t offset);
+
+    ~FileBackedBlockAllocator() override;
+    FileBackedBlockAllocator(const FileBackedBlockAllocator&)            = delete;
+    FileBackedBlockAllocator(FileBackedBlockAllocator&&)                 = delete;
+    FileBackedBlockAllocator& operator=(const FileBackedBlockAllocator&) = delete;
+    FileBackedBlockAllocator& operator=(FileBackedBlockAllocator&&)      = delete;
+
+    PageList getPages() override;
+
+    /** Write the given page to the file, and drop it from memory */
+    void spill(size_t id);
+
+    friend class FileBackedBlockFactory;
+  };
+
+  ////////////////////////////////////////////////////////////////////////
+  // FileBackedBlockAllocator
+
+  FileBackedBlockAllocator::FileBackedBlockAllocator(
+    FileBackedBlockFactory::Ptr factory_, size_t count_, size_t size_, size_t offset_, uint8_t* data_)
+    : factory(std::move(factory_))
+    , count(count_)
+    , size(size_)
+    , offset(offset_)
+    , mappedSize(roundUp(count_ * size_, systemPageSize()))
+    , data(data_)
+    , pages(count_)
+  {
+  }
+
+  BlockInterface::Ptr
+    FileBackedBlockAllocator::create(FileBackedBlockFactory::Ptr factory, size_t count, size_t size, size_t offset)
+  {
+    const size_t mappedSize = roundUp(count * size, systemPageSize());
+    void* const  data =
+      mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, factory->fd, static_cast<off_t>(offset));
+    if(data == MAP_FAILED)
+    {
+      throw std::bad_alloc();
+    }
+
+    return BlockInterface::Ptr(
+      new FileBackedBlockAllocator(std::move(factory), count, size, offset, static_cast<uint8_t*>(data)));
+  }
+
+  FileBackedBlockAllocator::~FileBackedBlockAllocator()
+  {
+    factory->forget(*this);
+    munmap(data, mappedSize);
+
+#  ifdef FALLOC_FL_PUNCH_HOLE
+    // Give the disk space back
+    fallocate(
+      factory->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(mappedSize));
+#  endif
+  }
+
+  RawPageData::Ptr FileBackedBlockAllocator::get(size_t id)
+  {
+    if(id >= count)
+    {
+      throw std::out_of_range("");
+    }
+
+    factory->acquire(*this, id);
+
+    return RawPageData::Ptr(data + id * size,
+                            [me = shared_from_this<FileBackedBlockAllocator>(), id](uint8_t* /*unused*/)
+                            { me->factory->release(*me, id); });
+  }
+
+  PageList FileBackedBlockAllocator::getPages()
+  {
+    BlockInterface::Ptr const me = shared_from_this<BlockInterface>();
+
+    PageList result;
+    for(size_t i = 0; i < count; i++)
+    {
+      result.emplace_back(me, i);
+    }
+
+    return result;
+  }
+
+  void FileBackedBlockAllocator::spill(size_t id)
+  {
+    // Only whole system pages can be dropped
+    const size_t pageSize = systemPageSize();
+    const size_t begin    = roundUp(id * size, pageSize);
+    const size_t end      = roundDown((id + 1) * size, pageSize);
+    if(begin < end)
+    {
+      msync(data + begin, end - begin, MS_SYNC);
+      madvise(data + begin, end - begin, MADV_DONTNEED);
+      posix_fadvise(factory->fd, static_cast<off_t>(offset + begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FileBackedBlockFactory
+
+  FileBackedBlockFactory::FileBackedBlockFactory(int fd_, size_t residentLimit_)
+    : fd(fd_)
+    , residentLimit(residentLimit_)
+  {
+  }
+
+  FileBackedBlockFactory::Ptr FileBackedBlockFactory::create(const std::string& directory, size_t residentLimit)
+  {
+    std::string       pattern = directory + "/scroom-spill-XXXXXX";
+    std::vector<char> fileName(pattern.begin(), pattern.end());
+    fileName.push_back('\0');
+
+    const int fd = mkstemp(fileName.data());
+    if(fd < 0)
+    {
+      spdlog::warn("Can't create a spill file in {}: {}", directory, strerror(errno)); // NOLINT(concurrency-mt-unsafe)
+      return nullptr;
+    }
+    // The file disappears as soon as we close it
+    unlink(fileName.data());
+
+    return Ptr(new FileBackedBlockFactory(fd, residentLimit));
+  }
+
+  FileBackedBlockFactory::Ptr FileBackedBlockFactory::createFromEnvironment()
+  {
+    const char* value = getenv(ENVIRONMENT_VARIABLE); // NOLINT(concurrency-mt-unsafe)
+    if(value == nullptr)
+    {
+      return nullptr;
+    }
+
+    size_t residentLimit = 0;
+    try
+    {
+      residentLimit = boost::lexical_cast<size_t>(value) * 1024 * 1024;
+    }
+    catch(boost::bad_lexical_cast&)
+    {
+      spdlog::warn("{}: Expected a number of MiB, not {}. Not spilling to disk", ENVIRONMENT_VARIABLE, value);
+      return nullptr;
+    }
+
+    const char* directory = getenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+    return create(directory != nullptr ? directory : "/tmp", residentLimit);
+  }
+
+  FileBackedBlockFactory::~FileBackedBlockFactory() { close(fd); }
+
+  BlockInterface::Ptr FileBackedBlockFactory::create(size_t count, size_t size)
+  {
+    const size_t blockSize = roundUp(count * size, systemPageSize());
+
+    size_t offset = 0;
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      offset = fileSize;
+      if(ftruncate(fd, static_cast<off_t>(fileSize + blockSize)) != 0)
+      {
+        throw std::bad_alloc();
+      }
+      fileSize += blockSize;
+    }
+
+    return FileBackedBlockAllocator::create(shared_from_this<FileBackedBlockFactory>(), count, size, offset);
+  }
+
+  size_t FileBackedBlockFactory::getResidentSize()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    return residentSize;
+  }
+
+  void FileBackedBlockFactory::acquire(FileBackedBlockAllocator& block, size_t id)
+  {
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      FileBackedBlockAllocator::PageState& page = block.pages[id];
+      if(page.users == 0)
+      {
+        if(page.resident)
+        {
+          unused.erase(page.position);
+        }
+        else
+        {
+          page.resident = true;
+          residentSize += block.size;
+        }
+      }
+      page.users++;
+    }
+
+    spillExcess();
+  }
+
+  void FileBackedBlockFactory::release(FileBackedBlockAllocator& block, size_t id)
+  {
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      FileBackedBlockAllocator::PageState& page = block.pages[id];
+      require(page.users > 0);
+      page.users--;
+      if(page.users == 0)
+      {
+        page.position = unused.insert(unused.end(), std::make_pair(&block, id));
+      }
+    }
+
+    spillExcess();
+  }
+
+  void FileBackedBlockFactory::forget(FileBackedBlockAllocator& block)
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    for(FileBackedBlockAllocator::PageState& page: block.pages)
+    {
+      if(page.resident)
+      {
+        residentSize -= block.size;
+        if(page.users == 0)
+        {
+          unused.erase(page.position);
+        }
+      }
+    }
+  }
+
+  void FileBackedBlockFactory::spillExcess()
+  {
+    std::vector<std::pair<std::shared_ptr<FileBackedBlockAllocator>, size_t>> victims;
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      while(residentSize > residentLimit && !unused.empty())
+      {
+        auto [block, id] = unused.front();
+        unused.pop_front();
+        block->pages[id].resident = false;
+        residentSize -= block->size;
+
+        // A block that is being destructed doesn't need spilling
+        auto keepAlive = std::dynamic_pointer_cast<FileBackedBlockAllocator>(block->weak_from_this().lock());
+        if(keepAlive)
+        {
+          victims.emplace_back(std::move(keepAlive), id);
+        }
+      }
+    }
+
+    // The pages may be in use again by now, which is harmless
+    for(const auto& [block, id]: victims)
+    {
+      block->spill(id);
+    }
+  }
+
+#else
+
+  FileBackedBlockFactory::Ptr FileBackedBlockFactory::createFromEnvironment()
+  {
+    if(getenv(ENVIRONMENT_VARIABLE) != nullptr) // NOLINT(concurrency-mt-unsafe)
+    {
+      spdlog::warn("{}: Spilling to disk is not supported on this platform", ENVIRONMENT_VARIABLE);
+    }
+    return nullptr;
+  }
+
+#endif
+} // namespace Scroom::MemoryBlocks::Detail
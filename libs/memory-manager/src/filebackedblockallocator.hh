@@ -0,0 +1,97 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/blockallocator.hh>
+#include <scroom/utilities.hh>
+
+namespace Scroom::MemoryBlocks::Detail
+{
+  class FileBackedBlockAllocator;
+
+  /**
+   * Creates blocks that are backed by a sparse temporary file.
+   *
+   * Unlike swap, which is shared with every other process on the
+   * machine, the temporary file only contains our pages. Pages that
+   * are in use are always kept in memory. Once more than the resident
+   * limit is in memory, the least recently used pages that aren't in
+   * use are written to the file and dropped from memory.
+   *
+   * Because the file is mapped shared, dropping a page never loses
+   * its contents. Hence spilling is merely advice to the kernel,
+   * which may be given without holding any locks.
+   */
+  class FileBackedBlockFactory
+    : public BlockFactoryInterface
+    , public virtual Scroom::Utils::Base
+  {
+  public:
+    using Ptr = std::shared_ptr<FileBackedBlockFactory>;
+
+    /** Maximum number of MiB of pages to keep in memory */
+    static const char* const ENVIRONMENT_VARIABLE;
+
+  private:
+    using Lru = std::list<std::pair<FileBackedBlockAllocator*, size_t>>;
+
+    int          fd;
+    size_t       residentLimit;
+    boost::mutex mut; /**< Protects the fields below, and the page state of all blocks */
+    size_t       fileSize{0};
+    size_t       residentSize{0};
+    Lru          unused; /**< Resident pages that are not in use, least recently used first */
+
+  private:
+    FileBackedBlockFactory(int fd, size_t residentLimit);
+
+    void acquire(FileBackedBlockAllocator& block, size_t id);
+    void release(FileBackedBlockAllocator& block, size_t id);
+    void forget(FileBackedBlockAllocator& block);
+    void spillExcess();
+
+  public:
+    /**
+     * Create a factory whose blocks are stored in a file in @c directory
+     *
+     * @return @c nullptr if no file could be created
+     */
+    static Ptr create(const std::string& directory, size_t residentLimit);
+
+    /**
+     * Create a factory as configured by ENVIRONMENT_VARIABLE
+     *
+     * The file is created in $TMPDIR, or /tmp if that isn't set.
+     *
+     * @return @c nullptr if the environment variable isn't set
+     */
+    static Ptr createFromEnvironment();
+
+    ~FileBackedBlockFactory() override;
+    FileBackedBlockFactory(const FileBackedBlockFactory&)            = delete;
+    FileBackedBlockFactory(FileBackedBlockFactory&&)                 = delete;
+    FileBackedBlockFactory& operator=(const FileBackedBlockFactory&) = delete;
+    FileBackedBlockFactory& operator=(FileBackedBlockFactory&&)      = delete;
+
+    BlockInterface::Ptr create(size_t count, size_t size) override;
+
+    /** Number of bytes of pages that are currently kept in memory */
+    size_t getResidentSize();
+
+    friend class FileBackedBlockAllocator;
+  };
+} // namespace Scroom::MemoryBlocks::Detail
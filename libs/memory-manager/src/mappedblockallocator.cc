@@ -0,0 +1,102 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <scroom/blockallocator.hh>
+#include <scroom/utilities.hh>
+
+namespace Scroom::MemoryBlocks
+{
+  namespace Detail
+  {
+    class MappedBlockAllocator
+      : public BlockInterface
+      , public virtual Scroom::Utils::Base
+    {
+    private:
+      size_t                              count;
+      size_t                              size;
+      boost::interprocess::mapped_region region;
+
+    private:
+      MappedBlockAllocator(size_t count, size_t size, boost::interprocess::mapped_region region);
+
+    protected:
+      RawPageData::Ptr get(size_t id) override;
+
+    public:
+      static BlockInterface::Ptr create(const std::string& fileName, size_t offset, size_t count, size_t size);
+      PageList                   getPages() override;
+    };
+
+    MappedBlockAllocator::MappedBlockAllocator(size_t count_, size_t size_, boost::interprocess::mapped_region region_)
+      : count(count_)
+      , size(size_)
+      , region(std::move(region_))
+    {
+    }
+
+    RawPageData::Ptr MappedBlockAllocator::get(size_t id)
+    {
+      if(id >= count)
+      {
+        throw std::out_of_range("");
+      }
+
+      return RawPageData::Ptr(shared_from_this<MappedBlockAllocator>(), static_cast<uint8_t*>(region.get_address()) + id * size);
+    }
+
+    BlockInterface::Ptr MappedBlockAllocator::create(const std::string& fileName, size_t offset, size_t count, size_t size)
+    {
+      try
+      {
+        // The region stays valid after the mapping is closed
+        const boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region      region(
+          mapping, boost::interprocess::copy_on_write, static_cast<boost::interprocess::offset_t>(offset), count * size);
+
+        return BlockInterface::Ptr(new MappedBlockAllocator(count, size, std::move(region)));
+      }
+      catch(boost::interprocess::interprocess_exception& e)
+      {
+        spdlog::warn("Failed to map {}: {}", fileName, e.what());
+        return nullptr;
+      }
+    }
+
+    PageList MappedBlockAllocator::getPages()
+    {
+      BlockInterface::Ptr const me = shared_from_this<BlockInterface>();
+
+      PageList result;
+      for(size_t i = 0; i < count; i++)
+      {
+        result.emplace_back(me, i);
+      }
+
+      return result;
+    }
+  } // namespace Detail
+
+  ////////////////////////////////////////////////////////////////////////
+
+  BlockInterface::Ptr mapFile(const std::string& fileName, size_t offset, size_t count, size_t size)
+  {
+    return Detail::MappedBlockAllocator::create(fileName, offset, count, size);
+  }
+} // namespace Scroom::MemoryBlocks
@@ -0,0 +1,191 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <map>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/memoryaccounting.hh>
+#include <scroom/memoryblobs.hh>
+
+namespace Scroom::MemoryBlobs::Accounting
+{
+  namespace
+  {
+    boost::mutex                         categoriesMut;
+    std::map<std::string, Category::Ptr> categories; /**< Protected by categoriesMut */
+    const std::memory_order              relaxed = std::memory_order_relaxed;
+
+    const double MiB = 1024.0 * 1024.0;
+
+    template <typename T>
+    void add(std::atomic<T>& counter, ptrdiff_t delta)
+    {
+      counter.fetch_add(static_cast<T>(delta), relaxed);
+    }
+
+    void accumulate(Usage& total, const Usage& u)
+    {
+      total.blobs += u.blobs;
+      total.resident += u.resident;
+      total.referenced += u.referenced;
+      total.uncompressed += u.uncompressed;
+      total.compressed += u.compressed;
+      total.compressions += u.compressions;
+      total.decompressions += u.decompressions;
+      total.bytesCompressed += u.bytesCompressed;
+      total.bytesDecompressed += u.bytesDecompressed;
+    }
+
+    std::string describe(const Usage& u)
+    {
+      return fmt::format("{}: {} blobs, {:.1f} MiB resident ({:.1f} MiB referenced), {:.1f} MiB compressed (ratio {:.1f})",
+                         u.name,
+                         u.blobs,
+                         u.resident / MiB,
+                         u.referenced / MiB,
+                         u.compressed / MiB,
+                         u.compressionRatio());
+    }
+  } // namespace
+
+  ////////////////////////////////////////////////////////////////////////
+
+  double Usage::compressionRatio() const
+  {
+    if(compressed == 0)
+    {
+      return 0.0;
+    }
+    return static_cast<double>(uncompressed) / static_cast<double>(compressed);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  Category::Category(std::string name_)
+    : name(std::move(name_))
+  {
+  }
+
+  void Category::blobCreated() { blobs.fetch_add(1, relaxed); }
+
+  void Category::blobDestroyed() { blobs.fetch_sub(1, relaxed); }
+
+  void Category::addResident(ptrdiff_t delta) { add(resident, delta); }
+
+  void Category::addReferenced(ptrdiff_t delta) { add(referenced, delta); }
+
+  void Category::addCompressed(ptrdiff_t uncompressedDelta, ptrdiff_t compressedDelta)
+  {
+    add(uncompressed, uncompressedDelta);
+    add(compressed, compressedDelta);
+  }
+
+  void Category::recordCompression(size_t bytes)
+  {
+    compressions.fetch_add(1, relaxed);
+    bytesCompressed.fetch_add(bytes, relaxed);
+  }
+
+  void Category::recordDecompression(size_t bytes)
+  {
+    decompressions.fetch_add(1, relaxed);
+    bytesDecompressed.fetch_add(bytes, relaxed);
+  }
+
+  Usage Category::getUsage() const
+  {
+    Usage result;
+    result.name              = name;
+    result.blobs             = blobs.load(relaxed);
+    result.resident          = resident.load(relaxed);
+    result.referenced        = referenced.load(relaxed);
+    result.uncompressed      = uncompressed.load(relaxed);
+    result.compressed        = compressed.load(relaxed);
+    result.compressions      = compressions.load(relaxed);
+    result.decompressions    = decompressions.load(relaxed);
+    result.bytesCompressed   = bytesCompressed.load(relaxed);
+    result.bytesDecompressed = bytesDecompressed.load(relaxed);
+    return result;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  Statistics::Rates Statistics::ratesSince(const Statistics& earlier) const
+  {
+    Rates        result;
+    const double seconds = std::chrono::duration<double>(timestamp - earlier.timestamp).count();
+    if(seconds > 0)
+    {
+      result.compressed   = static_cast<double>(total.bytesCompressed - earlier.total.bytesCompressed) / seconds;
+      result.decompressed = static_cast<double>(total.bytesDecompressed - earlier.total.bytesDecompressed) / seconds;
+    }
+    return result;
+  }
+
+  std::string Statistics::toString() const
+  {
+    std::string result = fmt::format("Pages: {} of {} free, {:.1f} MiB allocated\n{}",
+                                     freePages,
+                                     pages,
+                                     pageBytes / MiB,
+                                     describe(total));
+    for(const Usage& u: categories)
+    {
+      result += "\n  " + describe(u);
+    }
+    return result;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+
+  Category::Ptr getCategory(const std::string& name)
+  {
+    boost::mutex::scoped_lock const lock(categoriesMut);
+    Category::Ptr&                  result = categories[name];
+    if(!result)
+    {
+      result = std::make_shared<Category>(name);
+    }
+    return result;
+  }
+
+  Category::Ptr defaultCategory()
+  {
+    static Category::Ptr const instance = getCategory("Other");
+    return instance;
+  }
+
+  Statistics getStatistics()
+  {
+    Statistics result;
+    result.timestamp  = Statistics::Clock::now();
+    result.total.name = "Total";
+
+    {
+      boost::mutex::scoped_lock const lock(categoriesMut);
+      for(const auto& [name, category]: categories)
+      {
+        result.categories.push_back(category->getUsage());
+        accumulate(result.total, result.categories.back());
+      }
+    }
+
+    for(const PageProvider::Ptr& provider: PageProvider::all())
+    {
+      const size_t pages = provider->getPageCount();
+      result.pages += pages;
+      result.freePages += provider->getFreePageCount();
+      result.pageBytes += pages * provider->getPageSize();
+    }
+
+    return result;
+  }
+} // namespace Scroom::MemoryBlobs::Accounting
@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <list>
+#include <tuple>
 #include <utility>
 
 #include <fmt/format.h>
@@ -18,6 +19,7 @@
 #include <scroom/blockallocator.hh>
 #include <scroom/memoryblobs.hh>
 #include <scroom/threadpool.hh>
+#include <scroom/trace.hh>
 
 #include "blob-compression.hh"
 
@@ -27,16 +29,49 @@ using namespace Scroom::MemoryBlocks;
 
 namespace Scroom::MemoryBlobs
 {
+  namespace
+  {
+    boost::mutex                           providersMut;
+    std::list<std::weak_ptr<PageProvider>> providers; /**< Protected by providersMut */
+
+    ptrdiff_t signedSize(size_t size) { return static_cast<ptrdiff_t>(size); }
+  } // namespace
+
   PageProvider::PageProvider(size_t blockCount_, size_t blockSize_)
     : blockCount(blockCount_)
     , blockSize(blockSize_)
     , blockFactoryInterface(getBlockFactoryInterface())
+    , codec(getDefaultCodec())
   {
   }
 
   PageProvider::Ptr PageProvider::create(size_t blockCount, size_t blockSize)
   {
-    return Ptr(new PageProvider(blockCount, blockSize));
+    Ptr result(new PageProvider(blockCount, blockSize));
+
+    boost::mutex::scoped_lock const lock(providersMut);
+    providers.push_back(result);
+    return result;
+  }
+
+  std::vector<PageProvider::Ptr> PageProvider::all()
+  {
+    std::vector<Ptr> result;
+
+    boost::mutex::scoped_lock const lock(providersMut);
+    for(auto cur = providers.begin(); cur != providers.end();)
+    {
+      if(Ptr provider = cur->lock())
+      {
+        result.push_back(std::move(provider));
+        ++cur;
+      }
+      else
+      {
+        cur = providers.erase(cur);
+      }
+    }
+    return result;
   }
 
   Page::Ptr PageProvider::getFreePage()
@@ -60,6 +95,22 @@ namespace Scroom::MemoryBlobs
 
   size_t PageProvider::getPageSize() const { return blockSize; }
 
+  size_t PageProvider::getPageCount()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    return allPages.size();
+  }
+
+  size_t PageProvider::getFreePageCount()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    return freePages.size();
+  }
+
+  void PageProvider::setCodec(Codec codec_) { codec = codec_; }
+
+  Codec PageProvider::getCodec() const { return codec; }
+
   void PageProvider::markPageFree(Scroom::MemoryBlocks::Page* p)
   {
     boost::mutex::scoped_lock const lock(mut);
@@ -68,14 +119,60 @@ namespace Scroom::MemoryBlobs
 
   ////////////////////////////////////////////////////////////////////////
 
-  Blob::Ptr Blob::create(PageProvider::Ptr provider, size_t size) { return Ptr(new Blob(std::move(provider), size)); }
+  Blob::Ptr Blob::create(PageProvider::Ptr provider, size_t size, Accounting::Category::Ptr category)
+  {
+    return Ptr(new Blob(std::move(provider), size, std::move(category)));
+  }
+
+  Blob::Ptr Blob::create(PageProvider::Ptr provider, size_t size, Codec codec, PageList pages, Accounting::Category::Ptr category)
+  {
+    return Ptr(new Blob(std::move(provider), size, codec, std::move(pages), std::move(category)));
+  }
+
+  Blob::Blob(PageProvider::Ptr provider_, size_t size_, Accounting::Category::Ptr category_)
+    : provider(std::move(provider_))
+    , size(size_)
+    , cpuBound(CpuBound())
+    , category(category_ ? std::move(category_) : Accounting::defaultCategory())
+  {
+    category->blobCreated();
+  }
 
-  Blob::Blob(PageProvider::Ptr provider_, size_t size_)
+  Blob::Blob(PageProvider::Ptr provider_, size_t size_, Codec codec_, PageList pages_, Accounting::Category::Ptr category_)
     : provider(std::move(provider_))
     , size(size_)
+    , state(CLEAN)
+    , codec(codec_)
     , cpuBound(CpuBound())
+    , category(category_ ? std::move(category_) : Accounting::defaultCategory())
+  {
+    category->blobCreated();
+    setPages(std::move(pages_));
+  }
+
+  Blob::~Blob()
+  {
+    if(data != nullptr)
+    {
+      freeData();
+    }
+    setPages({});
+    category->blobDestroyed();
+  }
 
+  void Blob::setPages(PageList newPages)
   {
+    const size_t pageSize = provider->getPageSize();
+    category->addCompressed(pages.empty() ? 0 : -signedSize(size), -signedSize(pages.size() * pageSize));
+    pages = std::move(newPages);
+    category->addCompressed(pages.empty() ? 0 : signedSize(size), signedSize(pages.size() * pageSize));
+  }
+
+  void Blob::freeData()
+  {
+    free(data);
+    data = nullptr;
+    category->addResident(-signedSize(size));
   }
 
   RawPageData::Ptr Blob::load()
@@ -88,12 +185,18 @@ namespace Scroom::MemoryBlobs
       case UNINITIALIZED:
         // Allocate new data
         data = static_cast<uint8_t*>(malloc(size * sizeof(uint8_t)));
+        category->addResident(signedSize(size));
         break;
       case CLEAN:
+      {
         // Decompress data
+        Scroom::Utils::Trace::Span const span("Blob::load");
         data = static_cast<uint8_t*>(malloc(size * sizeof(uint8_t)));
-        Detail::decompressBlob(data, size, pages, provider);
+        category->addResident(signedSize(size));
+        Detail::decompressBlob(data, size, pages, provider, codec);
+        category->recordDecompression(size);
         break;
+      }
       case DIRTY:
         break;
       case COMPRESSING:
@@ -109,6 +212,7 @@ namespace Scroom::MemoryBlobs
       result   = RawPageData::Ptr(data, UnloadData(shared_from_this<Blob>()));
       weakData = result;
       refcount++;
+      category->addReferenced(signedSize(size));
     }
 
     return result;
@@ -118,6 +222,7 @@ namespace Scroom::MemoryBlobs
   {
     boost::mutex::scoped_lock const lock(mut);
     refcount--;
+    category->addReferenced(-signedSize(size));
     if(refcount == 0)
     {
       if(state == DIRTY)
@@ -127,8 +232,7 @@ namespace Scroom::MemoryBlobs
       }
       else
       {
-        free(data);
-        data = nullptr;
+        freeData();
       }
     }
   }
@@ -140,9 +244,12 @@ namespace Scroom::MemoryBlobs
     {
       require(refcount == 0);
 
-      pages = Detail::compressBlob(data, size, provider);
-      free(data);
-      data = nullptr;
+      Scroom::Utils::Trace::Span const span("Blob::compress");
+      PageList                         compressed;
+      std::tie(codec, compressed) = Detail::compressBlob(data, size, provider, provider->getCodec());
+      setPages(std::move(compressed));
+      category->recordCompression(size);
+      freeData();
 
       state = CLEAN;
     }
@@ -170,4 +277,21 @@ namespace Scroom::MemoryBlobs
     boost::mutex::scoped_lock const lock(mut);
     return load();
   }
+
+  std::pair<Codec, PageList> Blob::getCompressed()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    switch(state)
+    {
+    case CLEAN:
+      return {codec, pages};
+    case DIRTY:
+    case COMPRESSING:
+      // Leave our own state alone. Someone may still be using the data
+      return Detail::compressBlob(data, size, provider, provider->getCodec());
+    case UNINITIALIZED:
+    default:
+      return {Codec::RAW, {}};
+    }
+  }
 } // namespace Scroom::MemoryBlobs
@@ -15,6 +15,8 @@
 #include <scroom/blockallocator.hh>
 #include <scroom/utilities.hh>
 
+#include "filebackedblockallocator.hh"
+
 namespace Scroom::MemoryBlocks
 {
   namespace Detail
@@ -111,7 +113,15 @@ namespace Scroom::MemoryBlocks
 
   BlockFactoryInterface::Ptr getBlockFactoryInterface()
   {
-    static BlockFactoryInterface::Ptr const instance = Detail::SwapBasedBlockAllocatorFactory::create();
+    static BlockFactoryInterface::Ptr const instance = []() -> BlockFactoryInterface::Ptr
+    {
+      BlockFactoryInterface::Ptr result = Detail::FileBackedBlockFactory::createFromEnvironment();
+      if(!result)
+      {
+        result = Detail::SwapBasedBlockAllocatorFactory::create();
+      }
+      return result;
+    }();
     return instance;
   }
 } // namespace Scroom::MemoryBlocks
@@ -0,0 +1,97 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <scroom/memoryaccounting.hh>
+#include <scroom/memoryblobs.hh>
+
+//////////////////////////////////////////////////////////////
+
+using namespace Scroom::MemoryBlobs;
+
+namespace
+{
+  /** Blobs are compressed in the background, so the test has to wait for that */
+  bool compresses(const Accounting::Category::Ptr& category, uint64_t count)
+  {
+    for(int i = 0; i < 200; i++)
+    {
+      const Accounting::Usage usage = category->getUsage();
+      if(usage.compressions == count && usage.resident == 0)
+      {
+        return true;
+      }
+      boost::this_thread::sleep(boost::posix_time::millisec(10));
+    }
+    return false;
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(Accounting_Tests)
+
+BOOST_AUTO_TEST_CASE(blobs_account_for_their_memory)
+{
+  const size_t                    blobSize = 16 * 1024;
+  const Accounting::Category::Ptr category = Accounting::getCategory("blobs_account_for_their_memory");
+  const PageProvider::Ptr         provider = PageProvider::create(16, 64);
+
+  Blob::Ptr blob = Blob::create(provider, blobSize, category);
+  BOOST_CHECK_EQUAL(1U, category->getUsage().blobs);
+  BOOST_CHECK_EQUAL(0U, category->getUsage().resident);
+
+  {
+    RawPageData::Ptr const data = blob->initialize(42);
+    Accounting::Usage      usage = category->getUsage();
+    BOOST_CHECK_EQUAL(blobSize, usage.resident);
+    BOOST_CHECK_EQUAL(blobSize, usage.referenced);
+    BOOST_CHECK_EQUAL(0U, usage.compressed);
+  }
+
+  BOOST_REQUIRE(compresses(category, 1));
+  Accounting::Usage usage = category->getUsage();
+  BOOST_CHECK_EQUAL(0U, usage.referenced);
+  BOOST_CHECK_EQUAL(blobSize, usage.uncompressed);
+  BOOST_CHECK_GT(usage.compressed, 0U);
+  BOOST_CHECK_GT(usage.compressionRatio(), 1.0);
+
+  {
+    RawPageData::ConstPtr const data = blob->getConst();
+    usage                            = category->getUsage();
+    BOOST_CHECK_EQUAL(blobSize, usage.resident);
+    BOOST_CHECK_EQUAL(1U, usage.decompressions);
+    BOOST_CHECK_EQUAL(blobSize, usage.bytesDecompressed);
+  }
+
+  blob.reset();
+  usage = category->getUsage();
+  BOOST_CHECK_EQUAL(0U, usage.blobs);
+  BOOST_CHECK_EQUAL(0U, usage.resident);
+  BOOST_CHECK_EQUAL(0U, usage.compressed);
+}
+
+BOOST_AUTO_TEST_CASE(statistics_include_pages_and_categories)
+{
+  const Accounting::Category::Ptr category = Accounting::getCategory("statistics_include_pages_and_categories");
+  const PageProvider::Ptr         provider = PageProvider::create(16, 64);
+  Page::Ptr const                 page     = provider->getFreePage();
+
+  const Accounting::Statistics statistics = Accounting::getStatistics();
+  BOOST_CHECK_GE(statistics.pages, 16U);
+  BOOST_CHECK_GE(statistics.pageBytes, 16U * 64);
+  BOOST_CHECK_LT(statistics.freePages, statistics.pages);
+
+  bool found = false;
+  for(const Accounting::Usage& u: statistics.categories)
+  {
+    found = found || u.name == "statistics_include_pages_and_categories";
+  }
+  BOOST_CHECK(found);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
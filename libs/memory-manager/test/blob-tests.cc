@@ -128,4 +128,40 @@ BOOST_AUTO_TEST_CASE(blobs_can_be_initialized)
   BOOST_CHECK(!memcmp(expected, raw.get(), blobSize));
 }
 
+BOOST_AUTO_TEST_CASE(blobs_can_be_recreated_from_compressed_data)
+{
+  const size_t blobSize   = 16 * 1024;
+  const size_t blockCount = 16;
+  const size_t blockSize  = 64;
+
+  PageProvider::Ptr const provider = PageProvider::create(blockCount, blockSize);
+
+  Blob::Ptr const original = Blob::create(provider, blobSize);
+  BOOST_CHECK(original->getCompressed().second.empty());
+
+  uint8_t expected[blobSize];
+  {
+    RawPageData::Ptr const raw = original->get();
+    for(size_t i = 0; i < blobSize; i++)
+    {
+      raw.get()[i] = static_cast<uint8_t>(i / 64);
+    }
+    memcpy(expected, raw.get(), blobSize);
+  }
+
+  auto [codec, pages] = original->getCompressed();
+  BOOST_CHECK(!pages.empty());
+
+  Blob::Ptr const copy = Blob::create(provider, blobSize, codec, pages);
+  {
+    RawPageData::ConstPtr const raw = copy->getConst();
+    BOOST_REQUIRE(raw.get());
+    BOOST_CHECK(!memcmp(expected, raw.get(), blobSize));
+  }
+
+  const auto recompressed = copy->getCompressed();
+  BOOST_CHECK(codec == recompressed.first);
+  BOOST_CHECK(pages == recompressed.second);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
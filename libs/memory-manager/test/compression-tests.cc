@@ -6,6 +6,8 @@
  */
 
 #include <cstring>
+#include <random>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -62,4 +64,85 @@ BOOST_AUTO_TEST_CASE(compression_decompression_retains_data_with_large_blocks)
   BOOST_CHECK(!memcmp(in, out, blobSize));
 }
 
+namespace
+{
+  std::vector<uint8_t> createGradient(size_t size)
+  {
+    std::vector<uint8_t> result(size);
+    for(size_t i = 0; i < size; i++)
+    {
+      result[i] = i / 256 + i % 256;
+    }
+    return result;
+  }
+
+  std::vector<uint8_t> createNoise(size_t size)
+  {
+    std::mt19937                       generator(42); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<uint8_t> result(size);
+    for(uint8_t& value: result)
+    {
+      value = static_cast<uint8_t>(distribution(generator));
+    }
+    return result;
+  }
+
+  void verifyRoundTrip(const std::vector<uint8_t>& in, Codec requested)
+  {
+    PageProvider::Ptr const provider = PageProvider::create(16, 64);
+
+    const auto [codec, l] = compressBlob(in.data(), in.size(), provider, requested);
+    BOOST_CHECK(isAvailable(codec));
+    BOOST_CHECK(codec != Codec::AUTO);
+
+    std::vector<uint8_t> out(in.size());
+    decompressBlob(out.data(), out.size(), l, provider, codec);
+
+    BOOST_CHECK(in == out);
+  }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(all_codecs_retain_data)
+{
+  for(const Codec codec: {Codec::AUTO, Codec::RAW, Codec::ZLIB, Codec::LZ4, Codec::ZSTD})
+  {
+    BOOST_TEST_CONTEXT("Codec " << to_string(codec))
+    {
+      verifyRoundTrip(createGradient(16 * 1024), codec);
+      verifyRoundTrip(createNoise(16 * 1024), codec);
+      verifyRoundTrip(createGradient(100), codec);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(incompressible_data_is_stored_raw)
+{
+  const std::vector<uint8_t> noise = createNoise(16 * 1024);
+
+  BOOST_CHECK_GT(estimateEntropy(noise.data(), noise.size()), 7.5);
+  BOOST_CHECK(Codec::RAW == chooseCodec(noise.data(), noise.size(), Codec::AUTO));
+
+  PageProvider::Ptr const provider = PageProvider::create(16, 64);
+  BOOST_CHECK(Codec::RAW == compressBlob(noise.data(), noise.size(), provider, Codec::ZLIB).first);
+}
+
+BOOST_AUTO_TEST_CASE(regular_data_is_compressed)
+{
+  const std::vector<uint8_t> gradient = createGradient(16 * 1024);
+
+  BOOST_CHECK_LT(estimateEntropy(gradient.data(), gradient.size()), 1.0);
+  BOOST_CHECK(Codec::RAW != chooseCodec(gradient.data(), gradient.size(), Codec::AUTO));
+}
+
+BOOST_AUTO_TEST_CASE(codec_names_can_be_parsed)
+{
+  for(const Codec codec: {Codec::AUTO, Codec::RAW, Codec::ZLIB, Codec::LZ4, Codec::ZSTD})
+  {
+    BOOST_CHECK(codec == codecFromString(to_string(codec)));
+  }
+  BOOST_CHECK(!codecFromString("bogus"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
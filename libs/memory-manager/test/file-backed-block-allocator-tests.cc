@@ -0,0 +1,133 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/blockallocator.hh>
+
+#include "filebackedblockallocator.hh"
+
+//////////////////////////////////////////////////////////////
+
+using namespace Scroom::MemoryBlocks;
+using Scroom::MemoryBlocks::Detail::FileBackedBlockFactory;
+
+namespace
+{
+  const size_t size  = 16 * 1024;
+  const size_t count = 16;
+
+  FileBackedBlockFactory::Ptr createFactory(size_t residentLimit)
+  {
+    FileBackedBlockFactory::Ptr result =
+      FileBackedBlockFactory::create(boost::filesystem::temp_directory_path().string(), residentLimit);
+    BOOST_REQUIRE(result);
+    return result;
+  }
+
+  void fill(PageList& pages)
+  {
+    uint8_t data = 0;
+    for(Page& p: pages)
+    {
+      RawPageData::Ptr const raw = p.get();
+      BOOST_REQUIRE(raw.get());
+
+      memset(raw.get(), data, size);
+      data++;
+    }
+  }
+
+  void check(PageList& pages)
+  {
+    uint8_t              data = 0;
+    std::vector<uint8_t> expected(size);
+    for(Page& p: pages)
+    {
+      RawPageData::Ptr const raw = p.get();
+      BOOST_REQUIRE(raw.get());
+
+      memset(expected.data(), data, size);
+      BOOST_CHECK(!memcmp(expected.data(), raw.get(), size));
+      data++;
+    }
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(File_backed_Block_Allocator_Tests)
+
+BOOST_AUTO_TEST_CASE(allocator_provides_a_number_of_independent_blocks_of_a_given_size)
+{
+  FileBackedBlockFactory::Ptr const factory = createFactory(count * size);
+  BlockInterface::Ptr               bi      = factory->create(count, size);
+
+  PageList pages = bi->getPages();
+  BOOST_CHECK_EQUAL(count, pages.size());
+
+  bi.reset();
+
+  fill(pages);
+  check(pages);
+}
+
+BOOST_AUTO_TEST_CASE(spilled_pages_keep_their_contents)
+{
+  FileBackedBlockFactory::Ptr const factory = createFactory(0);
+  PageList                          pages   = factory->create(count, size)->getPages();
+  PageList                          more    = factory->create(count, size)->getPages();
+  pages.splice(pages.end(), more);
+
+  fill(pages);
+  BOOST_CHECK_EQUAL(0U, factory->getResidentSize());
+  check(pages);
+}
+
+BOOST_AUTO_TEST_CASE(resident_pages_stay_within_limit)
+{
+  FileBackedBlockFactory::Ptr const factory = createFactory(2 * size);
+  PageList                          pages   = factory->create(count, size)->getPages();
+  fill(pages);
+  BOOST_CHECK_EQUAL(2 * size, factory->getResidentSize());
+
+  // Using a spilled page makes another one spill
+  pages.front().get();
+  BOOST_CHECK_EQUAL(2 * size, factory->getResidentSize());
+  check(pages);
+}
+
+BOOST_AUTO_TEST_CASE(pages_in_use_are_not_spilled)
+{
+  FileBackedBlockFactory::Ptr const factory = createFactory(0);
+  PageList                          pages   = factory->create(count, size)->getPages();
+
+  std::vector<RawPageData::Ptr> inUse;
+  for(Page& p: pages)
+  {
+    inUse.push_back(p.get());
+  }
+  BOOST_CHECK_EQUAL(count * size, factory->getResidentSize());
+
+  inUse.clear();
+  BOOST_CHECK_EQUAL(0U, factory->getResidentSize());
+}
+
+BOOST_AUTO_TEST_CASE(destroying_blocks_releases_resident_pages)
+{
+  FileBackedBlockFactory::Ptr const factory = createFactory(count * size);
+  {
+    PageList pages = factory->create(count, size)->getPages();
+    fill(pages);
+    BOOST_CHECK_EQUAL(count * size, factory->getResidentSize());
+  }
+  BOOST_CHECK_EQUAL(0U, factory->getResidentSize());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
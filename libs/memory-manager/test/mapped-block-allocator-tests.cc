@@ -0,0 +1,100 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/blockallocator.hh>
+
+//////////////////////////////////////////////////////////////
+
+using namespace Scroom::MemoryBlocks;
+
+namespace
+{
+  /** A file that is removed when it goes out of scope */
+  class TemporaryFile
+  {
+  public:
+    const std::string name{(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()};
+
+    explicit TemporaryFile(const std::vector<char>& contents)
+    {
+      std::ofstream out(name, std::ios::binary);
+      out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    TemporaryFile(const TemporaryFile&)            = delete;
+    TemporaryFile(TemporaryFile&&)                 = delete;
+    TemporaryFile& operator=(const TemporaryFile&) = delete;
+    TemporaryFile& operator=(TemporaryFile&&)      = delete;
+
+    ~TemporaryFile() { boost::filesystem::remove(name); }
+  };
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(Mapped_Block_Allocator_Tests)
+
+BOOST_AUTO_TEST_CASE(pages_contain_the_file_contents)
+{
+  const size_t size   = 64;
+  const size_t count  = 4;
+  const size_t offset = 10;
+
+  std::vector<char> contents(offset + count * size);
+  for(size_t i = 0; i < contents.size(); i++)
+  {
+    contents[i] = static_cast<char>(i * 7);
+  }
+  const TemporaryFile file(contents);
+
+  BlockInterface::Ptr bi = mapFile(file.name, offset, count, size);
+  BOOST_REQUIRE(bi);
+
+  PageList pages = bi->getPages();
+  BOOST_CHECK_EQUAL(count, pages.size());
+  bi.reset();
+
+  size_t i = 0;
+  for(Page& p: pages)
+  {
+    RawPageData::Ptr const raw = p.get();
+    BOOST_REQUIRE(raw.get());
+    BOOST_CHECK(!memcmp(contents.data() + offset + i * size, raw.get(), size));
+    i++;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(changing_pages_leaves_the_file_alone)
+{
+  const std::vector<char> contents(128, 'x');
+  const TemporaryFile     file(contents);
+
+  {
+    BlockInterface::Ptr const bi = mapFile(file.name, 0, 2, 64);
+    BOOST_REQUIRE(bi);
+    memset(bi->getPages().front().get().get(), 'y', 64);
+  }
+
+  std::ifstream     in(file.name, std::ios::binary);
+  std::vector<char> actual(contents.size());
+  in.read(actual.data(), static_cast<std::streamsize>(actual.size()));
+  BOOST_CHECK(actual == contents);
+}
+
+BOOST_AUTO_TEST_CASE(missing_files_cannot_be_mapped)
+{
+  BOOST_CHECK(!mapFile((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string(), 0, 1, 64));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <scroom/memoryblobs.hh>
+
+#include "blob-compression.hh"
+
+using namespace Scroom::MemoryBlobs;
+
+namespace
+{
+  const size_t TILESIZE    = 4096;
+  const int    REPETITIONS = 5;
+
+  struct TestTile
+  {
+    std::string          name;
+    std::vector<uint8_t> data;
+  };
+
+  /** Black text-like blocks on a white background, with some noise */
+  TestTile create1bpp()
+  {
+    std::mt19937         generator(1); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> data(TILESIZE * TILESIZE / 8);
+    for(size_t y = 0; y < TILESIZE; y++)
+    {
+      for(size_t x = 0; x < TILESIZE / 8; x++)
+      {
+        const bool inGlyph = (y / 12) % 2 == 0 && (x / 2) % 3 != 0;
+        data[y * TILESIZE / 8 + x] = inGlyph ? static_cast<uint8_t>(generator()) : 0;
+      }
+    }
+    return {"1bpp", data};
+  }
+
+  /** A smooth gradient, with some noise in the least significant bits */
+  TestTile create8bpp()
+  {
+    std::mt19937         generator(8); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> data(TILESIZE * TILESIZE);
+    for(size_t y = 0; y < TILESIZE; y++)
+    {
+      for(size_t x = 0; x < TILESIZE; x++)
+      {
+        data[y * TILESIZE + x] = static_cast<uint8_t>(((x + y) / 32) ^ (generator() & 0x3));
+      }
+    }
+    return {"8bpp", data};
+  }
+
+  /** Four independent gradients, interleaved as CMYK */
+  TestTile createCmyk()
+  {
+    std::mt19937         generator(32); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> data(TILESIZE * TILESIZE * 4);
+    for(size_t y = 0; y < TILESIZE; y++)
+    {
+      for(size_t x = 0; x < TILESIZE; x++)
+      {
+        uint8_t* pixel = &data[(y * TILESIZE + x) * 4];
+        pixel[0]       = static_cast<uint8_t>(x / 16);
+        pixel[1]       = static_cast<uint8_t>(y / 16);
+        pixel[2]       = static_cast<uint8_t>((x + y) / 32);
+        pixel[3]       = static_cast<uint8_t>((x / 256) % 2 ? generator() & 0x7 : 0);
+      }
+    }
+    return {"CMYK", data};
+  }
+
+  /** Random data, which can't be compressed */
+  TestTile createNoise()
+  {
+    std::mt19937         generator(0); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> data(TILESIZE * TILESIZE);
+    for(uint8_t& value: data)
+    {
+      value = static_cast<uint8_t>(generator());
+    }
+    return {"noise", data};
+  }
+
+  double measure(const std::function<void()>& f)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < REPETITIONS; i++)
+    {
+      f();
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / REPETITIONS;
+  }
+
+  void measure(const TestTile& tile, Codec requested)
+  {
+    PageProvider::Ptr const provider  = PageProvider::create(1024, 4096);
+    const size_t            size      = tile.data.size();
+    const double            megabytes = static_cast<double>(size) / 1024 / 1024;
+
+    std::pair<Codec, PageList> compressed;
+    const double               compressTime =
+      measure([&] { compressed = Detail::compressBlob(tile.data.data(), size, provider, requested); });
+
+    std::vector<uint8_t> out(size);
+    const double         decompressTime =
+      measure([&] { Detail::decompressBlob(out.data(), size, compressed.second, provider, compressed.first); });
+
+    if(out != tile.data)
+    {
+      fmt::print("{:6} {:6}: Data was corrupted\n", tile.name, to_string(requested));
+      return;
+    }
+
+    const double ratio = static_cast<double>(size) / static_cast<double>(compressed.second.size() * provider->getPageSize());
+    fmt::print("{:6} {:6} {:6} {:8.1f} {:10.0f} {:12.0f}\n",
+               tile.name,
+               to_string(requested),
+               to_string(compressed.first),
+               ratio,
+               megabytes / compressTime,
+               megabytes / decompressTime);
+  }
+} // namespace
+
+int main()
+{
+  const std::vector<TestTile> tiles = {create1bpp(), create8bpp(), createCmyk(), createNoise()};
+
+  fmt::print("{:6} {:6} {:6} {:>8} {:>10} {:>12}\n", "Tile", "Codec", "Used", "Ratio", "Comp MB/s", "Decomp MB/s");
+  for(const TestTile& tile: tiles)
+  {
+    for(const Codec codec: {Codec::AUTO, Codec::RAW, Codec::ZLIB, Codec::LZ4, Codec::ZSTD})
+    {
+      if(isAvailable(codec))
+      {
+        measure(tile, codec);
+      }
+    }
+  }
+
+  return 0;
+}
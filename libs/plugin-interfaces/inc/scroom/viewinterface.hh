@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <memory>
@@ -69,11 +70,22 @@ public:
   [[nodiscard]] double width() const { return abs(end.x - start.x); }
   [[nodiscard]] double height() const { return abs(end.y - start.y); }
   [[nodiscard]] double length() const { return std::hypot(width(), height()); }
+
+  /** @return The smallest rectangle containing both @c start and @c end */
+  [[nodiscard]] Scroom::Utils::Rectangle<double> boundingBox() const
+  {
+    return Scroom::Utils::make_rect_from_start_end(Point(std::min(start.x, end.x), std::min(start.y, end.y)),
+                                                   Point(std::max(start.x, end.x), std::max(start.y, end.y)));
+  }
 };
 
 /**
  * Interface provided to something that wants to
  * draw on top of the current presentation.
+ *
+ * The view keeps what was drawn around, so whenever what you draw
+ * changes, call ViewInterface::invalidateArea() for both the old and
+ * the new area.
  */
 class PostRenderer : private Interface
 {
@@ -201,6 +213,22 @@ public:
    */
   virtual void invalidate() = 0;
 
+  /**
+   * Request that part of the window content is redrawn.
+   *
+   * Views that keep the previously drawn content around can use this
+   * to redraw only what has changed. By default, the entire window
+   * content is redrawn.
+   *
+   * @param presentationArea The area that changed, in presentation
+   *    coordinates
+   *
+   * @pre Should be called from within a Gdk critical section
+   *    (i.e. between gdk_threads_enter() and gdk_threads_leave()
+   *    calls)
+   */
+  virtual void invalidateArea(Scroom::Utils::Rectangle<double> /*presentationArea*/) { invalidate(); }
+
   /**
    * Return a pointer to the progess interface associated with the View
    *
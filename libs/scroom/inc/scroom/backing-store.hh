@@ -0,0 +1,78 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <cairo.h>
+
+#include <scroom/point.hh>
+#include <scroom/rectangle.hh>
+
+/**
+ * Keeps the rendered content of a view around between redraws.
+ *
+ * When the view scrolls, the pixels that are still visible are moved,
+ * and only the newly exposed strips are rendered. Areas that were
+ * invalidated in the mean time are rendered again as well.
+ */
+class BackingStore
+{
+public:
+  /**
+   * Render (part of) the view.
+   *
+   * @param cr The context to draw on. Its origin is the top-left corner
+   *    of the view, and it is clipped to the part that needs rendering.
+   * @param presentationArea The area of the presentation that is
+   *    visible in the view.
+   */
+  using Renderer = std::function<void(cairo_t* cr, Scroom::Utils::Rectangle<double> presentationArea)>;
+
+private:
+  cairo_surface_t*                              surface{nullptr};
+  cairo_surface_t*                              spare{nullptr};
+  Scroom::Utils::Point<int>                     size;
+  Scroom::Utils::Point<double>                  position;
+  int                                           zoom{0};
+  bool                                          valid{false};
+  std::vector<Scroom::Utils::Rectangle<double>> dirtyAreas;
+
+public:
+  BackingStore() = default;
+  ~BackingStore();
+  BackingStore(const BackingStore&)            = delete;
+  BackingStore(BackingStore&&)                 = delete;
+  BackingStore& operator=(const BackingStore&) = delete;
+  BackingStore& operator=(BackingStore&&)      = delete;
+
+  /** Discard all stored content */
+  void invalidate();
+
+  /** Discard the stored content for the given area of the presentation */
+  void invalidate(Scroom::Utils::Rectangle<double> presentationArea);
+
+  /**
+   * Draw the view on @c cr, rendering only the parts that aren't stored
+   *
+   * @param cr The context to draw on
+   * @param position_ The presentation coordinate of the top-left pixel
+   * @param size_ The size of the view, in pixels
+   * @param zoom_ The zoom level
+   * @param render Renders the parts that aren't stored
+   */
+  void redraw(cairo_t*                     cr,
+              Scroom::Utils::Point<double> position_,
+              Scroom::Utils::Point<int>    size_,
+              int                          zoom_,
+              const Renderer&              render);
+
+private:
+  void reset();
+};
@@ -45,17 +45,22 @@ namespace Detail
     using Ptr = std::shared_ptr<ViewData>;
 
   public:
-    Scroom::Utils::Rectangle<double>   presentationArea;
-    int                                zoom{0};
+    /**
+     * Scratch surface the untransformed presentation is drawn on,
+     * before it is scaled. Reused across redraws, and only reallocated
+     * when it is too small.
+     */
     Scroom::Bitmap::BitmapSurface::Ptr image;
     ViewInterface::WeakPtr             weakParent;
+    TransformationData::Ptr            transformationData;
 
   public:
     [[nodiscard]] ViewInterface::Ptr parent() const;
-    static ViewData::Ptr             create(const ViewInterface::WeakPtr& parent);
+    static ViewData::Ptr create(const ViewInterface::WeakPtr& parent, TransformationData::Ptr transformationData);
 
     // ViewInterface
     void                                   invalidate() override;
+    void                                   invalidateArea(Scroom::Utils::Rectangle<double> presentationArea) override;
     ProgressInterface::Ptr                 getProgressInterface() override;
     void                                   addSideWidget(std::string title, GtkWidget* w) override;
     void                                   removeSideWidget(GtkWidget* w) override;
@@ -68,7 +73,7 @@ namespace Detail
     void                                   addToolButton(GtkToggleButton* button, ToolStateListener::Ptr ptr) override;
 
   private:
-    explicit ViewData(ViewInterface::WeakPtr parent_);
+    ViewData(ViewInterface::WeakPtr parent_, TransformationData::Ptr transformationData_);
   };
 
 } // namespace Detail
@@ -0,0 +1,205 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <scroom/backing-store.hh>
+#include <scroom/cairo-helpers.hh>
+
+namespace
+{
+  /**
+   * Scrolling by a fraction of a pixel would require re-sampling the
+   * stored content, so in that case we render everything instead.
+   */
+  const double SUBPIXEL_TOLERANCE = 1e-6;
+
+  /**
+   * Beyond this many separate dirty areas, they are merged into one,
+   * to keep the clip path of the next redraw simple.
+   */
+  const size_t MAX_DIRTY_AREAS = 16;
+
+  Scroom::Utils::Rectangle<double> boundingBox(const std::vector<Scroom::Utils::Rectangle<double>>& areas)
+  {
+    double left   = areas.front().getLeft();
+    double top    = areas.front().getTop();
+    double right  = areas.front().getRight();
+    double bottom = areas.front().getBottom();
+    for(const auto& area: areas)
+    {
+      left   = std::min(left, area.getLeft());
+      top    = std::min(top, area.getTop());
+      right  = std::max(right, area.getRight());
+      bottom = std::max(bottom, area.getBottom());
+    }
+    return {left, top, right - left, bottom - top};
+  }
+
+  /** @return The pixels covered by @c area, clipped to a view of the given @c size */
+  cairo_rectangle_int_t toPixels(const Scroom::Utils::Rectangle<double>& area, Scroom::Utils::Point<int> size)
+  {
+    const int left   = std::max(0, static_cast<int>(std::floor(area.getLeft())));
+    const int top    = std::max(0, static_cast<int>(std::floor(area.getTop())));
+    const int right  = std::min(size.x, static_cast<int>(std::ceil(area.getRight())));
+    const int bottom = std::min(size.y, static_cast<int>(std::ceil(area.getBottom())));
+
+    return {left, top, std::max(0, right - left), std::max(0, bottom - top)};
+  }
+} // namespace
+
+BackingStore::~BackingStore() { reset(); }
+
+void BackingStore::reset()
+{
+  if(surface)
+  {
+    cairo_surface_destroy(surface);
+    surface = nullptr;
+  }
+  if(spare)
+  {
+    cairo_surface_destroy(spare);
+    spare = nullptr;
+  }
+  invalidate();
+}
+
+void BackingStore::invalidate()
+{
+  valid = false;
+  dirtyAreas.clear();
+}
+
+void BackingStore::invalidate(Scroom::Utils::Rectangle<double> presentationArea)
+{
+  if(!valid || presentationArea.isEmpty())
+  {
+    return;
+  }
+
+  for(const auto& area: dirtyAreas)
+  {
+    if(area.contains(presentationArea))
+    {
+      return;
+    }
+  }
+  dirtyAreas.erase(std::remove_if(dirtyAreas.begin(),
+                                  dirtyAreas.end(),
+                                  [&](const Scroom::Utils::Rectangle<double>& area) { return presentationArea.contains(area); }),
+                   dirtyAreas.end());
+  dirtyAreas.push_back(presentationArea);
+
+  if(dirtyAreas.size() > MAX_DIRTY_AREAS)
+  {
+    dirtyAreas = {boundingBox(dirtyAreas)};
+  }
+}
+
+void BackingStore::redraw(cairo_t*                     cr,
+                          Scroom::Utils::Point<double> position_,
+                          Scroom::Utils::Point<int>    size_,
+                          int                          zoom_,
+                          const Renderer&              render)
+{
+  if(size_.x <= 0 || size_.y <= 0)
+  {
+    return;
+  }
+
+  if(!surface || size != size_)
+  {
+    reset();
+    surface = cairo_surface_create_similar(cairo_get_target(cr), CAIRO_CONTENT_COLOR_ALPHA, size_.x, size_.y);
+    spare   = cairo_surface_create_similar(cairo_get_target(cr), CAIRO_CONTENT_COLOR_ALPHA, size_.x, size_.y);
+    size    = size_;
+  }
+
+  const double                pixelSize = pixelSizeFromZoom(zoom_);
+  const cairo_rectangle_int_t everything{0, 0, size.x, size.y};
+  cairo_region_t*             dirty = cairo_region_create();
+
+  if(valid && zoom != zoom_)
+  {
+    valid = false;
+  }
+
+  if(valid && position != position_)
+  {
+    const Scroom::Utils::Point<double> shift = (position - position_) * pixelSize;
+    const Scroom::Utils::Point<double> rounded(std::round(shift.x), std::round(shift.y));
+
+    if(std::abs(shift.x - rounded.x) > SUBPIXEL_TOLERANCE || std::abs(shift.y - rounded.y) > SUBPIXEL_TOLERANCE
+       || std::abs(rounded.x) >= size.x || std::abs(rounded.y) >= size.y)
+    {
+      valid = false;
+    }
+    else
+    {
+      // Move the pixels that remain visible, and render the rest
+      const auto offset = rounded.to<int>();
+
+      cairo_t* spare_cr = cairo_create(spare);
+      cairo_set_operator(spare_cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface(spare_cr, surface, offset.x, offset.y);
+      cairo_paint(spare_cr);
+      cairo_destroy(spare_cr);
+      std::swap(surface, spare);
+
+      const cairo_rectangle_int_t kept{offset.x, offset.y, size.x, size.y};
+      cairo_region_union_rectangle(dirty, &everything);
+      cairo_region_subtract_rectangle(dirty, &kept);
+    }
+  }
+
+  if(valid)
+  {
+    for(const auto& area: dirtyAreas)
+    {
+      const cairo_rectangle_int_t r = toPixels((area - position_) * pixelSize, size);
+      cairo_region_union_rectangle(dirty, &r);
+    }
+  }
+  else
+  {
+    cairo_region_union_rectangle(dirty, &everything);
+  }
+  dirtyAreas.clear();
+
+  if(!cairo_region_is_empty(dirty))
+  {
+    cairo_t* surface_cr = cairo_create(surface);
+    for(int i = 0; i < cairo_region_num_rectangles(dirty); i++)
+    {
+      cairo_rectangle_int_t r;
+      cairo_region_get_rectangle(dirty, i, &r);
+      cairo_rectangle(surface_cr, r.x, r.y, r.width, r.height);
+    }
+    cairo_clip(surface_cr);
+    cairo_set_operator(surface_cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(surface_cr);
+    cairo_set_operator(surface_cr, CAIRO_OPERATOR_OVER);
+
+    render(surface_cr, Scroom::Utils::make_rect(position_, size.to<double>() / pixelSize));
+
+    cairo_destroy(surface_cr);
+  }
+  cairo_region_destroy(dirty);
+
+  position = position_;
+  zoom     = zoom_;
+  valid    = true;
+
+  cairo_save(cr);
+  cairo_set_source_surface(cr, surface, 0, 0);
+  cairo_paint(cr);
+  cairo_restore(cr);
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <utility>
 
@@ -15,6 +17,18 @@
 
 #include "scroom/cairo-helpers.hh"
 
+namespace
+{
+  /**
+   * Number of pixels drawn around the area that needs to be drawn, such
+   * that scaling doesn't blend in transparent pixels at its edges
+   */
+  int scalingMargin(Scroom::Utils::Point<double> aspectRatio)
+  {
+    return 1 + static_cast<int>(std::ceil(std::max(1 / aspectRatio.x, 1 / aspectRatio.y)));
+  }
+} // namespace
+
 TransformationData::TransformationData()
   : aspectRatio(1, 1)
 {
@@ -61,7 +75,7 @@ Scroom::Utils::Rectangle<double> TransformPresentation::getRect()
 
 void TransformPresentation::open(ViewInterface::WeakPtr viewInterface)
 {
-  auto [it, inserted] = viewData.insert({viewInterface, Detail::ViewData::create(viewInterface)});
+  auto [it, inserted] = viewData.insert({viewInterface, Detail::ViewData::create(viewInterface, transformationData)});
   require(inserted);
   auto& [_, data] = *it;
 
@@ -85,30 +99,55 @@ void TransformPresentation::redraw(ViewInterface::Ptr const&        vi,
 {
   Scroom::Utils::Point<double> const aspectRatio = transformationData->getAspectRatio();
   const auto                         data        = viewData.at(vi);
-
-  if(data->presentationArea != presentationArea || data->zoom != zoom)
+  const double                       pixelSize   = pixelSizeFromZoom(zoom);
+  const int                          margin      = scalingMargin(aspectRatio);
+
+  // Usually, only a small part of the view needs drawing, for example
+  // after scrolling. Draw only that part of the untransformed
+  // presentation, in its pixels. The presentation is still asked for
+  // the entire area, such that it keeps everything that is in view
+  // loaded. The clip takes care of the rest.
+  double x1 = 0;
+  double y1 = 0;
+  double x2 = 0;
+  double y2 = 0;
+  cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+
+  const auto viewSize = ceil((presentationArea * pixelSize / aspectRatio).getSize()).to<int>();
+  const int  left     = std::max(0, static_cast<int>(std::floor(x1 / aspectRatio.x)) - margin);
+  const int  top      = std::max(0, static_cast<int>(std::floor(y1 / aspectRatio.y)) - margin);
+  const int  right    = std::min(viewSize.x, static_cast<int>(std::ceil(x2 / aspectRatio.x)) + margin);
+  const int  bottom   = std::min(viewSize.y, static_cast<int>(std::ceil(y2 / aspectRatio.y)) + margin);
+  if(right <= left || bottom <= top)
   {
-    data->image.reset();
+    return;
   }
-  if(!data->image)
-  {
-    auto pixelSize = pixelSizeFromZoom(zoom);
-    auto viewArea  = ceil((presentationArea * pixelSize / aspectRatio).getSize()).to<int>();
+  const int width  = right - left;
+  const int height = bottom - top;
 
-    data->image = Scroom::Bitmap::BitmapSurface::create(viewArea.x, viewArea.y, CAIRO_FORMAT_ARGB32);
+  if(!data->image || cairo_image_surface_get_width(data->image->get()) < width
+     || cairo_image_surface_get_height(data->image->get()) < height)
+  {
+    data->image = Scroom::Bitmap::BitmapSurface::create(width, height, CAIRO_FORMAT_ARGB32);
+  }
 
-    cairo_surface_t* surface  = data->image->get();
-    cairo_t*         image_cr = cairo_create(surface);
+  cairo_t* image_cr = cairo_create(data->image->get());
+  cairo_rectangle(image_cr, 0, 0, width, height);
+  cairo_clip(image_cr);
+  cairo_set_operator(image_cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint(image_cr);
+  cairo_set_operator(image_cr, CAIRO_OPERATOR_OVER);
+  cairo_translate(image_cr, -left, -top);
 
-    presentation->redraw(data, image_cr, presentationArea / aspectRatio, zoom);
+  presentation->redraw(data, image_cr, presentationArea / aspectRatio, zoom);
 
-    cairo_destroy(image_cr);
-  }
+  cairo_destroy(image_cr);
 
   cairo_save(cr);
   cairo_scale(cr, aspectRatio.x, aspectRatio.y);
-  cairo_set_source_surface(cr, data->image->get(), 0, 0);
-  cairo_paint(cr);
+  cairo_set_source_surface(cr, data->image->get(), left, top);
+  cairo_rectangle(cr, left, top, width, height);
+  cairo_fill(cr);
   cairo_restore(cr);
 }
 
@@ -150,17 +189,19 @@ Scroom::Utils::Point<double> TransformPresentation::getAspectRatio() const { ret
 
 namespace Detail
 {
-  ViewData::ViewData(ViewInterface::WeakPtr parent_)
+  ViewData::ViewData(ViewInterface::WeakPtr parent_, TransformationData::Ptr transformationData_)
     : weakParent(std::move(parent_))
+    , transformationData(std::move(transformationData_))
   {
   }
 
   ViewInterface::Ptr ViewData::parent() const { return ViewInterface::Ptr(weakParent); }
 
-  void ViewData::invalidate()
+  void ViewData::invalidate() { parent()->invalidate(); }
+
+  void ViewData::invalidateArea(Scroom::Utils::Rectangle<double> presentationArea)
   {
-    image.reset();
-    parent()->invalidate();
+    parent()->invalidateArea(presentationArea * transformationData->getAspectRatio());
   }
 
   ProgressInterface::Ptr ViewData::getProgressInterface() { return parent()->getProgressInterface(); }
@@ -173,5 +214,8 @@ namespace Detail
   void ViewData::setStatusMessage(const std::string& string) { parent()->setStatusMessage(string); }
   std::shared_ptr<PresentationInterface> ViewData::getCurrentPresentation() { return parent()->getCurrentPresentation(); }
   void ViewData::addToolButton(GtkToggleButton* button, ToolStateListener::Ptr ptr) { parent()->addToolButton(button, ptr); }
-  ViewData::Ptr ViewData::create(const ViewInterface::WeakPtr& parent) { return ViewData::Ptr(new ViewData(parent)); }
+  ViewData::Ptr ViewData::create(const ViewInterface::WeakPtr& parent, TransformationData::Ptr transformationData)
+  {
+    return ViewData::Ptr(new ViewData(parent, std::move(transformationData)));
+  }
 } // namespace Detail
\ No newline at end of file
@@ -0,0 +1,216 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cairo.h>
+
+#include <scroom/backing-store.hh>
+
+using Scroom::Utils::Point;
+using Scroom::Utils::Rectangle;
+
+namespace
+{
+  const Point<int> size(64, 48);
+  const int        cellSize = 8;
+
+  /**
+   * Draws a checkerboard in presentation coordinates, and remembers
+   * which parts of the view it was asked to render
+   */
+  class Checkerboard
+  {
+  public:
+    std::vector<Rectangle<double>> rendered;
+
+    void operator()(cairo_t* cr, Rectangle<double> presentationArea)
+    {
+      double x1 = 0;
+      double y1 = 0;
+      double x2 = 0;
+      double y2 = 0;
+      cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+      rendered.emplace_back(x1, y1, x2 - x1, y2 - y1);
+
+      const int left   = static_cast<int>(std::floor(presentationArea.getLeft() / cellSize));
+      const int top    = static_cast<int>(std::floor(presentationArea.getTop() / cellSize));
+      const int right  = static_cast<int>(std::ceil(presentationArea.getRight() / cellSize));
+      const int bottom = static_cast<int>(std::ceil(presentationArea.getBottom() / cellSize));
+
+      cairo_set_source_rgb(cr, 0, 0, 0);
+      for(int i = left; i < right; i++)
+      {
+        for(int j = top; j < bottom; j++)
+        {
+          if((i + j) % 2 == 0)
+          {
+            cairo_rectangle(cr,
+                            i * cellSize - presentationArea.getLeft(),
+                            j * cellSize - presentationArea.getTop(),
+                            cellSize,
+                            cellSize);
+          }
+        }
+      }
+      cairo_fill(cr);
+    }
+  };
+
+  class Target
+  {
+  public:
+    cairo_surface_t* surface{cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size.x, size.y)};
+    cairo_t*         cr{cairo_create(surface)};
+
+    Target()                         = default;
+    Target(const Target&)            = delete;
+    Target(Target&&)                 = delete;
+    Target& operator=(const Target&) = delete;
+    Target& operator=(Target&&)      = delete;
+
+    ~Target()
+    {
+      cairo_destroy(cr);
+      cairo_surface_destroy(surface);
+    }
+
+    void clear()
+    {
+      cairo_save(cr);
+      cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+      cairo_paint(cr);
+      cairo_restore(cr);
+    }
+
+    bool operator==(Target& other)
+    {
+      cairo_surface_flush(surface);
+      cairo_surface_flush(other.surface);
+      const int stride = cairo_image_surface_get_stride(surface);
+      return 0
+             == std::memcmp(cairo_image_surface_get_data(surface),
+                            cairo_image_surface_get_data(other.surface),
+                            static_cast<size_t>(stride) * size.y);
+    }
+  };
+
+  /** Render the view at @c position from scratch */
+  void renderFromScratch(Target& target, Point<double> position)
+  {
+    BackingStore store;
+    Checkerboard checkerboard;
+    store.redraw(target.cr, position, size, 0, std::ref(checkerboard));
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BackingStore_Tests)
+
+BOOST_AUTO_TEST_CASE(renders_only_once)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(1U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(0, 0, size.x, size.y), checkerboard.rendered[0]);
+}
+
+BOOST_AUTO_TEST_CASE(scrolling_renders_exposed_strip)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+  target.clear();
+  store.redraw(target.cr, {3, 0}, size, 0, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(2U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(size.x - 3, 0, 3, size.y), checkerboard.rendered[1]);
+
+  Target expected;
+  renderFromScratch(expected, {3, 0});
+  BOOST_CHECK(target == expected);
+}
+
+BOOST_AUTO_TEST_CASE(scrolling_diagonally_matches_full_render)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+  store.redraw(target.cr, {-5, 7}, size, 0, std::ref(checkerboard));
+  target.clear();
+  store.redraw(target.cr, {2, 3}, size, 0, std::ref(checkerboard));
+
+  Target expected;
+  renderFromScratch(expected, {2, 3});
+  BOOST_CHECK(target == expected);
+}
+
+BOOST_AUTO_TEST_CASE(zooming_renders_everything)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+  store.redraw(target.cr, {0, 0}, size, 1, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(2U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(0, 0, size.x, size.y), checkerboard.rendered[1]);
+}
+
+BOOST_AUTO_TEST_CASE(invalidated_area_is_rendered)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {10, 10}, size, 0, std::ref(checkerboard));
+  store.invalidate(Rectangle<double>(20, 20, 5, 5));
+  store.invalidate(Rectangle<double>(21, 21, 2, 2)); // Already covered
+  store.redraw(target.cr, {10, 10}, size, 0, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(2U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(10, 10, 5, 5), checkerboard.rendered[1]);
+
+  store.invalidate();
+  store.redraw(target.cr, {10, 10}, size, 0, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(3U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(0, 0, size.x, size.y), checkerboard.rendered[2]);
+}
+
+BOOST_AUTO_TEST_CASE(many_invalidated_areas_are_merged)
+{
+  Target       target;
+  BackingStore store;
+  Checkerboard checkerboard;
+
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+  for(int i = 0; i < 20; i++)
+  {
+    store.invalidate(Rectangle<double>(2 * i, i, 1, 1));
+  }
+  store.redraw(target.cr, {0, 0}, size, 0, std::ref(checkerboard));
+
+  BOOST_REQUIRE_EQUAL(2U, checkerboard.rendered.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(0, 0, 39, 20), checkerboard.rendered[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
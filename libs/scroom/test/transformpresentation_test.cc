@@ -19,6 +19,7 @@ using ::testing::AtLeast;
 using ::testing::ByRef;
 using ::testing::DoAll;
 using ::testing::Eq;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::SaveArg;
 using ::testing::Sequence;
@@ -66,7 +67,7 @@ TEST(TransformPresentation_Tests, TransformationData_supports_aspect_ratio) // N
 
   tp->open(vi);
 
-  BitmapSurface::Ptr const s       = BitmapSurface::create(10, 10, CAIRO_FORMAT_ARGB32);
+  BitmapSurface::Ptr const s       = BitmapSurface::create(32, 72, CAIRO_FORMAT_ARGB32);
   cairo_surface_t*         surface = s->get();
   cairo_t*                 cr      = cairo_create(surface);
 
@@ -78,3 +79,54 @@ TEST(TransformPresentation_Tests, TransformationData_supports_aspect_ratio) // N
 
   tp->close(vi);
 }
+
+TEST(TransformPresentation_Tests, TransformPresentation_requests_everything_but_draws_only_the_clipped_area) // NOLINT
+{
+  TransformationData::Ptr const td = TransformationData::create();
+  td->setAspectRatio(2, 3);
+
+  ColormappablePresentationMock::Ptr const cpm = ColormappablePresentationMock::create();
+
+  TransformPresentation::Ptr const tp = TransformPresentation::create(cpm, td);
+
+  ViewInterface::Ptr const vi(reinterpret_cast<ViewInterface*>(1), DontDelete<ViewInterface>());
+  EXPECT_CALL(*cpm, getRect()).WillRepeatedly(Return(make_rect(1.0, 2.0, 3.0, 4.0)));
+
+  ViewInterface::WeakPtr viw;
+  EXPECT_CALL(*cpm, open(_)).WillOnce(SaveArg<0>(&viw));
+  Scroom::Utils::Rectangle<double> requested_to_be_drawn;
+  Scroom::Utils::Rectangle<double> clipped_to;
+  EXPECT_CALL(*cpm, redraw(Eq(ByRef(viw)), _, _, _))
+    .WillOnce(DoAll(SaveArg<2>(&requested_to_be_drawn),
+                    Invoke(
+                      [&clipped_to](ViewInterface::Ptr const& /*vi*/,
+                                    cairo_t* image_cr,
+                                    Scroom::Utils::Rectangle<double> /*presentationArea*/,
+                                    int /*zoom*/)
+                      {
+                        double x1 = 0;
+                        double y1 = 0;
+                        double x2 = 0;
+                        double y2 = 0;
+                        cairo_clip_extents(image_cr, &x1, &y1, &x2, &y2);
+                        clipped_to = make_rect(x1, y1, x2 - x1, y2 - y1);
+                      })));
+  EXPECT_CALL(*cpm, close(Eq(ByRef(viw))));
+
+  tp->open(vi);
+
+  BitmapSurface::Ptr const s  = BitmapSurface::create(32, 72, CAIRO_FORMAT_ARGB32);
+  cairo_t*                 cr = cairo_create(s->get());
+  cairo_rectangle(cr, 0, 36, 32, 36);
+  cairo_clip(cr);
+
+  tp->redraw(vi, cr, make_rect(1.0, 4.5, 4.0, 9.0), 3);
+
+  // The presentation is asked for everything in view...
+  EXPECT_PRED2(rects_are_close, make_rect(0.5, 1.5, 2.0, 3.0), requested_to_be_drawn);
+  // ...but only draws the bottom 12 pixels, plus a margin of 2 pixels for scaling
+  EXPECT_PRED2(rects_are_close, make_rect(0.0, 10.0, 16.0, 14.0), clipped_to);
+  cairo_destroy(cr);
+
+  tp->close(vi);
+}
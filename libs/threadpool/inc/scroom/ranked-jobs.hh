@@ -0,0 +1,112 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+#include <scroom/threadpool.hh>
+
+/**
+ * Jobs whose order can be changed after they have been scheduled.
+ *
+ * ThreadPool priorities are fixed at the moment a job is scheduled.
+ * That doesn't work well for jobs whose importance changes while they
+ * wait, like loading the tiles that are visible on the screen: As
+ * soon as the user scrolls, the tiles closest to the centre of the
+ * view should be done first.
+ *
+ * Each job you schedule() on a RankedJobs object puts a placeholder
+ * on the ThreadPool, at the priority given to create(). Once a
+ * placeholder gets to run, it executes the pending job with the
+ * lowest rank at that time. Hence, you can change the order in which
+ * the jobs are executed by calling Job::setRank(), and you can take a
+ * job out of the queue with Job::cancel(). A placeholder that finds no
+ * pending jobs does nothing.
+ *
+ * Like with ThreadPool::schedule(), jobs whose ThreadPool::Queue has
+ * been deleted are silently discarded.
+ */
+class RankedJobs : public std::enable_shared_from_this<RankedJobs>
+{
+public:
+  using Ptr = std::shared_ptr<RankedJobs>;
+
+  class Job;
+
+private:
+  using Jobs = std::multimap<double, std::shared_ptr<Job>>;
+
+public:
+  /**
+   * A job that has been scheduled on a RankedJobs object.
+   *
+   * Dropping your reference does not cancel the job.
+   */
+  class Job
+  {
+  public:
+    using Ptr = std::shared_ptr<Job>;
+
+  private:
+    std::weak_ptr<RankedJobs>  owner;
+    boost::function<void()>    fn;
+    ThreadPool::WeakQueue::Ptr queue;
+    Jobs::iterator             position;
+    bool                       pending{true}; /**< @c true while @c position is valid */
+
+  public:
+    Job(std::weak_ptr<RankedJobs> owner, boost::function<void()> fn, ThreadPool::WeakQueue::Ptr queue);
+
+    /** Change the rank of this job, if it hasn't been started yet */
+    void setRank(double rank);
+
+    /**
+     * Take this job out of the queue
+     *
+     * @retval true if the job will not be executed
+     * @retval false if the job was executed or cancelled before
+     */
+    bool cancel();
+
+    friend class RankedJobs;
+  };
+
+private:
+  ThreadPool::Ptr pool;
+  int             priority;
+  boost::mutex    mut; /**< Protects @c jobs, and Job::position and Job::pending of the jobs in it */
+  Jobs            jobs;
+
+private:
+  RankedJobs(ThreadPool::Ptr pool, int priority);
+
+  /** Execute the pending job with the lowest rank, if any */
+  void executeOne();
+
+public:
+  /** Create a RankedJobs object that schedules its jobs on @c pool at the given @c priority */
+  static Ptr create(ThreadPool::Ptr pool, int priority);
+
+  /**
+   * Schedule the given job
+   *
+   * Jobs with a lower @c rank are executed first. Jobs with equal rank
+   * are executed in the order in which they were scheduled.
+   */
+  Job::Ptr schedule(boost::function<void()> const& fn, double rank, const ThreadPool::WeakQueue::Ptr& queue);
+
+  /** Schedule the given job */
+  Job::Ptr schedule(boost::function<void()> const& fn, double rank, const ThreadPool::Queue::Ptr& queue);
+
+  /** Return the number of jobs that have not been started or cancelled yet */
+  size_t getPendingCount();
+};
@@ -11,8 +11,13 @@
 #  include <config.h>
 #endif
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <queue>
+#include <string>
 #include <vector>
 
 #include <boost/function.hpp>
@@ -35,6 +40,7 @@ enum
 namespace Scroom::Detail::ThreadPool
 {
   class QueueImpl;
+  class StatisticsCollector;
 } // namespace Scroom::Detail::ThreadPool
 
 /**
@@ -48,6 +54,95 @@ class ThreadPool
 public:
   class WeakQueue;
 
+  /** How jobs are handed out to the threads of the ThreadPool */
+  enum class Scheduling
+  {
+    /**
+     * One queue per priority, shared by all threads.
+     *
+     * All threads take the same lock for every job they schedule or
+     * execute.
+     */
+    PRIORITY_QUEUE,
+
+    /**
+     * Each thread has its own queue per priority.
+     *
+     * Jobs scheduled from a thread in the ThreadPool end up in that
+     * thread's queue. Jobs scheduled from elsewhere end up in a shared
+     * queue. Threads that run out of work steal from the others. Within
+     * a priority, each queue is processed in FIFO order.
+     *
+     * @note Only priorities PRIO_HIGHEST through PRIO_LOWEST are
+     *    distinguished. Other priorities are clamped to that range.
+     */
+    WORK_STEALING
+  };
+
+  /**
+   * Scheduling used by ThreadPool objects that don't specify one.
+   *
+   * Set the SCROOM_THREADPOOL environment variable to @c work-stealing
+   * or @c priority-queue to choose. Defaults to Scheduling::PRIORITY_QUEUE.
+   */
+  static Scheduling defaultScheduling();
+
+  /**
+   * What a ThreadPool has been doing since it was created
+   *
+   * Priorities are distinguished from PRIO_HIGHEST through PRIO_LOWEST.
+   * Other priorities are counted as the nearest one in that range.
+   *
+   * @see getStatistics()
+   */
+  struct Statistics
+  {
+    /**
+     * Distribution of durations
+     *
+     * Bucket 0 counts durations below 1µs. Bucket i > 0 counts those
+     * from 2^(i-1)µs up to 2^iµs. The last bucket also counts anything
+     * longer.
+     */
+    struct Histogram
+    {
+      static const size_t bucketCount = 28;
+
+      std::array<uint64_t, bucketCount> buckets{};
+
+      [[nodiscard]] uint64_t count() const;
+
+      /** Upper bound of the bucket that holds the given @p fraction of the durations, or zero if there are none */
+      [[nodiscard]] std::chrono::microseconds percentile(double fraction) const;
+    };
+
+    struct Priority
+    {
+      int       priority{0};
+      uint64_t  scheduled{0};
+      uint64_t  started{0};
+      uint64_t  finished{0};
+      uint64_t  cancelled{0}; /**< Not executed, because their Queue no longer existed */
+      Histogram waitTime;     /**< From being scheduled to being started */
+      Histogram runTime;
+
+      /** Number of jobs that are still waiting to be executed */
+      [[nodiscard]] uint64_t queued() const { return scheduled - started - cancelled; }
+    };
+
+    std::string                         name;
+    size_t                              threads{0};
+    std::chrono::steady_clock::duration uptime{0};
+    std::chrono::steady_clock::duration busy{0};    /**< Total time spent running jobs, over all threads */
+    std::vector<Priority>               priorities; /**< Only those that have seen any jobs */
+
+    /** Fraction of the time the threads spent running jobs */
+    [[nodiscard]] double utilisation() const;
+
+    /** Multi-line, human readable summary */
+    [[nodiscard]] std::string toString() const;
+  };
+
   /**
    * Represent a Queue in the ThreadPool.
    *
@@ -160,9 +255,11 @@ private:
   {
     std::shared_ptr<Scroom::Detail::ThreadPool::QueueImpl> queue;
     boost::function<void()>                                fn;
+    std::chrono::steady_clock::time_point                  scheduled;
+    int                                                    priority{0};
 
     Job() = default;
-    Job(boost::function<void()> fn, const WeakQueue::Ptr& queue);
+    Job(boost::function<void()> fn, const WeakQueue::Ptr& queue, int priority);
   };
 
 public:
@@ -170,6 +267,8 @@ public:
   using ThreadPtr = std::shared_ptr<boost::thread>;
 
 private:
+  class WorkStealingScheduler;
+
   /**
    * Data needed by the threads to do their work.
    *
@@ -198,7 +297,7 @@ private:
   public:
     unsigned int              jobcount{0}; /**< current number of tasks in ThreadPool::jobs */
     boost::mutex              mut;         /**< For protecting ThreadPool::jobs */
-    bool                      alive{true}; /**< @c true if this ThreadPool is not in the process of being destroyed */
+    std::atomic<bool>         alive{true}; /**< @c true if this ThreadPool is not in the process of being destroyed */
     boost::condition_variable cond;        /**< For signalling newly queued jobs */
 
     /**
@@ -236,11 +335,22 @@ private:
      */
     Queue::Ptr defaultQueue;
 
+    /**
+     * Per-thread queues, if Scheduling::WORK_STEALING is used.
+     *
+     * If this is set, @c jobs and @c jobcount are unused, and @c mut and
+     * @c cond are only used by threads that have run out of work.
+     */
+    std::shared_ptr<WorkStealingScheduler> workStealing;
+
+    /** Counts the jobs going through this ThreadPool. Doesn't need @c mut */
+    std::shared_ptr<Scroom::Detail::ThreadPool::StatisticsCollector> statistics;
+
   private:
-    explicit PrivateData(bool completeAllJobsBeforeDestruction);
+    PrivateData(bool completeAllJobsBeforeDestruction, Scheduling scheduling);
 
   public:
-    static Ptr create(bool completeAllJobsBeforeDestruction);
+    static Ptr create(bool completeAllJobsBeforeDestruction, Scheduling scheduling);
   };
 
   std::list<ThreadPtr> threads; /**< Threads in this ThreadPool */
@@ -266,6 +376,9 @@ private:
    */
   static void do_one(const PrivateData::Ptr& priv);
 
+  /** Execute the given job, unless its Queue has been deleted */
+  static void execute(const Job& job, PrivateData& priv);
+
   static Queue::Ptr defaultQueue();
   static const int  defaultPriority;
 
@@ -276,12 +389,18 @@ public:
   /** Create a ThreadPool with the given number of threads */
   explicit ThreadPool(int count, bool completeAllJobsBeforeDestruction = false);
 
+  /** Create a ThreadPool with the given number of threads and Scheduling */
+  ThreadPool(int count, Scheduling scheduling, bool completeAllJobsBeforeDestruction = false);
+
   /** Create a ThreadPool with one thread for each core in the system */
   static ThreadPool::Ptr create(bool completeAllJobsBeforeDestruction = false);
 
   /** Create a ThreadPool with the given number of threads */
   static ThreadPool::Ptr create(int count, bool completeAllJobsBeforeDestruction = false);
 
+  /** Create a ThreadPool with the given number of threads and Scheduling */
+  static ThreadPool::Ptr create(int count, Scheduling scheduling, bool completeAllJobsBeforeDestruction = false);
+
   ThreadPool(const ThreadPool&)           = delete;
   ThreadPool(ThreadPool&&)                = delete;
   ThreadPool operator=(const ThreadPool&) = delete;
@@ -382,6 +501,18 @@ public:
    * @return references to the newly added threads.
    */
   std::vector<ThreadPtr> add(int count);
+
+  /** Set the name under which the Statistics of this ThreadPool are reported */
+  void setName(const std::string& name);
+
+  /** Statistics of this ThreadPool. Cheap enough to call periodically */
+  [[nodiscard]] Statistics getStatistics() const;
+
+  /** Statistics of all ThreadPool objects that currently exist */
+  static std::vector<Statistics> getAllStatistics();
+
+  /** Log getAllStatistics(), one ThreadPool at a time */
+  static void dumpStatistics();
 };
 
 /**
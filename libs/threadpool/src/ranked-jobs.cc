@@ -0,0 +1,130 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <scroom/ranked-jobs.hh>
+
+#include <utility>
+
+#include "queue.hh"
+
+using namespace Scroom::Detail::ThreadPool;
+
+////////////////////////////////////////////////////////////////////////
+/// RankedJobs::Job
+////////////////////////////////////////////////////////////////////////
+
+RankedJobs::Job::Job(std::weak_ptr<RankedJobs> owner_, boost::function<void()> fn_, ThreadPool::WeakQueue::Ptr queue_)
+  : owner(std::move(owner_))
+  , fn(std::move(fn_))
+  , queue(std::move(queue_))
+{
+}
+
+void RankedJobs::Job::setRank(double rank)
+{
+  RankedJobs::Ptr const owner_ = owner.lock();
+  if(owner_)
+  {
+    boost::mutex::scoped_lock const lock(owner_->mut);
+    if(pending && position->first != rank)
+    {
+      auto node  = owner_->jobs.extract(position);
+      node.key() = rank;
+      position   = owner_->jobs.insert(std::move(node));
+    }
+  }
+}
+
+bool RankedJobs::Job::cancel()
+{
+  // Release anything the job holds on to, but not while holding the
+  // lock, because that might result in more jobs being cancelled
+  boost::function<void()> discarded;
+
+  RankedJobs::Ptr const owner_ = owner.lock();
+  if(owner_)
+  {
+    boost::mutex::scoped_lock const lock(owner_->mut);
+    if(pending)
+    {
+      owner_->jobs.erase(position);
+      pending = false;
+      discarded.swap(fn);
+    }
+  }
+  return !discarded.empty();
+}
+
+////////////////////////////////////////////////////////////////////////
+/// RankedJobs
+////////////////////////////////////////////////////////////////////////
+
+RankedJobs::RankedJobs(ThreadPool::Ptr pool_, int priority_)
+  : pool(std::move(pool_))
+  , priority(priority_)
+{
+}
+
+RankedJobs::Ptr RankedJobs::create(ThreadPool::Ptr pool, int priority)
+{
+  return RankedJobs::Ptr(new RankedJobs(std::move(pool), priority));
+}
+
+RankedJobs::Job::Ptr RankedJobs::schedule(boost::function<void()> const& fn, double rank, const ThreadPool::WeakQueue::Ptr& queue)
+{
+  Job::Ptr const job = std::make_shared<Job>(shared_from_this(), fn, queue);
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    job->position = jobs.emplace(rank, job);
+  }
+
+  pool->schedule([me = shared_from_this()] { me->executeOne(); }, priority);
+
+  return job;
+}
+
+RankedJobs::Job::Ptr RankedJobs::schedule(boost::function<void()> const& fn, double rank, const ThreadPool::Queue::Ptr& queue)
+{
+  return schedule(fn, rank, queue->getWeak());
+}
+
+size_t RankedJobs::getPendingCount()
+{
+  boost::mutex::scoped_lock const lock(mut);
+  return jobs.size();
+}
+
+void RankedJobs::executeOne()
+{
+  for(;;)
+  {
+    Job::Ptr job;
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      if(jobs.empty())
+      {
+        // The job this placeholder was scheduled for has been cancelled
+        return;
+      }
+      job = jobs.begin()->second;
+      jobs.erase(jobs.begin());
+      job->pending = false;
+    }
+
+    QueueLock const l(job->queue->get());
+    if(l.queueExists())
+    {
+      boost::this_thread::disable_interruption const while_executing_jobs;
+      job->fn();
+      job->fn.clear();
+      return;
+    }
+
+    // The Queue of this job has been deleted. Rather than wasting our
+    // turn, try the next one.
+  }
+}
@@ -0,0 +1,205 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "statistics.hh"
+
+#include <algorithm>
+#include <list>
+
+#include <fmt/format.h>
+
+using namespace Scroom::Detail::ThreadPool;
+
+namespace
+{
+  boost::mutex                                  registryMut;
+  std::list<std::weak_ptr<StatisticsCollector>> registry; /**< Protected by registryMut */
+  const std::memory_order                       relaxed = std::memory_order_relaxed;
+
+  std::string describe(const ThreadPool::Statistics::Histogram& h)
+  {
+    return fmt::format(
+      "p50 {}us, p90 {}us, p99 {}us", h.percentile(0.5).count(), h.percentile(0.9).count(), h.percentile(0.99).count());
+  }
+} // namespace
+
+////////////////////////////////////////////////////////////////////////
+/// ThreadPool::Statistics
+////////////////////////////////////////////////////////////////////////
+
+uint64_t ThreadPool::Statistics::Histogram::count() const
+{
+  uint64_t result = 0;
+  for(uint64_t const b: buckets)
+  {
+    result += b;
+  }
+  return result;
+}
+
+std::chrono::microseconds ThreadPool::Statistics::Histogram::percentile(double fraction) const
+{
+  const uint64_t total = count();
+  if(total == 0)
+  {
+    return std::chrono::microseconds(0);
+  }
+
+  const auto wanted = static_cast<uint64_t>(std::max(1.0, fraction * static_cast<double>(total)));
+  uint64_t   seen   = 0;
+  size_t     bucket = 0;
+  for(; bucket < bucketCount - 1; bucket++)
+  {
+    seen += buckets[bucket];
+    if(seen >= wanted)
+    {
+      break;
+    }
+  }
+  return std::chrono::microseconds(int64_t(1) << bucket);
+}
+
+double ThreadPool::Statistics::utilisation() const
+{
+  if(threads == 0 || uptime.count() == 0)
+  {
+    return 0.0;
+  }
+  return std::chrono::duration<double>(busy).count() / (std::chrono::duration<double>(uptime).count() * double(threads));
+}
+
+std::string ThreadPool::Statistics::toString() const
+{
+  std::string result = fmt::format("{}: {} threads, {:.1f}% busy", name, threads, 100 * utilisation());
+  for(const Priority& p: priorities)
+  {
+    result += fmt::format("\n  priority {}: {} scheduled, {} queued, {} running, {} cancelled\n"
+                          "    wait {}\n"
+                          "    run  {}",
+                          p.priority,
+                          p.scheduled,
+                          p.queued(),
+                          p.started - p.finished,
+                          p.cancelled,
+                          describe(p.waitTime),
+                          describe(p.runTime));
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// StatisticsCollector
+////////////////////////////////////////////////////////////////////////
+
+StatisticsCollector::Ptr StatisticsCollector::create()
+{
+  Ptr result(new StatisticsCollector());
+
+  boost::mutex::scoped_lock const lock(registryMut);
+  registry.push_back(result);
+  return result;
+}
+
+std::vector<StatisticsCollector::Ptr> StatisticsCollector::all()
+{
+  std::vector<Ptr> result;
+
+  boost::mutex::scoped_lock const lock(registryMut);
+  for(auto cur = registry.begin(); cur != registry.end();)
+  {
+    if(Ptr collector = cur->lock())
+    {
+      result.push_back(std::move(collector));
+      ++cur;
+    }
+    else
+    {
+      cur = registry.erase(cur);
+    }
+  }
+  return result;
+}
+
+StatisticsCollector::Counters& StatisticsCollector::countersFor(int priority)
+{
+  return counters[std::clamp<int>(priority, PRIO_HIGHEST, PRIO_LOWEST) - PRIO_HIGHEST];
+}
+
+void StatisticsCollector::add(Histogram& histogram, Clock::duration d)
+{
+  auto   us     = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  size_t bucket = 0;
+  for(; us > 0 && bucket < histogram.size() - 1; us >>= 1)
+  {
+    bucket++;
+  }
+  histogram[bucket].fetch_add(1, relaxed);
+}
+
+void StatisticsCollector::setName(const std::string& name_)
+{
+  boost::mutex::scoped_lock const lock(mut);
+  name = name_;
+}
+
+void StatisticsCollector::threadAdded() { threads.fetch_add(1, relaxed); }
+
+void StatisticsCollector::jobScheduled(int priority) { countersFor(priority).scheduled.fetch_add(1, relaxed); }
+
+void StatisticsCollector::jobStarted(int priority, Clock::duration waitTime)
+{
+  Counters& c = countersFor(priority);
+  c.started.fetch_add(1, relaxed);
+  add(c.waitTime, waitTime);
+}
+
+void StatisticsCollector::jobFinished(int priority, Clock::duration runTime)
+{
+  Counters& c = countersFor(priority);
+  c.finished.fetch_add(1, relaxed);
+  add(c.runTime, runTime);
+  busy.fetch_add(runTime.count(), relaxed);
+}
+
+void StatisticsCollector::jobCancelled(int priority) { countersFor(priority).cancelled.fetch_add(1, relaxed); }
+
+StatisticsCollector::Snapshot StatisticsCollector::get()
+{
+  Snapshot result;
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    result.name = name.empty() ? "Unnamed threadpool" : name;
+  }
+  result.threads = threads.load(relaxed);
+  result.uptime  = Clock::now() - created;
+  result.busy    = Clock::duration(busy.load(relaxed));
+
+  for(size_t i = 0; i < counters.size(); i++)
+  {
+    // Later stages first, so jobs that are in flight don't make the difference negative
+    const Counters&    c = counters[i];
+    Snapshot::Priority p;
+    p.priority  = PRIO_HIGHEST + static_cast<int>(i);
+    p.finished  = c.finished.load(relaxed);
+    p.started   = c.started.load(relaxed);
+    p.cancelled = c.cancelled.load(relaxed);
+    p.scheduled = c.scheduled.load(relaxed);
+    if(p.scheduled == 0)
+    {
+      continue;
+    }
+
+    for(size_t b = 0; b < Snapshot::Histogram::bucketCount; b++)
+    {
+      p.waitTime.buckets[b] = c.waitTime[b].load(relaxed);
+      p.runTime.buckets[b]  = c.runTime[b].load(relaxed);
+    }
+    result.priorities.push_back(p);
+  }
+
+  return result;
+}
@@ -0,0 +1,83 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/threadpool.hh>
+
+namespace Scroom::Detail::ThreadPool
+{
+  /**
+   * Lock-free counters behind ::ThreadPool::Statistics
+   *
+   * Updated by the threads scheduling and executing jobs. Reading gives
+   * a snapshot that may be slightly inconsistent, e.g. a job may be
+   * counted as started, but not yet as scheduled.
+   */
+  class StatisticsCollector
+  {
+  public:
+    using Ptr      = std::shared_ptr<StatisticsCollector>;
+    using Clock    = std::chrono::steady_clock;
+    using Snapshot = ::ThreadPool::Statistics;
+
+  private:
+    static const int priorityCount = PRIO_LOWEST - PRIO_HIGHEST + 1;
+
+    using Histogram = std::array<std::atomic<uint64_t>, Snapshot::Histogram::bucketCount>;
+
+    struct Counters
+    {
+      std::atomic<uint64_t> scheduled{0};
+      std::atomic<uint64_t> started{0};
+      std::atomic<uint64_t> finished{0};
+      std::atomic<uint64_t> cancelled{0};
+      Histogram             waitTime{};
+      Histogram             runTime{};
+    };
+
+    std::array<Counters, priorityCount> counters;
+    std::atomic<Clock::rep>             busy{0};
+    std::atomic<size_t>                 threads{0};
+    const Clock::time_point             created{Clock::now()};
+
+    boost::mutex mut; /**< Protects name */
+    std::string  name;
+
+  private:
+    StatisticsCollector() = default;
+
+    Counters&   countersFor(int priority);
+    static void add(Histogram& histogram, Clock::duration d);
+
+  public:
+    static Ptr create();
+
+    /** Collectors of all ThreadPool objects that currently exist */
+    static std::vector<Ptr> all();
+
+    void setName(const std::string& name);
+    void threadAdded();
+
+    void jobScheduled(int priority);
+    void jobStarted(int priority, Clock::duration waitTime);
+    void jobFinished(int priority, Clock::duration runTime);
+    void jobCancelled(int priority);
+
+    Snapshot get();
+  };
+} // namespace Scroom::Detail::ThreadPool
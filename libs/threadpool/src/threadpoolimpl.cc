@@ -22,11 +22,19 @@
 #include <scroom/assertions.hh>
 #include <scroom/async-deleter.hh>
 #include <scroom/threadpool.hh>
+#include <scroom/trace.hh>
 
 #include "queue.hh"
+#include "statistics.hh"
+#include "work-stealing-scheduler.hh"
 
 using namespace Scroom::Detail::ThreadPool;
 
+namespace
+{
+  const std::string SCROOM_THREADPOOL = "SCROOM_THREADPOOL";
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////
 /// ThreadList / ThreadWaiter
 ////////////////////////////////////////////////////////////////////////
@@ -190,15 +198,20 @@ namespace
 /// ThreadPool::PrivateData
 ////////////////////////////////////////////////////////////////////////
 
-ThreadPool::PrivateData::PrivateData(bool completeAllJobsBeforeDestruction_)
+ThreadPool::PrivateData::PrivateData(bool completeAllJobsBeforeDestruction_, Scheduling scheduling)
   : completeAllJobsBeforeDestruction(completeAllJobsBeforeDestruction_)
   , defaultQueue(ThreadPool::defaultQueue())
+  , statistics(StatisticsCollector::create())
 {
+  if(scheduling == Scheduling::WORK_STEALING)
+  {
+    workStealing = WorkStealingScheduler::create();
+  }
 }
 
-ThreadPool::PrivateData::Ptr ThreadPool::PrivateData::create(bool completeAllJobsBeforeDestruction)
+ThreadPool::PrivateData::Ptr ThreadPool::PrivateData::create(bool completeAllJobsBeforeDestruction, Scheduling scheduling)
 {
-  return Ptr(new PrivateData(completeAllJobsBeforeDestruction));
+  return Ptr(new PrivateData(completeAllJobsBeforeDestruction, scheduling));
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -206,7 +219,7 @@ ThreadPool::PrivateData::Ptr ThreadPool::PrivateData::create(bool completeAllJob
 ////////////////////////////////////////////////////////////////////////
 
 ThreadPool::ThreadPool(bool completeAllJobsBeforeDestruction)
-  : priv(PrivateData::create(completeAllJobsBeforeDestruction))
+  : priv(PrivateData::create(completeAllJobsBeforeDestruction, defaultScheduling()))
 {
   const int count = boost::thread::hardware_concurrency();
 #ifndef MULTITHREADING
@@ -217,7 +230,12 @@ ThreadPool::ThreadPool(bool completeAllJobsBeforeDestruction)
 }
 
 ThreadPool::ThreadPool(int count, bool completeAllJobsBeforeDestruction)
-  : priv(PrivateData::create(completeAllJobsBeforeDestruction))
+  : ThreadPool(count, defaultScheduling(), completeAllJobsBeforeDestruction)
+{
+}
+
+ThreadPool::ThreadPool(int count, Scheduling scheduling, bool completeAllJobsBeforeDestruction)
+  : priv(PrivateData::create(completeAllJobsBeforeDestruction, scheduling))
 {
 #ifndef MULTITHREADING
   if(count > 1)
@@ -236,11 +254,38 @@ ThreadPool::Ptr ThreadPool::create(int count, bool completeAllJobsBeforeDestruct
   return std::make_shared<ThreadPool>(count, completeAllJobsBeforeDestruction);
 }
 
+ThreadPool::Ptr ThreadPool::create(int count, Scheduling scheduling, bool completeAllJobsBeforeDestruction)
+{
+  return std::make_shared<ThreadPool>(count, scheduling, completeAllJobsBeforeDestruction);
+}
+
+ThreadPool::Scheduling ThreadPool::defaultScheduling()
+{
+  static const Scheduling scheduling = []
+  {
+    const char* value = getenv(SCROOM_THREADPOOL.c_str()); // NOLINT(concurrency-mt-unsafe)
+    if(value == nullptr || std::string(value) == "priority-queue")
+    {
+      return Scheduling::PRIORITY_QUEUE;
+    }
+    if(std::string(value) == "work-stealing")
+    {
+      return Scheduling::WORK_STEALING;
+    }
+
+    spdlog::warn("{}: Unknown scheduling {}. Using priority-queue", SCROOM_THREADPOOL, value);
+    return Scheduling::PRIORITY_QUEUE;
+  }();
+
+  return scheduling;
+}
+
 ThreadPool::ThreadPtr ThreadPool::add()
 {
   auto t = std::make_shared<boost::thread>([data = priv] { ThreadPool::work(data); });
   threads.push_back(t);
   ThreadList::instance()->add(t);
+  priv->statistics->threadAdded();
   return t;
 }
 
@@ -273,6 +318,12 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::work(const ThreadPool::PrivateData::Ptr& priv)
 {
+  if(priv->workStealing)
+  {
+    priv->workStealing->work(priv);
+    return;
+  }
+
   boost::mutex::scoped_lock lock(priv->mut);
   while(priv->alive)
   {
@@ -329,13 +380,30 @@ void ThreadPool::do_one(const ThreadPool::PrivateData::Ptr& priv)
     }
   }
 
+  execute(job, *priv);
+}
+
+void ThreadPool::execute(const ThreadPool::Job& job, PrivateData& priv)
+{
   if(job.queue)
   {
     QueueLock const l(job.queue);
     if(l.queueExists())
     {
-      boost::this_thread::disable_interruption const while_executing_jobs;
-      job.fn();
+      const auto started = std::chrono::steady_clock::now();
+      priv.statistics->jobStarted(job.priority, started - job.scheduled);
+      Scroom::Utils::Trace::record("ThreadPool queue wait", job.scheduled);
+
+      {
+        boost::this_thread::disable_interruption const while_executing_jobs;
+        job.fn();
+      }
+
+      priv.statistics->jobFinished(job.priority, std::chrono::steady_clock::now() - started);
+    }
+    else
+    {
+      priv.statistics->jobCancelled(job.priority);
     }
   }
 }
@@ -352,8 +420,16 @@ void ThreadPool::schedule(boost::function<void()> const& fn, const ThreadPool::Q
 
 void ThreadPool::schedule(boost::function<void()> const& fn, int priority, const ThreadPool::WeakQueue::Ptr& queue)
 {
+  priv->statistics->jobScheduled(priority);
+
+  if(priv->workStealing)
+  {
+    priv->workStealing->schedule(Job(fn, queue, priority), priority, *priv);
+    return;
+  }
+
   boost::mutex::scoped_lock const lock(priv->mut);
-  priv->jobs[priority].emplace(fn, queue);
+  priv->jobs[priority].emplace(fn, queue, priority);
   priv->jobcount++;
   priv->cond.notify_one();
 }
@@ -371,6 +447,28 @@ ThreadPool::Queue::Ptr ThreadPool::defaultQueue()
 
 const int ThreadPool::defaultPriority = PRIO_NORMAL;
 
+void ThreadPool::setName(const std::string& name) { priv->statistics->setName(name); }
+
+ThreadPool::Statistics ThreadPool::getStatistics() const { return priv->statistics->get(); }
+
+std::vector<ThreadPool::Statistics> ThreadPool::getAllStatistics()
+{
+  std::vector<Statistics> result;
+  for(const StatisticsCollector::Ptr& collector: StatisticsCollector::all())
+  {
+    result.push_back(collector->get());
+  }
+  return result;
+}
+
+void ThreadPool::dumpStatistics()
+{
+  for(const Statistics& statistics: getAllStatistics())
+  {
+    spdlog::info("{}", statistics.toString());
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////
 /// ThreadPool::Queue
 ////////////////////////////////////////////////////////////////////////
@@ -407,9 +505,11 @@ QueueImpl::Ptr ThreadPool::WeakQueue::get() { return qi; }
 /// ThreadPool::Job
 ////////////////////////////////////////////////////////////////////////
 
-ThreadPool::Job::Job(boost::function<void()> fn_, const WeakQueue::Ptr& queue_)
+ThreadPool::Job::Job(boost::function<void()> fn_, const WeakQueue::Ptr& queue_, int priority_)
   : queue(queue_->get())
   , fn(std::move(fn_))
+  , scheduled(std::chrono::steady_clock::now())
+  , priority(priority_)
 {
 }
 
@@ -452,15 +552,24 @@ void QueueJumper::operator()()
 
 ThreadPool::Ptr CpuBound()
 {
-  static ThreadPool::Ptr const cpuBound = NotifyThreadList<ThreadPool>(std::make_shared<ThreadPool>(), "CpuBound threadpool");
+  static ThreadPool::Ptr const cpuBound = []
+  {
+    auto pool = std::make_shared<ThreadPool>();
+    pool->setName("CpuBound");
+    return NotifyThreadList<ThreadPool>(pool, "CpuBound threadpool");
+  }();
 
   return cpuBound;
 }
 
 ThreadPool::Ptr Sequentially()
 {
-  static ThreadPool::Ptr const sequentially =
-    NotifyThreadList<ThreadPool>(std::make_shared<ThreadPool>(1), "Sequential threadpool");
+  static ThreadPool::Ptr const sequentially = []
+  {
+    auto pool = std::make_shared<ThreadPool>(1);
+    pool->setName("Sequentially");
+    return NotifyThreadList<ThreadPool>(pool, "Sequential threadpool");
+  }();
 
   return sequentially;
 }
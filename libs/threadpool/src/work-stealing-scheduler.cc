@@ -0,0 +1,174 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "work-stealing-scheduler.hh"
+
+#include <algorithm>
+#include <utility>
+
+thread_local ThreadPool::WorkStealingScheduler*         ThreadPool::WorkStealingScheduler::currentScheduler = nullptr;
+thread_local ThreadPool::WorkStealingScheduler::Worker* ThreadPool::WorkStealingScheduler::currentWorker    = nullptr;
+
+////////////////////////////////////////////////////////////////////////
+/// Lane
+////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::WorkStealingScheduler::Lane::push(Job job)
+{
+  boost::mutex::scoped_lock const lock(mut);
+  jobs.push_back(std::move(job));
+  size++;
+}
+
+bool ThreadPool::WorkStealingScheduler::Lane::pop(Job& job)
+{
+  if(size == 0)
+  {
+    return false;
+  }
+
+  boost::mutex::scoped_lock const lock(mut);
+  if(jobs.empty())
+  {
+    return false;
+  }
+
+  job = std::move(jobs.front());
+  jobs.pop_front();
+  size--;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// Worker
+////////////////////////////////////////////////////////////////////////
+
+ThreadPool::WorkStealingScheduler::Worker::Worker(size_t index_)
+  : index(index_)
+{
+}
+
+////////////////////////////////////////////////////////////////////////
+/// WorkStealingScheduler
+////////////////////////////////////////////////////////////////////////
+
+ThreadPool::WorkStealingScheduler::Ptr ThreadPool::WorkStealingScheduler::create() { return Ptr(new WorkStealingScheduler()); }
+
+ThreadPool::WorkStealingScheduler::WorkStealingScheduler()
+  : workers(std::make_shared<const WorkerList>())
+{
+  for(auto& q: queued)
+  {
+    q = 0;
+  }
+}
+
+int ThreadPool::WorkStealingScheduler::laneFor(int priority) { return std::clamp<int>(priority, PRIO_HIGHEST, PRIO_LOWEST) - PRIO_HIGHEST; }
+
+ThreadPool::WorkStealingScheduler::Worker* ThreadPool::WorkStealingScheduler::addWorker()
+{
+  boost::mutex::scoped_lock const lock(workersMut);
+
+  std::shared_ptr<const WorkerList> const current = std::atomic_load(&workers);
+  auto                                    updated = std::make_shared<WorkerList>(*current);
+  updated->push_back(std::make_shared<Worker>(updated->size()));
+  Worker* const result = updated->back().get();
+  std::atomic_store(&workers, std::shared_ptr<const WorkerList>(std::move(updated)));
+
+  return result;
+}
+
+void ThreadPool::WorkStealingScheduler::schedule(Job job, int priority, PrivateData& priv)
+{
+  const int lane = laneFor(priority);
+
+  if(currentScheduler == this)
+  {
+    currentWorker->lanes[lane].push(std::move(job));
+  }
+  else
+  {
+    shared[lane].push(std::move(job));
+  }
+  queued[lane]++;
+  pending++;
+
+  if(sleepers > 0)
+  {
+    boost::mutex::scoped_lock const lock(priv.mut);
+    priv.cond.notify_one();
+  }
+}
+
+bool ThreadPool::WorkStealingScheduler::getJob(Worker* self, Job& job)
+{
+  for(int lane = 0; lane < laneCount && pending > 0; lane++)
+  {
+    if(queued[lane] > 0 && (self->lanes[lane].pop(job) || shared[lane].pop(job) || steal(self, lane, job)))
+    {
+      queued[lane]--;
+      pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::WorkStealingScheduler::steal(Worker* self, int lane, Job& job)
+{
+  std::shared_ptr<const WorkerList> const all   = std::atomic_load(&workers);
+  const size_t                            count = all->size();
+
+  // Start with our neighbour, so not everyone is robbing the same thread
+  for(size_t i = 1; i < count; i++)
+  {
+    if((*all)[(self->index + i) % count]->lanes[lane].pop(job))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkStealingScheduler::work(const PrivateData::Ptr& priv)
+{
+  Worker* const self = addWorker();
+  currentScheduler   = this;
+  currentWorker      = self;
+
+  Job job;
+  while(priv->alive)
+  {
+    if(getJob(self, job))
+    {
+      execute(job, *priv);
+      job = Job();
+    }
+    else
+    {
+      boost::mutex::scoped_lock lock(priv->mut);
+      sleepers++;
+      while(priv->alive && pending == 0)
+      {
+        priv->cond.wait(lock);
+      }
+      sleepers--;
+    }
+  }
+
+  if(priv->completeAllJobsBeforeDestruction)
+  {
+    while(getJob(self, job))
+    {
+      execute(job, *priv);
+      job = Job();
+    }
+  }
+
+  currentScheduler = nullptr;
+  currentWorker    = nullptr;
+}
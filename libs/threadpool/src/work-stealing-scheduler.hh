@@ -0,0 +1,99 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <scroom/threadpool.hh>
+
+/**
+ * Job administration for ThreadPool::Scheduling::WORK_STEALING
+ *
+ * There is a Lane for each priority. Each thread has its own set of
+ * Lanes, and there is one shared set for jobs scheduled from outside
+ * the ThreadPool. Each Lane has its own mutex, so threads only
+ * contend when they steal from the same Lane.
+ *
+ * Threads look for work in order of priority. Within a priority, they
+ * look at their own Lane first, then at the shared one, and finally
+ * at the Lanes of the other threads.
+ */
+class ThreadPool::WorkStealingScheduler
+{
+public:
+  using Ptr = std::shared_ptr<WorkStealingScheduler>;
+
+private:
+  static const int laneCount = PRIO_LOWEST - PRIO_HIGHEST + 1;
+
+  class Lane
+  {
+  private:
+    boost::mutex        mut;
+    std::deque<Job>     jobs;
+    std::atomic<size_t> size{0}; /**< Allows checking for emptiness without taking the lock */
+
+  public:
+    void push(Job job);
+    bool pop(Job& job);
+  };
+
+  struct Worker
+  {
+    using Ptr = std::shared_ptr<Worker>;
+
+    size_t                      index;
+    std::array<Lane, laneCount> lanes;
+
+    explicit Worker(size_t index);
+  };
+
+  using WorkerList = std::vector<Worker::Ptr>;
+
+private:
+  std::array<Lane, laneCount>             shared;
+  std::array<std::atomic<int>, laneCount> queued;     /**< Number of jobs per priority, over all Lanes */
+  std::atomic<int>                        pending{0}; /**< Number of jobs, over all priorities */
+  std::atomic<int>                        sleepers{0};
+
+  /**
+   * All threads that ever worked for this scheduler.
+   *
+   * Replaced, rather than modified, when a thread is added, such that
+   * stealing threads can iterate over it without holding a lock.
+   */
+  std::shared_ptr<const WorkerList> workers;
+  boost::mutex                      workersMut; /**< Serializes adding threads */
+
+  static thread_local WorkStealingScheduler* currentScheduler;
+  static thread_local Worker*                currentWorker;
+
+private:
+  WorkStealingScheduler();
+
+  Worker* addWorker();
+  bool    getJob(Worker* self, Job& job);
+  bool    steal(Worker* self, int lane, Job& job);
+
+  static int laneFor(int priority);
+
+public:
+  static Ptr create();
+
+  /** Enqueue @c job, waking up a sleeping thread if necessary */
+  void schedule(Job job, int priority, PrivateData& priv);
+
+  /** Body of each thread in the ThreadPool */
+  void work(const PrivateData::Ptr& priv);
+};
@@ -0,0 +1,156 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <scroom/ranked-jobs.hh>
+
+#include <memory>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/semaphore.hh>
+#include <scroom/threadpool.hh>
+
+#include "helpers.hh"
+
+using namespace boost::posix_time;
+
+static const millisec long_timeout(2000);
+
+//////////////////////////////////////////////////////////////
+
+namespace
+{
+  /** Records the order in which jobs are executed */
+  class Recorder
+  {
+  public:
+    boost::mutex     mut;
+    std::vector<int> executed;
+
+    boost::function<void()> record(int i)
+    {
+      return [this, i]
+      {
+        boost::mutex::scoped_lock const lock(mut);
+        executed.push_back(i);
+      };
+    }
+  };
+
+  /** Start a single thread on @c pool, and wait until all of its jobs have been executed */
+  void runAll(const ThreadPool::Ptr& pool)
+  {
+    Semaphore done;
+    pool->schedule(clear(&done), PRIO_LOWEST);
+    pool->add();
+    BOOST_REQUIRE(done.P(long_timeout));
+  }
+} // namespace
+
+//////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(RankedJobs_Tests)
+
+BOOST_AUTO_TEST_CASE(jobs_are_executed_in_order_of_rank)
+{
+  ThreadPool::Ptr const        pool   = ThreadPool::create(0);
+  RankedJobs::Ptr const        ranked = RankedJobs::create(pool, PRIO_NORMAL);
+  ThreadPool::Queue::Ptr const queue  = ThreadPool::Queue::create();
+  Recorder                     recorder;
+
+  ranked->schedule(recorder.record(3), 3.0, queue);
+  ranked->schedule(recorder.record(1), 1.0, queue);
+  ranked->schedule(recorder.record(2), 2.0, queue);
+  ranked->schedule(recorder.record(4), 2.0, queue);
+  BOOST_CHECK_EQUAL(4U, ranked->getPendingCount());
+
+  runAll(pool);
+
+  BOOST_CHECK_EQUAL(0U, ranked->getPendingCount());
+  const std::vector<int> expected = {1, 2, 4, 3};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), recorder.executed.begin(), recorder.executed.end());
+}
+
+BOOST_AUTO_TEST_CASE(rank_can_be_changed_while_pending)
+{
+  ThreadPool::Ptr const        pool   = ThreadPool::create(0);
+  RankedJobs::Ptr const        ranked = RankedJobs::create(pool, PRIO_NORMAL);
+  ThreadPool::Queue::Ptr const queue  = ThreadPool::Queue::create();
+  Recorder                     recorder;
+
+  RankedJobs::Job::Ptr const first = ranked->schedule(recorder.record(1), 1.0, queue);
+  ranked->schedule(recorder.record(2), 2.0, queue);
+  RankedJobs::Job::Ptr const third = ranked->schedule(recorder.record(3), 3.0, queue);
+
+  first->setRank(10.0);
+  third->setRank(0.0);
+
+  runAll(pool);
+
+  const std::vector<int> expected = {3, 2, 1};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), recorder.executed.begin(), recorder.executed.end());
+
+  // Changing the rank of a job that already ran is harmless
+  first->setRank(0.0);
+  BOOST_CHECK_EQUAL(0U, ranked->getPendingCount());
+}
+
+BOOST_AUTO_TEST_CASE(cancelled_jobs_are_not_executed)
+{
+  ThreadPool::Ptr const        pool   = ThreadPool::create(0);
+  RankedJobs::Ptr const        ranked = RankedJobs::create(pool, PRIO_NORMAL);
+  ThreadPool::Queue::Ptr const queue  = ThreadPool::Queue::create();
+  Recorder                     recorder;
+
+  ranked->schedule(recorder.record(1), 1.0, queue);
+  RankedJobs::Job::Ptr const second = ranked->schedule(recorder.record(2), 2.0, queue);
+
+  BOOST_CHECK(second->cancel());
+  BOOST_CHECK(!second->cancel());
+  BOOST_CHECK_EQUAL(1U, ranked->getPendingCount());
+
+  runAll(pool);
+
+  const std::vector<int> expected = {1};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), recorder.executed.begin(), recorder.executed.end());
+}
+
+BOOST_AUTO_TEST_CASE(cancelling_releases_the_job)
+{
+  ThreadPool::Ptr const        pool   = ThreadPool::create(0);
+  RankedJobs::Ptr const        ranked = RankedJobs::create(pool, PRIO_NORMAL);
+  ThreadPool::Queue::Ptr const queue  = ThreadPool::Queue::create();
+
+  std::shared_ptr<int> const data = std::make_shared<int>(42);
+  RankedJobs::Job::Ptr const job  = ranked->schedule([data] {}, 1.0, queue);
+  BOOST_CHECK_EQUAL(2, data.use_count());
+
+  job->cancel();
+  BOOST_CHECK_EQUAL(1, data.use_count());
+}
+
+BOOST_AUTO_TEST_CASE(jobs_on_deleted_queues_are_skipped)
+{
+  ThreadPool::Ptr const        pool   = ThreadPool::create(0);
+  RankedJobs::Ptr const        ranked = RankedJobs::create(pool, PRIO_NORMAL);
+  ThreadPool::Queue::Ptr const queue  = ThreadPool::Queue::create();
+  ThreadPool::Queue::Ptr       doomed = ThreadPool::Queue::create();
+  Recorder                     recorder;
+
+  ranked->schedule(recorder.record(1), 1.0, doomed);
+  ranked->schedule(recorder.record(2), 2.0, queue);
+  doomed.reset();
+
+  runAll(pool);
+
+  const std::vector<int> expected = {2};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), recorder.executed.begin(), recorder.executed.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,139 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <scroom/threadpool.hh>
+
+#include "helpers.hh"
+
+using namespace boost::posix_time;
+
+namespace
+{
+  const millisec long_timeout(2000);
+
+  const ThreadPool::Statistics::Priority* find(const ThreadPool::Statistics& statistics, int priority)
+  {
+    for(const auto& p: statistics.priorities)
+    {
+      if(p.priority == priority)
+      {
+        return &p;
+      }
+    }
+    return nullptr;
+  }
+
+  /** Jobs are counted as finished after they return, so the test has to wait for that */
+  bool finishes(const ThreadPool& pool, int priority, uint64_t count)
+  {
+    for(int i = 0; i < 200; i++)
+    {
+      const ThreadPool::Statistics            statistics = pool.getStatistics();
+      const ThreadPool::Statistics::Priority* p          = find(statistics, priority);
+      if(p != nullptr && p->finished + p->cancelled == count)
+      {
+        return true;
+      }
+      boost::this_thread::sleep(millisec(10));
+    }
+    return false;
+  }
+} // namespace
+
+//////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(ThreadPool_Statistics_Tests)
+
+BOOST_AUTO_TEST_CASE(jobs_are_counted_per_priority)
+{
+  ThreadPool pool(0);
+  pool.setName("Counted");
+  Semaphore s(0);
+
+  pool.schedule(clear(&s), PRIO_HIGH);
+  pool.schedule(clear(&s), PRIO_HIGH);
+  pool.schedule(clear(&s), PRIO_LOW);
+
+  ThreadPool::Statistics statistics = pool.getStatistics();
+  BOOST_CHECK_EQUAL("Counted", statistics.name);
+  BOOST_CHECK_EQUAL(0U, statistics.threads);
+  BOOST_REQUIRE_EQUAL(2U, statistics.priorities.size());
+  BOOST_REQUIRE(find(statistics, PRIO_HIGH));
+  BOOST_CHECK_EQUAL(2U, find(statistics, PRIO_HIGH)->queued());
+  BOOST_REQUIRE(find(statistics, PRIO_LOW));
+  BOOST_CHECK_EQUAL(1U, find(statistics, PRIO_LOW)->queued());
+
+  pool.add();
+  BOOST_CHECK(s.P(long_timeout));
+  BOOST_CHECK(s.P(long_timeout));
+  BOOST_CHECK(s.P(long_timeout));
+  BOOST_CHECK(finishes(pool, PRIO_HIGH, 2));
+  BOOST_CHECK(finishes(pool, PRIO_LOW, 1));
+
+  statistics = pool.getStatistics();
+  BOOST_CHECK_EQUAL(1U, statistics.threads);
+  const ThreadPool::Statistics::Priority* high = find(statistics, PRIO_HIGH);
+  BOOST_REQUIRE(high);
+  BOOST_CHECK_EQUAL(0U, high->queued());
+  BOOST_CHECK_EQUAL(2U, high->finished);
+  BOOST_CHECK_EQUAL(0U, high->cancelled);
+  BOOST_CHECK_EQUAL(2U, high->waitTime.count());
+  BOOST_CHECK_EQUAL(2U, high->runTime.count());
+  BOOST_CHECK_NE(std::string::npos, statistics.toString().find("Counted: 1 threads"));
+}
+
+BOOST_AUTO_TEST_CASE(jobs_of_deleted_queues_are_counted_as_cancelled)
+{
+  ThreadPool::Queue::Ptr           queue = ThreadPool::Queue::create();
+  ThreadPool::WeakQueue::Ptr const weak  = queue->getWeak();
+  ThreadPool                       pool(0);
+  Semaphore                        s(0);
+
+  pool.schedule(clear(&s), PRIO_NORMAL, weak);
+  queue.reset();
+  pool.add();
+
+  BOOST_CHECK(finishes(pool, PRIO_NORMAL, 1));
+  const ThreadPool::Statistics            statistics = pool.getStatistics();
+  const ThreadPool::Statistics::Priority* normal     = find(statistics, PRIO_NORMAL);
+  BOOST_REQUIRE(normal);
+  BOOST_CHECK_EQUAL(1U, normal->cancelled);
+  BOOST_CHECK_EQUAL(0U, normal->started);
+  BOOST_CHECK(!s.try_P());
+}
+
+BOOST_AUTO_TEST_CASE(percentiles_are_bucket_upper_bounds)
+{
+  ThreadPool::Statistics::Histogram h;
+  BOOST_CHECK_EQUAL(0, h.percentile(0.5).count());
+
+  h.buckets[0]  = 1; // Below 1us
+  h.buckets[4]  = 8; // 8us up to 16us
+  h.buckets[10] = 1; // 512us up to 1024us
+  BOOST_CHECK_EQUAL(10U, h.count());
+  BOOST_CHECK_EQUAL(1, h.percentile(0.1).count());
+  BOOST_CHECK_EQUAL(16, h.percentile(0.5).count());
+  BOOST_CHECK_EQUAL(1024, h.percentile(1.0).count());
+}
+
+BOOST_AUTO_TEST_CASE(all_statistics_include_existing_threadpools)
+{
+  ThreadPool pool(0);
+  pool.setName("Listed");
+
+  const auto all = ThreadPool::getAllStatistics();
+  BOOST_CHECK(std::any_of(all.begin(), all.end(), [](const ThreadPool::Statistics& s) { return s.name == "Listed"; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
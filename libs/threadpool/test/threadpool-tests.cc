@@ -231,6 +231,83 @@ BOOST_AUTO_TEST_SUITE_END()
 
 //////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_SUITE(WorkStealing_Tests)
+
+BOOST_AUTO_TEST_CASE(work_gets_done)
+{
+  Semaphore  s(0);
+  ThreadPool pool(0, ThreadPool::Scheduling::WORK_STEALING);
+  pool.schedule(clear(&s));
+
+  BOOST_CHECK(!s.P(long_timeout));
+  pool.add();
+  BOOST_CHECK(s.P(long_timeout));
+}
+
+BOOST_AUTO_TEST_CASE(work_gets_done_by_prio)
+{
+  Semaphore  high(0);
+  Semaphore  low(0);
+  ThreadPool pool(0, ThreadPool::Scheduling::WORK_STEALING);
+  pool.schedule(clear(&low), PRIO_NORMAL);
+  pool.schedule(pass(&low) + clear(&high), PRIO_HIGH);
+
+  pool.add();
+  BOOST_CHECK(!high.P(short_timeout));
+
+  pool.add();
+  BOOST_CHECK(high.P(long_timeout));
+}
+
+BOOST_AUTO_TEST_CASE(construct_2_threads)
+{
+  ThreadPool pool(2, ThreadPool::Scheduling::WORK_STEALING);
+  const int  expected = 2;
+#ifndef MULTITHREADING
+  expected = 1;
+#endif
+  BOOST_CHECK(has_exactly_n_threads(&pool, expected));
+}
+
+BOOST_AUTO_TEST_CASE(idle_thread_steals_work)
+{
+  Semaphore  started(0);
+  Semaphore  stolen(0);
+  Semaphore  done(0);
+  ThreadPool pool(2, ThreadPool::Scheduling::WORK_STEALING);
+
+  // The second job ends up in the queue of the thread executing the
+  // first job, which is blocked until the second job is done. Hence,
+  // it only gets done if the other thread steals it.
+  pool.schedule(
+    [&]
+    {
+      pool.schedule(clear(&stolen));
+      started.V();
+      stolen.P();
+      done.V();
+    });
+
+  BOOST_CHECK(started.P(long_timeout));
+  BOOST_CHECK(done.P(long_timeout));
+}
+
+BOOST_AUTO_TEST_CASE(deleted_queue_cancels_jobs)
+{
+  Semaphore              s(0);
+  ThreadPool             pool(0, ThreadPool::Scheduling::WORK_STEALING);
+  ThreadPool::Queue::Ptr queue = ThreadPool::Queue::create();
+  pool.schedule(clear(&s), queue);
+  queue.reset();
+
+  pool.add();
+  BOOST_CHECK(!s.P(short_timeout));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+//////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE(CpuBound_Tests)
 
 BOOST_AUTO_TEST_CASE(verify_threadcount)
@@ -0,0 +1,125 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include <fmt/core.h>
+
+#include <scroom/semaphore.hh>
+#include <scroom/threadpool.hh>
+
+using namespace Scroom;
+
+namespace
+{
+  const int JOBS        = 1000000;
+  const int FANOUT      = 64;
+  const int REPETITIONS = 3;
+
+  std::string to_string(ThreadPool::Scheduling scheduling)
+  {
+    switch(scheduling)
+    {
+    case ThreadPool::Scheduling::PRIORITY_QUEUE:
+      return "priority-queue";
+    case ThreadPool::Scheduling::WORK_STEALING:
+      return "work-stealing";
+    }
+    return "unknown";
+  }
+
+  /** Returns the best of REPETITIONS runs, in jobs per second */
+  double measure(const std::function<void()>& f)
+  {
+    double best = 0;
+    for(int i = 0; i < REPETITIONS; i++)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+      best                                          = std::max(best, JOBS / duration.count());
+    }
+    return best;
+  }
+
+  /** All jobs are scheduled from the main thread */
+  void scheduleFromOutside(ThreadPool& pool)
+  {
+    std::atomic<int> remaining(JOBS);
+    Semaphore        done(0);
+    const auto       job = [&]
+    {
+      if(--remaining == 0)
+      {
+        done.V();
+      }
+    };
+
+    for(int i = 0; i < JOBS; i++)
+    {
+      pool.schedule(job, PRIO_NORMAL);
+    }
+    done.P();
+  }
+
+  /**
+   * Jobs are scheduled from within the pool, like pyramid building does
+   *
+   * Each of JOBS / FANOUT parent jobs schedules FANOUT tiny child jobs.
+   * JOBS must be a multiple of FANOUT.
+   */
+  void scheduleFromInside(ThreadPool& pool)
+  {
+    std::atomic<int> remaining(JOBS);
+    Semaphore        done(0);
+    const auto       child = [&]
+    {
+      if(--remaining == 0)
+      {
+        done.V();
+      }
+    };
+    const auto parent = [&]
+    {
+      for(int i = 0; i < FANOUT; i++)
+      {
+        pool.schedule(child, PRIO_HIGHER);
+      }
+    };
+
+    for(int i = 0; i < JOBS / FANOUT; i++)
+    {
+      pool.schedule(parent, PRIO_NORMAL);
+    }
+    done.P();
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  // Optional argument: number of threads. Defaults to one per core
+  const int threads = argc > 1 ? std::stoi(argv[1]) : static_cast<int>(boost::thread::hardware_concurrency());
+
+  fmt::print("{} jobs on {} threads\n", JOBS, threads);
+  fmt::print("{:15} {:>15} {:>15}\n", "Scheduling", "Outside jobs/s", "Inside jobs/s");
+  for(const ThreadPool::Scheduling scheduling: {ThreadPool::Scheduling::PRIORITY_QUEUE, ThreadPool::Scheduling::WORK_STEALING})
+  {
+    ThreadPool   pool(threads, scheduling);
+    const double outside = measure([&] { scheduleFromOutside(pool); });
+    const double inside  = measure([&] { scheduleFromInside(pool); });
+
+    fmt::print("{:15} {:15.0f} {:15.0f}\n", to_string(scheduling), outside, inside);
+  }
+
+  return 0;
+}
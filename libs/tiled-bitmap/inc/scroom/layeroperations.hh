@@ -7,11 +7,23 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
 #include <scroom/colormappable.hh>
 #include <scroom/interface.hh>
 #include <scroom/pipettelayeroperations.hh>
 #include <scroom/tiledbitmapinterface.hh>
 
+namespace Scroom::Bitmap
+{
+  class BitmapSurface;
+}
+
 class CommonOperations : public LayerOperations
 {
 public:
@@ -64,18 +76,85 @@ public:
   PipetteLayerOperations::PipetteColor sumPixelValues(Scroom::Utils::Rectangle<int> area, const ConstTile::Ptr& tile) override;
 };
 
-class Operations1bpp : public CommonOperations
+/**
+ * Table for converting pixels to ARGB32, derived from a Colormap
+ *
+ * Colormaps can be modified in place, so the table is rebuilt whenever
+ * the colors differ from the ones it was built from.
+ */
+class ColormapTable
 {
+public:
+  using Table   = std::shared_ptr<const std::vector<uint32_t>>;
+  using Builder = std::function<std::vector<uint32_t>(const std::vector<Color>& colors)>;
+
 private:
+  boost::mutex       mut;
+  std::vector<Color> colors;
+  Table              table;
+
+public:
+  /** @return The table for @c colormap, calling @c build if the colormap changed */
+  Table get(const Colormap::Ptr& colormap, const Builder& build);
+};
+
+/**
+ * Operations for layers whose pixels are converted to colors using a Colormap
+ *
+ * The cached surfaces remember the ColormapTable::Table they were
+ * rendered with. If the colormap changed since, isOutdated() says so,
+ * and updateCache() renders them again from the pixels of the tile.
+ * Hence, after changing the colormap, the caches need not be cleared.
+ * draw() keeps drawing the outdated surfaces until they are updated.
+ */
+class ColormappedOperations : public CommonOperations
+{
+protected:
   ColormapProvider::Ptr colormapProvider;
+  ColormapTable         colormapTable;
 
+public:
+  explicit ColormappedOperations(ColormapProvider::Ptr colormapProvider);
+
+  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
+  Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& tile, int zoom, Scroom::Utils::Stuff& cache) override;
+  bool                 isOutdated(const Scroom::Utils::Stuff& cache) override;
+  bool                 updateCache(const ConstTile::Ptr& tile, int zoom, const Scroom::Utils::Stuff& cache) override;
+  void                 draw(cairo_t*                         cr,
+                            const ConstTile::Ptr&            tile,
+                            Scroom::Utils::Rectangle<double> tileArea,
+                            Scroom::Utils::Rectangle<double> viewArea,
+                            int                              zoom,
+                            Scroom::Utils::Stuff             cache) override;
+
+protected:
+  /** Table for converting pixels to ARGB32, given the colors of the colormap */
+  virtual std::vector<uint32_t> buildTable(const std::vector<Color>& colors) = 0;
+
+  /** Convert the pixels of @c tile to ARGB32, using @c table */
+  virtual std::shared_ptr<Scroom::Bitmap::BitmapSurface>
+    render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) = 0;
+
+  /**
+   * Convert the pixels of @c tile to ARGB32 at the given @c zoom level, using @c table
+   *
+   * The default implementation scales the result of render()
+   */
+  virtual std::shared_ptr<Scroom::Bitmap::BitmapSurface>
+    renderZoom(const ConstTile::Ptr& tile, int zoom, const std::vector<uint32_t>& table);
+
+  /** The table for the current colormap */
+  ColormapTable::Table getTable();
+};
+
+class Operations1bpp : public ColormappedOperations
+{
 public:
   static Ptr create(ColormapProvider::Ptr colormapProvider);
   explicit Operations1bpp(ColormapProvider::Ptr colormapProvider);
 
-  int                  getBpp() override;
-  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
-  void                 reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+  int  getBpp() override;
+  void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
 
   void draw(cairo_t*                         cr,
             const ConstTile::Ptr&            tile,
@@ -83,20 +162,20 @@ public:
             Scroom::Utils::Rectangle<double> viewArea,
             int                              zoom,
             Scroom::Utils::Stuff             cache) override;
+
+protected:
+  std::vector<uint32_t>                          buildTable(const std::vector<Color>& colors) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface> render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) override;
 };
 
-class Operations8bpp : public CommonOperations
+class Operations8bpp : public ColormappedOperations
 {
-private:
-  ColormapProvider::Ptr colormapProvider;
-
 public:
   static Ptr create(ColormapProvider::Ptr colormapProvider);
   explicit Operations8bpp(ColormapProvider::Ptr colormapProvider);
 
-  int                  getBpp() override;
-  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
-  void                 reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+  int  getBpp() override;
+  void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
 
   void draw(cairo_t*                         cr,
             const ConstTile::Ptr&            tile,
@@ -104,6 +183,10 @@ public:
             Scroom::Utils::Rectangle<double> viewArea,
             int                              zoom,
             Scroom::Utils::Stuff             cache) override;
+
+protected:
+  std::vector<uint32_t>                          buildTable(const std::vector<Color>& colors) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface> render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) override;
 };
 
 class Operations24bpp : public PipetteCommonOperationsRGB
@@ -117,14 +200,13 @@ public:
   void                 reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
 };
 
-class Operations : public CommonOperations
+class Operations : public ColormappedOperations
 {
 protected:
-  ColormapProvider::Ptr colormapProvider;
-  const unsigned        bpp;
-  const unsigned        pixelsPerByte;
-  const unsigned        pixelOffset;
-  const unsigned        pixelMask;
+  const unsigned bpp;
+  const unsigned pixelsPerByte;
+  const unsigned pixelOffset;
+  const unsigned pixelMask;
 
 public:
   static Ptr create(ColormapProvider::Ptr colormapProvider, int bpp);
@@ -133,9 +215,8 @@ public:
   ////////////////////////////////////////////////////////////////////////
   // LayerOperations
 
-  int                  getBpp() override;
-  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
-  void                 reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+  int  getBpp() override;
+  void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
 
   void draw(cairo_t*                         cr,
             const ConstTile::Ptr&            tile,
@@ -143,6 +224,10 @@ public:
             Scroom::Utils::Rectangle<double> viewArea,
             int                              zoom,
             Scroom::Utils::Stuff             cache) override;
+
+protected:
+  std::vector<uint32_t>                          buildTable(const std::vector<Color>& colors) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface> render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) override;
 };
 
 class OperationsColormapped : public Operations
@@ -151,24 +236,30 @@ public:
   static Ptr create(ColormapProvider::Ptr colormapProvider, int bpp);
   OperationsColormapped(ColormapProvider::Ptr colormapProvider, int bpp);
 
-  int                  getBpp() override;
-  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
-  void                 reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+  int  getBpp() override;
+  void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+
+protected:
+  std::vector<uint32_t>                          buildTable(const std::vector<Color>& colors) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface> render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) override;
 };
 
-class Operations1bppClipped : public CommonOperations
+class Operations1bppClipped : public ColormappedOperations
 {
-private:
-  ColormapProvider::Ptr colormapProvider;
-
 public:
   static Ptr create(ColormapProvider::Ptr colormapProvider);
   explicit Operations1bppClipped(ColormapProvider::Ptr colormapProvider);
 
   int                  getBpp() override;
-  Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& tile, int zoom, Scroom::Utils::Stuff& cache) override;
+  Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override;
 
   void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override;
+
+protected:
+  std::vector<uint32_t>                          buildTable(const std::vector<Color>& colors) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface> render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table) override;
+  std::shared_ptr<Scroom::Bitmap::BitmapSurface>
+    renderZoom(const ConstTile::Ptr& tile, int zoom, const std::vector<uint32_t>& table) override;
 };
 
 class OperationsCMYK32 : public PipetteCommonOperationsCMYK
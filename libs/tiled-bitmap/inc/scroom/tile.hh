@@ -50,6 +50,15 @@ public:
   int                                        bpp;
   Scroom::MemoryBlobs::RawPageData::ConstPtr data;
 
+  /**
+   * If all pixels of this tile have the same value, a small tile
+   * consisting of that same value. Otherwise empty.
+   *
+   * LayerOperations can compute caches from the small tile rather than
+   * from this one, and draw them by filling the entire tile area.
+   */
+  ConstTile::Ptr uniform;
+
 public:
   ConstTile(int width_, int height_, int bpp_, Scroom::MemoryBlobs::RawPageData::ConstPtr data_)
     : width(width_)
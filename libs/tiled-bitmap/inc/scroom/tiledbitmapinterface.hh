@@ -146,6 +146,39 @@ public:
     return {};
   }
 
+  /**
+   * Check whether a cache was made outdated by something other than the tile
+   *
+   * Some LayerOperations keep their caches when, for example, the
+   * colormap changes. draw() keeps drawing such outdated caches as
+   * they are, while the TiledBitmap has them updated in the background
+   * using updateCache().
+   *
+   * The default implementation returns @c false
+   *
+   * @param cache the output of cache() or cacheZoom()
+   */
+  virtual bool isOutdated(const Scroom::Utils::Stuff& /*cache*/) { return false; }
+
+  /**
+   * Update a cache for which isOutdated() returned @c true
+   *
+   * The cache is updated in place, as it may be shared by several
+   * views. This function is called on a worker thread, while draw()
+   * may still be drawing the outdated cache.
+   *
+   * The default implementation does nothing, and returns @c false
+   *
+   * @param tile the Tile the cache was computed for
+   * @param zoom the zoom level the cache was computed for
+   * @param cache the output of cacheZoom()
+   * @retval true if @p cache was updated, and needs to be drawn again
+   */
+  virtual bool updateCache(const ConstTile::Ptr& /*tile*/, int /*zoom*/, const Scroom::Utils::Stuff& /*cache*/)
+  {
+    return false;
+  }
+
   /**
    * Reduce the source tile by a factor of 8
    *
@@ -217,8 +250,82 @@ public:
   virtual void done() = 0;
 
   virtual std::string getName() = 0;
+
+  /**
+   * Indicate whether fillTiles() may be called concurrently
+   *
+   * By default, fillTiles() is called for one row of tiles at a time,
+   * from top to bottom. Sources that return @c true here promise that
+   * fillTiles() can be called from several threads at once, for
+   * different rows of tiles, in any order. The TiledBitmap will then
+   * load up to getLoadConcurrency() rows in parallel.
+   *
+   * done() is still called exactly once, after the last fillTiles()
+   * call has returned.
+   */
+  virtual bool supportsConcurrentFillTiles() { return false; }
+};
+
+/**
+ * Set the maximum number of tile rows that are loaded in parallel
+ *
+ * This only affects SourcePresentation objects that return @c true
+ * from SourcePresentation::supportsConcurrentFillTiles(). The default
+ * is the number of available cores. Values less than 1 are treated as
+ * 1.
+ */
+void setLoadConcurrency(int maxConcurrentRows);
+
+/**
+ * Retrieve the maximum number of tile rows that are loaded in parallel
+ *
+ * @see setLoadConcurrency()
+ */
+int getLoadConcurrency();
+
+/**
+ * Set the size of the chunks in which tiles are converted for drawing
+ *
+ * At zoom levels 0 and up, usually only part of a tile is visible.
+ * Tiles are then converted in square chunks of the given size, once
+ * they become visible. Smaller chunks make the first frame after
+ * panning or zooming in appear sooner, larger chunks have less
+ * overhead. The size is rounded down to a power of two between 64 and
+ * the tile size. The default is 256.
+ */
+void setRenderChunkSize(int size);
+
+/**
+ * Retrieve the size of the chunks in which tiles are converted for drawing
+ *
+ * @see setRenderChunkSize()
+ */
+int getRenderChunkSize();
+
+/** Time spent creating one layer of the bitmap pyramid */
+struct LayerTiming
+{
+  int    tiles{0};   /**< Number of tiles completed */
+  double seconds{0}; /**< Time spent, summed over all threads */
 };
 
+/**
+ * Retrieve the time spent creating each layer, by depth
+ *
+ * Layer 0 is filled by the SourcePresentation. Each layer above it is
+ * reduced from the one below. Times are accumulated over all bitmaps
+ * loaded since the last call to resetLayerTimings(). Meant for
+ * performance measurements.
+ */
+std::vector<LayerTiming> getLayerTimings();
+
+/**
+ * Start accumulating layer timings from scratch
+ *
+ * @see getLayerTimings()
+ */
+void resetLayerTimings();
+
 class Layer;
 
 /**
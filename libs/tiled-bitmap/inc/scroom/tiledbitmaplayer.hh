@@ -7,16 +7,20 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <boost/thread.hpp>
 
 #include <scroom/interface.hh>
 #include <scroom/memoryblobs.hh>
+#include <scroom/memorybudget.hh>
 #include <scroom/observable.hh>
 #include <scroom/presentationinterface.hh>
+#include <scroom/ranked-jobs.hh>
 #include <scroom/rectangle.hh>
 #include <scroom/stuff.hh>
 #include <scroom/threadpool.hh>
@@ -39,6 +43,7 @@ enum TileStateInternal
 };
 
 class TileViewState;
+class TileCaches;
 class CompressedTile;
 
 ////////////////////////////////////////////////////////////////////////
@@ -112,17 +117,23 @@ public:
   const int bpp;   /**< Bits per pixel of this tile. Must be a divisor of 8. */
 
 private:
-  TileStateInternal                      state;     /**< State of this tile */
-  Tile::WeakPtr                          tile;      /**< Reference to the actual Tile */
-  ConstTile::WeakPtr                     constTile; /**< Reference to the actual Tile */
-  Scroom::MemoryBlobs::PageProvider::Ptr provider;  /**< Provider of blocks of memory */
-  Scroom::MemoryBlobs::Blob::Ptr         data;      /**< Data associated with the Tile */
-  boost::mutex                           stateData; /**< Mutex protecting the state field */
-  boost::mutex                           tileData;  /**< Mutex protecting the data-related fields */
-
-  ThreadPool::Queue::WeakPtr queue; /**< Queue on which the load operation is executed */
+  TileStateInternal                              state;          /**< State of this tile */
+  Tile::WeakPtr                                  tile;           /**< Reference to the actual Tile */
+  ConstTile::WeakPtr                             constTile;      /**< Reference to the actual Tile */
+  Scroom::Utils::MemoryBudget::Entry::Ptr        constTileEntry; /**< Keeps the recently used constTile in memory */
+  Scroom::MemoryBlobs::PageProvider::Ptr         provider;       /**< Provider of blocks of memory */
+  Scroom::MemoryBlobs::Accounting::Category::Ptr category;       /**< Where the memory of data is accounted for */
+  Scroom::MemoryBlobs::Blob::Ptr                 data;           /**< Data associated with the Tile */
+  std::vector<uint8_t>                           uniform;        /**< If not empty, every pixel is this, and data is unused */
+  boost::mutex                                   stateData;      /**< Mutex protecting the state field */
+  boost::mutex                                   tileData;       /**< Mutex protecting the data-related fields */
+
+  ThreadPool::Queue::WeakPtr queue;   /**< Queue on which the load operation is executed */
+  RankedJobs::Job::Ptr       loadJob; /**< The asynchronous load operation, if any */
+  double                     rank{0}; /**< Rank of the asynchronous load operation */
 
   Scroom::Utils::WeakKeyMap<ViewInterface::WeakPtr, std::weak_ptr<TileViewState>> viewStates;
+  std::shared_ptr<TileCaches> caches; /**< Shared by all viewStates. Created when the first view needs it */
 
 private:
   CompressedTile(int                                           depth,
@@ -147,6 +158,44 @@ public:
    */
   Tile::Ptr initialize();
 
+  /**
+   * Initializes the tile data from data that was compressed earlier
+   *
+   * This changes state to TSI_NORMAL, without notifying any
+   * observers. Only tiles that are still TSI_UNINITIALIZED are changed.
+   *
+   * @see getCompressedData()
+   */
+  void restore(Scroom::MemoryBlobs::Codec codec, Scroom::MemoryBlobs::PageList pages);
+
+  /**
+   * Get the compressed tile data
+   *
+   * @return The codec used, and the pages containing the compressed
+   *    data. If the tile hasn't been initialized, or all its pixels are
+   *    the same, there are no pages.
+   */
+  std::pair<Scroom::MemoryBlobs::Codec, Scroom::MemoryBlobs::PageList> getCompressedData();
+
+  /**
+   * Initializes the tile such that all its pixels have the same value
+   *
+   * No memory is allocated for the pixel data. This changes state to
+   * TSI_NORMAL, without notifying any observers. Only tiles that are
+   * still TSI_UNINITIALIZED are changed.
+   *
+   * @param pattern The bytes every pixel consists of
+   *
+   * @see getUniformPattern()
+   */
+  void initializeUniform(std::vector<uint8_t> pattern);
+
+  /**
+   * @return The bytes every pixel consists of, or an empty vector if
+   *    the pixels are not all the same.
+   */
+  std::vector<uint8_t> getUniformPattern();
+
 protected:
   /**
    * Keep track of new TileInitialisationObserver registrations.
@@ -214,6 +263,16 @@ public:
 
   TileState getState();
 
+  /**
+   * Set the rank of the asynchronous load of this tile
+   *
+   * Tiles with a lower rank get loaded first. If the tile is visible
+   * in more than one view, the most recent rank applies.
+   *
+   * @see RankedJobs
+   */
+  void setRank(double rank);
+
   std::shared_ptr<TileViewState> getViewState(const ViewInterface::WeakPtr& vi);
 
 private:
@@ -226,6 +285,25 @@ private:
   ConstTile::Ptr do_load();
   void           notifyObservers(const ConstTile::Ptr& tile);
 
+  /**
+   * Mark @c tile as recently used with the MemoryBudget, re-registering
+   * it if it has been evicted.
+   */
+  void keepResident(const ConstTile::Ptr& tile);
+
+  /**
+   * If all pixels of the tile have the same value, drop the pixel data
+   * and store only the value.
+   */
+  void compactIfUniform();
+
+  /**
+   * Memory used by the loaded tile, for the MemoryBudget
+   *
+   * Call only while tileData is locked.
+   */
+  size_t loadedSize() const;
+
   // Viewable ////////////////////////////////////////////////////////////
 public:
   void open(ViewInterface::WeakPtr vi) override;
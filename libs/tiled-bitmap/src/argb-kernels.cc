@@ -0,0 +1,307 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "argb-kernels.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <scroom/assertions.hh>
+
+#ifdef SCROOM_X86_KERNELS
+#  include <immintrin.h>
+#endif
+
+namespace Scroom::TiledBitmap::Detail
+{
+  namespace
+  {
+    ////////////////////////////////////////////////////////////////////////
+    // Scalar
+
+    void lookup8Scalar(const uint8_t* in, uint32_t* out, size_t count, const uint32_t* lut)
+    {
+      for(size_t i = 0; i < count; i++)
+      {
+        out[i] = lut[in[i]];
+      }
+    }
+
+    void lookup16Scalar(const uint16_t* in, uint32_t* out, size_t count, const uint32_t* lut)
+    {
+      for(size_t i = 0; i < count; i++)
+      {
+        out[i] = lut[in[i]];
+      }
+    }
+
+    void rgb24Scalar(const uint8_t* in, uint32_t* out, size_t count)
+    {
+      for(size_t i = 0; i < count; i++, in += 3)
+      {
+        //          A          R             G            B
+        out[i] = 0xFF000000 | in[0] << 16 | in[1] << 8 | in[2];
+      }
+    }
+
+    void cmyk32Scalar(const uint8_t* in, uint32_t* out, size_t count)
+    {
+      for(size_t i = 0; i < count; i++, in += 4)
+      {
+        out[i] = argbFromInvertedCmyk(static_cast<uint8_t>(255 - in[0]),
+                                      static_cast<uint8_t>(255 - in[1]),
+                                      static_cast<uint8_t>(255 - in[2]),
+                                      static_cast<uint8_t>(255 - in[3]));
+      }
+    }
+
+    const ArgbKernels scalarKernels = {lookup8Scalar, lookup16Scalar, rgb24Scalar, cmyk32Scalar};
+
+    template <size_t samplesPerByte>
+    void expand(const uint8_t* in, uint32_t* out, size_t bytes, const uint32_t* table)
+    {
+      for(size_t i = 0; i < bytes; i++, out += samplesPerByte)
+      {
+        std::memcpy(out, table + in[i] * samplesPerByte, samplesPerByte * sizeof(uint32_t));
+      }
+    }
+
+    void expand(const uint8_t* in, uint32_t* out, size_t bytes, const uint32_t* table, size_t samplesPerByte)
+    {
+      switch(samplesPerByte)
+      {
+      case 1:
+        getArgbKernels().lookup8(in, out, bytes, table);
+        break;
+      case 2:
+        expand<2>(in, out, bytes, table);
+        break;
+      case 4:
+        expand<4>(in, out, bytes, table);
+        break;
+      case 8:
+        expand<8>(in, out, bytes, table);
+        break;
+      default:
+        defect();
+      }
+    }
+
+#ifdef SCROOM_X86_KERNELS
+    ////////////////////////////////////////////////////////////////////////
+    // SSE2
+    //
+    // Dividing by 255 is done as (x + 1 + (x >> 8)) >> 8, which is exact
+    // for all products of two bytes.
+
+    /** Convert two CMYK pixels, unpacked into 16-bit lanes, into two ARGB pixels in 16-bit lanes */
+    __attribute__((target("sse2"))) __m128i argbFromCmyk(__m128i v)
+    {
+      const __m128i inverted = _mm_sub_epi16(_mm_set1_epi16(255), v);
+      const __m128i k        = _mm_shufflehi_epi16(_mm_shufflelo_epi16(inverted, 0xFF), 0xFF);
+      const __m128i product  = _mm_mullo_epi16(inverted, k);
+      const __m128i quotient =
+        _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(product, _mm_set1_epi16(1)), _mm_srli_epi16(product, 8)), 8);
+
+      // C, M, Y, K becomes B, G, R, A (i.e. ARGB in little endian)
+      const __m128i bgr   = _mm_shufflehi_epi16(_mm_shufflelo_epi16(quotient, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+      const __m128i alpha = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+      const __m128i mask  = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+      return _mm_or_si128(_mm_and_si128(bgr, mask), alpha);
+    }
+
+    __attribute__((target("sse2"))) void cmyk32Sse2(const uint8_t* in, uint32_t* out, size_t count)
+    {
+      const __m128i zero = _mm_setzero_si128();
+
+      size_t i = 0;
+      for(; i + 4 <= count; i += 4)
+      {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i));
+        const __m128i low  = argbFromCmyk(_mm_unpacklo_epi8(v, zero));
+        const __m128i high = argbFromCmyk(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+      }
+      cmyk32Scalar(in + 4 * i, out + i, count - i);
+    }
+
+    // Without gather or byte shuffle instructions, there is little to
+    // gain over the scalar versions
+    const ArgbKernels sse2Kernels = {lookup8Scalar, lookup16Scalar, rgb24Scalar, cmyk32Sse2};
+
+    ////////////////////////////////////////////////////////////////////////
+    // AVX2
+
+    __attribute__((target("avx2"))) void lookup8Avx2(const uint8_t* in, uint32_t* out, size_t count, const uint32_t* lut)
+    {
+      const auto* base = reinterpret_cast<const int*>(lut);
+
+      size_t i = 0;
+      for(; i + 8 <= count; i += 8)
+      {
+        const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_i32gather_epi32(base, indices, 4));
+      }
+      lookup8Scalar(in + i, out + i, count - i, lut);
+    }
+
+    __attribute__((target("avx2"))) void lookup16Avx2(const uint16_t* in, uint32_t* out, size_t count, const uint32_t* lut)
+    {
+      const auto* base = reinterpret_cast<const int*>(lut);
+
+      size_t i = 0;
+      for(; i + 8 <= count; i += 8)
+      {
+        const __m256i indices = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_i32gather_epi32(base, indices, 4));
+      }
+      lookup16Scalar(in + i, out + i, count - i, lut);
+    }
+
+    __attribute__((target("avx2"))) void rgb24Avx2(const uint8_t* in, uint32_t* out, size_t count)
+    {
+      // R, G, B becomes B, G, R, 0 (i.e. ARGB in little endian, without alpha)
+      const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+      const __m128i alpha   = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+      // Each load of 16 bytes only uses the first 12 (4 pixels). Stop
+      // early enough not to read past the end.
+      size_t i = 0;
+      for(; i + 6 <= count; i += 4)
+      {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+      }
+      rgb24Scalar(in + 3 * i, out + i, count - i);
+    }
+
+    __attribute__((target("avx2"))) __m256i argbFromCmyk(__m256i v)
+    {
+      const __m256i inverted = _mm256_sub_epi16(_mm256_set1_epi16(255), v);
+      const __m256i k        = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(inverted, 0xFF), 0xFF);
+      const __m256i product  = _mm256_mullo_epi16(inverted, k);
+      const __m256i quotient =
+        _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(product, _mm256_set1_epi16(1)), _mm256_srli_epi16(product, 8)), 8);
+
+      const __m256i bgr =
+        _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(quotient, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+      const __m256i alpha = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+      const __m256i mask  = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+      return _mm256_or_si256(_mm256_and_si256(bgr, mask), alpha);
+    }
+
+    __attribute__((target("avx2"))) void cmyk32Avx2(const uint8_t* in, uint32_t* out, size_t count)
+    {
+      const __m256i zero = _mm256_setzero_si256();
+
+      // Unpacking and packing both work per 128-bit lane, so the order
+      // of the pixels is preserved
+      size_t i = 0;
+      for(; i + 8 <= count; i += 8)
+      {
+        const __m256i v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i));
+        const __m256i low  = argbFromCmyk(_mm256_unpacklo_epi8(v, zero));
+        const __m256i high = argbFromCmyk(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(low, high));
+      }
+      cmyk32Sse2(in + 4 * i, out + i, count - i);
+    }
+
+    const ArgbKernels avx2Kernels = {lookup8Avx2, lookup16Avx2, rgb24Avx2, cmyk32Avx2};
+#endif
+  } // namespace
+
+  const ArgbKernels& getArgbKernels(InstructionSet instructionSet)
+  {
+    require(isAvailable(instructionSet));
+
+    switch(instructionSet)
+    {
+    case InstructionSet::SCALAR:
+      return scalarKernels;
+#ifdef SCROOM_X86_KERNELS
+    case InstructionSet::SSE2:
+      return sse2Kernels;
+    case InstructionSet::AVX2:
+      return avx2Kernels;
+#else
+    case InstructionSet::SSE2:
+    case InstructionSet::AVX2:
+      break;
+#endif
+    }
+    defect();
+  }
+
+  const ArgbKernels& getArgbKernels()
+  {
+    static const ArgbKernels& best = getArgbKernels(bestInstructionSet());
+    return best;
+  }
+
+  std::vector<uint32_t> createExpansionTable(int bitsPerSample, const std::function<uint32_t(unsigned int)>& argb)
+  {
+    if(bitsPerSample == 16)
+    {
+      std::vector<uint32_t> table(1 << 16);
+      for(unsigned int sample = 0; sample < table.size(); sample++)
+      {
+        table[sample] = argb(sample);
+      }
+      return table;
+    }
+
+    require(bitsPerSample == 1 || bitsPerSample == 2 || bitsPerSample == 4 || bitsPerSample == 8);
+    const unsigned int samplesPerByte = 8 / bitsPerSample;
+    const unsigned int mask           = (1u << bitsPerSample) - 1;
+
+    std::vector<uint32_t> table(256 * samplesPerByte);
+    for(unsigned int byte = 0; byte < 256; byte++)
+    {
+      for(unsigned int s = 0; s < samplesPerByte; s++)
+      {
+        const unsigned int shift         = (samplesPerByte - 1 - s) * bitsPerSample;
+        table[byte * samplesPerByte + s] = argb((byte >> shift) & mask);
+      }
+    }
+    return table;
+  }
+
+  void expandBytes(const uint8_t* in, uint32_t* out, size_t count, const uint32_t* table, int bitsPerSample)
+  {
+    const size_t samplesPerByte = 8 / bitsPerSample;
+    const size_t bytes          = count / samplesPerByte;
+    const size_t remainder      = count % samplesPerByte;
+
+    expand(in, out, bytes, table, samplesPerByte);
+    if(remainder)
+    {
+      std::memcpy(out + bytes * samplesPerByte, table + in[bytes] * samplesPerByte, remainder * sizeof(uint32_t));
+    }
+  }
+
+  void expandWords(const uint16_t* in, uint32_t* out, size_t count, const uint32_t* table, int bitsPerSample)
+  {
+    if(bitsPerSample == 16)
+    {
+      getArgbKernels().lookup16(in, out, count, table);
+      return;
+    }
+
+    // The most significant byte of each word comes first
+    const size_t samplesPerByte = 8 / bitsPerSample;
+    for(size_t done = 0; done < count; in++)
+    {
+      for(const uint8_t byte: {static_cast<uint8_t>(*in >> 8), static_cast<uint8_t>(*in & 0xFF)})
+      {
+        const size_t n = std::min(samplesPerByte, count - done);
+        std::memcpy(out + done, table + byte * samplesPerByte, n * sizeof(uint32_t));
+        done += n;
+      }
+    }
+  }
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,95 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "instruction-set.hh"
+
+/**
+ * Kernels for converting tiles to ARGB32, for use by
+ * LayerOperations::cache()
+ *
+ * Formats with few bits per pixel are converted using lookup tables,
+ * formats with many bits per pixel are converted directly. There is a
+ * scalar version of each kernel, and, on x86, SSE2 and AVX2 versions.
+ * All versions produce identical output.
+ */
+namespace Scroom::TiledBitmap::Detail
+{
+  /** Replace each byte in @c in by the corresponding entry of the 256-entry @c lut */
+  using Lookup8 = void (*)(const uint8_t* in, uint32_t* out, size_t count, const uint32_t* lut);
+
+  /** Replace each word in @c in by the corresponding entry of the 65536-entry @c lut */
+  using Lookup16 = void (*)(const uint16_t* in, uint32_t* out, size_t count, const uint32_t* lut);
+
+  /** Convert @c count pixels */
+  using Convert = void (*)(const uint8_t* in, uint32_t* out, size_t count);
+
+  struct ArgbKernels
+  {
+    Lookup8  lookup8;
+    Lookup16 lookup16;
+    Convert  rgb24;  /**< RGB to opaque ARGB */
+    Convert  cmyk32; /**< CMYK to opaque ARGB, as argbFromInvertedCmyk() */
+  };
+
+  /**
+   * @return The kernels for the given instruction set.
+   *
+   * @pre isAvailable(instructionSet)
+   */
+  const ArgbKernels& getArgbKernels(InstructionSet instructionSet);
+
+  /** @return The fastest kernels the current CPU supports */
+  const ArgbKernels& getArgbKernels();
+
+  /**
+   * Convert inverted CMYK values (i.e. 255 - C etc.) to opaque ARGB
+   *
+   * R = (255 - C) * (255 - K) / 255, and similarly for G and B.
+   */
+  inline uint32_t argbFromInvertedCmyk(uint8_t C_i, uint8_t M_i, uint8_t Y_i, uint8_t K_i)
+  {
+    const uint32_t R = (C_i * K_i) / 255;
+    const uint32_t G = (M_i * K_i) / 255;
+    const uint32_t B = (Y_i * K_i) / 255;
+
+    return 255u << 24 | R << 16 | G << 8 | B;
+  }
+
+  /**
+   * Create a table for converting samples to ARGB
+   *
+   * For @c bitsPerSample of 8 or less, the table contains, for each
+   * possible byte, the ARGB values of all samples in that byte, most
+   * significant sample first. For 16 @c bitsPerSample, it contains the
+   * ARGB value of each sample.
+   *
+   * @param bitsPerSample One of 1, 2, 4, 8 or 16
+   * @param argb Computes the ARGB value of a sample
+   */
+  std::vector<uint32_t> createExpansionTable(int bitsPerSample, const std::function<uint32_t(unsigned int)>& argb);
+
+  /**
+   * Convert @c count samples, packed into bytes most significant first,
+   * using a table created by createExpansionTable()
+   */
+  void expandBytes(const uint8_t* in, uint32_t* out, size_t count, const uint32_t* table, int bitsPerSample);
+
+  /**
+   * Convert @c count samples, packed into native 16-bit words most
+   * significant first, using a table created by createExpansionTable()
+   *
+   * This matches the way SampleIterator<const uint16_t> reads samples.
+   */
+  void expandWords(const uint16_t* in, uint32_t* out, size_t count, const uint32_t* table, int bitsPerSample);
+} // namespace Scroom::TiledBitmap::Detail
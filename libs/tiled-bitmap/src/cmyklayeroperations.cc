@@ -5,8 +5,11 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <array>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include <cairo.h>
 
@@ -17,6 +20,11 @@
 #include <scroom/stuff.hh>
 #include <scroom/tile.hh>
 
+#include "argb-kernels.hh"
+#include "reduce-kernels.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
 ////////////////////////////////////////////////////////////////////////
 // OperationsCMYK32
 
@@ -38,26 +46,9 @@ Scroom::Utils::Stuff OperationsCMYK32::cache(const ConstTile::Ptr& tile)
   const int                      stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
   std::shared_ptr<uint8_t> const data   = Scroom::Utils::shared_malloc(static_cast<size_t>(stride * tile->height));
 
-  // Row is a pointer to a row of pixels (destination)
-  auto* row = reinterpret_cast<uint32_t*>(data.get());
-  // Cur is a pointer to the start of the row in the tile (source)
-  const uint8_t* cur = tile->data.get();
-
-  for(int i = 0; i < 4 * tile->height * tile->width; i += 4)
-  {
-    // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
-    auto C_i = static_cast<uint8_t>(255 - cur[i]);
-    auto M_i = static_cast<uint8_t>(255 - cur[i + 1]);
-    auto Y_i = static_cast<uint8_t>(255 - cur[i + 2]);
-    auto K_i = static_cast<uint8_t>(255 - cur[i + 3]);
-
-    uint32_t const R = static_cast<uint8_t>((C_i * K_i) / 255);
-    uint32_t const G = static_cast<uint8_t>((M_i * K_i) / 255);
-    uint32_t const B = static_cast<uint8_t>((Y_i * K_i) / 255);
-
-    // Write 255 as alpha (fully opaque)
-    row[i / 4] = 255u << 24 | R << 16 | G << 8 | B;
-  }
+  // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
+  // Assumes stride == tile->width * 4
+  getArgbKernels().cmyk32(tile->data.get(), reinterpret_cast<uint32_t*>(data.get()), tile->height * tile->width);
 
   return Scroom::Bitmap::BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
 }
@@ -71,39 +62,12 @@ void OperationsCMYK32::reduce(Tile::Ptr target, const ConstTile::Ptr source, int
   const int targetStride = 8 * target->width / 2; // stride in bytes
   byte*     targetBase   = target->data.get() + (target->height * top_left_y + top_left_x) * targetStride / 8;
 
+  // Each target pixel gets the average colour of the corresponding
+  // 8*8 source pixels
+  const auto reduceRow = getReduceKernels().reduceCMYK32;
   for(int y = 0; y < source->height / 8; y++)
   {
-    byte* targetPtr = targetBase;
-
-    for(int x = 0; x < source->width / 8; x++)
-    {
-      // We want to store the average colour of the 8*8 pixel image
-      // with (x, y) as its top-left corner into targetPtr.
-      const byte* base = sourceBase + 8 * 4 * x;  // start of the row
-      const byte* end  = base + 8 * sourceStride; // end of the row
-
-      int sum_c = 0;
-      int sum_m = 0;
-      int sum_y = 0;
-      int sum_k = 0;
-      for(const byte* row = base; row < end; row += sourceStride)
-      {
-        for(size_t current = 0; current < 8 * 4; current += 4)
-        {
-          sum_c += row[current];
-          sum_m += row[current + 1];
-          sum_y += row[current + 2];
-          sum_k += row[current + 3];
-        }
-      }
-
-      targetPtr[0] = static_cast<byte>(sum_c / 64);
-      targetPtr[1] = static_cast<byte>(sum_m / 64);
-      targetPtr[2] = static_cast<byte>(sum_y / 64);
-      targetPtr[3] = static_cast<byte>(sum_k / 64);
-
-      targetPtr += 4;
-    }
+    reduceRow(sourceBase, sourceStride, targetBase, source->width / 8);
 
     targetBase += targetStride;
     sourceBase += sourceStride * 8;
@@ -131,26 +95,29 @@ Scroom::Utils::Stuff OperationsCMYK16::cache(const ConstTile::Ptr& tile)
   const int                      stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
   std::shared_ptr<uint8_t> const data   = Scroom::Utils::shared_malloc(static_cast<size_t>(stride * tile->height));
 
-  // Row is a pointer to a row of pixels (destination)
-  auto* row = reinterpret_cast<uint32_t*>(data.get());
-  // Cur is a pointer to the start of the row in the tile (source)
-  const uint8_t* cur = tile->data.get();
-
-  for(int i = 0; i < 2 * tile->height * tile->width; i += 2)
-  {
-    // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
-    auto C_i = static_cast<uint8_t>(255 - ((cur[i]) >> 4) * 17); // 17 == 255/15
-    auto M_i = static_cast<uint8_t>(255 - ((cur[i] & 0x0F)) * 17);
-    auto Y_i = static_cast<uint8_t>(255 - ((cur[i + 1]) >> 4) * 17);
-    auto K_i = static_cast<uint8_t>(255 - ((cur[i + 1] & 0x0F)) * 17);
-
-    uint32_t const R = static_cast<uint8_t>((C_i * K_i) / 255);
-    uint32_t const G = static_cast<uint8_t>((M_i * K_i) / 255);
-    uint32_t const B = static_cast<uint8_t>((Y_i * K_i) / 255);
-
-    // Write 255 as alpha (fully opaque)
-    row[i / 2] = 255u << 24 | R << 16 | G << 8 | B;
-  }
+  // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
+  // Assumes stride == tile->width * 4
+  static const std::vector<uint32_t> table = createExpansionTable(
+    16,
+    [](unsigned int value)
+    {
+      // Samples are words in native byte order. Interpret them as the bytes they are in memory
+      const auto             word = static_cast<uint16_t>(value);
+      std::array<uint8_t, 2> cur{};
+      std::memcpy(cur.data(), &word, sizeof(word));
+
+      auto C_i = static_cast<uint8_t>(255 - ((cur[0]) >> 4) * 17); // 17 == 255/15
+      auto M_i = static_cast<uint8_t>(255 - ((cur[0] & 0x0F)) * 17);
+      auto Y_i = static_cast<uint8_t>(255 - ((cur[1]) >> 4) * 17);
+      auto K_i = static_cast<uint8_t>(255 - ((cur[1] & 0x0F)) * 17);
+      return argbFromInvertedCmyk(C_i, M_i, Y_i, K_i);
+    });
+
+  expandWords(reinterpret_cast<const uint16_t*>(tile->data.get()),
+              reinterpret_cast<uint32_t*>(data.get()),
+              tile->height * tile->width,
+              table.data(),
+              16);
 
   return Scroom::Bitmap::BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
 }
@@ -224,27 +191,20 @@ Scroom::Utils::Stuff OperationsCMYK8::cache(const ConstTile::Ptr& tile)
   const int                      stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
   std::shared_ptr<uint8_t> const data   = Scroom::Utils::shared_malloc(static_cast<size_t>(stride * tile->height));
 
-  // Row is a pointer to a row of pixels (destination)
-  auto* row = reinterpret_cast<uint32_t*>(data.get());
-  // Cur is a pointer to the start of the row in the tile (source)
-  const uint8_t* cur = tile->data.get();
+  // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
+  // Assumes stride == tile->width * 4
+  static const std::vector<uint32_t> table = createExpansionTable(
+    8,
+    [](unsigned int cur)
+    {
+      auto C_i = static_cast<uint8_t>(255 - ((cur) >> 6) * 85); // 85 == 255/3
+      auto M_i = static_cast<uint8_t>(255 - ((cur & 0x30) >> 4) * 85);
+      auto Y_i = static_cast<uint8_t>(255 - ((cur & 0x0C) >> 2) * 85);
+      auto K_i = static_cast<uint8_t>(255 - ((cur & 0x03)) * 85);
+      return argbFromInvertedCmyk(C_i, M_i, Y_i, K_i);
+    });
 
-  // assume stride = tile->width * 4
-  for(int i = 0; i < tile->height * tile->width; i++)
-  {
-    // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
-    auto C_i = static_cast<uint8_t>(255 - ((cur[i]) >> 6) * 85); // 85 == 255/3
-    auto M_i = static_cast<uint8_t>(255 - ((cur[i] & 0x30) >> 4) * 85);
-    auto Y_i = static_cast<uint8_t>(255 - ((cur[i] & 0x0C) >> 2) * 85);
-    auto K_i = static_cast<uint8_t>(255 - ((cur[i] & 0x03)) * 85);
-
-    uint32_t const R = static_cast<uint8_t>((C_i * K_i) / 255);
-    uint32_t const G = static_cast<uint8_t>((M_i * K_i) / 255);
-    uint32_t const B = static_cast<uint8_t>((Y_i * K_i) / 255);
-
-    // Write 255 as alpha (fully opaque)
-    row[i] = 255u << 24 | R << 16 | G << 8 | B;
-  }
+  expandBytes(tile->data.get(), reinterpret_cast<uint32_t*>(data.get()), tile->height * tile->width, table.data(), 8);
 
   return Scroom::Bitmap::BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
 }
@@ -318,44 +278,21 @@ Scroom::Utils::Stuff OperationsCMYK4::cache(const ConstTile::Ptr& tile)
   const int                      stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
   std::shared_ptr<uint8_t> const data   = Scroom::Utils::shared_malloc(static_cast<size_t>(stride * tile->height));
 
-  // Row is a pointer to a row of pixels (destination)
-  auto* row = reinterpret_cast<uint32_t*>(data.get());
-  // Cur is a pointer to the start of the row in the tile (source)
-  const uint8_t* cur = tile->data.get();
-
-  // assume stride = tile->width * 4
-  for(int i = 0; i < tile->height * tile->width; i++)
-  {
-    // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
-    uint8_t C_i;
-
-    uint8_t M_i;
-
-    uint8_t Y_i;
-
-    uint8_t K_i;
-    if((i & 1) == 0)
-    {                                                      // even pixels -> top half of byte
-      C_i = static_cast<uint8_t>(((cur[i / 2]) >> 7) - 1); // 0 -> 255 (= -1), 1 -> 0
-      M_i = static_cast<uint8_t>(((cur[i / 2] & 0x40) >> 6) - 1);
-      Y_i = static_cast<uint8_t>(((cur[i / 2] & 0x20) >> 5) - 1);
-      K_i = static_cast<uint8_t>(((cur[i / 2] & 0x10) >> 4) - 1);
-    }
-    else
-    {                                                             // odd pixels -> lower half of the byte
-      C_i = static_cast<uint8_t>(((cur[i / 2] & 0x08) >> 3) - 1); // 0 -> 255 (= -1), 1 -> 0
-      M_i = static_cast<uint8_t>(((cur[i / 2] & 0x04) >> 2) - 1);
-      Y_i = static_cast<uint8_t>(((cur[i / 2] & 0x02) >> 1) - 1);
-      K_i = static_cast<uint8_t>(((cur[i / 2] & 0x01)) - 1);
-    }
-
-    uint32_t const R = static_cast<uint8_t>((C_i * K_i) / 255);
-    uint32_t const G = static_cast<uint8_t>((M_i * K_i) / 255);
-    uint32_t const B = static_cast<uint8_t>((Y_i * K_i) / 255);
-
-    // Write 255 as alpha (fully opaque)
-    row[i] = 255u << 24 | R << 16 | G << 8 | B;
-  }
+  // Convert CMYK to ARGB, because cairo doesn't know how to render CMYK.
+  // Assumes stride == tile->width * 4. Even pixels are in the top half
+  // of each byte, odd pixels in the lower half.
+  static const std::vector<uint32_t> table = createExpansionTable(
+    4,
+    [](unsigned int cur)
+    {
+      auto C_i = static_cast<uint8_t>(((cur & 0x08) >> 3) - 1); // 0 -> 255 (= -1), 1 -> 0
+      auto M_i = static_cast<uint8_t>(((cur & 0x04) >> 2) - 1);
+      auto Y_i = static_cast<uint8_t>(((cur & 0x02) >> 1) - 1);
+      auto K_i = static_cast<uint8_t>(((cur & 0x01)) - 1);
+      return argbFromInvertedCmyk(C_i, M_i, Y_i, K_i);
+    });
+
+  expandBytes(tile->data.get(), reinterpret_cast<uint32_t*>(data.get()), tile->height * tile->width, table.data(), 4);
 
   return Scroom::Bitmap::BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
 }
@@ -9,13 +9,18 @@
 #include <memory>
 #include <utility>
 
+#include <fmt/format.h>
+
+#include <scroom/memorybudget.hh>
 #include <scroom/tiledbitmaplayer.hh>
 
 #include "local.hh"
 #include "tileviewstate.hh"
+#include "uniform-tiles.hh"
 
 using namespace Scroom::Utils;
 using namespace Scroom::MemoryBlobs;
+using namespace Scroom::TiledBitmap::Detail;
 
 ////////////////////////////////////////////////////////////////////////
 /// CompressedTile
@@ -26,7 +31,8 @@ CompressedTile::CompressedTile(int depth_, int x_, int y_, int bpp_, const PageP
   , bpp(bpp_)
   , state(state_)
   , provider(provider_)
-  , data(Blob::create(provider_, TILESIZE * TILESIZE * bpp / 8))
+  , category(Accounting::getCategory(fmt::format("Layer {}, {} bpp", depth, bpp)))
+  , data(Blob::create(provider_, TILESIZE * TILESIZE * bpp / 8, category))
 {
 }
 
@@ -49,6 +55,10 @@ ConstTile::Ptr CompressedTile::getConstTileSync()
   {
     result = do_load();
   }
+  else
+  {
+    keepResident(result);
+  }
 
   return result;
 }
@@ -74,6 +84,15 @@ Tile::Ptr CompressedTile::getTileSync()
     if(!result)
     {
       boost::mutex::scoped_lock const lock(tileData);
+      if(!uniform.empty())
+      {
+        // The tile may be modified, so it needs pixels of its own
+        RawPageData::Ptr const pixels = data->initialize(0);
+        fillPattern(pixels.get(), TILESIZE * TILESIZE * bpp / 8, uniform);
+        uniform.clear();
+        constTile.reset();
+        constTileEntry.reset();
+      }
       result = std::make_shared<Tile>(TILESIZE, TILESIZE, bpp, data->get());
       tile   = result;
     }
@@ -85,9 +104,32 @@ Tile::Ptr CompressedTile::getTileSync()
 ConstTile::Ptr CompressedTile::getConstTileAsync()
 {
   ConstTile::Ptr result = constTile.lock();
+  if(result)
+  {
+    keepResident(result);
+  }
   return result;
 }
 
+void CompressedTile::keepResident(const ConstTile::Ptr& tile_)
+{
+  boost::mutex::scoped_lock const lock(tileData);
+  if(constTileEntry && constTileEntry->isResident())
+  {
+    constTileEntry->touch();
+  }
+  else
+  {
+    constTileEntry = MemoryBudget::instance()->retain(tile_, loadedSize());
+  }
+}
+
+size_t CompressedTile::loadedSize() const
+{
+  // Uniform tiles share their pixel data
+  return uniform.empty() ? TILESIZE * TILESIZE * bpp / 8 : 0;
+}
+
 Tile::Ptr CompressedTile::initialize()
 {
   Scroom::Utils::Stuff s;
@@ -114,8 +156,87 @@ Tile::Ptr CompressedTile::initialize()
   return tile_;
 }
 
+void CompressedTile::restore(Codec codec, PageList pages)
+{
+  boost::mutex::scoped_lock const stateLock(stateData);
+  boost::mutex::scoped_lock const dataLock(tileData);
+
+  if(state == TSI_UNINITIALIZED)
+  {
+    data  = Blob::create(provider, TILESIZE * TILESIZE * bpp / 8, codec, std::move(pages), category);
+    state = TSI_NORMAL;
+  }
+}
+
+void CompressedTile::initializeUniform(std::vector<uint8_t> pattern)
+{
+  boost::mutex::scoped_lock const stateLock(stateData);
+  boost::mutex::scoped_lock const dataLock(tileData);
+
+  if(state == TSI_UNINITIALIZED)
+  {
+    uniform = std::move(pattern);
+    state   = TSI_NORMAL;
+  }
+}
+
+std::vector<uint8_t> CompressedTile::getUniformPattern()
+{
+  boost::mutex::scoped_lock const dataLock(tileData);
+  return uniform;
+}
+
+std::pair<Codec, PageList> CompressedTile::getCompressedData()
+{
+  Blob::Ptr data_;
+  {
+    boost::mutex::scoped_lock const stateLock(stateData);
+    boost::mutex::scoped_lock const dataLock(tileData);
+    if(state == TSI_UNINITIALIZED || state == TSI_OUT_OF_BOUNDS || !uniform.empty())
+    {
+      return {Codec::RAW, {}};
+    }
+    data_ = data;
+  }
+  return data_->getCompressed();
+}
+
+void CompressedTile::compactIfUniform()
+{
+  const size_t size = TILESIZE * TILESIZE * bpp / 8;
+
+  Blob::Ptr data_;
+  {
+    boost::mutex::scoped_lock const dataLock(tileData);
+    if(!uniform.empty())
+    {
+      return;
+    }
+    data_ = data;
+  }
+
+  RawPageData::ConstPtr const pixels  = data_->getConst();
+  std::vector<uint8_t>        pattern = detectUniform(pixels.get(), size, bpp);
+  if(!pattern.empty())
+  {
+    boost::mutex::scoped_lock const dataLock(tileData);
+    if(data == data_)
+    {
+      // Replacing the Blob releases its pages, as soon as whoever
+      // filled the tile lets go of it.
+      uniform = std::move(pattern);
+      data    = Blob::create(provider, size, category);
+      tile.reset();
+      constTile.reset();
+      constTileEntry.reset();
+    }
+  }
+}
+
 void CompressedTile::reportFinished()
 {
+  compactIfUniform();
+
   CompressedTile::Ptr const me = shared_from_this<CompressedTile>();
   ConstTile::Ptr const      t  = do_load();
   for(const TileInitialisationObserver::Ptr& observer: Observable<TileInitialisationObserver>::getObservers())
@@ -143,9 +264,11 @@ ConstTile::Ptr CompressedTile::do_load()
     result = constTile.lock(); // This ought to fail
     if(!result)
     {
-      result    = std::make_shared<ConstTile>(TILESIZE, TILESIZE, bpp, data->getConst());
-      constTile = result;
-      didLoad   = true;
+      result         = uniform.empty() ? std::make_shared<ConstTile>(TILESIZE, TILESIZE, bpp, data->getConst())
+                                       : createUniformTile(TILESIZE, TILESIZE, bpp, uniform);
+      constTile      = result;
+      constTileEntry = MemoryBudget::instance()->retain(result, loadedSize());
+      didLoad        = true;
     }
   }
   {
@@ -161,13 +284,27 @@ ConstTile::Ptr CompressedTile::do_load()
   return result;
 }
 
+void CompressedTile::setRank(double rank_)
+{
+  boost::mutex::scoped_lock const lock(stateData);
+  rank = rank_;
+  if(loadJob)
+  {
+    loadJob->setRank(rank);
+  }
+}
+
 TileViewState::Ptr CompressedTile::getViewState(const ViewInterface::WeakPtr& vi)
 {
   TileViewState::Ptr result = viewStates[vi].lock();
 
   if(!result)
   {
-    result         = TileViewState::create(shared_from_this<CompressedTile>());
+    if(!caches)
+    {
+      caches = TileCaches::create();
+    }
+    result         = TileViewState::create(shared_from_this<CompressedTile>(), caches);
     viewStates[vi] = result;
   }
 
@@ -240,7 +377,7 @@ void CompressedTile::observerAdded(TileLoadingObserver::Ptr const& observer, Scr
         queue_ = ThreadPool::Queue::create();
         queue  = queue_;
       }
-      CpuBound()->schedule([this] { do_load(); }, LOAD_PRIO, queue_);
+      loadJob = LoadJobs()->schedule([this] { do_load(); }, rank, queue_);
       state = TSI_LOADING_ASYNCHRONOUSLY;
 
       break;
@@ -0,0 +1,64 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "instruction-set.hh"
+
+#include <scroom/assertions.hh>
+
+namespace Scroom::TiledBitmap::Detail
+{
+  std::string to_string(InstructionSet instructionSet)
+  {
+    switch(instructionSet)
+    {
+    case InstructionSet::SCALAR:
+      return "scalar";
+    case InstructionSet::SSE2:
+      return "SSE2";
+    case InstructionSet::AVX2:
+      return "AVX2";
+    }
+    defect();
+  }
+
+  bool isAvailable(InstructionSet instructionSet)
+  {
+    switch(instructionSet)
+    {
+    case InstructionSet::SCALAR:
+      return true;
+#ifdef SCROOM_X86_KERNELS
+    case InstructionSet::SSE2:
+      return __builtin_cpu_supports("sse2");
+    case InstructionSet::AVX2:
+      return __builtin_cpu_supports("avx2");
+#else
+    case InstructionSet::SSE2:
+    case InstructionSet::AVX2:
+      return false;
+#endif
+    }
+    defect();
+  }
+
+  InstructionSet bestInstructionSet()
+  {
+    static const InstructionSet best = []
+    {
+      for(const InstructionSet instructionSet: {InstructionSet::AVX2, InstructionSet::SSE2})
+      {
+        if(isAvailable(instructionSet))
+        {
+          return instructionSet;
+        }
+      }
+      return InstructionSet::SCALAR;
+    }();
+
+    return best;
+  }
+} // namespace Scroom::TiledBitmap::Detail
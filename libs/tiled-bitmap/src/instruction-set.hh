@@ -0,0 +1,34 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <string>
+
+#if(defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+/** Defined if SSE2 and AVX2 kernels are built, using @c __attribute__((target)) */
+#  define SCROOM_X86_KERNELS
+#endif
+
+namespace Scroom::TiledBitmap::Detail
+{
+  /** Instruction sets that the pixel kernels can be built for */
+  enum class InstructionSet
+  {
+    SCALAR,
+    SSE2,
+    AVX2
+  };
+
+  std::string to_string(InstructionSet instructionSet);
+
+  /** @return @c true if this build and the current CPU support @c instructionSet */
+  bool isAvailable(InstructionSet instructionSet);
+
+  /** @return The most capable instruction set the current CPU supports */
+  InstructionSet bestInstructionSet();
+} // namespace Scroom::TiledBitmap::Detail
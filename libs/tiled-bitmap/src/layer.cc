@@ -5,12 +5,18 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <utility>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <scroom/impl/threadpoolimpl.hh>
 #include <scroom/memoryblobs.hh>
 #include <scroom/stuff.hh>
@@ -18,6 +24,7 @@
 #include <scroom/tile.hh>
 #include <scroom/tiledbitmapinterface.hh>
 #include <scroom/tiledbitmaplayer.hh>
+#include <scroom/trace.hh>
 #include <scroom/viewinterface.hh>
 
 #include "local.hh"
@@ -39,27 +46,85 @@ static Scroom::MemoryBlobs::PageProvider::Ptr createProvider(double width, doubl
 }
 
 
-class DataFetcher
+namespace
 {
-private:
+  std::atomic<int> loadConcurrency{static_cast<int>(std::max(1U, boost::thread::hardware_concurrency()))};
+
+  boost::mutex             layerTimingsMutex;
+  std::vector<LayerTiming> layerTimings;
+} // namespace
+
+void setLoadConcurrency(int maxConcurrentRows) { loadConcurrency = std::max(1, maxConcurrentRows); }
+
+int getLoadConcurrency() { return loadConcurrency; }
+
+std::vector<LayerTiming> getLayerTimings()
+{
+  boost::mutex::scoped_lock const lock(layerTimingsMutex);
+  return layerTimings;
+}
+
+void resetLayerTimings()
+{
+  boost::mutex::scoped_lock const lock(layerTimingsMutex);
+  layerTimings.clear();
+}
+
+void addLayerTiming(int depth, double seconds, int tiles)
+{
+  boost::mutex::scoped_lock const lock(layerTimingsMutex);
+  const auto index = static_cast<size_t>(depth);
+  if(layerTimings.size() <= index)
+  {
+    layerTimings.resize(index + 1);
+  }
+  layerTimings[index].seconds += seconds;
+  layerTimings[index].tiles += tiles;
+}
+
+/**
+ * Administration shared by all DataFetcher instances loading one Layer
+ */
+class DataFetchState
+{
+public:
+  using Ptr = std::shared_ptr<DataFetchState>;
+
   Layer::Ptr                 layer;
   int                        height;
   int                        horTileCount;
   int                        verTileCount;
-  int                        currentRow{0};
   SourcePresentation::Ptr    sp;
   ThreadPool::Ptr            threadPool;
   ThreadPool::WeakQueue::Ptr queue;
   std::function<void()>      on_finished;
 
+  std::atomic<int> nextRow{0};
+  std::atomic<int> unfinishedRows;
+
+  DataFetchState(Layer::Ptr                 layer,
+                 int                        height,
+                 int                        horTileCount,
+                 int                        verTileCount,
+                 SourcePresentation::Ptr    sp,
+                 ThreadPool::WeakQueue::Ptr queue,
+                 std::function<void()>      on_finished);
+};
+
+/**
+ * Fetch rows of tiles from the SourcePresentation, until there are none left
+ *
+ * Several DataFetcher instances may share one DataFetchState. Each
+ * of them claims the next unfetched row, so rows are started in
+ * top-to-bottom order, but may be fetched concurrently.
+ */
+class DataFetcher
+{
+private:
+  DataFetchState::Ptr state;
+
 public:
-  DataFetcher(Layer::Ptr                 layer,
-              int                        height,
-              int                        horTileCount,
-              int                        verTileCount,
-              SourcePresentation::Ptr    sp,
-              ThreadPool::WeakQueue::Ptr queue,
-              std::function<void()>      on_finished);
+  explicit DataFetcher(DataFetchState::Ptr state);
 
   void operator()();
 };
@@ -147,9 +212,23 @@ CompressedTileLine& Layer::getTileLine(int j)
 
 void Layer::fetchData(SourcePresentation::Ptr sp, const ThreadPool::WeakQueue::Ptr& queue, std::function<void()> on_finished)
 {
-  DataFetcher const df(
+  if(verTileCount == 0)
+  {
+    sp->done();
+    on_finished();
+    return;
+  }
+
+  const int fetcherCount = sp->supportsConcurrentFillTiles() ? std::min(getLoadConcurrency(), verTileCount) : 1;
+
+  auto state = std::make_shared<DataFetchState>(
     shared_from_this<Layer>(), height, horTileCount, verTileCount, std::move(sp), queue, std::move(on_finished));
-  CpuBound()->schedule(df, DATAFETCH_PRIO, queue);
+
+  spdlog::debug("Fetching {} rows of tiles using {} fetchers", verTileCount, fetcherCount);
+  for(int i = 0; i < fetcherCount; i++)
+  {
+    CpuBound()->schedule(DataFetcher(state), DATAFETCH_PRIO, queue);
+  }
 }
 
 // Layer::Viewable /////////////////////////////////////////////////////
@@ -187,15 +266,15 @@ void Layer::close(ViewInterface::WeakPtr vi)
 }
 
 ////////////////////////////////////////////////////////////////////////
-/// DataFetcher
-
-DataFetcher::DataFetcher(Layer::Ptr                 layer_,
-                         int                        height_,
-                         int                        horTileCount_,
-                         int                        verTileCount_,
-                         SourcePresentation::Ptr    sp_,
-                         ThreadPool::WeakQueue::Ptr queue_,
-                         std::function<void()>      on_finished_)
+/// DataFetchState
+
+DataFetchState::DataFetchState(Layer::Ptr                 layer_,
+                               int                        height_,
+                               int                        horTileCount_,
+                               int                        verTileCount_,
+                               SourcePresentation::Ptr    sp_,
+                               ThreadPool::WeakQueue::Ptr queue_,
+                               std::function<void()>      on_finished_)
   : layer(std::move(layer_))
   , height(height_)
   , horTileCount(horTileCount_)
@@ -204,44 +283,65 @@ DataFetcher::DataFetcher(Layer::Ptr                 layer_,
   , threadPool(CpuBound())
   , queue(std::move(queue_))
   , on_finished(std::move(on_finished_))
+  , unfinishedRows(verTileCount_)
+{
+}
+
+////////////////////////////////////////////////////////////////////////
+/// DataFetcher
+
+DataFetcher::DataFetcher(DataFetchState::Ptr state_)
+  : state(std::move(state_))
 {
 }
 
 void DataFetcher::operator()()
 {
+  const int currentRow = state->nextRow++;
+  if(currentRow >= state->verTileCount)
+  {
+    // Other fetchers claimed the remaining rows
+    return;
+  }
+
   QueueJumper::Ptr const qj = QueueJumper::create();
 
-  threadPool->schedule(qj, REDUCE_PRIO, queue);
+  state->threadPool->schedule(qj, REDUCE_PRIO, state->queue);
+
+  Scroom::Utils::Trace::Span const span("DataFetcher", {state->layer->getDepth(), -1, currentRow, nullptr});
+  const auto                       start = std::chrono::steady_clock::now();
 
-  CompressedTileLine&    tileLine = layer->getTileLine(currentRow);
+  CompressedTileLine&    tileLine = state->layer->getTileLine(currentRow);
   std::vector<Tile::Ptr> tiles;
-  for(int x = 0; x < horTileCount; x++)
+  for(int x = 0; x < state->horTileCount; x++)
   {
     CompressedTile::Ptr const  ti = tileLine[x];
     Scroom::Utils::Stuff const s  = ti->initialize();
     tiles.push_back(ti->getTileSync());
   }
-  const int lineCount = std::min(TILESIZE, height - currentRow * TILESIZE);
+  const int lineCount = std::min(TILESIZE, state->height - currentRow * TILESIZE);
 
-  sp->fillTiles(currentRow * TILESIZE, lineCount, TILESIZE, 0, tiles);
+  state->sp->fillTiles(currentRow * TILESIZE, lineCount, TILESIZE, 0, tiles);
 
-  for(int x = 0; x < horTileCount; x++)
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  addLayerTiming(state->layer->getDepth(), duration.count(), state->horTileCount);
+
+  for(int x = 0; x < state->horTileCount; x++)
   {
     tileLine[x]->reportFinished();
   }
 
-  currentRow++;
-  if(currentRow < verTileCount)
+  if(0 == --state->unfinishedRows)
+  {
+    state->sp->done();
+    state->on_finished();
+  }
+  else if(state->nextRow < state->verTileCount)
   {
     DataFetcher const successor(*this);
     if(!qj->setWork(successor))
     {
-      threadPool->schedule(successor, DATAFETCH_PRIO, queue);
+      state->threadPool->schedule(successor, DATAFETCH_PRIO, state->queue);
     }
   }
-  else
-  {
-    sp->done();
-    on_finished();
-  }
 }
@@ -7,13 +7,35 @@
 
 #include "layercoordinator.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <utility>
 
 #include <scroom/threadpool.hh>
 #include <scroom/tiledbitmaplayer.hh>
+#include <scroom/trace.hh>
 
 #include "local.hh"
+#include "uniform-tiles.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
+namespace
+{
+  /** Number of source tiles that together cover an entire target tile */
+  const size_t FULL_COVERAGE = 8 * 8;
+
+  /**
+   * Whether this thread is reducing a source tile
+   *
+   * Finishing a target tile finishes a source tile of the layer above.
+   * While reducing, that one is reduced right away, on the same thread,
+   * rather than scheduled. It is small enough to still be in the CPU
+   * cache, and doesn't have to wait in memory for its turn.
+   */
+  thread_local bool reducing = false;
+} // namespace
 
 LayerCoordinator::Ptr LayerCoordinator::create(CompressedTile::Ptr targetTile, LayerOperations::Ptr lo)
 {
@@ -50,8 +72,21 @@ void LayerCoordinator::tileFinished(const CompressedTile::Ptr& tile)
   ConstTile::Ptr const tileData = tile->getConstTileAsync();
   require(tileData);
 
-  CpuBound()->schedule([me = shared_from_this<LayerCoordinator>(), tile, tileData] { me->reduceSourceTile(tile, tileData); },
-                       REDUCE_PRIO);
+  if(reducing)
+  {
+    reduceSourceTile(tile, tileData);
+  }
+  else
+  {
+    CpuBound()->schedule(
+      [me = shared_from_this<LayerCoordinator>(), tile, tileData]
+      {
+        reducing = true;
+        me->reduceSourceTile(tile, tileData);
+        reducing = false;
+      },
+      REDUCE_PRIO);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -64,24 +99,109 @@ void LayerCoordinator::reduceSourceTile(const CompressedTile::Ptr& tile, ConstTi
   // need to unzip the compressed tile.
   //
   // Other than that side-effect, we have no use for tileData
-  Scroom::Utils::Stuff const s        = targetTile->initialize();
-  const std::pair<int, int>  location = sourceTiles[tile];
-  const int                  x        = location.first;
-  const int                  y        = location.second;
+  Scroom::Utils::Trace::Span const span("LayerCoordinator::reduceSourceTile", {tile->depth, tile->x, tile->y, nullptr});
+  const auto                       start = std::chrono::steady_clock::now();
 
-  if(!targetTileData)
+  const std::pair<int, int> location = sourceTiles[tile];
+  const int                 x        = location.first;
+  const int                 y        = location.second;
+
+  ConstTile::Ptr const       source  = tile->getConstTileSync();
+  std::vector<uint8_t> const pattern = source->uniform ? reduceUniform(source->uniform) : std::vector<uint8_t>();
+
+  boost::unique_lock<boost::mutex> lock(mut);
+  if(!pattern.empty() && !targetTileData && (uniformSourceTiles.empty() || pattern == uniformPattern))
   {
-    targetTileData = targetTile->getTileSync();
+    uniformSourceTiles.push_back(location);
+    uniformPattern = pattern;
+  }
+  else
+  {
+    initializeTarget();
+    if(!pattern.empty())
+    {
+      fillTarget(location, pattern);
+    }
+    else
+    {
+      Tile::Ptr const target = targetTileData;
+      lock.unlock();
+      lo->reduce(target, source, x, y);
+      lock.lock();
+    }
   }
-  ConstTile::Ptr const source = tile->getConstTileSync();
-
-  lo->reduce(targetTileData, source, x, y);
 
-  boost::unique_lock<boost::mutex> const lock(mut);
+  bool finished = false;
   unfinishedSourceTiles--;
   if(!unfinishedSourceTiles)
   {
+    if(!targetTileData)
+    {
+      // Parts not covered by any source tile are zero
+      const bool isZero =
+        std::all_of(uniformPattern.begin(), uniformPattern.end(), [](uint8_t value) { return value == 0; });
+      if(uniformSourceTiles.size() == FULL_COVERAGE || isZero)
+      {
+        targetTile->initializeUniform(uniformPattern);
+      }
+      else
+      {
+        initializeTarget();
+      }
+    }
+    finished = true;
+  }
+  lock.unlock();
+
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  addLayerTiming(targetTile->depth, duration.count(), finished ? 1 : 0);
+
+  if(finished)
+  {
+    // Not while holding our lock, because this may reduce the target
+    // tile into the layer above right away.
     targetTile->reportFinished();
+
+    lock.lock();
     targetTileData.reset();
   }
 }
+
+std::vector<uint8_t> LayerCoordinator::reduceUniform(const ConstTile::Ptr& sample)
+{
+  const int    bpp  = targetTile->bpp;
+  const size_t size = UNIFORM_SAMPLE_SIZE * UNIFORM_SAMPLE_SIZE * bpp / 8;
+
+  Scroom::MemoryBlobs::RawPageData::Ptr const pixels(new uint8_t[size](), std::default_delete<uint8_t[]>());
+  lo->reduce(Tile::create(UNIFORM_SAMPLE_SIZE, UNIFORM_SAMPLE_SIZE, bpp, pixels), sample, 0, 0);
+
+  // The sample reduces to the top-left 8*8 pixels. A row of those is bpp bytes.
+  return detectUniform(pixels.get(), bpp, bpp);
+}
+
+void LayerCoordinator::initializeTarget()
+{
+  if(!targetTileData)
+  {
+    Scroom::Utils::Stuff const s = targetTile->initialize();
+    targetTileData               = targetTile->getTileSync();
+
+    for(const std::pair<int, int>& location: uniformSourceTiles)
+    {
+      fillTarget(location, uniformPattern);
+    }
+    uniformSourceTiles.clear();
+  }
+}
+
+void LayerCoordinator::fillTarget(std::pair<int, int> location, const std::vector<uint8_t>& pattern)
+{
+  const size_t stride = TILESIZE * targetTile->bpp / 8;
+  const size_t width  = stride / 8;
+
+  uint8_t* row = targetTileData->data.get() + location.second * stride * TILESIZE / 8 + location.first * width;
+  for(int j = 0; j < TILESIZE / 8; j++, row += stride)
+  {
+    fillPattern(row, width, pattern);
+  }
+}
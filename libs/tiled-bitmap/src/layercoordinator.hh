@@ -7,9 +7,11 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -28,6 +30,16 @@ private:
   boost::mutex                                       mut;
   int                                                unfinishedSourceTiles{0};
 
+  /**
+   * Locations of uniform source tiles that haven't been reduced into
+   * targetTileData yet, because they all reduce to uniformPattern.
+   *
+   * As long as that remains the case, the target tile doesn't need
+   * pixels of its own. It'll be uniform as well.
+   */
+  std::vector<std::pair<int, int>> uniformSourceTiles;
+  std::vector<uint8_t>             uniformPattern;
+
 public:
   using Ptr = std::shared_ptr<LayerCoordinator>;
 
@@ -46,6 +58,30 @@ private:
 
   void reduceSourceTile(const CompressedTile::Ptr& tile, ConstTile::Ptr const& tileData);
 
+  /**
+   * Reduce the sample of a uniform source tile
+   *
+   * @return The pattern of the resulting target pixels, or an empty
+   *    vector if they're not uniform.
+   */
+  std::vector<uint8_t> reduceUniform(const ConstTile::Ptr& sample);
+
+  /**
+   * Give the target tile pixels of its own, and fill in the uniform
+   * source tiles reduced so far.
+   *
+   * Call only while mut is locked.
+   */
+  void initializeTarget();
+
+  /**
+   * Fill the part of the target tile corresponding to the source tile
+   * at @p location with @p pattern
+   *
+   * Call only while mut is locked.
+   */
+  void fillTarget(std::pair<int, int> location, const std::vector<uint8_t>& pattern);
+
 public:
   ////////////////////////////////////////////////////////////////////////
   /// TileInitialisationObserver
@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <memory>
@@ -17,9 +18,14 @@
 #include <scroom/cairo-helpers.hh>
 #include <scroom/layeroperations.hh>
 
+#include "argb-kernels.hh"
+#include "pixel-value-labels.hh"
+#include "reduce-kernels.hh"
+
 
 using Scroom::Utils::Stuff;
 using namespace Scroom::Bitmap;
+using namespace Scroom::TiledBitmap::Detail;
 
 ////////////////////////////////////////////////////////////////////////
 
@@ -27,39 +33,85 @@ namespace
 {
   std::shared_ptr<unsigned char> shared_malloc(size_t size) { return {static_cast<unsigned char*>(malloc(size)), free}; }
 
-} // namespace
-////////////////////////////////////////////////////////////////////////
-// BitCountLut
+  /** ARGB value of the given color, or transparent if the colormap is too small */
+  uint32_t argbOf(const std::vector<Color>& colors, unsigned int index)
+  {
+    return index < colors.size() ? colors[index].getARGB32() : 0;
+  }
 
-class BitCountLut
-{
-private:
-  byte lut[256];
+  /** A surface, and the colormap table it was rendered with */
+  class ColormappedSurface
+  {
+  public:
+    using Ptr = std::shared_ptr<ColormappedSurface>;
+
+  private:
+    boost::mutex         mut;
+    ColormapTable::Table table;
+    BitmapSurface::Ptr   surface;
+
+  public:
+    ColormappedSurface(ColormapTable::Table table_, BitmapSurface::Ptr surface_)
+      : table(std::move(table_))
+      , surface(std::move(surface_))
+    {
+    }
+
+    /** @return The surface, which may have been rendered using an outdated table */
+    BitmapSurface::Ptr get()
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      return surface;
+    }
 
-public:
-  BitCountLut();
+    bool isRenderedWith(const ColormapTable::Table& table_)
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      return table == table_;
+    }
 
-  byte lookup(byte index);
-};
+    /**
+     * Call @c render to render the surface again, if it was rendered using a table other than @c table_
+     *
+     * Rendering happens without holding the lock, such that the outdated
+     * surface can still be drawn in the mean time.
+     *
+     * @retval true if the surface was rendered again
+     */
+    template <typename F>
+    bool update(const ColormapTable::Table& table_, F render)
+    {
+      if(isRenderedWith(table_))
+      {
+        return false;
+      }
 
-BitCountLut bcl;
+      BitmapSurface::Ptr rendered = render();
 
-// NOLINTNEXTLINE
-BitCountLut::BitCountLut()
+      boost::mutex::scoped_lock const lock(mut);
+      surface = std::move(rendered);
+      table   = table_;
+      return true;
+    }
+  };
+} // namespace
+////////////////////////////////////////////////////////////////////////
+// ColormapTable
+
+ColormapTable::Table ColormapTable::get(const Colormap::Ptr& colormap, const Builder& build)
 {
-  for(int i = 0; i < 256; i++)
+  const auto same = [](const Color& a, const Color& b)
+  { return a.alpha == b.alpha && a.red == b.red && a.green == b.green && a.blue == b.blue; };
+
+  boost::mutex::scoped_lock const lock(mut);
+  if(!table || !std::equal(colors.begin(), colors.end(), colormap->colors.begin(), colormap->colors.end(), same))
   {
-    int sum = 0;
-    for(int v = i; v; v >>= 1)
-    {
-      sum += v & 1;
-    }
-    lut[i] = sum;
+    colors = colormap->colors;
+    table  = std::make_shared<const std::vector<uint32_t>>(build(colors));
   }
+  return table;
 }
 
-inline byte BitCountLut::lookup(byte index) { return lut[index]; }
-
 ////////////////////////////////////////////////////////////////////////
 // CommonOperations
 
@@ -158,8 +210,8 @@ Scroom::Utils::Stuff CommonOperations::cacheZoom(const ConstTile::Ptr& tile, int
   return result;
 }
 
-void CommonOperations::draw(cairo_t* cr,
-                            const ConstTile::Ptr& /*tile*/,
+void CommonOperations::draw(cairo_t*                         cr,
+                            const ConstTile::Ptr&            tile,
                             Scroom::Utils::Rectangle<double> tileArea,
                             Scroom::Utils::Rectangle<double> viewArea,
                             int                              zoom,
@@ -173,6 +225,16 @@ void CommonOperations::draw(cairo_t* cr,
   {
     drawState(cr, TILE_UNLOADED, viewArea);
   }
+  else if(tile->uniform)
+  {
+    // The cache is a small surface of identical pixels. Repeat it to fill the tile.
+    BitmapSurface::Ptr const source = std::static_pointer_cast<BitmapSurface>(cache);
+
+    cairo_set_source_surface(cr, source->get(), 0, 0);
+    cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_REPEAT);
+    cairo_rectangle(cr, viewArea.getLeft(), viewArea.getTop(), viewArea.getWidth(), viewArea.getHeight());
+    cairo_fill(cr);
+  }
   else
   {
     BitmapSurface::Ptr const source = std::static_pointer_cast<BitmapSurface>(cache);
@@ -254,6 +316,85 @@ PipetteLayerOperations::PipetteColor PipetteCommonOperationsRGB::sumPixelValues(
   return {{"R", sum_r}, {"G", sum_g}, {"B", sum_b}};
 }
 
+////////////////////////////////////////////////////////////////////////
+// ColormappedOperations
+
+ColormappedOperations::ColormappedOperations(ColormapProvider::Ptr colormapProvider_)
+  : colormapProvider(std::move(colormapProvider_))
+{
+}
+
+ColormapTable::Table ColormappedOperations::getTable()
+{
+  return colormapTable.get(colormapProvider->getColormap(),
+                           [this](const std::vector<Color>& colors) { return buildTable(colors); });
+}
+
+Scroom::Utils::Stuff ColormappedOperations::cache(const ConstTile::Ptr& tile)
+{
+  ColormapTable::Table const table = getTable();
+  return std::make_shared<ColormappedSurface>(table, render(tile, *table));
+}
+
+Scroom::Utils::Stuff ColormappedOperations::cacheZoom(const ConstTile::Ptr& tile, int zoom, Stuff& cache)
+{
+  if(zoom >= 0 && cache)
+  {
+    // Don't zoom in. It is a waste of space
+    return cache;
+  }
+
+  ColormapTable::Table const table = getTable();
+  if(!cache)
+  {
+    return std::make_shared<ColormappedSurface>(table, renderZoom(tile, std::min(zoom, 0), *table));
+  }
+
+  auto base = std::static_pointer_cast<ColormappedSurface>(cache);
+  base->update(table, [&] { return render(tile, *table); });
+
+  Stuff       baseSurface = base->get();
+  Stuff const zoomed      = CommonOperations::cacheZoom(tile, zoom, baseSurface);
+  return std::make_shared<ColormappedSurface>(table, std::static_pointer_cast<BitmapSurface>(zoomed));
+}
+
+bool ColormappedOperations::isOutdated(const Scroom::Utils::Stuff& cache)
+{
+  return cache && !std::static_pointer_cast<ColormappedSurface>(cache)->isRenderedWith(getTable());
+}
+
+bool ColormappedOperations::updateCache(const ConstTile::Ptr& tile, int zoom, const Scroom::Utils::Stuff& cache)
+{
+  if(!cache)
+  {
+    return false;
+  }
+
+  ColormapTable::Table const table    = getTable();
+  const auto                 rerender = [&] { return renderZoom(tile, std::min(zoom, 0), *table); };
+  return std::static_pointer_cast<ColormappedSurface>(cache)->update(table, rerender);
+}
+
+void ColormappedOperations::draw(cairo_t*                         cr,
+                                 const ConstTile::Ptr&            tile,
+                                 Scroom::Utils::Rectangle<double> tileArea,
+                                 Scroom::Utils::Rectangle<double> viewArea,
+                                 int                              zoom,
+                                 Scroom::Utils::Stuff             cache)
+{
+  // If the colormap changed, this draws the outdated surface, while the
+  // TiledBitmap has it updated in the background. See updateCache().
+  Stuff const surface = cache ? std::static_pointer_cast<ColormappedSurface>(cache)->get() : nullptr;
+
+  CommonOperations::draw(cr, tile, tileArea, viewArea, zoom, surface);
+}
+
+BitmapSurface::Ptr ColormappedOperations::renderZoom(const ConstTile::Ptr& tile, int zoom, const std::vector<uint32_t>& table)
+{
+  Stuff base = render(tile, table);
+  return std::static_pointer_cast<BitmapSurface>(CommonOperations::cacheZoom(tile, zoom, base));
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Operations1bpp
 
@@ -263,29 +404,26 @@ LayerOperations::Ptr Operations1bpp::create(ColormapProvider::Ptr colormapProvid
 }
 
 Operations1bpp::Operations1bpp(ColormapProvider::Ptr colormapProvider_)
-  : colormapProvider(std::move(colormapProvider_))
+  : ColormappedOperations(std::move(colormapProvider_))
 {
 }
 
 int Operations1bpp::getBpp() { return 1; }
 
-Scroom::Utils::Stuff Operations1bpp::cache(const ConstTile::Ptr& tile)
+std::vector<uint32_t> Operations1bpp::buildTable(const std::vector<Color>& colors)
 {
-  const int                            stride   = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
-  std::shared_ptr<unsigned char> const data     = shared_malloc(stride * tile->height);
-  Colormap::Ptr const                  colormap = colormapProvider->getColormap();
+  return createExpansionTable(1, [&](unsigned int index) { return argbOf(colors, index); });
+}
+
+BitmapSurface::Ptr Operations1bpp::render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table)
+{
+  const int                            stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
+  std::shared_ptr<unsigned char> const data   = shared_malloc(stride * tile->height);
 
   unsigned char* row = data.get();
   for(int j = 0; j < tile->height; j++, row += stride)
   {
-    SampleIterator<const byte> bit(tile->data.get() + j * tile->width / 8, 0);
-    auto*                      pixel = reinterpret_cast<uint32_t*>(row);
-    for(int i = 0; i < tile->width; i++)
-    {
-      *pixel = colormap->colors[*bit].getARGB32();
-      pixel++;
-      ++bit;
-    }
+    expandBytes(tile->data.get() + j * tile->width / 8, reinterpret_cast<uint32_t*>(row), tile->width, table.data(), 1);
   }
 
   return BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
@@ -300,30 +438,11 @@ void Operations1bpp::reduce(Tile::Ptr target, const ConstTile::Ptr source, int x
   const int targetStride = target->width;
   byte*     targetBase   = target->data.get() + target->height * y * targetStride / 8 + target->width * x / 8;
 
+  const auto reduceRow = getReduceKernels().reduce1bpp;
   for(int j = 0; j < source->height / 8; j++, targetBase += targetStride, sourceBase += sourceStride * 8)
   {
     // Iterate vertically over target
-    const byte* sourcePtr = sourceBase;
-    byte*       targetPtr = targetBase;
-
-    for(int i = 0; i < source->width / 8; i++, sourcePtr++, targetPtr++)
-    {
-      // Iterate horizontally over target
-
-      // Goal is to compute a 8-bit grey value from a 8*8 black/white
-      // image. To do so, we take each of the 8 bytes, count the
-      // number of 1's in each, and add them. Finally, we divide that
-      // by 64 (the maximum number of ones in that area
-
-      const byte* current = sourcePtr;
-      int         sum     = 0;
-      for(int k = 0; k < 8; k++, current += sourceStride)
-      {
-        sum += bcl.lookup(*current);
-      }
-
-      *targetPtr = sum * 255 / 64;
-    }
+    reduceRow(sourceBase, sourceStride, targetBase, source->width / 8);
   }
 }
 
@@ -335,16 +454,15 @@ void Operations1bpp::draw(cairo_t*                         cr,
                           Scroom::Utils::Stuff             cache)
 {
   cairo_save(cr);
-  CommonOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
+  ColormappedOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
   cairo_restore(cr);
 
   // Draw pixelvalues at 32:1 zoom
   if(zoom == 5)
   {
-    const int multiplier = 1 << zoom;
-    const int stride     = tile->width / 8;
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 12.0);
+    const int        multiplier = 1 << zoom;
+    const int        stride     = tile->width / 8;
+    PixelValueLabels labels(multiplier);
 
     Colormap::Ptr const colormap = colormapProvider->getColormap();
 
@@ -361,12 +479,11 @@ void Operations1bpp::draw(cairo_t*                         cr,
       {
         const int value = *current;
 
-        cairo_save(cr);
-        drawPixelValue(
-          cr, viewArea.x() + multiplier * x, viewArea.y() + multiplier * y, multiplier, value, colormap->colors[value]);
-        cairo_restore(cr);
+        labels.add(viewArea.getTopLeft() + Scroom::Utils::make_point<double>(x, y) * multiplier, value, colormap->colors[value]);
       }
     }
+
+    labels.draw(cr, viewArea.getTopLeft());
   }
 }
 
@@ -379,33 +496,28 @@ LayerOperations::Ptr Operations8bpp::create(ColormapProvider::Ptr colormapProvid
 }
 
 Operations8bpp::Operations8bpp(ColormapProvider::Ptr colormapProvider_)
-  : colormapProvider(std::move(colormapProvider_))
+  : ColormappedOperations(std::move(colormapProvider_))
 {
 }
 
 int Operations8bpp::getBpp() { return 8; }
 
-Scroom::Utils::Stuff Operations8bpp::cache(const ConstTile::Ptr& tile)
+std::vector<uint32_t> Operations8bpp::buildTable(const std::vector<Color>& colors)
 {
-  const int                            stride   = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
-  std::shared_ptr<unsigned char> const data     = shared_malloc(stride * tile->height);
-  Colormap::Ptr const                  colormap = colormapProvider->getColormap();
-  const Color&                         c1       = colormap->colors[0];
-  const Color&                         c2       = colormap->colors[1];
+  const Color& c1 = colors[0];
+  const Color& c2 = colors[1];
+  return createExpansionTable(8, [&](unsigned int value) { return mix(c2, c1, 1.0 * value / 255).getARGB32(); });
+}
+
+BitmapSurface::Ptr Operations8bpp::render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table)
+{
+  const int                            stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
+  std::shared_ptr<unsigned char> const data   = shared_malloc(stride * tile->height);
 
   unsigned char* row = data.get();
   for(int j = 0; j < tile->height; j++, row += stride)
   {
-    const byte* cur = tile->data.get() + j * tile->width;
-
-    auto* pixel = reinterpret_cast<uint32_t*>(row);
-    for(int i = 0; i < tile->width; i++)
-    {
-      *pixel = mix(c2, c1, 1.0 * *cur / 255).getARGB32();
-
-      pixel++;
-      ++cur;
-    }
+    expandBytes(tile->data.get() + j * tile->width, reinterpret_cast<uint32_t*>(row), tile->width, table.data(), 8);
   }
 
   return BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
@@ -420,30 +532,11 @@ void Operations8bpp::reduce(Tile::Ptr target, const ConstTile::Ptr source, int x
   const int targetStride = target->width;
   byte*     targetBase   = target->data.get() + target->height * y * targetStride / 8 + target->width * x / 8;
 
+  const auto reduceRow = getReduceKernels().reduce8bpp;
   for(int j = 0; j < source->height / 8; j++, targetBase += targetStride, sourceBase += sourceStride * 8)
   {
     // Iterate vertically over target
-    const byte* sourcePtr = sourceBase;
-    byte*       targetPtr = targetBase;
-
-    for(int i = 0; i < source->width / 8; i++, sourcePtr += 8, targetPtr++)
-    {
-      // Iterate horizontally over target
-
-      // Goal is to compute a 8-bit grey value from a 8*8 grey image.
-      const byte* base = sourcePtr;
-      int         sum  = 0;
-      for(int k = 0; k < 8; k++, base += sourceStride)
-      {
-        const byte* current = base;
-        for(int l = 0; l < 8; l++, current++)
-        {
-          sum += *current;
-        }
-      }
-
-      *targetPtr = sum / 64;
-    }
+    reduceRow(sourceBase, sourceStride, targetBase, source->width / 8);
   }
 }
 
@@ -455,16 +548,15 @@ void Operations8bpp::draw(cairo_t*                         cr,
                           Scroom::Utils::Stuff             cache)
 {
   cairo_save(cr);
-  CommonOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
+  ColormappedOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
   cairo_restore(cr);
 
   // Draw pixelvalues at 32:1 zoom
   if(zoom == 5)
   {
-    const int multiplier = 1 << zoom;
-    const int stride     = tile->width;
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 12.0);
+    const int        multiplier = 1 << zoom;
+    const int        stride     = tile->width;
+    PixelValueLabels labels(multiplier);
 
     Colormap::Ptr const colormap = colormapProvider->getColormap();
     const Color&        c1       = colormap->colors[0];
@@ -482,11 +574,11 @@ void Operations8bpp::draw(cairo_t*                         cr,
         const int   value = data[(tileAreaInt.y() + y) * stride + tileAreaInt.x() + x];
         Color const c     = mix(c2, c1, 1.0 * value / 255);
 
-        cairo_save(cr);
-        drawPixelValue(cr, viewArea.x() + multiplier * x, viewArea.y() + multiplier * y, multiplier, value, c);
-        cairo_restore(cr);
+        labels.add(viewArea.getTopLeft() + Scroom::Utils::make_point<double>(x, y) * multiplier, value, c);
       }
     }
+
+    labels.draw(cr, viewArea.getTopLeft());
   }
 }
 
@@ -504,22 +596,14 @@ int Operations24bpp::getBpp() { return 24; }
 
 Scroom::Utils::Stuff Operations24bpp::cache(const ConstTile::Ptr& tile)
 {
-  const int                            stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
-  std::shared_ptr<unsigned char> const data   = shared_malloc(stride * tile->height);
-  unsigned char*                       row    = data.get();
+  const int                            stride  = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
+  std::shared_ptr<unsigned char> const data    = shared_malloc(stride * tile->height);
+  const auto                           convert = getArgbKernels().rgb24;
+
+  unsigned char* row = data.get();
   for(int j = 0; j < tile->height; j++, row += stride)
   {
-    const byte* cur = tile->data.get() + 3 * j * tile->width;
-
-    auto* pixel = reinterpret_cast<uint32_t*>(row);
-    for(int i = 0; i < tile->width; i++)
-    {
-      //         A          R              G             B
-      *pixel = 0xFF000000 | cur[0] << 16 | cur[1] << 8 | cur[2];
-
-      pixel++;
-      cur += 3;
-    }
+    convert(tile->data.get() + 3 * j * tile->width, reinterpret_cast<uint32_t*>(row), tile->width);
   }
 
   return BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
@@ -534,35 +618,11 @@ void Operations24bpp::reduce(Tile::Ptr target, const ConstTile::Ptr source, int
   const int targetStride = 3 * target->width; // stride in bytes
   byte*     targetBase   = target->data.get() + target->height * y * targetStride / 8 + targetStride * x / 8;
 
+  const auto reduceRow = getReduceKernels().reduce24bpp;
   for(int j = 0; j < source->height / 8; j++, targetBase += targetStride, sourceBase += sourceStride * 8)
   {
     // Iterate vertically over target
-    const byte* sourcePtr = sourceBase;
-    byte*       targetPtr = targetBase;
-
-    for(int i = 0; i < source->width / 8; i++, sourcePtr += 8 * 3, targetPtr += 3)
-    {
-      // Iterate horizontally over target
-
-      // Goal is to compute a average RGB value from a 8*8 RGB image.
-      const byte* base  = sourcePtr;
-      int         sum_r = 0;
-      int         sum_g = 0;
-      int         sum_b = 0;
-      for(int k = 0; k < 8; k++, base += sourceStride)
-      {
-        const byte* current = base;
-        for(int l = 0; l < 8; l++, current += 3)
-        {
-          sum_r += current[0];
-          sum_g += current[1];
-          sum_b += current[2];
-        }
-      }
-      targetPtr[0] = sum_r / 64;
-      targetPtr[1] = sum_g / 64;
-      targetPtr[2] = sum_b / 64;
-    }
+    reduceRow(sourceBase, sourceStride, targetBase, source->width / 8);
   }
 }
 
@@ -575,7 +635,7 @@ LayerOperations::Ptr Operations::create(ColormapProvider::Ptr colormapProvider,
 }
 
 Operations::Operations(ColormapProvider::Ptr colormapProvider_, int bpp_)
-  : colormapProvider(std::move(colormapProvider_))
+  : ColormappedOperations(std::move(colormapProvider_))
   , bpp(bpp_)
   , pixelsPerByte(8 / bpp_)
   , pixelOffset(bpp_)
@@ -585,24 +645,21 @@ Operations::Operations(ColormapProvider::Ptr colormapProvider_, int bpp_)
 
 int Operations::getBpp() { return bpp; }
 
-Scroom::Utils::Stuff Operations::cache(const ConstTile::Ptr& tile)
+std::vector<uint32_t> Operations::buildTable(const std::vector<Color>& colors)
 {
-  const int                            stride   = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
-  std::shared_ptr<unsigned char> const data     = shared_malloc(stride * tile->height);
-  Colormap::Ptr const                  colormap = colormapProvider->getColormap();
+  return createExpansionTable(bpp, [&](unsigned int index) { return argbOf(colors, index); });
+}
+
+BitmapSurface::Ptr Operations::render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table)
+{
+  const int                            stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
+  std::shared_ptr<unsigned char> const data   = shared_malloc(stride * tile->height);
 
   unsigned char* row = data.get();
   for(int j = 0; j < tile->height; j++, row += stride)
   {
-    SampleIterator<const byte> pixelIn(tile->data.get() + j * tile->width / pixelsPerByte, 0, bpp);
-
-    auto* pixelOut = reinterpret_cast<uint32_t*>(row);
-    for(int i = 0; i < tile->width; i++)
-    {
-      *pixelOut = colormap->colors[*pixelIn].getARGB32();
-      pixelOut++;
-      ++pixelIn;
-    }
+    expandBytes(
+      tile->data.get() + j * tile->width / pixelsPerByte, reinterpret_cast<uint32_t*>(row), tile->width, table.data(), bpp);
   }
 
   return BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
@@ -680,16 +737,15 @@ void Operations::draw(cairo_t*                         cr,
                       Scroom::Utils::Stuff             cache)
 {
   cairo_save(cr);
-  CommonOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
+  ColormappedOperations::draw(cr, tile, tileArea, viewArea, zoom, cache);
   cairo_restore(cr);
 
   // Draw pixelvalues at 32:1 zoom
   if(zoom == 5)
   {
-    const int multiplier = 1 << zoom;
-    const int stride     = tile->width / pixelsPerByte;
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 12.0);
+    const int        multiplier = 1 << zoom;
+    const int        stride     = tile->width / pixelsPerByte;
+    PixelValueLabels labels(multiplier);
 
     Colormap::Ptr const colormap = colormapProvider->getColormap();
 
@@ -706,12 +762,11 @@ void Operations::draw(cairo_t*                         cr,
       {
         const int value = *current;
 
-        cairo_save(cr);
-        drawPixelValue(
-          cr, viewArea.x() + multiplier * x, viewArea.y() + multiplier * y, multiplier, value, colormap->colors[value]);
-        cairo_restore(cr);
+        labels.add(viewArea.getTopLeft() + Scroom::Utils::make_point<double>(x, y) * multiplier, value, colormap->colors[value]);
       }
     }
+
+    labels.draw(cr, viewArea.getTopLeft());
   }
 }
 
@@ -730,26 +785,36 @@ OperationsColormapped::OperationsColormapped(ColormapProvider::Ptr colormapProvi
 
 int OperationsColormapped::getBpp() { return 2 * bpp; }
 
-Scroom::Utils::Stuff OperationsColormapped::cache(const ConstTile::Ptr& tile)
+std::vector<uint32_t> OperationsColormapped::buildTable(const std::vector<Color>& colors)
+{
+  const int  multiplier = 2; // data is 2*bpp, containing 2 colors
+  const auto argb       = [&](unsigned int value) -> uint32_t
+  {
+    const unsigned int first  = value & pixelMask;
+    const unsigned int second = value >> pixelOffset;
+    if(first >= colors.size() || second >= colors.size())
+    {
+      return 0;
+    }
+    return mix(colors[first], colors[second], 0.5).getARGB32();
+  };
+  return createExpansionTable(multiplier * bpp, argb);
+}
+
+BitmapSurface::Ptr OperationsColormapped::render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table)
 {
   const int                            stride     = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, tile->width);
   std::shared_ptr<unsigned char> const data       = shared_malloc(stride * tile->height);
-  Colormap::Ptr const                  colormap   = colormapProvider->getColormap();
   const int                            multiplier = 2; // data is 2*bpp, containing 2 colors
 
   unsigned char* row = data.get();
   for(int j = 0; j < tile->height; j++, row += stride)
   {
-    SampleIterator<const uint16_t> pixelIn(
-      reinterpret_cast<uint16_t const*>(tile->data.get() + j * multiplier * tile->width / pixelsPerByte), 0, multiplier * bpp);
-    auto* pixelOut = reinterpret_cast<uint32_t*>(row);
-    for(int i = 0; i < tile->width; i++)
-    {
-      *pixelOut = mix(colormap->colors[*pixelIn & pixelMask], colormap->colors[*pixelIn >> pixelOffset], 0.5).getARGB32();
-
-      pixelOut++;
-      ++pixelIn;
-    }
+    expandWords(reinterpret_cast<uint16_t const*>(tile->data.get() + j * multiplier * tile->width / pixelsPerByte),
+                reinterpret_cast<uint32_t*>(row),
+                tile->width,
+                table.data(),
+                multiplier * bpp);
   }
 
   return BitmapSurface::create(tile->width, tile->height, CAIRO_FORMAT_ARGB32, stride, data);
@@ -829,26 +894,36 @@ LayerOperations::Ptr Operations1bppClipped::create(ColormapProvider::Ptr colorma
 }
 
 Operations1bppClipped::Operations1bppClipped(ColormapProvider::Ptr colormapProvider_)
-  : colormapProvider(std::move(colormapProvider_))
+  : ColormappedOperations(std::move(colormapProvider_))
 {
 }
 
 int Operations1bppClipped::getBpp() { return 1; }
 
-Scroom::Utils::Stuff Operations1bppClipped::cacheZoom(const ConstTile::Ptr& tile, int zoom, Stuff& /*cache*/)
+Scroom::Utils::Stuff Operations1bppClipped::cache(const ConstTile::Ptr& /*tile*/)
 {
-  if(zoom >= 0)
-  {
-    zoom = 0;
-  }
+  // Each zoom level is computed from the tile directly
+  return {};
+}
 
+std::vector<uint32_t> Operations1bppClipped::buildTable(const std::vector<Color>& colors)
+{
+  return {colors[0].getARGB32(), colors[1].getARGB32()};
+}
+
+BitmapSurface::Ptr Operations1bppClipped::render(const ConstTile::Ptr& tile, const std::vector<uint32_t>& table)
+{
+  return renderZoom(tile, 0, table);
+}
+
+BitmapSurface::Ptr Operations1bppClipped::renderZoom(const ConstTile::Ptr& tile, int zoom, const std::vector<uint32_t>& table)
+{
   const int pixelSize    = 1 << (-zoom);
   const int outputWidth  = tile->width / pixelSize;
   const int outputHeight = tile->height / pixelSize;
 
-  const int                            stride   = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, outputWidth);
-  std::shared_ptr<unsigned char> const data     = shared_malloc(stride * outputHeight);
-  Colormap::Ptr const                  colormap = colormapProvider->getColormap();
+  const int                            stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, outputWidth);
+  std::shared_ptr<unsigned char> const data   = shared_malloc(stride * outputHeight);
 
   unsigned char* row = data.get();
   for(int j = 0; j < outputHeight; j++, row += stride)
@@ -878,7 +953,7 @@ Scroom::Utils::Stuff Operations1bppClipped::cacheZoom(const ConstTile::Ptr& tile
       {
         sum = 1;
       }
-      *pixel = colormap->colors[sum].getARGB32();
+      *pixel = table[sum];
       pixel++;
     }
   }
@@ -895,29 +970,20 @@ void Operations1bppClipped::reduce(Tile::Ptr target, const ConstTile::Ptr source
   const int targetStride = target->width / 8;
   byte*     targetBase   = target->data.get() + target->height * y * targetStride / 8 + target->width * x / 8 / 8;
 
+  // Compute grey values like Operations1bpp does. A target pixel is set
+  // if any of its source pixels is set
+  const auto        reduceRow = getReduceKernels().reduce1bpp;
+  const int         count     = source->width / 8;
+  std::vector<byte> grey(count);
   for(int j = 0; j < source->height / 8; j++, targetBase += targetStride, sourceBase += sourceStride * 8)
   {
     // Iterate vertically over target
-    const byte*          sourcePtr = sourceBase;
-    SampleIterator<byte> targetPtr(targetBase, 0);
+    reduceRow(sourceBase, sourceStride, grey.data(), count);
 
-    for(int i = 0; i < source->width / 8; i++, sourcePtr++, targetPtr++)
+    SampleIterator<byte> targetPtr(targetBase, 0);
+    for(int i = 0; i < count; i++, targetPtr++)
     {
-      // Iterate horizontally over target
-
-      // Goal is to compute a 8-bit grey value from a 8*8 black/white
-      // image. To do so, we take each of the 8 bytes, count the
-      // number of 1's in each, and add them. Finally, we divide that
-      // by 64 (the maximum number of ones in that area
-
-      const byte* current = sourcePtr;
-      int         sum     = 0;
-      for(int k = 0; k < 8; k++, current += sourceStride)
-      {
-        sum += bcl.lookup(*current);
-      }
-
-      targetPtr.set((sum > 0) ? 1 : 0);
+      targetPtr.set((grey[i] > 0) ? 1 : 0);
     }
   }
 }
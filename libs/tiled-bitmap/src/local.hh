@@ -10,3 +10,26 @@
 #define LOAD_PRIO PRIO_HIGHER
 #define DATAFETCH_PRIO PRIO_HIGH
 #define REDUCE_PRIO PRIO_NORMAL
+
+#include <scroom/ranked-jobs.hh>
+#include <scroom/threadpool.hh>
+
+/**
+ * Account @p seconds of work on the layer at the given @p depth
+ *
+ * @param tiles Number of tiles of that layer completed by the work
+ *
+ * @see getLayerTimings()
+ */
+void addLayerTiming(int depth, double seconds, int tiles);
+
+/**
+ * Loading tiles and computing their caches, most important first
+ *
+ * The rank of these jobs is their distance to the centre of the view.
+ */
+inline RankedJobs::Ptr LoadJobs()
+{
+  static RankedJobs::Ptr const loadJobs = RankedJobs::create(CpuBound(), LOAD_PRIO);
+  return loadJobs;
+}
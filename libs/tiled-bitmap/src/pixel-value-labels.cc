@@ -0,0 +1,137 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "pixel-value-labels.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/bitmap-helpers.hh>
+#include <scroom/layeroperations.hh>
+#include <scroom/memorybudget.hh>
+
+using Scroom::Bitmap::BitmapSurface;
+
+namespace
+{
+  using LabelKey = std::tuple<int, bool, int>; /**< Size, white, value */
+
+  struct RenderedLabel
+  {
+    std::weak_ptr<BitmapSurface>            surface;
+    Scroom::Utils::MemoryBudget::Entry::Ptr entry; /**< Keeps the surface until the MemoryBudget evicts it */
+  };
+
+  const size_t MIN_PRUNE_SIZE = 64;
+
+  boost::mutex                      labelsMutex;
+  std::map<LabelKey, RenderedLabel> renderedLabels;             /**< Protected by labelsMutex */
+  size_t                            pruneSize = MIN_PRUNE_SIZE; /**< Protected by labelsMutex */
+
+  BitmapSurface::Ptr renderLabel(int size, bool white, int value)
+  {
+    BitmapSurface::Ptr const result = BitmapSurface::create(size, size, CAIRO_FORMAT_ARGB32);
+    cairo_t*                 cr     = cairo_create(result->get());
+    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 12.0);
+    Color(white ? 1 : 0).setColor(cr);
+    CommonOperations::drawPixelValue(cr, 0, 0, size, value);
+    cairo_destroy(cr);
+    return result;
+  }
+
+  /**
+   * Forget the labels the MemoryBudget evicted
+   *
+   * Done whenever the number of labels doubled, such that it takes
+   * constant time per label on average.
+   */
+  void pruneLabels()
+  {
+    if(renderedLabels.size() < pruneSize)
+    {
+      return;
+    }
+
+    for(auto it = renderedLabels.begin(); it != renderedLabels.end();)
+    {
+      it = it->second.surface.expired() ? renderedLabels.erase(it) : std::next(it);
+    }
+    pruneSize = std::max(MIN_PRUNE_SIZE, 2 * renderedLabels.size());
+  }
+} // namespace
+
+namespace Scroom::TiledBitmap::Detail
+{
+  BitmapSurface::Ptr getPixelValueLabel(int size, bool white, int value)
+  {
+    boost::mutex::scoped_lock const lock(labelsMutex);
+    pruneLabels();
+
+    RenderedLabel&     label  = renderedLabels[LabelKey(size, white, value)];
+    BitmapSurface::Ptr result = label.surface.lock();
+    if(result)
+    {
+      label.entry->touch();
+    }
+    else
+    {
+      result        = renderLabel(size, white, value);
+      label.surface = result;
+      label.entry   = Scroom::Utils::MemoryBudget::instance()->retain(result, static_cast<size_t>(size) * size * 4);
+    }
+    return result;
+  }
+
+  PixelValueLabels::PixelValueLabels(int size_)
+    : size(size_)
+  {
+  }
+
+  void PixelValueLabels::add(Scroom::Utils::Point<double> position, int value, const Color& background)
+  {
+    labels.push_back({value, background.getContrastingBlackOrWhite().red > 0.5, position});
+  }
+
+  void PixelValueLabels::draw(cairo_t* cr, Scroom::Utils::Point<double> origin)
+  {
+    std::sort(labels.begin(),
+              labels.end(),
+              [](const Label& a, const Label& b) { return std::tie(a.white, a.value) < std::tie(b.white, b.value); });
+
+    cairo_matrix_t matrix;
+    cairo_matrix_init_translate(&matrix, -origin.x, -origin.y);
+
+    for(auto begin = labels.begin(); begin != labels.end();)
+    {
+      auto end = std::find_if(
+        begin, labels.end(), [&](const Label& l) { return l.white != begin->white || l.value != begin->value; });
+
+      // The label repeats every size pixels, so all its cells can be filled at once
+      BitmapSurface::Ptr const label   = getPixelValueLabel(size, begin->white, begin->value);
+      cairo_pattern_t*         pattern = cairo_pattern_create_for_surface(label->get());
+      cairo_pattern_set_extend(pattern, CAIRO_EXTEND_REPEAT);
+      cairo_pattern_set_matrix(pattern, &matrix);
+      cairo_set_source(cr, pattern);
+      for(auto current = begin; current != end; ++current)
+      {
+        cairo_rectangle(cr, current->position.x, current->position.y, size, size);
+      }
+      cairo_fill(cr);
+      cairo_pattern_destroy(pattern);
+
+      begin = end;
+    }
+
+    labels.clear();
+  }
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,67 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <cairo.h>
+
+#include <scroom/bitmap-helpers.hh>
+#include <scroom/color.hh>
+#include <scroom/point.hh>
+
+/**
+ * Drawing of pixel values at the highest zoom levels
+ *
+ * Laying out text for each visible pixel is much too slow to do on
+ * every redraw. Instead, the label of each value is rendered only once
+ * per label size and text color, and kept for later use, as long as
+ * the MemoryBudget allows. Labels are then drawn by filling all cells
+ * showing the same label in one go.
+ */
+namespace Scroom::TiledBitmap::Detail
+{
+  /**
+   * @return The label showing @p value, in a cell of @p size by @p size
+   *    pixels, in white or black text. Rendered only if it isn't cached.
+   */
+  Scroom::Bitmap::BitmapSurface::Ptr getPixelValueLabel(int size, bool white, int value);
+
+  class PixelValueLabels
+  {
+  private:
+    struct Label
+    {
+      int                          value;
+      bool                         white;
+      Scroom::Utils::Point<double> position;
+    };
+
+    int                size;
+    std::vector<Label> labels;
+
+  public:
+    /** Prepare drawing labels in cells of @p size by @p size pixels */
+    explicit PixelValueLabels(int size);
+
+    /**
+     * Draw @p value in the cell at @p position later on, in a color
+     * that contrasts with @p background
+     */
+    void add(Scroom::Utils::Point<double> position, int value, const Color& background);
+
+    /**
+     * Draw all labels added so far
+     *
+     * @pre All positions are on a grid of size by size pixels, aligned
+     *    with @p origin
+     */
+    void draw(cairo_t* cr, Scroom::Utils::Point<double> origin);
+  };
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,472 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "pyramid-cache.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <boost/filesystem.hpp>
+
+#include <scroom/blockallocator.hh>
+#include <scroom/memoryblobs.hh>
+
+using namespace Scroom::MemoryBlobs;
+
+namespace
+{
+  /*
+   * File layout, all values in native byte order:
+   *
+   *   magic, version, TILESIZE, page size, the Key,
+   *   layer count, and for each layer
+   *     width, height, bpp, horizontal and vertical tile count
+   *   for each tile of each layer, row by row
+   *     codec, page count, and, for uniform tiles, the pattern
+   *   total page count,
+   *   padding up to a multiple of the page size, and
+   *   the contents of all pages
+   */
+  const std::array<char, 8> MAGIC   = {'S', 'C', 'R', 'M', 'P', 'Y', 'R', '1'};
+  const uint32_t            VERSION = 2;
+
+  const char* const SIDECAR   = "sidecar";
+  const char* const EXTENSION = ".scroom-cache";
+
+  const size_t SAMPLE_COUNT = 16;
+  const size_t SAMPLE_SIZE  = 64 * 1024;
+
+  /** 64-bit FNV-1a */
+  class Hash
+  {
+  private:
+    uint64_t value{0xcbf29ce484222325ULL};
+
+  public:
+    void add(const char* data, size_t size)
+    {
+      for(size_t i = 0; i < size; i++)
+      {
+        value = (value ^ static_cast<uint8_t>(data[i])) * 0x100000001b3ULL;
+      }
+    }
+
+    uint64_t get() const { return value; }
+  };
+
+  /**
+   * Hash SAMPLE_COUNT evenly spaced chunks of the given file.
+   *
+   * Hashing the entire file would take almost as long as loading it.
+   * Together with its size and modification time, a few samples are
+   * enough to notice a file has changed.
+   */
+  bool hashSamples(const std::string& fileName, uint64_t size, uint64_t& result)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    if(!in)
+    {
+      return false;
+    }
+
+    Hash              hash;
+    std::vector<char> buffer(SAMPLE_SIZE);
+    const uint64_t    last = size > SAMPLE_SIZE ? size - SAMPLE_SIZE : 0;
+    for(size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+      const uint64_t offset = last * i / (SAMPLE_COUNT - 1);
+      in.seekg(static_cast<std::streamoff>(offset));
+      in.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(SAMPLE_SIZE, size)));
+      if(!in)
+      {
+        return false;
+      }
+      hash.add(buffer.data(), static_cast<size_t>(in.gcount()));
+    }
+    result = hash.get();
+    return true;
+  }
+
+  template <typename T>
+  void write(std::ostream& out, const T& value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  template <typename T>
+  bool read(std::istream& in, T& value)
+  {
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(in);
+  }
+
+  void writeString(std::ostream& out, const std::string& value)
+  {
+    write(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+  }
+
+  bool readString(std::istream& in, std::string& value)
+  {
+    uint32_t size = 0;
+    if(!read(in, size) || size > 64 * 1024)
+    {
+      return false;
+    }
+    value.resize(size);
+    in.read(value.data(), size);
+    return static_cast<bool>(in);
+  }
+
+  struct LayerLayout
+  {
+    int32_t width{0};
+    int32_t height{0};
+    int32_t bpp{0};
+    int32_t horTileCount{0};
+    int32_t verTileCount{0};
+
+    explicit LayerLayout(const Layer::Ptr& layer)
+      : width(layer->getWidth())
+      , height(layer->getHeight())
+      , bpp(layer->getTile(0, 0)->bpp)
+      , horTileCount(layer->getHorTileCount())
+      , verTileCount(layer->getVerTileCount())
+    {
+    }
+
+    LayerLayout() = default;
+
+    bool operator==(const LayerLayout& other) const
+    {
+      return width == other.width && height == other.height && bpp == other.bpp && horTileCount == other.horTileCount
+             && verTileCount == other.verTileCount;
+    }
+
+    size_t tileCount() const { return static_cast<size_t>(horTileCount) * static_cast<size_t>(verTileCount); }
+  };
+
+  bool isValidCodec(uint32_t codec)
+  {
+    switch(static_cast<Codec>(codec))
+    {
+    case Codec::RAW:
+    case Codec::ZLIB:
+    case Codec::LZ4:
+    case Codec::ZSTD:
+      return isAvailable(static_cast<Codec>(codec));
+    default:
+      return false;
+    }
+  }
+
+  struct TileEntry
+  {
+    uint32_t               codec{0};
+    uint32_t               pageCount{0};   /**< Zero for uniform tiles */
+    uint32_t               patternSize{0}; /**< Zero for tiles that aren't uniform */
+    std::array<uint8_t, 8> pattern{};
+
+    bool isValid() const
+    {
+      return pageCount == 0 ? patternSize > 0 && patternSize <= pattern.size() : patternSize == 0 && isValidCodec(codec);
+    }
+  };
+
+  /** The contents of a tile, as stored in the file */
+  struct TileContents
+  {
+    std::pair<Codec, PageList> compressed;
+    std::vector<uint8_t>       pattern;
+  };
+
+  template <typename F>
+  void forEachTile(const std::vector<Layer::Ptr>& layers, F f)
+  {
+    for(const Layer::Ptr& layer: layers)
+    {
+      for(int j = 0; j < layer->getVerTileCount(); j++)
+      {
+        for(int i = 0; i < layer->getHorTileCount(); i++)
+        {
+          f(layer->getTile(i, j));
+        }
+      }
+    }
+  }
+
+  uint64_t roundUp(uint64_t value, uint64_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+} // namespace
+
+const char* const PyramidCache::ENVIRONMENT_VARIABLE = "SCROOM_PYRAMID_CACHE";
+
+bool PyramidCache::Key::operator==(const Key& other) const
+{
+  return path == other.path && size == other.size && modified == other.modified && hash == other.hash;
+}
+
+PyramidCache::PyramidCache(std::string cacheFileName_, Key key_)
+  : cacheFileName(std::move(cacheFileName_))
+  , key(std::move(key_))
+{
+}
+
+PyramidCache::Ptr PyramidCache::create(const std::string& fileName)
+{
+  const char* value = getenv(ENVIRONMENT_VARIABLE); // NOLINT(concurrency-mt-unsafe)
+  if(value == nullptr || *value == '\0')
+  {
+    return nullptr;
+  }
+
+  boost::system::error_code     ec;
+  const boost::filesystem::path path = boost::filesystem::canonical(fileName, ec);
+  if(ec)
+  {
+    return nullptr;
+  }
+
+  if(strcmp(value, SIDECAR) == 0)
+  {
+    return create(path.string(), path.string() + EXTENSION);
+  }
+
+  Hash hash;
+  hash.add(path.string().data(), path.string().size());
+  return create(path.string(), (boost::filesystem::path(value) / fmt::format("{:016x}{}", hash.get(), EXTENSION)).string());
+}
+
+PyramidCache::Ptr PyramidCache::create(const std::string& fileName, const std::string& cacheFileName)
+{
+  boost::system::error_code ec;
+  Key                       key;
+  key.path     = fileName;
+  key.size     = boost::filesystem::file_size(fileName, ec);
+  key.modified = ec ? 0 : static_cast<int64_t>(boost::filesystem::last_write_time(fileName, ec));
+  if(ec || !hashSamples(fileName, key.size, key.hash))
+  {
+    spdlog::warn("Not caching {}: Can't read file", fileName);
+    return nullptr;
+  }
+
+  return Ptr(new PyramidCache(cacheFileName, std::move(key)));
+}
+
+bool PyramidCache::restore(const std::vector<Layer::Ptr>& layers)
+{
+  std::ifstream in(cacheFileName, std::ios::binary);
+  if(!in || layers.empty())
+  {
+    return false;
+  }
+
+  const uint64_t pageSize = layers[0]->getPageProvider()->getPageSize();
+
+  std::array<char, MAGIC.size()> magic{};
+  uint32_t                       version      = 0;
+  uint32_t                       tileSize     = 0;
+  uint64_t                       filePageSize = 0;
+  Key                            fileKey;
+  uint32_t                       layerCount = 0;
+
+  in.read(magic.data(), magic.size());
+  if(!in || magic != MAGIC || !read(in, version) || version != VERSION || !read(in, tileSize) || tileSize != TILESIZE
+     || !read(in, filePageSize) || filePageSize != pageSize || !readString(in, fileKey.path) || !read(in, fileKey.size)
+     || !read(in, fileKey.modified) || !read(in, fileKey.hash))
+  {
+    spdlog::info("Ignoring {}: Not a compatible cache file", cacheFileName);
+    return false;
+  }
+  if(!(fileKey == key))
+  {
+    spdlog::info("Ignoring {}: {} has changed", cacheFileName, key.path);
+    return false;
+  }
+
+  size_t tileCount = 0;
+  if(!read(in, layerCount) || layerCount != layers.size())
+  {
+    spdlog::info("Ignoring {}: Different number of layers", cacheFileName);
+    return false;
+  }
+  for(const Layer::Ptr& layer: layers)
+  {
+    LayerLayout fileLayout;
+    if(!read(in, fileLayout) || !(fileLayout == LayerLayout(layer)))
+    {
+      spdlog::info("Ignoring {}: Different layer layout", cacheFileName);
+      return false;
+    }
+    tileCount += fileLayout.tileCount();
+  }
+
+  std::vector<TileEntry> entries(tileCount);
+  uint64_t               pageCount = 0;
+  for(TileEntry& entry: entries)
+  {
+    if(!read(in, entry) || !entry.isValid())
+    {
+      spdlog::info("Ignoring {}: Invalid tile", cacheFileName);
+      return false;
+    }
+    pageCount += entry.pageCount;
+  }
+
+  uint64_t filePageCount = 0;
+  if(!read(in, filePageCount) || filePageCount != pageCount)
+  {
+    spdlog::info("Ignoring {}: Invalid page count", cacheFileName);
+    return false;
+  }
+
+  const uint64_t            dataOffset = roundUp(static_cast<uint64_t>(in.tellg()), pageSize);
+  boost::system::error_code ec;
+  if(boost::filesystem::file_size(cacheFileName, ec) != dataOffset + pageCount * pageSize || ec)
+  {
+    spdlog::info("Ignoring {}: Truncated", cacheFileName);
+    return false;
+  }
+
+  // If all tiles are uniform, there are no pages, and nothing to map
+  Scroom::MemoryBlocks::BlockInterface::Ptr block;
+  if(pageCount > 0)
+  {
+    block = Scroom::MemoryBlocks::mapFile(cacheFileName, dataOffset, pageCount, pageSize);
+    if(!block)
+    {
+      return false;
+    }
+  }
+
+  size_t page  = 0;
+  auto   entry = entries.begin();
+  forEachTile(layers,
+              [&](const CompressedTile::Ptr& tile)
+              {
+                if(entry->patternSize > 0)
+                {
+                  tile->initializeUniform({entry->pattern.begin(), entry->pattern.begin() + entry->patternSize});
+                }
+                else
+                {
+                  PageList pages;
+                  for(uint32_t i = 0; i < entry->pageCount; i++)
+                  {
+                    pages.push_back(std::make_shared<Scroom::MemoryBlocks::Page>(block, page++));
+                  }
+                  tile->restore(static_cast<Codec>(entry->codec), std::move(pages));
+                }
+                ++entry;
+              });
+
+  spdlog::info("Restored {} tiles of {} from {}", tileCount, key.path, cacheFileName);
+  return true;
+}
+
+bool PyramidCache::store(const std::vector<Layer::Ptr>& layers)
+{
+  if(layers.empty())
+  {
+    return false;
+  }
+
+  const uint64_t pageSize = layers[0]->getPageProvider()->getPageSize();
+
+  std::vector<TileContents> tiles;
+  uint64_t                  pageCount = 0;
+  bool                      complete  = true;
+  forEachTile(layers,
+              [&](const CompressedTile::Ptr& tile)
+              {
+                TileContents contents{tile->getCompressedData(), tile->getUniformPattern()};
+                complete = complete
+                           && (!contents.compressed.second.empty()
+                               || (!contents.pattern.empty() && contents.pattern.size() <= TileEntry().pattern.size()));
+                pageCount += contents.compressed.second.size();
+                tiles.push_back(std::move(contents));
+              });
+  if(!complete)
+  {
+    spdlog::warn("Not caching {}: Not all tiles have been loaded", key.path);
+    return false;
+  }
+
+  boost::system::error_code     ec;
+  const boost::filesystem::path target(cacheFileName);
+  // Other viewers may be storing the same file concurrently
+  const boost::filesystem::path temporary = target.string() + boost::filesystem::unique_path(".%%%%-%%%%-%%%%.tmp").string();
+  if(target.has_parent_path())
+  {
+    boost::filesystem::create_directories(target.parent_path(), ec);
+  }
+
+  {
+    std::ofstream out(temporary.string(), std::ios::binary | std::ios::trunc);
+    out.write(MAGIC.data(), MAGIC.size());
+    write(out, VERSION);
+    write(out, static_cast<uint32_t>(TILESIZE));
+    write(out, pageSize);
+    writeString(out, key.path);
+    write(out, key.size);
+    write(out, key.modified);
+    write(out, key.hash);
+
+    write(out, static_cast<uint32_t>(layers.size()));
+    for(const Layer::Ptr& layer: layers)
+    {
+      write(out, LayerLayout(layer));
+    }
+    for(const TileContents& tile: tiles)
+    {
+      TileEntry entry;
+      entry.codec       = static_cast<uint32_t>(tile.compressed.first);
+      entry.pageCount   = static_cast<uint32_t>(tile.compressed.second.size());
+      entry.patternSize = static_cast<uint32_t>(tile.pattern.size());
+      std::copy(tile.pattern.begin(), tile.pattern.end(), entry.pattern.begin());
+      write(out, entry);
+    }
+    write(out, pageCount);
+
+    const uint64_t          dataOffset = roundUp(static_cast<uint64_t>(out.tellp()), pageSize);
+    const std::vector<char> padding(dataOffset - static_cast<uint64_t>(out.tellp()), 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+    for(const TileContents& tile: tiles)
+    {
+      for(const Page::Ptr& page: tile.compressed.second)
+      {
+        out.write(reinterpret_cast<const char*>(page->get().get()), static_cast<std::streamsize>(pageSize));
+      }
+    }
+
+    if(!out.flush())
+    {
+      spdlog::warn("Failed to write {}", temporary.string());
+      out.close();
+      boost::filesystem::remove(temporary, ec);
+      return false;
+    }
+  }
+
+  boost::filesystem::rename(temporary, target, ec);
+  if(ec)
+  {
+    spdlog::warn("Failed to write {}: {}", cacheFileName, ec.message());
+    boost::filesystem::remove(temporary, ec);
+    return false;
+  }
+
+  spdlog::info("Stored {} tiles of {} in {}", tiles.size(), key.path, cacheFileName);
+  return true;
+}
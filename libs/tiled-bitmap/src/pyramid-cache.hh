@@ -0,0 +1,93 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <scroom/tiledbitmaplayer.hh>
+
+/**
+ * Keeps the compressed tiles of all layers of a bitmap on disk
+ *
+ * Loading a large file, and reducing it into all the layers of the
+ * pyramid, takes a lot of time. Once that is done, store() writes the
+ * compressed tiles to a cache file. When the same file is opened
+ * again, restore() memory-maps the cache file, and uses it as the
+ * contents of the tiles, such that loading and reducing can be
+ * skipped entirely.
+ *
+ * The cache is only used if the SCROOM_PYRAMID_CACHE environment
+ * variable is set. If its value is "sidecar", the cache file is stored
+ * next to the original file. Otherwise, it is the name of the
+ * directory the cache files are stored in.
+ *
+ * A cache file is only used if the path, size, modification time and
+ * a hash of (samples of) the contents of the original file haven't
+ * changed, and if the layers have the same layout as when the cache
+ * was stored.
+ */
+class PyramidCache
+{
+public:
+  using Ptr = std::shared_ptr<PyramidCache>;
+
+  static const char* const ENVIRONMENT_VARIABLE;
+
+  /** Identifies the version of the original file that was cached */
+  struct Key
+  {
+    std::string path;
+    uint64_t    size{0};
+    int64_t     modified{0};
+    uint64_t    hash{0};
+
+    bool operator==(const Key& other) const;
+  };
+
+private:
+  std::string cacheFileName;
+  Key         key;
+
+private:
+  PyramidCache(std::string cacheFileName, Key key);
+
+public:
+  /**
+   * Create a cache for the given file, if caching is enabled
+   *
+   * @return @c nullptr if caching is disabled, or if @c fileName can't be read
+   */
+  static Ptr create(const std::string& fileName);
+
+  /** Create a cache for @c fileName, stored in @c cacheFileName */
+  static Ptr create(const std::string& fileName, const std::string& cacheFileName);
+
+  /**
+   * Initialize all tiles of @c layers from the cache file
+   *
+   * Nothing is changed unless the cache file is valid for the current
+   * contents of the original file.
+   *
+   * @retval true if the tiles were restored
+   */
+  bool restore(const std::vector<Layer::Ptr>& layers);
+
+  /**
+   * Write the compressed tiles of @c layers to the cache file
+   *
+   * All tiles must have been initialized.
+   *
+   * @retval true if the cache file was written
+   */
+  bool store(const std::vector<Layer::Ptr>& layers);
+
+  const std::string& getCacheFileName() const { return cacheFileName; }
+};
@@ -0,0 +1,385 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "reduce-kernels.hh"
+
+#include <array>
+#include <cstring>
+
+#include <scroom/assertions.hh>
+
+#ifdef SCROOM_X86_KERNELS
+#  include <immintrin.h>
+#endif
+
+namespace Scroom::TiledBitmap::Detail
+{
+  namespace
+  {
+    ////////////////////////////////////////////////////////////////////////
+    // Scalar
+
+    std::array<uint8_t, 256> createBitCountLut()
+    {
+      std::array<uint8_t, 256> lut{};
+      for(size_t i = 0; i < lut.size(); i++)
+      {
+        size_t sum = 0;
+        for(size_t v = i; v; v >>= 1)
+        {
+          sum += v & 1;
+        }
+        lut[i] = static_cast<uint8_t>(sum);
+      }
+      return lut;
+    }
+
+    const std::array<uint8_t, 256> bitCountLut = createBitCountLut();
+
+    void reduce1bppScalar(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      // Goal is to compute a 8-bit grey value from a 8*8 black/white
+      // image. To do so, we take each of the 8 bytes, count the
+      // number of 1's in each, and add them. Finally, we divide that
+      // by 64 (the maximum number of ones in that area)
+      for(size_t i = 0; i < count; i++)
+      {
+        const uint8_t* current = source + i;
+        int            sum     = 0;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          sum += bitCountLut[*current];
+        }
+        target[i] = static_cast<uint8_t>(sum * 255 / 64);
+      }
+    }
+
+    void reduce8bppScalar(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      for(size_t i = 0; i < count; i++)
+      {
+        const uint8_t* base = source + 8 * i;
+        int            sum  = 0;
+        for(int k = 0; k < 8; k++, base += sourceStride)
+        {
+          for(int l = 0; l < 8; l++)
+          {
+            sum += base[l];
+          }
+        }
+        target[i] = static_cast<uint8_t>(sum / 64);
+      }
+    }
+
+    void reduce24bppScalar(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      for(size_t i = 0; i < count; i++)
+      {
+        const uint8_t* base  = source + 8 * 3 * i;
+        int            sum_r = 0;
+        int            sum_g = 0;
+        int            sum_b = 0;
+        for(int k = 0; k < 8; k++, base += sourceStride)
+        {
+          const uint8_t* current = base;
+          for(int l = 0; l < 8; l++, current += 3)
+          {
+            sum_r += current[0];
+            sum_g += current[1];
+            sum_b += current[2];
+          }
+        }
+        target[3 * i]     = static_cast<uint8_t>(sum_r / 64);
+        target[3 * i + 1] = static_cast<uint8_t>(sum_g / 64);
+        target[3 * i + 2] = static_cast<uint8_t>(sum_b / 64);
+      }
+    }
+
+    void reduceCMYK32Scalar(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      for(size_t i = 0; i < count; i++)
+      {
+        const uint8_t* base  = source + 8 * 4 * i;
+        int            sum_c = 0;
+        int            sum_m = 0;
+        int            sum_y = 0;
+        int            sum_k = 0;
+        for(int k = 0; k < 8; k++, base += sourceStride)
+        {
+          for(size_t current = 0; current < 8 * 4; current += 4)
+          {
+            sum_c += base[current];
+            sum_m += base[current + 1];
+            sum_y += base[current + 2];
+            sum_k += base[current + 3];
+          }
+        }
+        target[4 * i]     = static_cast<uint8_t>(sum_c / 64);
+        target[4 * i + 1] = static_cast<uint8_t>(sum_m / 64);
+        target[4 * i + 2] = static_cast<uint8_t>(sum_y / 64);
+        target[4 * i + 3] = static_cast<uint8_t>(sum_k / 64);
+      }
+    }
+
+    const ReduceKernels scalarKernels = {reduce1bppScalar, reduce8bppScalar, reduce24bppScalar, reduceCMYK32Scalar};
+
+#ifdef SCROOM_X86_KERNELS
+    ////////////////////////////////////////////////////////////////////////
+    // SSE2
+    //
+    // All sums below fit in 16 bits: 64 pixels of at most 255 add up to
+    // at most 16320. Dividing by 64 is a shift, as all sums are positive.
+
+    __attribute__((target("sse2"))) __m128i load(const uint8_t* p)
+    {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    /** Count the bits in each byte */
+    __attribute__((target("sse2"))) __m128i bitCount(__m128i v)
+    {
+      const __m128i m1 = _mm_set1_epi8(0x55);
+      const __m128i m2 = _mm_set1_epi8(0x33);
+      const __m128i m4 = _mm_set1_epi8(0x0F);
+
+      v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+      v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+      return _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+    }
+
+    __attribute__((target("sse2"))) void reduce1bppSse2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m128i zero  = _mm_setzero_si128();
+      const __m128i scale = _mm_set1_epi16(255);
+
+      size_t i = 0;
+      for(; i + 16 <= count; i += 16)
+      {
+        // Each byte holds the number of ones in one 8*8 area, at most 64
+        __m128i        sum     = zero;
+        const uint8_t* current = source + i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          sum = _mm_add_epi8(sum, bitCount(load(current)));
+        }
+
+        const __m128i low  = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(sum, zero), scale), 6);
+        const __m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(sum, zero), scale), 6);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(low, high));
+      }
+      reduce1bppScalar(source + i, sourceStride, target + i, count - i);
+    }
+
+    __attribute__((target("sse2"))) void reduce8bppSse2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m128i zero = _mm_setzero_si128();
+
+      size_t i = 0;
+      for(; i + 2 <= count; i += 2)
+      {
+        // psadbw sums each group of 8 bytes into a 64-bit lane
+        __m128i        sum     = zero;
+        const uint8_t* current = source + 8 * i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          sum = _mm_add_epi64(sum, _mm_sad_epu8(load(current), zero));
+        }
+
+        sum           = _mm_srli_epi64(sum, 6);
+        target[i]     = static_cast<uint8_t>(_mm_cvtsi128_si32(sum));
+        target[i + 1] = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum)));
+      }
+      reduce8bppScalar(source + 8 * i, sourceStride, target + i, count - i);
+    }
+
+    __attribute__((target("sse2"))) void reduce24bppSse2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m128i zero = _mm_setzero_si128();
+
+      size_t i = 0;
+      for(; i + 2 <= count; i += 2)
+      {
+        // Two target pixels take 48 source bytes per row. Sum the rows
+        // first, then sum each colour channel within the row
+        __m128i        sum[6]  = {zero, zero, zero, zero, zero, zero}; // NOLINT(modernize-avoid-c-arrays)
+        const uint8_t* current = source + 8 * 3 * i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          for(size_t b = 0; b < 3; b++)
+          {
+            const __m128i v = load(current + 16 * b);
+            sum[2 * b]      = _mm_add_epi16(sum[2 * b], _mm_unpacklo_epi8(v, zero));
+            sum[2 * b + 1]  = _mm_add_epi16(sum[2 * b + 1], _mm_unpackhi_epi8(v, zero));
+          }
+        }
+
+        std::array<uint16_t, 48> columns{};
+        std::memcpy(columns.data(), sum, sizeof(columns));
+        for(size_t p = 0; p < 2; p++)
+        {
+          for(size_t c = 0; c < 3; c++)
+          {
+            int total = 0;
+            for(size_t l = 0; l < 8; l++)
+            {
+              total += columns[24 * p + 3 * l + c];
+            }
+            target[3 * (i + p) + c] = static_cast<uint8_t>(total / 64);
+          }
+        }
+      }
+      reduce24bppScalar(source + 8 * 3 * i, sourceStride, target + 3 * i, count - i);
+    }
+
+    /** Sum the four CMYK pixels in @c v, divide by 64, and store the result in @c target */
+    __attribute__((target("sse2"))) void storeCMYK(__m128i v, uint8_t* target)
+    {
+      v                    = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), 6);
+      const int32_t result = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+      std::memcpy(target, &result, 4);
+    }
+
+    __attribute__((target("sse2"))) void reduceCMYK32Sse2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m128i zero = _mm_setzero_si128();
+
+      for(size_t i = 0; i < count; i++)
+      {
+        // Each 16-bit lane sums one channel of a column of pixels
+        __m128i        sum     = zero;
+        const uint8_t* current = source + 8 * 4 * i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          const __m128i v0 = load(current);
+          const __m128i v1 = load(current + 16);
+          sum              = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v0, zero), _mm_unpackhi_epi8(v0, zero)));
+          sum              = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v1, zero), _mm_unpackhi_epi8(v1, zero)));
+        }
+        storeCMYK(sum, target + 4 * i);
+      }
+    }
+
+    const ReduceKernels sse2Kernels = {reduce1bppSse2, reduce8bppSse2, reduce24bppSse2, reduceCMYK32Sse2};
+
+    ////////////////////////////////////////////////////////////////////////
+    // AVX2
+
+    __attribute__((target("avx2"))) __m256i load256(const uint8_t* p)
+    {
+      return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    __attribute__((target("avx2"))) __m256i bitCount(__m256i v)
+    {
+      const __m256i m1 = _mm256_set1_epi8(0x55);
+      const __m256i m2 = _mm256_set1_epi8(0x33);
+      const __m256i m4 = _mm256_set1_epi8(0x0F);
+
+      v = _mm256_sub_epi8(v, _mm256_and_si256(_mm256_srli_epi16(v, 1), m1));
+      v = _mm256_add_epi8(_mm256_and_si256(v, m2), _mm256_and_si256(_mm256_srli_epi16(v, 2), m2));
+      return _mm256_and_si256(_mm256_add_epi8(v, _mm256_srli_epi16(v, 4)), m4);
+    }
+
+    __attribute__((target("avx2"))) void reduce1bppAvx2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m256i zero  = _mm256_setzero_si256();
+      const __m256i scale = _mm256_set1_epi16(255);
+
+      size_t i = 0;
+      for(; i + 32 <= count; i += 32)
+      {
+        __m256i        sum     = zero;
+        const uint8_t* current = source + i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          sum = _mm256_add_epi8(sum, bitCount(load256(current)));
+        }
+
+        // Unpacking and packing both work per 128-bit lane, so the
+        // order of the bytes is preserved
+        const __m256i low  = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(sum, zero), scale), 6);
+        const __m256i high = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(sum, zero), scale), 6);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i), _mm256_packus_epi16(low, high));
+      }
+      reduce1bppSse2(source + i, sourceStride, target + i, count - i);
+    }
+
+    __attribute__((target("avx2"))) void reduce8bppAvx2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m256i zero = _mm256_setzero_si256();
+
+      size_t i = 0;
+      for(; i + 4 <= count; i += 4)
+      {
+        __m256i        sum     = zero;
+        const uint8_t* current = source + 8 * i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          sum = _mm256_add_epi64(sum, _mm256_sad_epu8(load256(current), zero));
+        }
+
+        std::array<uint64_t, 4> sums{};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums.data()), sum);
+        for(size_t p = 0; p < 4; p++)
+        {
+          target[i + p] = static_cast<uint8_t>(sums[p] / 64);
+        }
+      }
+      reduce8bppSse2(source + 8 * i, sourceStride, target + i, count - i);
+    }
+
+    __attribute__((target("avx2"))) void reduceCMYK32Avx2(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count)
+    {
+      const __m256i zero = _mm256_setzero_si256();
+
+      for(size_t i = 0; i < count; i++)
+      {
+        __m256i        sum     = zero;
+        const uint8_t* current = source + 8 * 4 * i;
+        for(int k = 0; k < 8; k++, current += sourceStride)
+        {
+          const __m256i v = load256(current);
+          sum = _mm256_add_epi16(sum, _mm256_add_epi16(_mm256_unpacklo_epi8(v, zero), _mm256_unpackhi_epi8(v, zero)));
+        }
+        storeCMYK(_mm_add_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)), target + 4 * i);
+      }
+    }
+
+    // RGB pixels don't line up with 256-bit registers, so there is
+    // little to gain over SSE2 there
+    const ReduceKernels avx2Kernels = {reduce1bppAvx2, reduce8bppAvx2, reduce24bppSse2, reduceCMYK32Avx2};
+#endif
+  } // namespace
+
+  const ReduceKernels& getReduceKernels(InstructionSet instructionSet)
+  {
+    require(isAvailable(instructionSet));
+
+    switch(instructionSet)
+    {
+    case InstructionSet::SCALAR:
+      return scalarKernels;
+#ifdef SCROOM_X86_KERNELS
+    case InstructionSet::SSE2:
+      return sse2Kernels;
+    case InstructionSet::AVX2:
+      return avx2Kernels;
+#else
+    case InstructionSet::SSE2:
+    case InstructionSet::AVX2:
+      break;
+#endif
+    }
+    defect();
+  }
+
+  const ReduceKernels& getReduceKernels()
+  {
+    static const ReduceKernels& best = getReduceKernels(bestInstructionSet());
+    return best;
+  }
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,52 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "instruction-set.hh"
+
+/**
+ * Kernels for reducing bitmaps by a factor 8, for use by
+ * LayerOperations::reduce()
+ *
+ * Each kernel computes one row of target pixels from 8 rows of source
+ * pixels. There is a scalar version of each kernel, and, on x86, SSE2
+ * and AVX2 versions. All versions produce identical output.
+ */
+namespace Scroom::TiledBitmap::Detail
+{
+  /**
+   * Reduce one row of pixels by a factor 8
+   *
+   * @param source Top-left of the 8 source rows
+   * @param sourceStride Distance between two source rows, in bytes
+   * @param target First target pixel
+   * @param count Number of target pixels to compute
+   */
+  using ReduceRow = void (*)(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t count);
+
+  struct ReduceKernels
+  {
+    ReduceRow reduce1bpp;   /**< 1bpp source to 8bpp greyscale target */
+    ReduceRow reduce8bpp;   /**< 8bpp source to 8bpp target */
+    ReduceRow reduce24bpp;  /**< RGB source to RGB target */
+    ReduceRow reduceCMYK32; /**< CMYK source to CMYK target */
+  };
+
+  /**
+   * @return The kernels for the given instruction set.
+   *
+   * @pre isAvailable(instructionSet)
+   */
+  const ReduceKernels& getReduceKernels(InstructionSet instructionSet);
+
+  /** @return The fastest kernels the current CPU supports */
+  const ReduceKernels& getReduceKernels();
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,240 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "tile-chunks.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include <scroom/tiledbitmaplayer.hh>
+#include <scroom/trace.hh>
+
+#include "local.hh"
+
+namespace
+{
+  const int MIN_CHUNK_SIZE     = 64;
+  const int DEFAULT_CHUNK_SIZE = 256;
+
+  std::atomic<int> renderChunkSize{DEFAULT_CHUNK_SIZE};
+
+  size_t bytesFor(int width, int height, int bpp)
+  {
+    return static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(bpp) / 8;
+  }
+
+  /** Copy the given area of @p tile into a tile of its own */
+  ConstTile::Ptr copyChunk(const ConstTile::Ptr& tile, int x, int y, int width, int height)
+  {
+    if(width == tile->width && height == tile->height)
+    {
+      return tile;
+    }
+
+    const size_t   sourceStride = bytesFor(tile->width, 1, tile->bpp);
+    const size_t   stride       = bytesFor(width, 1, tile->bpp);
+    const uint8_t* source       = tile->data.get() + bytesFor(tile->width, y, tile->bpp) + bytesFor(x, 1, tile->bpp);
+
+    std::shared_ptr<uint8_t> const data(new uint8_t[stride * static_cast<size_t>(height)], std::default_delete<uint8_t[]>());
+    uint8_t*                       target = data.get();
+    for(int j = 0; j < height; j++, source += sourceStride, target += stride)
+    {
+      memcpy(target, source, stride);
+    }
+
+    return ConstTile::create(width, height, tile->bpp, data);
+  }
+} // namespace
+
+void setRenderChunkSize(int size)
+{
+  int result = MIN_CHUNK_SIZE;
+  while(result < TILESIZE && 2 * result <= size)
+  {
+    result *= 2;
+  }
+  renderChunkSize = result;
+}
+
+int getRenderChunkSize() { return renderChunkSize; }
+
+TileChunks::Ptr TileChunks::create(ConstTile::Ptr tile, LayerOperations::Ptr lo, int chunkSize)
+{
+  return Ptr(new TileChunks(std::move(tile), std::move(lo), chunkSize));
+}
+
+TileChunks::TileChunks(ConstTile::Ptr tile_, LayerOperations::Ptr lo_, int chunkSize_)
+  : tile(std::move(tile_))
+  , lo(std::move(lo_))
+  , chunkSize(chunkSize_)
+  , horChunkCount((tile->width + chunkSize - 1) / chunkSize)
+  , verChunkCount((tile->height + chunkSize - 1) / chunkSize)
+  , queue(ThreadPool::Queue::createAsync())
+  , chunks(static_cast<size_t>(horChunkCount * verChunkCount))
+{
+}
+
+TileChunks::~TileChunks()
+{
+  // Conversions that haven't started yet are no longer needed
+  for(Chunk& chunk: chunks)
+  {
+    if(chunk.job)
+    {
+      chunk.job->cancel();
+    }
+  }
+}
+
+void TileChunks::draw(cairo_t*                         cr,
+                      Scroom::Utils::Rectangle<double> tileArea,
+                      Scroom::Utils::Rectangle<double> viewArea,
+                      int                              zoom,
+                      double                           rank,
+                      const DrawMissing&               drawMissing)
+{
+  const int multiplier = 1 << zoom;
+
+  const int imin = std::max(0, static_cast<int>(tileArea.getLeft()) / chunkSize);
+  const int imax = std::min(horChunkCount, static_cast<int>(std::ceil(tileArea.getRight() / chunkSize)));
+  const int jmin = std::max(0, static_cast<int>(tileArea.getTop()) / chunkSize);
+  const int jmax = std::min(verChunkCount, static_cast<int>(std::ceil(tileArea.getBottom() / chunkSize)));
+
+  for(int j = jmin; j < jmax; j++)
+  {
+    for(int i = imin; i < imax; i++)
+    {
+      std::shared_ptr<Contents> contents;
+      {
+        boost::mutex::scoped_lock const lock(mut);
+        contents = getContents(i, j, rank);
+      }
+
+      const int                              width  = std::min(chunkSize, tile->width - i * chunkSize);
+      const int                              height = std::min(chunkSize, tile->height - j * chunkSize);
+      const Scroom::Utils::Rectangle<double> chunkArea(i * chunkSize, j * chunkSize, width, height);
+      const auto                             visibleChunkArea = tileArea.intersection(chunkArea);
+      if(visibleChunkArea.isEmpty())
+      {
+        continue;
+      }
+
+      auto chunkViewArea = (visibleChunkArea - tileArea.getTopLeft()) * multiplier;
+      chunkViewArea += viewArea.getTopLeft();
+
+      cairo_save(cr);
+      if(contents)
+      {
+        lo->draw(cr, contents->tile, visibleChunkArea - chunkArea.getTopLeft(), chunkViewArea, zoom, contents->cache);
+      }
+      else
+      {
+        drawMissing(visibleChunkArea, chunkViewArea);
+      }
+      cairo_restore(cr);
+    }
+  }
+}
+
+int TileChunks::getCachedChunkCount()
+{
+  boost::mutex::scoped_lock const lock(mut);
+  return static_cast<int>(
+    std::count_if(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return !chunk.contents.expired(); }));
+}
+
+std::shared_ptr<TileChunks::Contents> TileChunks::getContents(int i, int j, double rank)
+{
+  Chunk&                          chunk  = chunks[static_cast<size_t>(j * horChunkCount + i)];
+  std::shared_ptr<Contents> const result = chunk.contents.lock();
+  if(result)
+  {
+    chunk.entry->touch();
+
+    if(lo->isOutdated(result->cache) && !chunk.job)
+    {
+      // The colormap changed. Keep drawing the outdated chunk until it has been converted again
+      chunk.job = scheduleConversion(i, j, rank);
+    }
+  }
+  else if(chunk.job)
+  {
+    chunk.job->setRank(rank);
+  }
+  else
+  {
+    chunk.job = scheduleConversion(i, j, rank);
+  }
+
+  return result;
+}
+
+RankedJobs::Job::Ptr TileChunks::scheduleConversion(int i, int j, double rank)
+{
+  // Pending conversions shouldn't keep us alive
+  return LoadJobs()->schedule(
+    [weak = std::weak_ptr<TileChunks>(shared_from_this<TileChunks>()), i, j]
+    {
+      if(auto me = weak.lock())
+      {
+        me->convert(i, j);
+      }
+    },
+    rank,
+    queue);
+}
+
+void TileChunks::convert(int i, int j)
+{
+  Scroom::Utils::Trace::Span const span("TileChunks::convert");
+
+  std::shared_ptr<Contents> result;
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    result = chunks[static_cast<size_t>(j * horChunkCount + i)].contents.lock();
+  }
+
+  if(result)
+  {
+    // Outdated
+    lo->updateCache(result->tile, 0, result->cache);
+  }
+  else
+  {
+    const int width  = std::min(chunkSize, tile->width - i * chunkSize);
+    const int height = std::min(chunkSize, tile->height - j * chunkSize);
+
+    result       = std::make_shared<Contents>();
+    result->tile = copyChunk(tile, i * chunkSize, j * chunkSize, width, height);
+
+    // Zoom level 0 is used for all zoom levels above it as well
+    Scroom::Utils::Stuff base = lo->cache(result->tile);
+    result->cache             = lo->cacheZoom(result->tile, 0, base);
+
+    const size_t copied = result->tile == tile ? 0 : bytesFor(width, height, tile->bpp);
+    Scroom::Utils::MemoryBudget::Entry::Ptr entry =
+      Scroom::Utils::MemoryBudget::instance()->retain(result, copied + bytesFor(width, height, 32));
+
+    boost::mutex::scoped_lock const lock(mut);
+    Chunk&                          chunk = chunks[static_cast<size_t>(j * horChunkCount + i)];
+    chunk.contents                        = result;
+    chunk.entry                           = std::move(entry);
+  }
+
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    chunks[static_cast<size_t>(j * horChunkCount + i)].job.reset();
+  }
+
+  for(const TileLoadingObserver::Ptr& observer: getObservers())
+  {
+    observer->tileLoaded(tile);
+  }
+}
@@ -0,0 +1,123 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/memorybudget.hh>
+#include <scroom/observable.hh>
+#include <scroom/ranked-jobs.hh>
+#include <scroom/rectangle.hh>
+#include <scroom/stuff.hh>
+#include <scroom/threadpool.hh>
+#include <scroom/tile.hh>
+#include <scroom/tiledbitmapinterface.hh>
+#include <scroom/tiledbitmaplayer.hh>
+
+/**
+ * Caches of a tile for zoom levels 0 and up, computed per chunk when needed
+ *
+ * At those zoom levels, usually only a small part of a tile is
+ * visible. Rather than converting the entire tile up front, the tile
+ * is divided in square chunks, which are converted as soon as draw()
+ * first needs them. Each chunk is a ConstTile of its own, such that
+ * the LayerOperations can treat it like any other tile.
+ *
+ * Chunks are converted on the thread pool, as LoadJobs. Until a chunk
+ * is ready, draw() has something else drawn in its place. Observers
+ * are told when chunks become ready, such that they can be drawn.
+ *
+ * Chunks are accounted for by the MemoryBudget. If it evicts one, it
+ * is computed again the next time it is drawn.
+ *
+ * @see setRenderChunkSize()
+ */
+class TileChunks : public Scroom::Utils::Observable<TileLoadingObserver>
+{
+public:
+  using Ptr = std::shared_ptr<TileChunks>;
+
+  /**
+   * Draw something in place of a chunk that isn't ready yet
+   *
+   * The parameters are the tileArea and viewArea of the chunk, like
+   * those of LayerOperations::draw().
+   */
+  using DrawMissing = std::function<void(Scroom::Utils::Rectangle<double>, Scroom::Utils::Rectangle<double>)>;
+
+private:
+  struct Contents
+  {
+    ConstTile::Ptr       tile; /**< Copy of the pixels of the chunk */
+    Scroom::Utils::Stuff cache;
+  };
+
+  struct Chunk
+  {
+    std::weak_ptr<Contents>                 contents;
+    Scroom::Utils::MemoryBudget::Entry::Ptr entry;
+    RankedJobs::Job::Ptr                    job; /**< Converting the chunk, if that is in progress */
+  };
+
+  ConstTile::Ptr         tile;
+  LayerOperations::Ptr   lo;
+  int                    chunkSize;
+  int                    horChunkCount;
+  int                    verChunkCount;
+  ThreadPool::Queue::Ptr queue;
+  boost::mutex           mut;
+  std::vector<Chunk>     chunks; /**< Protected by mut */
+
+public:
+  ~TileChunks() override;
+  TileChunks(const TileChunks&)           = delete;
+  TileChunks(TileChunks&&)                = delete;
+  TileChunks operator=(const TileChunks&) = delete;
+  TileChunks operator=(TileChunks&&)      = delete;
+
+  static Ptr create(ConstTile::Ptr tile, LayerOperations::Ptr lo, int chunkSize);
+
+  /**
+   * Draw the given tileArea into the given viewArea
+   *
+   * Like LayerOperations::draw(), but drawing chunks covering
+   * @p tileArea that aren't ready using @p drawMissing, and scheduling
+   * their conversion with the given @p rank.
+   *
+   * @pre @p zoom >= 0
+   */
+  void draw(cairo_t*                         cr,
+            Scroom::Utils::Rectangle<double> tileArea,
+            Scroom::Utils::Rectangle<double> viewArea,
+            int                              zoom,
+            double                           rank,
+            const DrawMissing&               drawMissing);
+
+  /** @return The number of chunks that currently have a cache */
+  int getCachedChunkCount();
+
+private:
+  TileChunks(ConstTile::Ptr tile, LayerOperations::Ptr lo, int chunkSize);
+
+  /**
+   * Return the contents of the given chunk, or schedule its conversion if there are none
+   *
+   * Call only while mut is locked
+   */
+  std::shared_ptr<Contents> getContents(int i, int j, double rank);
+
+  /** Schedule convert() of the given chunk on the LoadJobs */
+  RankedJobs::Job::Ptr scheduleConversion(int i, int j, double rank);
+
+  /** Compute the contents of the given chunk */
+  void convert(int i, int j);
+};
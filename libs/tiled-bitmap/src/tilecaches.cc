@@ -0,0 +1,65 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "tilecaches.hh"
+
+#include <iterator>
+
+TileCaches::Ptr TileCaches::create() { return Ptr(new TileCaches()); }
+
+TileCaches::Cache TileCaches::find(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile)
+{
+  boost::mutex::scoped_lock const l(mut);
+  return lookup(lo, zoom, tile);
+}
+
+TileCaches::Cache TileCaches::store(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile, Cache cache)
+{
+  boost::mutex::scoped_lock const l(mut);
+
+  Cache const existing = lookup(lo, zoom, tile);
+  if(existing.stuff)
+  {
+    return existing;
+  }
+
+  // Forget about caches that are no longer in use
+  for(auto i = caches.begin(); i != caches.end();)
+  {
+    i = i->second.stuff.expired() ? caches.erase(i) : std::next(i);
+  }
+
+  if(cache.stuff)
+  {
+    caches[Key(lo.get(), zoom)] = Entry{tile, lo, cache.stuff, cache.entry, cache.entry != nullptr};
+  }
+
+  return cache;
+}
+
+TileCaches::Cache TileCaches::lookup(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile)
+{
+  Cache result;
+
+  auto i = caches.find(Key(lo.get(), zoom));
+  if(i != caches.end() && i->second.tile.lock() == tile && i->second.lo.lock() == lo)
+  {
+    result.stuff = i->second.stuff.lock();
+    result.entry = i->second.entry.lock();
+    if(i->second.accounted && !result.entry)
+    {
+      // No longer accounted for. Better to compute it again
+      result = Cache();
+    }
+    else if(result.entry)
+    {
+      result.entry->touch();
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,88 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/memorybudget.hh>
+#include <scroom/stuff.hh>
+#include <scroom/tile.hh>
+#include <scroom/tiledbitmapinterface.hh>
+
+/**
+ * Caches computed by LayerOperations for a single tile, shared by all views
+ *
+ * Views that show the same tile, using the same LayerOperations, at
+ * the same zoom level, need identical caches. Rather than each view
+ * computing and storing its own, they share them via this object.
+ *
+ * Caches are only referenced weakly. They disappear as soon as no
+ * view holds on to them anymore, and they are never handed out for a
+ * tile other than the one they were computed from.
+ */
+class TileCaches
+{
+public:
+  using Ptr = std::shared_ptr<TileCaches>;
+
+  /** Zoom level to use for the result of LayerOperations::cache() */
+  static constexpr int BASE = std::numeric_limits<int>::min();
+
+  /** Zoom level to use for the TileChunks used at zoom levels 0 and up */
+  static constexpr int CHUNKS = BASE + 1;
+
+  struct Cache
+  {
+    Scroom::Utils::Stuff                    stuff;
+    Scroom::Utils::MemoryBudget::Entry::Ptr entry; /**< Accounts for @c stuff, if it needs accounting */
+  };
+
+private:
+  struct Entry
+  {
+    ConstTile::WeakPtr                                tile;
+    std::weak_ptr<LayerOperations>                    lo;
+    Scroom::Utils::StuffWeak                          stuff;
+    std::weak_ptr<Scroom::Utils::MemoryBudget::Entry> entry;
+    bool                                              accounted;
+  };
+
+  using Key = std::pair<const LayerOperations*, int>;
+
+  boost::mutex         mut;
+  std::map<Key, Entry> caches;
+
+public:
+  static Ptr create();
+
+  /**
+   * Find the cache computed by @p lo for @p tile at the given @p zoom
+   *
+   * @return An empty Cache if there is none
+   */
+  Cache find(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile);
+
+  /**
+   * Make the given cache available to other views
+   *
+   * If another view stored a cache for the same tile in the mean time,
+   * that one is returned, such that the duplicate can be dropped.
+   */
+  Cache store(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile, Cache cache);
+
+private:
+  TileCaches() = default;
+
+  /** Call only while mut is locked */
+  Cache lookup(const LayerOperations::Ptr& lo, int zoom, const ConstTile::Ptr& tile);
+};
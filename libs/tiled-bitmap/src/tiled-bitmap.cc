@@ -48,7 +48,7 @@ Scroom::Utils::Stuff Scroom::TiledBitmap::scheduleLoadingBitmap(const SourcePres
   Sequentially()->schedule(
     [progress, layer, sp, weakQueue, on_finished, wait_until_done]
     {
-      Scroom::GtkHelpers::sync_on_ui_thread([=] { progress->setWorking(0); });
+      Scroom::GtkHelpers::post_on_ui_thread([=] { progress->setWorking(0); });
       layer->fetchData(sp, weakQueue, on_finished);
       wait_until_done->P();
     });
@@ -96,6 +96,16 @@ void TiledBitmap::initialize(const Layer::Ptr& bottom)
   LayerOperations::Ptr                         lo       = ls[i];
   Scroom::MemoryBlobs::PageProvider::Ptr const provider = bottom->getPageProvider();
 
+  progressUpdate = Scroom::GtkHelpers::CoalescedUpdate::create(
+    [weakMe = WeakPtr(shared_from_this<TiledBitmap>())]
+    {
+      TiledBitmap::Ptr const me = weakMe.lock();
+      if(me)
+      {
+        me->reportProgress();
+      }
+    });
+
   registrations.emplace_back(bottom->registerObserver(shared_from_this<TileInitialisationObserver>()));
   layers.push_back(bottom);
 
@@ -213,7 +223,8 @@ void TiledBitmap::redraw(ViewInterface::Ptr const&               vi,
     scaledRequestedPresentationArea /= 8;
   }
   Layer::Ptr const           layer           = layers[layerNr];
-  LayerOperations::Ptr const layerOperations = ls[std::min(ls.size() - 1, static_cast<size_t>(layerNr))];
+  LayerOperations::Ptr const layerOperations = getLayerOperations(layerNr);
+  Layer::Ptr const           parentLayer     = layerNr + 1 < layers.size() ? layers[layerNr + 1] : nullptr;
 
   const Scroom::Utils::Rectangle<int> actualPresentationArea = layer->getRect();
   const auto validPresentationArea = scaledRequestedPresentationArea.intersection(actualPresentationArea);
@@ -228,7 +239,12 @@ void TiledBitmap::redraw(ViewInterface::Ptr const&               vi,
   const int jmin = std::max(0, top / TILESIZE);
   const int jmax = (bottom + TILESIZE - 1) / TILESIZE;
 
-  viewData_->setNeededTiles(layer, imin, imax, jmin, jmax, zoom, layerOperations);
+  const Scroom::Utils::Point<double> centre =
+    Scroom::Utils::make_point((scaledRequestedPresentationArea.getLeft() + scaledRequestedPresentationArea.getRight()) / 2,
+                              (scaledRequestedPresentationArea.getTop() + scaledRequestedPresentationArea.getBottom()) / 2);
+
+  viewData_->setNeededTiles(
+    layer, imin, imax, jmin, jmax, zoom, layerOperations, centre, parentLayer, getLayerOperations(layerNr + 1));
 
   const double pixelSize = pixelSizeFromZoom(zoom);
 
@@ -252,13 +268,42 @@ void TiledBitmap::redraw(ViewInterface::Ptr const&               vi,
       CompressedTile::Ptr const  tile          = layer->getTile(i, j);
       TileViewState::Ptr const   tileViewState = tile->getViewState(vi);
       Scroom::Utils::Stuff const cacheResult   = tileViewState->getCacheResult();
+      TileChunks::Ptr const      chunks        = tileViewState->getChunks();
       ConstTile::Ptr const       t             = tile->getConstTileAsync();
 
-      if(t)
+      if(chunks)
+      {
+        cairo_save(cr);
+        chunks->draw(cr,
+                     tileAreaRect,
+                     viewAreaRect,
+                     zoom,
+                     tileViewState->getRank(),
+                     [&](Scroom::Utils::Rectangle<double> chunkArea, Scroom::Utils::Rectangle<double> chunkViewArea)
+                     {
+                       // Not converted yet. A scaled up version will have to do for now
+                       if(!drawFromParent(vi, cr, layerNr, i, j, chunkArea, chunkViewArea, zoom))
+                       {
+                         layerOperations->drawState(cr, TILE_LOADED, chunkViewArea);
+                       }
+                     });
+        cairo_restore(cr);
+      }
+      else if(!(t && (cacheResult || tileViewState->isDone()))
+              && drawFromParent(vi, cr, layerNr, i, j, tileAreaRect, viewAreaRect, zoom))
+      {
+        // Not ready yet. A scaled up version will have to do for now
+      }
+      else if(t)
       {
         cairo_save(cr);
         layerOperations->draw(cr, t, tileAreaRect, viewAreaRect, zoom, cacheResult);
         cairo_restore(cr);
+
+        if(layerOperations->isOutdated(cacheResult))
+        {
+          tileViewState->updateCache();
+        }
       }
       else
       {
@@ -271,6 +316,73 @@ void TiledBitmap::redraw(ViewInterface::Ptr const&               vi,
   }
 }
 
+LayerOperations::Ptr TiledBitmap::getLayerOperations(size_t layerNr) const { return ls[std::min(ls.size() - 1, layerNr)]; }
+
+bool TiledBitmap::drawFromParent(ViewInterface::Ptr const&        vi,
+                                 cairo_t*                         cr,
+                                 size_t                           layerNr,
+                                 int                              i,
+                                 int                              j,
+                                 Scroom::Utils::Rectangle<double> tileArea,
+                                 Scroom::Utils::Rectangle<double> viewArea,
+                                 int                              zoom)
+{
+  const size_t parentNr = layerNr + 1;
+  if(tileArea.isEmpty() || parentNr >= layers.size())
+  {
+    return false;
+  }
+
+  // The parent layer is 8 times smaller. Only its tiles are kept
+  // loaded by setNeededTiles(), so there is no point in looking
+  // further up.
+  Scroom::Utils::Rectangle<double> area = tileArea;
+  area += Scroom::Utils::make_point<double>(i * TILESIZE, j * TILESIZE);
+  area /= 8;
+  zoom += 3;
+  i /= 8;
+  j /= 8;
+
+  // As zoom is at least 1 here, only chunks and uniform tiles can be
+  // drawn without knowing the zoom level their caches were made for
+  CompressedTile::Ptr const  tile             = layers[parentNr]->getTile(i, j);
+  TileViewState::Ptr const   tileViewState    = tile->getViewState(vi);
+  TileChunks::Ptr const      chunks           = tileViewState->getChunks();
+  ConstTile::Ptr const       t                = tile->getConstTileAsync();
+  LayerOperations::Ptr const parentOperations = getLayerOperations(parentNr);
+
+  const auto parentTileArea = area - Scroom::Utils::make_point<double>(i * TILESIZE, j * TILESIZE);
+  if(chunks)
+  {
+    cairo_save(cr);
+    chunks->draw(cr,
+                 parentTileArea,
+                 viewArea,
+                 zoom,
+                 tileViewState->getRank(),
+                 [&](Scroom::Utils::Rectangle<double> /*chunkArea*/, Scroom::Utils::Rectangle<double> chunkViewArea)
+                 { parentOperations->drawState(cr, TILE_LOADED, chunkViewArea); });
+    cairo_restore(cr);
+    return true;
+  }
+
+  Scroom::Utils::Stuff const cacheResult = tileViewState->getCacheResult();
+  if(t && t->uniform && cacheResult)
+  {
+    cairo_save(cr);
+    parentOperations->draw(cr, t, parentTileArea, viewArea, zoom, cacheResult);
+    cairo_restore(cr);
+
+    if(parentOperations->isOutdated(cacheResult))
+    {
+      tileViewState->updateCache();
+    }
+    return true;
+  }
+
+  return false;
+}
+
 void TiledBitmap::clearCaches(ViewInterface::Ptr viewInterface)
 {
   boost::mutex::scoped_lock const lock(viewDataMutex);
@@ -318,22 +430,69 @@ void TiledBitmap::tileCreated(const CompressedTile::Ptr& /*tile*/) { tileCount++
 void TiledBitmap::tileFinished(const CompressedTile::Ptr& /*tile*/)
 {
   boost::mutex::scoped_lock const lock(tileFinishedMutex);
-  tileFinishedCount++;
-  if(tileFinishedCount > tileCount)
+  const int                       finished = ++tileFinishedCount;
+  if(finished > tileCount)
   {
     defect_message("ERROR: Too many tiles are finished!");
   }
   else
   {
-    Scroom::GtkHelpers::sync_on_ui_thread(
-      [=]
-      {
-        progressBroadcaster->setWorking(1.0 * tileFinishedCount / tileCount);
-        if(tileFinishedCount == tileCount)
+    // Don't wait for the UI thread. It reads tileFinishedCount when it gets to it
+    progressUpdate->request();
+
+    if(finished == tileCount && cache)
+    {
+      // Writing the cache takes a while, and isn't urgent
+      CpuBound()->schedule(
+        [weakMe = WeakPtr(shared_from_this<TiledBitmap>()), cache_ = cache]
         {
-          progressBroadcaster->setFinished();
-          spdlog::info("Finished loading file");
-        }
-      });
+          TiledBitmap::Ptr const me = weakMe.lock();
+          if(me)
+          {
+            cache_->store(me->layers);
+          }
+        },
+        PRIO_LOWEST);
+      cache.reset();
+    }
+  }
+}
+
+void TiledBitmap::reportProgress()
+{
+  const int finished = tileFinishedCount;
+  if(finishedReported)
+  {
+    return;
+  }
+
+  progressBroadcaster->setWorking(1.0 * finished / tileCount);
+  if(finished == tileCount)
+  {
+    finishedReported = true;
+    progressBroadcaster->setFinished();
+    spdlog::info("Finished loading file");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// PyramidCache
+
+bool TiledBitmap::restore(const PyramidCache::Ptr& cache_)
+{
+  if(!cache_->restore(layers))
+  {
+    return false;
   }
+
+  boost::mutex::scoped_lock const lock(tileFinishedMutex);
+  tileFinishedCount = tileCount;
+  progressBroadcaster->setFinished();
+  return true;
+}
+
+void TiledBitmap::storeWhenFinished(PyramidCache::Ptr cache_)
+{
+  boost::mutex::scoped_lock const lock(tileFinishedMutex);
+  cache = std::move(cache_);
 }
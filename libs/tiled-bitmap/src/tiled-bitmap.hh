@@ -7,12 +7,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <memory>
 
 #include <boost/thread/mutex.hpp>
 
+#include <scroom/gtk-helpers.hh>
 #include <scroom/interface.hh>
 #include <scroom/opentiledbitmapinterface.hh>
 #include <scroom/progressinterfacehelpers.hh>
@@ -22,6 +24,7 @@
 #include <scroom/tiledbitmaplayer.hh>
 
 #include "layercoordinator.hh"
+#include "pyramid-cache.hh"
 #include "tiledbitmapviewdata.hh"
 
 class TiledBitmap
@@ -44,9 +47,12 @@ private:
   ViewDataMap                                      viewData;
   int                                              tileCount{0};
   boost::mutex                                     tileFinishedMutex;
-  int                                              tileFinishedCount{0};
+  std::atomic<int>                                 tileFinishedCount{0};
   Scroom::Utils::ProgressInterfaceBroadcaster::Ptr progressBroadcaster;
+  Scroom::GtkHelpers::CoalescedUpdate::Ptr         progressUpdate;          /**< Runs reportProgress() */
+  bool                                             finishedReported{false}; /**< Only accessed on the UI thread */
   Scroom::Utils::StuffList                         registrations;
+  PyramidCache::Ptr                                cache; /**< Stored once all tiles are finished */
 
 public:
   static Ptr create(int bitmapWidth, int bitmapHeight, LayerSpec const& ls);
@@ -64,10 +70,30 @@ private:
   void initialize();
   void initialize(const Layer::Ptr& bottom);
 
+  /** Pass the number of finished tiles to progressBroadcaster. Runs on the UI thread */
+  void reportProgress();
+
 private:
   static void drawTile(cairo_t* cr, const CompressedTile::Ptr& tile, const Scroom::Utils::Rectangle<double>& viewArea);
   void        connect(Layer::Ptr const& layer, Layer::Ptr const& prevLayer, const LayerOperations::Ptr& prevLo);
 
+  LayerOperations::Ptr getLayerOperations(size_t layerNr) const;
+
+  /**
+   * Draw the given area of tile (@p i, @p j) of layer @p layerNr by
+   * scaling up the parent layer, if that is ready to be drawn.
+   *
+   * @retval false if the parent layer isn't ready, or there is none
+   */
+  bool drawFromParent(ViewInterface::Ptr const&        vi,
+                      cairo_t*                         cr,
+                      size_t                           layerNr,
+                      int                              i,
+                      int                              j,
+                      Scroom::Utils::Rectangle<double> tileArea,
+                      Scroom::Utils::Rectangle<double> viewArea,
+                      int                              zoom);
+
 public:
   ////////////////////////////////////////////////////////////////////////
   // TiledBitmapInterface
@@ -93,4 +119,17 @@ public:
   ////////////////////////////////////////////////////////////////////////
   // Helpers
   ProgressInterface::Ptr progressInterface() { return progressBroadcaster; }
+
+  /** @return Layer @p layerNr, where layer 0 is the bottom layer */
+  Layer::Ptr getLayer(size_t layerNr) { return layers[layerNr]; }
+
+  /**
+   * Initialize all layers from @c cache, instead of loading them
+   *
+   * @retval true if all tiles were restored from the cache
+   */
+  bool restore(const PyramidCache::Ptr& cache);
+
+  /** Store all layers in @c cache, once all tiles have been loaded */
+  void storeWhenFinished(PyramidCache::Ptr cache);
 };
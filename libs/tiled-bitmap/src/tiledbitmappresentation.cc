@@ -140,7 +140,7 @@ namespace
     Scroom::Utils::WeakKeySet<ViewInterface::WeakPtr> getViews() override;
 
   private:
-    void clearCaches();
+    void redrawViews();
     TiledBitmapPresentation(std::string&&                        name_,
                             BitmapMetaData&&                     bmd_,
                             TiledBitmapInterface::Ptr&&          tbi_,
@@ -157,17 +157,15 @@ namespace
     }
   };
 
-  void TiledBitmapPresentation::clearCaches()
+  void TiledBitmapPresentation::redrawViews()
   {
+    // While drawing, the tiled bitmap notices the caches are outdated,
+    // and has them updated in the background
     for(const Views::value_type& p: views)
     {
       ViewInterface::Ptr const v = p.lock();
       if(v)
       {
-        if(tbi)
-        {
-          tbi->clearCaches(v);
-        }
         v->invalidate();
       }
     }
@@ -320,7 +318,7 @@ namespace
   void TiledBitmapPresentation::setColormap(Colormap::Ptr colormap)
   {
     colormapHelper->setColormap(colormap);
-    clearCaches();
+    redrawViews();
   }
 
   Colormap::Ptr TiledBitmapPresentation::getOriginalColormap() { return colormapHelper->getOriginalColormap(); }
@@ -330,19 +328,19 @@ namespace
   void TiledBitmapPresentation::setMonochromeColor(const Color& c)
   {
     colormapHelper->setMonochromeColor(c);
-    clearCaches();
+    redrawViews();
   }
 
   void TiledBitmapPresentation::setTransparentBackground()
   {
     colormapHelper->setTransparentBackground();
-    clearCaches();
+    redrawViews();
   }
 
   void TiledBitmapPresentation::disableTransparentBackground()
   {
     colormapHelper->disableTransparentBackground();
-    clearCaches();
+    redrawViews();
   }
 
   bool TiledBitmapPresentation::getTransparentBackground() { return colormapHelper->getTransparentBackground(); }
@@ -404,7 +402,20 @@ namespace
 
       auto tiledBitmapPresentation =
         TiledBitmapPresentation::create(fileName, bmd, tiledBitmap, properties, colormapHelper, pipetteLayerOperation);
-      tiledBitmapPresentation->add(load(tiledBitmap->progressInterface()));
+
+      PyramidCache::Ptr const cache = PyramidCache::create(fileName);
+      if(cache && tiledBitmap->restore(cache))
+      {
+        spdlog::info("Skipped loading {}", fileName);
+      }
+      else
+      {
+        if(cache)
+        {
+          tiledBitmap->storeWhenFinished(cache);
+        }
+        tiledBitmapPresentation->add(load(tiledBitmap->progressInterface()));
+      }
 
       if(bmd.aspectRatio)
       {
@@ -7,6 +7,8 @@
 
 #include "tiledbitmapviewdata.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 #include <scroom/gtk-helpers.hh>
@@ -14,6 +16,48 @@
 
 #include "tileviewstate.hh"
 
+namespace
+{
+  /**
+   * Tell the TiledBitmapViewData which area of the presentation
+   * changed when a tile finishes loading
+   */
+  class DirtyAreaReporter : public TileLoadingObserver
+  {
+  public:
+    using Ptr = std::shared_ptr<DirtyAreaReporter>;
+
+  private:
+    std::weak_ptr<TiledBitmapViewData> viewData;
+    Scroom::Utils::Rectangle<double>   presentationArea;
+
+  public:
+    DirtyAreaReporter(std::weak_ptr<TiledBitmapViewData> viewData_, Scroom::Utils::Rectangle<double> presentationArea_)
+      : viewData(std::move(viewData_))
+      , presentationArea(presentationArea_)
+    {
+    }
+
+    void tileLoaded(ConstTile::Ptr tile) override
+    {
+      TiledBitmapViewData::Ptr const viewData_ = viewData.lock();
+      if(viewData_)
+      {
+        viewData_->tileLoaded(tile, presentationArea);
+      }
+    }
+  };
+
+  /** Rank of the tiles of the parent layer, such that they are loaded before any tile of the layer itself */
+  const double PARENT_RANK = -1;
+
+  /** @return The rank of the tile at @c position, given a view centered on @c centre (in layer coordinates) */
+  double rankOf(Scroom::Utils::Point<int> position, Scroom::Utils::Point<double> centre)
+  {
+    return std::hypot((position.x + 0.5) * TILESIZE - centre.x, (position.y + 0.5) * TILESIZE - centre.y);
+  }
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////
 // TiledBitmapViewData
 
@@ -29,19 +73,37 @@ TiledBitmapViewData::TiledBitmapViewData(const ViewInterface::WeakPtr& viewInter
 {
 }
 
-void TiledBitmapViewData::setNeededTiles(Layer::Ptr const&    l,
-                                         int                  imin_,
-                                         int                  imax_,
-                                         int                  jmin_,
-                                         int                  jmax_,
-                                         int                  zoom_,
-                                         LayerOperations::Ptr layerOperations_)
+void TiledBitmapViewData::setNeededTiles(Layer::Ptr const&            l,
+                                         int                          imin_,
+                                         int                          imax_,
+                                         int                          jmin_,
+                                         int                          jmax_,
+                                         int                          zoom_,
+                                         LayerOperations::Ptr         layerOperations_,
+                                         Scroom::Utils::Point<double> centre_,
+                                         Layer::Ptr                   parentLayer_,
+                                         LayerOperations::Ptr         parentLayerOperations_)
 {
   boost::unique_lock<boost::mutex> lock(mut);
 
   if(layer == l && imin <= imin_ && imax >= imax_ && jmin <= jmin_ && jmax >= jmax_ && zoom == zoom_)
   {
-    // Nothing to do...
+    if(centre != centre_)
+    {
+      // The view moved. Do the work for the tiles closest to its centre first
+      centre     = centre_;
+      auto tiles = neededTiles;
+      lock.unlock();
+      for(const auto& [position, weakTileViewState]: tiles)
+      {
+        TileViewState::Ptr const tileViewState = weakTileViewState.lock();
+        if(tileViewState)
+        {
+          tileViewState->setRank(rankOf(position, centre_));
+        }
+      }
+      lock.lock();
+    }
   }
   else
   {
@@ -52,9 +114,13 @@ void TiledBitmapViewData::setNeededTiles(Layer::Ptr const&    l,
     jmax            = jmax_;
     zoom            = zoom_;
     layerOperations = std::move(layerOperations_);
+    centre          = centre_;
+
+    parentLayer           = std::move(parentLayer_);
+    parentLayerOperations = std::move(parentLayerOperations_);
 
     // Get data for new tiles
-    redrawPending = true; // if it isn't already
+    redrawPending = true; // Tiles that load while we register get drawn by this redraw
     lock.unlock();
     resetNeededTiles();
     lock.lock();
@@ -84,17 +150,68 @@ void TiledBitmapViewData::resetNeededTiles()
   // temporarily add registrations to the newStuff list, and add the newStuff to
   // stuff later.
 
+  const double layerScale = std::pow(8.0, layer->getDepth());
+
+  // Register the tiles closest to the centre of the view first, such
+  // that tiles of equal rank are also done in that order
+  std::vector<Scroom::Utils::Point<int>> positions;
   for(int i = imin; i < imax; i++)
   {
     for(int j = jmin; j < jmax; j++)
     {
-      CompressedTile::Ptr const tile = layer->getTile(i, j);
+      positions.emplace_back(i, j);
+    }
+  }
+  std::stable_sort(positions.begin(),
+                   positions.end(),
+                   [centre_ = centre](Scroom::Utils::Point<int> a, Scroom::Utils::Point<int> b)
+                   { return rankOf(a, centre_) < rankOf(b, centre_); });
+
+  std::vector<std::pair<Scroom::Utils::Point<int>, std::weak_ptr<TileViewState>>> newNeededTiles;
+
+  for(const Scroom::Utils::Point<int> position: positions)
+  {
+    const int                 i    = position.x;
+    const int                 j    = position.y;
+    CompressedTile::Ptr const tile = layer->getTile(i, j);
+
+    const Scroom::Utils::Rectangle<double> tileArea(i * TILESIZE, j * TILESIZE, TILESIZE, TILESIZE);
+    DirtyAreaReporter::Ptr const reporter =
+      std::make_shared<DirtyAreaReporter>(shared_from_this<TiledBitmapViewData>(), tileArea * layerScale);
+
+    TileViewState::Ptr const tileViewState = tile->getViewState(viewInterface);
+    tileViewState->setRank(rankOf(position, centre));
+    tileViewState->setViewData(shared_from_this<TiledBitmapViewData>());
+    tileViewState->setZoom(layerOperations, zoom);
+    newStuff.emplace_back(tileViewState);
+    newStuff.emplace_back(reporter);
+    newStuff.emplace_back(tileViewState->registerObserver(reporter));
+    newNeededTiles.emplace_back(position, tileViewState);
+  }
+
+  if(parentLayer)
+  {
+    // Tiles of the parent layer cover 64 tiles of this layer each, so
+    // loading them is relatively cheap. Scaled up, they fill the view
+    // while the tiles of this layer are still being loaded.
+    for(int i = imin / 8; i < (imax + 7) / 8; i++)
+    {
+      for(int j = jmin / 8; j < (jmax + 7) / 8; j++)
+      {
+        CompressedTile::Ptr const tile = parentLayer->getTile(i, j);
+
+        const Scroom::Utils::Rectangle<double> tileArea(i * TILESIZE, j * TILESIZE, TILESIZE, TILESIZE);
+        DirtyAreaReporter::Ptr const           reporter =
+          std::make_shared<DirtyAreaReporter>(shared_from_this<TiledBitmapViewData>(), tileArea * layerScale * 8);
 
-      TileViewState::Ptr const tileViewState = tile->getViewState(viewInterface);
-      tileViewState->setViewData(shared_from_this<TiledBitmapViewData>());
-      tileViewState->setZoom(layerOperations, zoom);
-      newStuff.emplace_back(tileViewState);
-      newStuff.emplace_back(tileViewState->registerObserver(shared_from_this<TiledBitmapViewData>()));
+        TileViewState::Ptr const tileViewState = tile->getViewState(viewInterface);
+        tileViewState->setRank(PARENT_RANK);
+        tileViewState->setViewData(shared_from_this<TiledBitmapViewData>());
+        tileViewState->setZoom(parentLayerOperations, zoom + 3);
+        newStuff.emplace_back(tileViewState);
+        newStuff.emplace_back(reporter);
+        newStuff.emplace_back(tileViewState->registerObserver(reporter));
+      }
     }
   }
 
@@ -108,14 +225,22 @@ void TiledBitmapViewData::resetNeededTiles()
   // Re-acquire the lock
   lock.lock();
   stuff.splice(stuff.end(), newStuff, newStuff.begin(), newStuff.end());
+  neededTiles.swap(newNeededTiles);
 }
 
-static void invalidate_view(const ViewInterface::WeakPtr& vi)
+static void invalidate_view(const TiledBitmapViewData::Ptr& viewData)
 {
-  ViewInterface::Ptr const v = vi.lock();
+  ViewInterface::Ptr const v = viewData->viewInterface.lock();
   if(v)
   {
-    Scroom::GtkHelpers::sync_on_ui_thread([=] { v->invalidate(); });
+    Scroom::GtkHelpers::sync_on_ui_thread(
+      [=]
+      {
+        for(const auto& area: viewData->takeDirtyAreas())
+        {
+          v->invalidateArea(area);
+        }
+      });
   }
 }
 
@@ -139,21 +264,36 @@ void TiledBitmapViewData::clearVolatileStuff()
   resetNeededTiles();
 }
 
-void TiledBitmapViewData::tileLoaded(ConstTile::Ptr tile)
+void TiledBitmapViewData::tileLoaded(const ConstTile::Ptr& tile, const Scroom::Utils::Rectangle<double>& presentationArea)
 {
   boost::unique_lock<boost::mutex> const lock(mut);
   stuff.emplace_back(tile);
 
   if(!redrawPending)
   {
-    // We're not sure about whether gdk_threads_enter() has been
-    // called or not, so we have no choice but to invalidate on
-    // another thread.
-    Scroom::GtkHelpers::async_on_ui_thread([=] { invalidate_view(viewInterface); });
-    redrawPending = true;
+    dirtyAreas.push_back(presentationArea);
+
+    if(!invalidatePending)
+    {
+      // We're not sure about whether gdk_threads_enter() has been
+      // called or not, so we have no choice but to invalidate on
+      // another thread.
+      TiledBitmapViewData::Ptr const me = shared_from_this<TiledBitmapViewData>();
+      Scroom::GtkHelpers::post_on_ui_thread([=] { invalidate_view(me); });
+      invalidatePending = true;
+    }
   }
 }
 
+std::vector<Scroom::Utils::Rectangle<double>> TiledBitmapViewData::takeDirtyAreas()
+{
+  boost::unique_lock<boost::mutex> const        lock(mut);
+  std::vector<Scroom::Utils::Rectangle<double>> result;
+  result.swap(dirtyAreas);
+  invalidatePending = false;
+  return result;
+}
+
 void TiledBitmapViewData::setIdle() { progressInterface->setIdle(); }
 
 void TiledBitmapViewData::setWaiting(double progress) { progressInterface->setWaiting(progress); }
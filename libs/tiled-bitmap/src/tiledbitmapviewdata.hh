@@ -8,17 +8,20 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <gtk/gtk.h>
 
 #include <scroom/bookkeeping.hh>
 #include <scroom/observable.hh>
+#include <scroom/point.hh>
+#include <scroom/rectangle.hh>
 #include <scroom/tiledbitmaplayer.hh>
 #include <scroom/viewinterface.hh>
 
 class TiledBitmapViewData
   : virtual public Scroom::Utils::Base
-  , public TileLoadingObserver
   , public ProgressInterface
 {
 public:
@@ -38,6 +41,19 @@ private:
   int                  zoom{0};
   LayerOperations::Ptr layerOperations;
 
+  /**
+   * The layer above @c layer, if any. Its tiles covering the view are
+   * loaded as well, to draw from while tiles of @c layer aren't ready.
+   */
+  Layer::Ptr           parentLayer;
+  LayerOperations::Ptr parentLayerOperations;
+
+  /** Centre of the view, in layer coordinates. Tiles closest to it are loaded first */
+  Scroom::Utils::Point<double> centre;
+
+  /** Tiles we need, with their coordinates, such that they can be re-ranked when the centre moves */
+  std::vector<std::pair<Scroom::Utils::Point<int>, std::weak_ptr<TileViewState>>> neededTiles;
+
   /**
    * References to things we want to keep around.
    *
@@ -55,9 +71,19 @@ private:
    */
   Scroom::Utils::StuffList volatileStuff;
 
+  /**
+   * Areas of the presentation, containing tiles that were loaded, that
+   * the view has not been asked to redraw yet
+   */
+  std::vector<Scroom::Utils::Rectangle<double>> dirtyAreas;
+
+  /** A full redraw is in progress, so there is no need to track dirty areas */
   bool redrawPending{false};
 
-  /** Protect @c stuff and @c redrawPending */
+  /** The view will be told about the @c dirtyAreas shortly */
+  bool invalidatePending{false};
+
+  /** Protect @c stuff, @c neededTiles, @c dirtyAreas, @c redrawPending and @c invalidatePending */
   boost::mutex mut;
 
 private:
@@ -66,14 +92,39 @@ private:
 public:
   static Ptr create(const ViewInterface::WeakPtr& viewInterface);
 
-  void
-    setNeededTiles(Layer::Ptr const& l, int imin, int imax, int jmin, int jmax, int zoom, LayerOperations::Ptr layerOperations);
+  /**
+   * Make sure the given tiles are loaded and cached
+   *
+   * @param centre The centre of the view, in layer coordinates. Tiles
+   *    closest to it are loaded first.
+   * @param parentLayer The layer above @p l, or nullptr if there is
+   *    none. The tiles covering the view are loaded before those of
+   *    @p l.
+   */
+  void setNeededTiles(Layer::Ptr const&            l,
+                      int                          imin,
+                      int                          imax,
+                      int                          jmin,
+                      int                          jmax,
+                      int                          zoom,
+                      LayerOperations::Ptr         layerOperations,
+                      Scroom::Utils::Point<double> centre,
+                      Layer::Ptr                   parentLayer,
+                      LayerOperations::Ptr         parentLayerOperations);
   void resetNeededTiles();
   void storeVolatileStuff(const Scroom::Utils::Stuff& stuff);
   void clearVolatileStuff();
 
-  // TileLoadingObserver ////////////////////////////////////////////////
-  void tileLoaded(ConstTile::Ptr tile) override;
+  /**
+   * Called when a tile we need finished loading
+   *
+   * @param tile The loaded tile
+   * @param presentationArea The area of the presentation covered by @c tile
+   */
+  void tileLoaded(const ConstTile::Ptr& tile, const Scroom::Utils::Rectangle<double>& presentationArea);
+
+  /** @return The areas the view should redraw, clearing them */
+  std::vector<Scroom::Utils::Rectangle<double>> takeDirtyAreas();
 
   // ProgressInterface ///////////////////////////////////////////////////
   void setIdle() override;
@@ -12,6 +12,7 @@
 
 #include <fmt/format.h>
 
+#include <scroom/memorybudget.hh>
 #include <scroom/observable.hh>
 #include <scroom/stuff.hh>
 #include <scroom/threadpool.hh>
@@ -21,20 +22,52 @@
 #include "local.hh"
 #include "tiledbitmapviewdata.hh"
 
+namespace
+{
+  /** Estimated size of an ARGB32 surface for @p tile at the given @p zoom */
+  size_t surfaceSize(const ConstTile::Ptr& tile, int zoom)
+  {
+    const int divider = zoom < 0 ? 1 << -zoom : 1;
+    return static_cast<size_t>(tile->width / divider) * static_cast<size_t>(tile->height / divider) * 4;
+  }
+} // namespace
+
+/** Tell the observers of a TileViewState that some of its chunks are ready */
+class TileViewState::ChunkObserver : public TileLoadingObserver
+{
+private:
+  TileViewState::WeakPtr owner;
+
+public:
+  explicit ChunkObserver(TileViewState::WeakPtr owner_)
+    : owner(std::move(owner_))
+  {
+  }
+
+  void tileLoaded(ConstTile::Ptr tile_) override
+  {
+    TileViewState::Ptr const owner_ = owner.lock();
+    if(owner_)
+    {
+      owner_->reportDone(nullptr, tile_);
+    }
+  }
+};
+
 TileViewState::~TileViewState() { r.reset(); }
 
-TileViewState::Ptr TileViewState::create(const std::shared_ptr<CompressedTile>& parent)
+TileViewState::Ptr TileViewState::create(const std::shared_ptr<CompressedTile>& parent, TileCaches::Ptr caches)
 {
-  TileViewState::Ptr result(new TileViewState(parent));
+  TileViewState::Ptr result(new TileViewState(parent, std::move(caches)));
 
   result->r = parent->registerObserver(result);
 
   return result;
 }
 
-TileViewState::TileViewState(std::shared_ptr<CompressedTile> parent_)
+TileViewState::TileViewState(std::shared_ptr<CompressedTile> parent_, TileCaches::Ptr caches_)
   : parent(std::move(parent_))
-  , cpuBound(CpuBound())
+  , caches(std::move(caches_))
 {
 }
 
@@ -47,9 +80,10 @@ void TileViewState::tileLoaded(ConstTile::Ptr tile_)
   // Abort any zoom currently in progress
   if(state > LOADED)
   {
-    queue.reset();
-    weakQueue.reset();
+    abort();
     zoomCache.reset();
+    zoomCacheEntry.reset();
+    dropChunks();
   }
   state = LOADED;
 
@@ -62,6 +96,37 @@ Scroom::Utils::Stuff TileViewState::getCacheResult()
   return zoomCache;
 }
 
+bool TileViewState::isDone()
+{
+  boost::mutex::scoped_lock const l(mut);
+  return state == DONE;
+}
+
+TileChunks::Ptr TileViewState::getChunks()
+{
+  boost::mutex::scoped_lock const l(mut);
+  return chunks;
+}
+
+void TileViewState::updateCache()
+{
+  boost::mutex::scoped_lock const l(mut);
+
+  // If work is in progress, the zoom cache is about to be replaced anyway
+  if(state != DONE || !zoomCache || queue || !tbvd.lock())
+  {
+    return;
+  }
+
+  queue     = ThreadPool::Queue::createAsync();
+  weakQueue = queue->getWeak();
+  job       = LoadJobs()->schedule(
+    [me = shared_from_this<TileViewState>(), wq = weakQueue, tile = tile, lo = lo, zoomCache = zoomCache, zoom = zoom]
+    { me->recomputeCache(wq, tile, lo, zoomCache, zoom); },
+    rank,
+    weakQueue);
+}
+
 void TileViewState::setViewData(const TiledBitmapViewData::Ptr& tbvd_)
 {
   boost::mutex::scoped_lock const l(mut);
@@ -94,10 +159,15 @@ void TileViewState::setZoom(LayerOperations::Ptr lo_, int zoom_)
     // Abort any zoom currently in progress
     if(state >= BASE_COMPUTED)
     {
-      queue.reset();
-      weakQueue.reset();
+      abort();
       zoomCache.reset();
-      state = BASE_COMPUTED;
+      zoomCacheEntry.reset();
+
+      // If we went straight to drawing in chunks, there is no base cache
+      // yet. Don't look at chunks for this, because they are only
+      // available once computeChunks() is done.
+      state = baseCacheEntry ? BASE_COMPUTED : LOADED;
+      dropChunks();
     }
   }
 
@@ -118,11 +188,44 @@ void TileViewState::kick()
 
   if(state >= LOADED && desiredState >= state && !queue && tbvd_)
   {
-    queue = ThreadPool::Queue::createAsync();
+    queue     = ThreadPool::Queue::createAsync();
+    weakQueue = queue->getWeak();
+    job       = LoadJobs()->schedule(
+      [me = shared_from_this<TileViewState>(), wq = weakQueue] { me->process(wq); }, rank, weakQueue);
+  }
+}
+
+void TileViewState::abort()
+{
+  if(job)
+  {
+    job->cancel();
+    job.reset();
+  }
+  queue.reset();
+  weakQueue.reset();
+}
 
-    cpuBound->schedule(
-      [me = shared_from_this<TileViewState>(), weakQueue = queue->getWeak()] { me->process(weakQueue); }, LOAD_PRIO, queue);
+void TileViewState::setRank(double rank_)
+{
+  {
+    boost::mutex::scoped_lock const l(mut);
+    rank = rank_;
+    if(job)
+    {
+      job->setRank(rank);
+    }
   }
+
+  // Not while holding our lock. The parent holds its lock while
+  // telling us the tile was loaded.
+  parent->setRank(rank_);
+}
+
+double TileViewState::getRank()
+{
+  boost::mutex::scoped_lock const l(mut);
+  return rank;
 }
 
 void TileViewState::process(const ThreadPool::WeakQueue::Ptr& wq)
@@ -138,15 +241,34 @@ void TileViewState::process(const ThreadPool::WeakQueue::Ptr& wq)
       switch(state)
       {
       case LOADED:
-        fn    = [me = shared_from_this<TileViewState>(), wq, tile = tile, lo = lo] { me->computeBase(wq, tile, lo); };
-        state = COMPUTING_BASE;
-        break;
-
       case BASE_COMPUTED:
-        fn = [me = shared_from_this<TileViewState>(), wq, tile = tile, lo = lo, baseCache = baseCache, zoom = zoom]
-        { me->computeZoom(wq, tile, lo, baseCache, zoom); };
-        state = COMPUTING_ZOOM;
-        break;
+      {
+        Scroom::Utils::Stuff const baseCache_ = baseCache.lock();
+        if(zoom >= 0 && !tile->uniform)
+        {
+          // Caches are computed while drawing, for the visible parts of the tile only
+          fn = [me = shared_from_this<TileViewState>(), wq, tile = tile, lo = lo, zoom = zoom]
+          { me->computeChunks(wq, tile, lo, zoom); };
+          state = COMPUTING_ZOOM;
+        }
+        else if(state == LOADED || (baseCacheEntry && !baseCache_))
+        {
+          // Not computed yet, or evicted by the MemoryBudget
+          fn    = [me = shared_from_this<TileViewState>(), wq, tile = tile, lo = lo] { me->computeBase(wq, tile, lo); };
+          state = COMPUTING_BASE;
+        }
+        else
+        {
+          if(baseCacheEntry)
+          {
+            baseCacheEntry->touch();
+          }
+          fn = [me = shared_from_this<TileViewState>(), wq, tile = tile, lo = lo, baseCache = baseCache_, zoom = zoom]
+          { me->computeZoom(wq, tile, lo, baseCache, zoom); };
+          state = COMPUTING_ZOOM;
+        }
+      }
+      break;
 
       case ZOOM_COMPUTED:
         state = DONE;
@@ -176,8 +298,7 @@ void TileViewState::process(const ThreadPool::WeakQueue::Ptr& wq)
 
     if(wq == weakQueue)
     {
-      queue.reset();
-      weakQueue.reset();
+      abort();
     }
   }
 }
@@ -186,15 +307,30 @@ void TileViewState::computeBase(const ThreadPool::WeakQueue::Ptr& wq,
                                 const ConstTile::Ptr&             tile_,
                                 const LayerOperations::Ptr&       lo_)
 {
-  Scroom::Utils::Stuff const baseCache_ = lo_->cache(tile_);
+  Scroom::Utils::Trace::Span const span("TileViewState::computeBase", traceTags());
+
+  TileCaches::Cache base = caches->find(lo_, TileCaches::BASE, tile_);
+  if(!base.stuff)
+  {
+    // For uniform tiles, caching the small sample suffices
+    const ConstTile::Ptr& source = tile_->uniform ? tile_->uniform : tile_;
+
+    base.stuff = lo_->cache(source);
+    if(base.stuff)
+    {
+      base.entry = Scroom::Utils::MemoryBudget::instance()->retain(base.stuff, surfaceSize(source, 0));
+      base       = caches->store(lo_, TileCaches::BASE, tile_, base);
+    }
+  }
 
   boost::mutex::scoped_lock const l(mut);
   TiledBitmapViewData::Ptr const  tbvd_ = tbvd.lock();
 
   if(tbvd_ && desiredState >= BASE_COMPUTED && weakQueue == wq)
   {
-    baseCache = baseCache_;
-    state     = BASE_COMPUTED;
+    baseCache      = base.stuff;
+    baseCacheEntry = base.entry;
+    state          = BASE_COMPUTED;
   }
 }
 
@@ -204,14 +340,83 @@ void TileViewState::computeZoom(const ThreadPool::WeakQueue::Ptr& wq,
                                 Scroom::Utils::Stuff              baseCache_,
                                 int                               zoom_)
 {
-  Scroom::Utils::Stuff const zoomCache_ = lo_->cacheZoom(tile_, zoom_, baseCache_);
+  Scroom::Utils::Trace::Span const span("TileViewState::computeZoom", traceTags());
+
+  TileCaches::Cache zoomed = caches->find(lo_, zoom_, tile_);
+  if(!zoomed.stuff)
+  {
+    // The sample of a uniform tile looks the same at any zoom level
+    const ConstTile::Ptr& source = tile_->uniform ? tile_->uniform : tile_;
+    const int             level  = tile_->uniform ? 0 : zoom_;
+
+    zoomed.stuff = lo_->cacheZoom(source, level, baseCache_);
+    if(zoomed.stuff && zoomed.stuff != baseCache_)
+    {
+      // Pinned for as long as any view holds on to it, but accounted for
+      zoomed.entry = Scroom::Utils::MemoryBudget::instance()->retain(zoomed.stuff, surfaceSize(source, level));
+    }
+    zoomed = caches->store(lo_, zoom_, tile_, zoomed);
+  }
 
   boost::mutex::scoped_lock const l(mut);
   TiledBitmapViewData::Ptr const  tbvd_ = tbvd.lock();
   if(tbvd_ && desiredState >= ZOOM_COMPUTED && zoom == zoom_ && weakQueue == wq)
   {
-    zoomCache = zoomCache_;
-    state     = ZOOM_COMPUTED;
+    zoomCache      = zoomed.stuff;
+    zoomCacheEntry = zoomed.entry;
+    state          = ZOOM_COMPUTED;
+  }
+}
+
+void TileViewState::computeChunks(const ThreadPool::WeakQueue::Ptr& wq,
+                                  const ConstTile::Ptr&             tile_,
+                                  const LayerOperations::Ptr&       lo_,
+                                  int                               zoom_)
+{
+  TileCaches::Cache shared = caches->find(lo_, TileCaches::CHUNKS, tile_);
+  if(!shared.stuff)
+  {
+    shared.stuff = TileChunks::create(tile_, lo_, getRenderChunkSize());
+    shared       = caches->store(lo_, TileCaches::CHUNKS, tile_, shared);
+  }
+
+  boost::mutex::scoped_lock const l(mut);
+  TiledBitmapViewData::Ptr const  tbvd_ = tbvd.lock();
+  if(tbvd_ && desiredState >= ZOOM_COMPUTED && zoom == zoom_ && weakQueue == wq)
+  {
+    chunks             = std::static_pointer_cast<TileChunks>(shared.stuff);
+    chunksRegistration = chunks->registerStrongObserver(std::make_shared<ChunkObserver>(shared_from_this<TileViewState>()));
+    state              = ZOOM_COMPUTED;
+  }
+}
+
+void TileViewState::recomputeCache(const ThreadPool::WeakQueue::Ptr& wq,
+                                   const ConstTile::Ptr&             tile_,
+                                   const LayerOperations::Ptr&       lo_,
+                                   Scroom::Utils::Stuff              zoomCache_,
+                                   int                               zoom_)
+{
+  Scroom::Utils::Trace::Span const span("TileViewState::recomputeCache", traceTags());
+
+  // Same as in computeZoom()
+  const ConstTile::Ptr& source = tile_->uniform ? tile_->uniform : tile_;
+  const int             level  = tile_->uniform ? 0 : zoom_;
+
+  const bool updated = lo_->updateCache(source, level, zoomCache_);
+
+  {
+    boost::mutex::scoped_lock const l(mut);
+    if(wq != weakQueue)
+    {
+      // Aborted. Whoever did that takes care of redrawing
+      return;
+    }
+    abort();
+  }
+
+  if(updated)
+  {
+    reportDone(wq, tile_);
   }
 }
 
@@ -223,6 +428,12 @@ void TileViewState::reportDone(const ThreadPool::WeakQueue::Ptr& /*wq*/, const C
   }
 }
 
+void TileViewState::dropChunks()
+{
+  chunksRegistration.reset();
+  chunks.reset();
+}
+
 void TileViewState::clear()
 {
   boost::mutex::scoped_lock const l(mut);
@@ -232,11 +443,30 @@ void TileViewState::clear()
     state = LOADED;
   }
 
-  queue.reset();
-  weakQueue.reset();
+  // The view no longer needs this tile. Drop any work that hasn't
+  // been done yet, rather than completing it. If the view needs the
+  // tile again, it'll call setViewData().
+  abort();
+  tbvd.reset();
   lifeTimeManager.reset();
   baseCache.reset();
+  baseCacheEntry.reset();
   zoomCache.reset();
+  zoomCacheEntry.reset();
+  dropChunks();
+}
 
-  kick();
+Scroom::Utils::Trace::Tags TileViewState::traceTags()
+{
+  Scroom::Utils::Trace::Tags tags{parent->depth, parent->x, parent->y, nullptr};
+  if(Scroom::Utils::Trace::isEnabled())
+  {
+    boost::mutex::scoped_lock const l(mut);
+    TiledBitmapViewData::Ptr const  tbvd_ = tbvd.lock();
+    if(tbvd_)
+    {
+      tags.view = tbvd_->viewInterface.lock().get();
+    }
+  }
+  return tags;
 }
@@ -11,11 +11,17 @@
 
 #include <boost/thread.hpp>
 
+#include <scroom/memorybudget.hh>
 #include <scroom/observable.hh>
+#include <scroom/ranked-jobs.hh>
 #include <scroom/stuff.hh>
 #include <scroom/threadpool.hh>
 #include <scroom/tiledbitmapinterface.hh>
 #include <scroom/tiledbitmaplayer.hh>
+#include <scroom/trace.hh>
+
+#include "tile-chunks.hh"
+#include "tilecaches.hh"
 
 class TiledBitmapViewData;
 
@@ -39,21 +45,46 @@ public:
   };
 
 private:
+  class ChunkObserver;
+
   std::shared_ptr<CompressedTile>    parent;
+  TileCaches::Ptr                    caches;
   boost::mutex                       mut;
   State                              state{INIT};
   State                              desiredState{LOADED};
   ThreadPool::Queue::Ptr             queue;
   ThreadPool::WeakQueue::Ptr         weakQueue;
+  RankedJobs::Job::Ptr               job;
+  double                             rank{0};
   Scroom::Utils::Stuff               r;
   ConstTile::Ptr                     tile;
   std::weak_ptr<TiledBitmapViewData> tbvd;
   LayerOperations::Ptr               lo;
   int                                zoom{0};
   Scroom::Utils::StuffWeak           lifeTimeManager;
-  Scroom::Utils::Stuff               baseCache;
-  Scroom::Utils::Stuff               zoomCache;
-  ThreadPool::Ptr                    cpuBound;
+
+  /**
+   * The base cache is only needed for computing new zoom levels, so
+   * the MemoryBudget is allowed to evict it. It'll be recomputed when
+   * needed.
+   *
+   * Both caches are shared with other views of the same tile, via
+   * TileCaches.
+   */
+  Scroom::Utils::StuffWeak                baseCache;
+  Scroom::Utils::MemoryBudget::Entry::Ptr baseCacheEntry;
+  Scroom::Utils::Stuff                    zoomCache;
+  Scroom::Utils::MemoryBudget::Entry::Ptr zoomCacheEntry;
+
+  /**
+   * At zoom levels 0 and up, the tile is drawn from chunks that are
+   * cached as they become visible, rather than from the zoomCache.
+   *
+   * Our observers are told when chunks become ready, via
+   * chunksRegistration.
+   */
+  TileChunks::Ptr            chunks;
+  Scroom::Bookkeeping::Token chunksRegistration;
 
 public:
   ~TileViewState() override;
@@ -62,23 +93,54 @@ public:
   TileViewState operator=(const TileViewState&) = delete;
   TileViewState operator=(TileViewState&&)      = delete;
 
-  static Ptr create(const std::shared_ptr<CompressedTile>& parent);
+  static Ptr create(const std::shared_ptr<CompressedTile>& parent, TileCaches::Ptr caches);
 
   Scroom::Utils::Stuff getCacheResult();
+
+  /** @return true if all caches for the current zoom level have been computed */
+  bool isDone();
+
+  /** @return The chunks to draw the tile from, or nullptr if the tile is to be drawn using getCacheResult() */
+  TileChunks::Ptr getChunks();
+
+  /**
+   * Update the cache for the current zoom level in the background, if it is outdated
+   *
+   * @see LayerOperations::isOutdated()
+   */
+  void updateCache();
+
   void                 setViewData(const std::shared_ptr<TiledBitmapViewData>& tbvd);
   void                 setZoom(LayerOperations::Ptr lo, int zoom);
 
+  /**
+   * Set the rank of the work that needs to be done for this tile
+   *
+   * Tiles with a lower rank get loaded and cached first.
+   *
+   * @see RankedJobs
+   */
+  void setRank(double rank);
+
+  /** @return The rank set using setRank() */
+  double getRank();
+
   // TileLoadingObserver /////////////////////////////////////////////////
   void tileLoaded(ConstTile::Ptr tile) override;
 
 private:
-  explicit TileViewState(std::shared_ptr<CompressedTile> parent);
+  TileViewState(std::shared_ptr<CompressedTile> parent, TileCaches::Ptr caches);
 
   /**
    * Kick the internal state machine into making some progress
    */
   void kick();
 
+  /**
+   * Abandon any work in progress, and drop work that hasn't started yet
+   */
+  void abort();
+
   /**
    * Asynchronously do work to make the state machine progress
    */
@@ -90,6 +152,19 @@ private:
                    const LayerOperations::Ptr&       lo,
                    Scroom::Utils::Stuff              baseCache,
                    int                               zoom);
+  void computeChunks(const ThreadPool::WeakQueue::Ptr& wq,
+                     const ConstTile::Ptr&             tile,
+                     const LayerOperations::Ptr&       lo,
+                     int                               zoom);
+  void recomputeCache(const ThreadPool::WeakQueue::Ptr& wq,
+                      const ConstTile::Ptr&             tile,
+                      const LayerOperations::Ptr&       lo,
+                      Scroom::Utils::Stuff              zoomCache,
+                      int                               zoom);
   void reportDone(const ThreadPool::WeakQueue::Ptr& wq, const ConstTile::Ptr& tile);
+  void dropChunks();
   void clear();
+
+  /** Describe this tile and its view, for tracing */
+  Scroom::Utils::Trace::Tags traceTags();
 };
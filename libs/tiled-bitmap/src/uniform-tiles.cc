@@ -0,0 +1,118 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include "uniform-tiles.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include <boost/thread/mutex.hpp>
+
+namespace Scroom::TiledBitmap::Detail
+{
+  namespace
+  {
+    size_t patternSize(int bpp) { return static_cast<size_t>(std::max(1, bpp / 8)); }
+
+    /** Shared pixel data of uniform tiles, by size and pattern */
+    class SharedData
+    {
+    private:
+      using Key = std::tuple<size_t, std::vector<uint8_t>>;
+
+      boost::mutex                                mut;
+      std::map<Key, std::weak_ptr<const uint8_t>> data;
+
+    public:
+      Scroom::MemoryBlobs::RawPageData::ConstPtr get(size_t size, const std::vector<uint8_t>& pattern)
+      {
+        boost::mutex::scoped_lock const lock(mut);
+
+        std::weak_ptr<const uint8_t>&              entry  = data[Key(size, pattern)];
+        Scroom::MemoryBlobs::RawPageData::ConstPtr result = entry.lock();
+        if(!result)
+        {
+          std::shared_ptr<uint8_t> const buffer(new uint8_t[size], std::default_delete<uint8_t[]>());
+          fillPattern(buffer.get(), size, pattern);
+          result = buffer;
+          entry  = result;
+        }
+
+        // Forget about data that is no longer in use
+        for(auto i = data.begin(); i != data.end();)
+        {
+          i = i->second.expired() ? data.erase(i) : std::next(i);
+        }
+
+        return result;
+      }
+    };
+
+    SharedData sharedData;
+  } // namespace
+
+  std::vector<uint8_t> detectUniform(const uint8_t* data, size_t size, int bpp)
+  {
+    const size_t unit = patternSize(bpp);
+    if(size < unit)
+    {
+      return {};
+    }
+
+    if(bpp < 8)
+    {
+      // The first byte must consist of identical pixels. That is, it
+      // must be the same when rotated by one pixel.
+      const unsigned int first   = data[0];
+      const unsigned int rotated = ((first >> bpp) | (first << (8 - bpp))) & 0xFF;
+      if(first != rotated)
+      {
+        return {};
+      }
+    }
+
+    // Each byte equals the one a pattern further on
+    if(memcmp(data, data + unit, size - unit) != 0)
+    {
+      return {};
+    }
+
+    return {data, data + unit};
+  }
+
+  void fillPattern(uint8_t* data, size_t size, const std::vector<uint8_t>& pattern)
+  {
+    if(pattern.size() == 1)
+    {
+      memset(data, pattern[0], size);
+      return;
+    }
+
+    const size_t first = std::min(size, pattern.size());
+    memcpy(data, pattern.data(), first);
+    // Double the filled part until done
+    for(size_t filled = first; filled < size; filled *= 2)
+    {
+      memcpy(data + filled, data, std::min(filled, size - filled));
+    }
+  }
+
+  ConstTile::Ptr createUniformTile(int width, int height, int bpp, const std::vector<uint8_t>& pattern)
+  {
+    const auto dataSize = [bpp](int w, int h)
+    { return static_cast<size_t>(w) * static_cast<size_t>(h) * static_cast<size_t>(bpp) / 8; };
+
+    const size_t   sampleSize = dataSize(UNIFORM_SAMPLE_SIZE, UNIFORM_SAMPLE_SIZE);
+    ConstTile::Ptr result     = ConstTile::create(width, height, bpp, sharedData.get(dataSize(width, height), pattern));
+    result->uniform = ConstTile::create(UNIFORM_SAMPLE_SIZE, UNIFORM_SAMPLE_SIZE, bpp, sharedData.get(sampleSize, pattern));
+    return result;
+  }
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,49 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <scroom/tile.hh>
+
+/**
+ * Support for tiles whose pixels all have the same value
+ *
+ * Large parts of typical bitmaps are blank. Tiles like that are stored
+ * as a pattern of a few bytes, rather than as compressed pixel data.
+ * For 8 or more bits per pixel, the pattern is a single pixel. For
+ * fewer bits per pixel, it is a byte containing several identical
+ * pixels.
+ */
+namespace Scroom::TiledBitmap::Detail
+{
+  /** Width and height of the ConstTile::uniform sample */
+  const int UNIFORM_SAMPLE_SIZE = 64;
+
+  /**
+   * Find out whether all pixels in @p data are the same
+   *
+   * @return The pattern all pixels consist of, or an empty vector if
+   *    not all pixels are the same.
+   */
+  std::vector<uint8_t> detectUniform(const uint8_t* data, size_t size, int bpp);
+
+  /** Fill @p size bytes at @p data by repeating @p pattern */
+  void fillPattern(uint8_t* data, size_t size, const std::vector<uint8_t>& pattern);
+
+  /**
+   * Create a tile of which all pixels consist of @p pattern
+   *
+   * The pixel data is shared by all such tiles that are alive at the
+   * same time, so having many of them doesn't cost extra memory. The
+   * tile has its ConstTile::uniform sample set.
+   */
+  ConstTile::Ptr createUniformTile(int width, int height, int bpp, const std::vector<uint8_t>& pattern);
+} // namespace Scroom::TiledBitmap::Detail
@@ -0,0 +1,166 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "argb-kernels.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
+namespace
+{
+  // Odd, such that every kernel also has to deal with leftover pixels
+  const size_t COUNT = 77;
+
+  const std::vector<InstructionSet> instructionSets = {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2};
+
+  template <typename T>
+  std::vector<T> randomData(size_t size)
+  {
+    std::mt19937   generator(42); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<T> data(size);
+    for(T& value: data)
+    {
+      value = static_cast<T>(generator());
+    }
+    return data;
+  }
+
+  /**
+   * Convert random data with each available instruction set, and
+   * compare the result to that of the scalar kernel
+   */
+  void checkIdenticalOutput(Convert ArgbKernels::*kernel, size_t bytesPerPixel)
+  {
+    const std::vector<uint8_t> in = randomData<uint8_t>(COUNT * bytesPerPixel);
+
+    std::vector<uint32_t> expected(COUNT);
+    (getArgbKernels(InstructionSet::SCALAR).*kernel)(in.data(), expected.data(), COUNT);
+
+    for(const InstructionSet instructionSet: instructionSets)
+    {
+      if(isAvailable(instructionSet))
+      {
+        BOOST_TEST_MESSAGE("Checking " << to_string(instructionSet));
+        std::vector<uint32_t> actual(COUNT);
+        (getArgbKernels(instructionSet).*kernel)(in.data(), actual.data(), COUNT);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+      }
+    }
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ArgbKernels_Tests)
+
+BOOST_AUTO_TEST_CASE(rgb24_is_identical) { checkIdenticalOutput(&ArgbKernels::rgb24, 3); }
+
+BOOST_AUTO_TEST_CASE(cmyk32_is_identical) { checkIdenticalOutput(&ArgbKernels::cmyk32, 4); }
+
+BOOST_AUTO_TEST_CASE(rgb24_converts_to_opaque_argb)
+{
+  const std::vector<uint8_t> in = {0x12, 0x34, 0x56};
+  uint32_t                   out{0};
+  getArgbKernels(InstructionSet::SCALAR).rgb24(in.data(), &out, 1);
+  BOOST_CHECK_EQUAL(0xFF123456, out);
+}
+
+BOOST_AUTO_TEST_CASE(cmyk32_divides_exactly)
+{
+  // Every possible combination of a colour channel and K
+  std::vector<uint8_t> in;
+  for(int c = 0; c < 256; c++)
+  {
+    for(int k = 0; k < 256; k++)
+    {
+      in.insert(in.end(), {static_cast<uint8_t>(c), 0, 0, static_cast<uint8_t>(k)});
+    }
+  }
+  const size_t count = in.size() / 4;
+
+  for(const InstructionSet instructionSet: instructionSets)
+  {
+    if(isAvailable(instructionSet))
+    {
+      std::vector<uint32_t> out(count);
+      getArgbKernels(instructionSet).cmyk32(in.data(), out.data(), count);
+      for(size_t i = 0; i < count; i++)
+      {
+        const uint32_t red = ((255 - in[4 * i]) * (255 - in[4 * i + 3])) / 255;
+        BOOST_REQUIRE_EQUAL(red, (out[i] >> 16) & 0xFF);
+        BOOST_REQUIRE_EQUAL(0xFFu, out[i] >> 24);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(lookups_are_identical)
+{
+  const std::vector<uint32_t> lut  = randomData<uint32_t>(1 << 16);
+  const std::vector<uint8_t>  in8  = randomData<uint8_t>(COUNT);
+  const std::vector<uint16_t> in16 = randomData<uint16_t>(COUNT);
+
+  for(const InstructionSet instructionSet: instructionSets)
+  {
+    if(isAvailable(instructionSet))
+    {
+      std::vector<uint32_t> out(COUNT);
+      getArgbKernels(instructionSet).lookup8(in8.data(), out.data(), COUNT, lut.data());
+      for(size_t i = 0; i < COUNT; i++)
+      {
+        BOOST_REQUIRE_EQUAL(lut[in8[i]], out[i]);
+      }
+
+      getArgbKernels(instructionSet).lookup16(in16.data(), out.data(), COUNT, lut.data());
+      for(size_t i = 0; i < COUNT; i++)
+      {
+        BOOST_REQUIRE_EQUAL(lut[in16[i]], out[i]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(expand_bytes_starts_with_most_significant_sample)
+{
+  const std::vector<uint32_t> table = createExpansionTable(2, [](unsigned int sample) { return 100 + sample; });
+  const std::vector<uint8_t>  in    = {0x1B, 0xE4}; // 0 1 2 3, 3 2 1 0
+
+  std::vector<uint32_t> out(7);
+  expandBytes(in.data(), out.data(), out.size(), table.data(), 2);
+
+  const std::vector<uint32_t> expected = {100, 101, 102, 103, 103, 102, 101};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), out.begin(), out.end());
+}
+
+BOOST_AUTO_TEST_CASE(expand_words_starts_with_most_significant_sample)
+{
+  const std::vector<uint32_t> table = createExpansionTable(4, [](unsigned int sample) { return 100 + sample; });
+  const std::vector<uint16_t> in    = {0x1234, 0xABCD};
+
+  std::vector<uint32_t> out(7);
+  expandWords(in.data(), out.data(), out.size(), table.data(), 4);
+
+  const std::vector<uint32_t> expected = {101, 102, 103, 104, 110, 111, 112};
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), out.begin(), out.end());
+}
+
+BOOST_AUTO_TEST_CASE(expand_words_with_16_bit_samples)
+{
+  const std::vector<uint32_t> table = createExpansionTable(16, [](unsigned int sample) { return 100000 + sample; });
+  const std::vector<uint16_t> in    = {0x1234, 0xABCD};
+
+  std::vector<uint32_t> out(2);
+  expandWords(in.data(), out.data(), out.size(), table.data(), 16);
+
+  BOOST_CHECK_EQUAL(100000 + 0x1234, out[0]);
+  BOOST_CHECK_EQUAL(100000 + 0xABCD, out[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
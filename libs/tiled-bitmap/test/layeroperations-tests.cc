@@ -0,0 +1,137 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/colormappable.hh>
+#include <scroom/layeroperations.hh>
+
+//////////////////////////////////////////////////////////////
+
+using Scroom::Utils::Rectangle;
+
+namespace
+{
+  const int size = 16;
+
+  class TestColormapProvider : public ColormapProvider
+  {
+  public:
+    using Ptr = std::shared_ptr<TestColormapProvider>;
+
+    Colormap::Ptr colormap = Colormap::createDefault(256);
+
+    Colormap::Ptr getColormap() override { return colormap; }
+  };
+
+  /** An 8bpp tile, of which all pixels have the given @p value */
+  ConstTile::Ptr createTile(uint8_t value)
+  {
+    std::shared_ptr<uint8_t> const data(new uint8_t[size * size], std::default_delete<uint8_t[]>());
+    memset(data.get(), value, size * size);
+    return ConstTile::create(size, size, 8, data);
+  }
+
+  /** Draw @p tile at the given @p zoom, and return the ARGB32 value of the top-left pixel drawn */
+  uint32_t drawAndPick(const LayerOperations::Ptr& lo, const ConstTile::Ptr& tile, int zoom, const Scroom::Utils::Stuff& cache)
+  {
+    const double     scale   = zoom < 0 ? 1.0 / (1 << -zoom) : (1 << zoom);
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    cairo_t*         cr      = cairo_create(surface);
+    lo->initializeCairo(cr);
+    lo->draw(cr, tile, Rectangle<double>(0, 0, size, size), Rectangle<double>(0, 0, size * scale, size * scale), zoom, cache);
+    cairo_destroy(cr);
+
+    cairo_surface_flush(surface);
+    const uint32_t result = *reinterpret_cast<const uint32_t*>(cairo_image_surface_get_data(surface));
+    cairo_surface_destroy(surface);
+    return result;
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(LayerOperations_Tests)
+
+BOOST_AUTO_TEST_CASE(colormap_table_is_built_once_per_set_of_colors)
+{
+  Colormap::Ptr const colormap = Colormap::createDefault(2);
+  ColormapTable       colormapTable;
+  int                 builds = 0;
+
+  const auto build = [&](const std::vector<Color>& colors)
+  {
+    builds++;
+    return std::vector<uint32_t>{colors[0].getARGB32(), colors[1].getARGB32()};
+  };
+
+  ColormapTable::Table const first = colormapTable.get(colormap, build);
+  BOOST_CHECK_EQUAL(1, builds);
+  BOOST_CHECK(first == colormapTable.get(colormap, build));
+  BOOST_CHECK(first == colormapTable.get(Colormap::createDefault(2), build));
+  BOOST_CHECK_EQUAL(1, builds);
+
+  // Colormaps can be modified in place
+  colormap->colors[1] = Color(1, 0, 0);
+  ColormapTable::Table const second = colormapTable.get(colormap, build);
+  BOOST_CHECK_EQUAL(2, builds);
+  BOOST_CHECK(first != second);
+  BOOST_CHECK_EQUAL(Color(1, 0, 0).getARGB32(), (*second)[1]);
+  BOOST_CHECK_EQUAL(Colormap::createDefault(2)->colors[1].getARGB32(), (*first)[1]);
+}
+
+BOOST_AUTO_TEST_CASE(outdated_caches_are_drawn_until_updated)
+{
+  TestColormapProvider::Ptr const provider = std::make_shared<TestColormapProvider>();
+  LayerOperations::Ptr const      lo       = Operations::create(provider, 8);
+  ConstTile::Ptr const            tile     = createTile(7);
+  const uint32_t                  before   = provider->colormap->colors[7].getARGB32();
+  const uint32_t                  after    = Color(0, 0, 1).getARGB32();
+
+  Scroom::Utils::Stuff       base   = lo->cache(tile);
+  Scroom::Utils::Stuff const zoomed = lo->cacheZoom(tile, -1, base);
+  BOOST_CHECK(!lo->isOutdated(base));
+  BOOST_CHECK(!lo->isOutdated(zoomed));
+  BOOST_CHECK_EQUAL(before, drawAndPick(lo, tile, -1, zoomed));
+
+  provider->colormap->colors[7] = Color(0, 0, 1);
+  BOOST_CHECK(lo->isOutdated(base));
+  BOOST_CHECK(lo->isOutdated(zoomed));
+
+  // Drawing doesn't render anything
+  BOOST_CHECK_EQUAL(before, drawAndPick(lo, tile, -1, zoomed));
+  BOOST_CHECK(lo->isOutdated(zoomed));
+
+  BOOST_CHECK(lo->updateCache(tile, -1, zoomed));
+  BOOST_CHECK(!lo->isOutdated(zoomed));
+  BOOST_CHECK_EQUAL(after, drawAndPick(lo, tile, -1, zoomed));
+
+  // Nothing changed since
+  BOOST_CHECK(!lo->updateCache(tile, -1, zoomed));
+}
+
+BOOST_AUTO_TEST_CASE(new_zoom_levels_use_the_current_colormap)
+{
+  TestColormapProvider::Ptr const provider = std::make_shared<TestColormapProvider>();
+  LayerOperations::Ptr const      lo       = Operations::create(provider, 8);
+  ConstTile::Ptr const            tile     = createTile(7);
+
+  Scroom::Utils::Stuff base = lo->cache(tile);
+  provider->colormap->colors[7] = Color(0, 1, 0);
+
+  // The outdated base cache is updated, rather than computed again
+  Scroom::Utils::Stuff const zoomed = lo->cacheZoom(tile, -2, base);
+  BOOST_CHECK(!lo->isOutdated(base));
+  BOOST_CHECK(!lo->isOutdated(zoomed));
+  BOOST_CHECK_EQUAL(Color(0, 1, 0).getARGB32(), drawAndPick(lo, tile, -2, zoomed));
+  BOOST_CHECK_EQUAL(Color(0, 1, 0).getARGB32(), drawAndPick(lo, tile, 0, base));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,92 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/bitmap-helpers.hh>
+#include <scroom/memorybudget.hh>
+
+#include "pixel-value-labels.hh"
+
+//////////////////////////////////////////////////////////////
+
+using Scroom::Bitmap::BitmapSurface;
+using Scroom::TiledBitmap::Detail::getPixelValueLabel;
+using Scroom::TiledBitmap::Detail::PixelValueLabels;
+
+namespace
+{
+  const int size = 32;
+
+  /** @return true if cells @p a and @p b of @p surface have the same pixels */
+  bool cellsAreEqual(const BitmapSurface::Ptr& surface, int a, int b)
+  {
+    cairo_surface_flush(surface->get());
+    const uint8_t* data   = cairo_image_surface_get_data(surface->get());
+    const int      stride = cairo_image_surface_get_stride(surface->get());
+    for(int y = 0; y < size; y++)
+    {
+      const uint8_t* row = data + y * stride;
+      if(memcmp(row + a * size * 4, row + b * size * 4, size * 4) != 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PixelValueLabels_Tests)
+
+BOOST_AUTO_TEST_CASE(labels_are_rendered_once)
+{
+  BitmapSurface::Ptr const label = getPixelValueLabel(size, false, 42);
+  BOOST_REQUIRE(label);
+
+  BOOST_CHECK(label == getPixelValueLabel(size, false, 42));
+  BOOST_CHECK(label != getPixelValueLabel(size, true, 42));
+  BOOST_CHECK(label != getPixelValueLabel(size, false, 43));
+  BOOST_CHECK(label != getPixelValueLabel(2 * size, false, 42));
+}
+
+BOOST_AUTO_TEST_CASE(labels_are_evicted_by_the_memory_budget)
+{
+  const Scroom::Utils::MemoryBudget::Ptr budget   = Scroom::Utils::MemoryBudget::instance();
+  const size_t                           original = budget->getLimit();
+
+  std::weak_ptr<BitmapSurface> const evicted = getPixelValueLabel(size, false, 7);
+  BOOST_CHECK(!evicted.expired());
+
+  budget->setLimit(0);
+  BOOST_CHECK(evicted.expired());
+  budget->setLimit(original);
+
+  // Evicted labels are rendered again when needed
+  BOOST_CHECK(getPixelValueLabel(size, false, 7));
+}
+
+BOOST_AUTO_TEST_CASE(cells_with_the_same_value_are_drawn_with_the_same_label)
+{
+  BitmapSurface::Ptr const surface = BitmapSurface::create(3 * size, size, CAIRO_FORMAT_ARGB32);
+  cairo_t*                 cr      = cairo_create(surface->get());
+
+  PixelValueLabels labels(size);
+  labels.add(Scroom::Utils::make_point<double>(0, 0), 5, Color(1));
+  labels.add(Scroom::Utils::make_point<double>(size, 0), 6, Color(1));
+  labels.add(Scroom::Utils::make_point<double>(2 * size, 0), 5, Color(1));
+  labels.draw(cr, Scroom::Utils::make_point<double>(0, 0));
+  cairo_destroy(cr);
+
+  BOOST_CHECK(cellsAreEqual(surface, 0, 2));
+  BOOST_CHECK(!cellsAreEqual(surface, 0, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,236 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/tiledbitmaplayer.hh>
+
+#include "pyramid-cache.hh"
+
+//////////////////////////////////////////////////////////////
+
+namespace
+{
+  const boost::filesystem::path directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  /** A directory containing an original file and a cache file, that is removed when it goes out of scope */
+  class TemporaryFiles
+  {
+  public:
+    const std::string original;
+    const std::string cache;
+
+    TemporaryFiles()
+      : original((directory / "original").string())
+      , cache((directory / "cache").string())
+    {
+      boost::filesystem::create_directories(directory);
+      write("Some data");
+    }
+
+    TemporaryFiles(const TemporaryFiles&)            = delete;
+    TemporaryFiles(TemporaryFiles&&)                 = delete;
+    TemporaryFiles& operator=(const TemporaryFiles&) = delete;
+    TemporaryFiles& operator=(TemporaryFiles&&)      = delete;
+
+    ~TemporaryFiles() { boost::filesystem::remove_all(directory); }
+
+    void write(const std::string& contents) const
+    {
+      std::ofstream out(original, std::ios::binary | std::ios::trunc);
+      out << contents;
+    }
+  };
+
+  std::vector<Layer::Ptr> createLayers()
+  {
+    Layer::Ptr const bottom = Layer::create(3 * TILESIZE, 2 * TILESIZE, 8);
+    Layer::Ptr const top    = Layer::create(1, 3 * TILESIZE / 8, 2 * TILESIZE / 8, 8, bottom->getPageProvider());
+    return {bottom, top};
+  }
+
+  uint8_t expectedValue(const CompressedTile::Ptr& tile, int offset)
+  {
+    return static_cast<uint8_t>(tile->depth * 31 + tile->x * 7 + tile->y * 5 + (offset % 3));
+  }
+
+  void fill(const std::vector<Layer::Ptr>& layers)
+  {
+    for(const Layer::Ptr& layer: layers)
+    {
+      for(int j = 0; j < layer->getVerTileCount(); j++)
+      {
+        for(int i = 0; i < layer->getHorTileCount(); i++)
+        {
+          CompressedTile::Ptr const tile = layer->getTile(i, j);
+          Tile::Ptr const           data = tile->initialize();
+          for(int k = 0; k < TILESIZE * TILESIZE; k++)
+          {
+            data->data.get()[k] = expectedValue(tile, k);
+          }
+        }
+      }
+    }
+  }
+
+  template <typename F>
+  void forEachTile(const std::vector<Layer::Ptr>& layers, F f)
+  {
+    for(const Layer::Ptr& layer: layers)
+    {
+      for(int j = 0; j < layer->getVerTileCount(); j++)
+      {
+        for(int i = 0; i < layer->getHorTileCount(); i++)
+        {
+          f(layer->getTile(i, j));
+        }
+      }
+    }
+  }
+
+  bool contentsMatch(const std::vector<Layer::Ptr>& layers)
+  {
+    for(const Layer::Ptr& layer: layers)
+    {
+      for(int j = 0; j < layer->getVerTileCount(); j++)
+      {
+        for(int i = 0; i < layer->getHorTileCount(); i++)
+        {
+          CompressedTile::Ptr const tile = layer->getTile(i, j);
+          ConstTile::Ptr const      data = tile->getConstTileSync();
+          for(int k = 0; k < TILESIZE * TILESIZE; k++)
+          {
+            if(data->data.get()[k] != expectedValue(tile, k))
+            {
+              return false;
+            }
+          }
+        }
+      }
+    }
+    return true;
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PyramidCache_Tests)
+
+BOOST_AUTO_TEST_CASE(restored_layers_match_stored_layers)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  fill(original);
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  std::vector<Layer::Ptr> const restored = createLayers();
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->restore(restored));
+  BOOST_CHECK_EQUAL(TILE_UNLOADED, restored[0]->getTile(0, 0)->getState());
+  BOOST_CHECK(contentsMatch(restored));
+}
+
+BOOST_AUTO_TEST_CASE(uniform_tiles_are_restored_without_data)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  fill(original);
+  CompressedTile::Ptr const uniform = original[0]->getTile(0, 0);
+  memset(uniform->getTileSync()->data.get(), 7, TILESIZE * TILESIZE);
+  uniform->reportFinished();
+  BOOST_REQUIRE(uniform->getUniformPattern() == std::vector<uint8_t>{7});
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  std::vector<Layer::Ptr> const restored = createLayers();
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->restore(restored));
+  BOOST_CHECK(restored[0]->getTile(0, 0)->getUniformPattern() == std::vector<uint8_t>{7});
+  BOOST_CHECK(restored[0]->getTile(0, 0)->getConstTileSync()->uniform);
+  BOOST_CHECK(restored[0]->getTile(1, 0)->getUniformPattern().empty());
+}
+
+BOOST_AUTO_TEST_CASE(layers_of_only_uniform_tiles_are_restored)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  forEachTile(original,
+              [](const CompressedTile::Ptr& tile)
+              {
+                memset(tile->initialize()->data.get(), 7, TILESIZE * TILESIZE);
+                tile->reportFinished();
+              });
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  std::vector<Layer::Ptr> const restored = createLayers();
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->restore(restored));
+  forEachTile(restored,
+              [](const CompressedTile::Ptr& tile) { BOOST_CHECK(tile->getUniformPattern() == std::vector<uint8_t>{7}); });
+}
+
+BOOST_AUTO_TEST_CASE(store_leaves_no_temporary_files)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  fill(original);
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  std::vector<std::string> names;
+  for(const auto& entry: boost::filesystem::directory_iterator(directory))
+  {
+    names.push_back(entry.path().filename().string());
+  }
+  std::sort(names.begin(), names.end());
+  BOOST_CHECK((names == std::vector<std::string>{"cache", "original"}));
+}
+
+BOOST_AUTO_TEST_CASE(incomplete_layers_are_not_stored)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const layers = createLayers();
+  layers[0]->getTile(0, 0)->initialize();
+
+  BOOST_CHECK(!PyramidCache::create(files.original, files.cache)->store(layers));
+  BOOST_CHECK(!boost::filesystem::exists(files.cache));
+}
+
+BOOST_AUTO_TEST_CASE(cache_is_ignored_when_original_changes)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  fill(original);
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  files.write("Different data");
+
+  std::vector<Layer::Ptr> const restored = createLayers();
+  BOOST_CHECK(!PyramidCache::create(files.original, files.cache)->restore(restored));
+  BOOST_CHECK_EQUAL(TILE_UNINITIALIZED, restored[0]->getTile(0, 0)->getState());
+}
+
+BOOST_AUTO_TEST_CASE(cache_is_ignored_when_layout_differs)
+{
+  const TemporaryFiles files;
+
+  std::vector<Layer::Ptr> const original = createLayers();
+  fill(original);
+  BOOST_REQUIRE(PyramidCache::create(files.original, files.cache)->store(original));
+
+  std::vector<Layer::Ptr> const restored = {Layer::create(3 * TILESIZE, 2 * TILESIZE, 8)};
+  BOOST_CHECK(!PyramidCache::create(files.original, files.cache)->restore(restored));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "reduce-kernels.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
+namespace
+{
+  // Odd, such that every kernel also has to deal with leftover pixels
+  const size_t COUNT = 77;
+
+  const std::vector<InstructionSet> instructionSets = {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2};
+
+  std::vector<uint8_t> randomData(size_t size)
+  {
+    std::mt19937         generator(42); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> data(size);
+    for(uint8_t& value: data)
+    {
+      value = static_cast<uint8_t>(generator());
+    }
+    return data;
+  }
+
+  /**
+   * Reduce random data with each available instruction set, and
+   * compare the result to that of the scalar kernel
+   */
+  void checkIdenticalOutput(ReduceRow ReduceKernels::*kernel, size_t sourceBytesPerPixel, size_t targetBytesPerPixel)
+  {
+    const size_t               sourceStride = COUNT * sourceBytesPerPixel;
+    const std::vector<uint8_t> source       = randomData(8 * sourceStride);
+
+    std::vector<uint8_t> expected(COUNT * targetBytesPerPixel);
+    (getReduceKernels(InstructionSet::SCALAR).*kernel)(source.data(), sourceStride, expected.data(), COUNT);
+
+    for(const InstructionSet instructionSet: instructionSets)
+    {
+      if(isAvailable(instructionSet))
+      {
+        BOOST_TEST_MESSAGE("Checking " << to_string(instructionSet));
+        std::vector<uint8_t> actual(COUNT * targetBytesPerPixel);
+        (getReduceKernels(instructionSet).*kernel)(source.data(), sourceStride, actual.data(), COUNT);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+      }
+    }
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ReduceKernels_Tests)
+
+BOOST_AUTO_TEST_CASE(scalar_is_available) { BOOST_CHECK(isAvailable(InstructionSet::SCALAR)); }
+
+BOOST_AUTO_TEST_CASE(reduce_1bpp_averages_bits)
+{
+  // Column i has i bits set per row, for 8*i bits in total
+  std::vector<uint8_t> source(8 * 9);
+  for(size_t row = 0; row < 8; row++)
+  {
+    for(size_t i = 0; i < 9; i++)
+    {
+      source[row * 9 + i] = static_cast<uint8_t>(0xFF00 >> i);
+    }
+  }
+
+  for(const InstructionSet instructionSet: instructionSets)
+  {
+    if(isAvailable(instructionSet))
+    {
+      std::vector<uint8_t> target(9);
+      getReduceKernels(instructionSet).reduce1bpp(source.data(), 9, target.data(), target.size());
+      for(size_t i = 0; i < 9; i++)
+      {
+        BOOST_CHECK_EQUAL(8 * i * 255 / 64, target[i]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(reduce_1bpp_is_identical) { checkIdenticalOutput(&ReduceKernels::reduce1bpp, 1, 1); }
+
+BOOST_AUTO_TEST_CASE(reduce_8bpp_is_identical) { checkIdenticalOutput(&ReduceKernels::reduce8bpp, 8, 1); }
+
+BOOST_AUTO_TEST_CASE(reduce_24bpp_is_identical) { checkIdenticalOutput(&ReduceKernels::reduce24bpp, 8 * 3, 3); }
+
+BOOST_AUTO_TEST_CASE(reduce_cmyk32_is_identical) { checkIdenticalOutput(&ReduceKernels::reduceCMYK32, 8 * 4, 4); }
+
+BOOST_AUTO_TEST_CASE(reduce_8bpp_of_white_is_white)
+{
+  const std::vector<uint8_t> source(8 * 8 * COUNT, 255);
+
+  for(const InstructionSet instructionSet: instructionSets)
+  {
+    if(isAvailable(instructionSet))
+    {
+      std::vector<uint8_t> target(COUNT);
+      getReduceKernels(instructionSet).reduce8bpp(source.data(), 8 * COUNT, target.data(), COUNT);
+      BOOST_CHECK(std::all_of(target.begin(), target.end(), [](uint8_t v) { return v == 255; }));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
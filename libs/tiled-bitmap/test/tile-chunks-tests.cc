@@ -0,0 +1,234 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/semaphore.hh>
+#include <scroom/tiledbitmapinterface.hh>
+#include <scroom/tiledbitmaplayer.hh>
+
+#include "tile-chunks.hh"
+
+//////////////////////////////////////////////////////////////
+
+using Scroom::Utils::Rectangle;
+
+namespace
+{
+  const int size      = 1024;
+  const int chunkSize = 256;
+
+  struct DrawCall
+  {
+    ConstTile::Ptr    tile;
+    Rectangle<double> tileArea;
+    Rectangle<double> viewArea;
+  };
+
+  /** Records what it is asked to cache and draw */
+  class RecordingLayerOperations : public LayerOperations
+  {
+  public:
+    using Ptr = std::shared_ptr<RecordingLayerOperations>;
+
+    std::atomic<int>      cacheCount{0}; /**< Chunks are cached on the thread pool */
+    std::vector<DrawCall> drawCalls;
+
+  public:
+    static Ptr create() { return Ptr(new RecordingLayerOperations()); }
+
+    int  getBpp() override { return 8; }
+    void initializeCairo(cairo_t* /*cr*/) override {}
+    void draw(cairo_t* /*cr*/,
+              const ConstTile::Ptr& tile,
+              Rectangle<double>     tileArea,
+              Rectangle<double>     viewArea,
+              int /*zoom*/,
+              Scroom::Utils::Stuff /*cache*/) override
+    {
+      drawCalls.push_back({tile, tileArea, viewArea});
+    }
+    void drawState(cairo_t* /*cr*/, TileState /*s*/, Rectangle<double> /*viewArea*/) override {}
+    void reduce(Tile::Ptr /*target*/, const ConstTile::Ptr /*source*/, int /*x*/, int /*y*/) override {}
+
+    Scroom::Utils::Stuff cache(const ConstTile::Ptr& /*tile*/) override
+    {
+      cacheCount++;
+      return std::make_shared<int>(42);
+    }
+
+    Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& /*tile*/, int /*zoom*/, Scroom::Utils::Stuff& cache) override
+    {
+      return cache;
+    }
+  };
+
+  uint8_t expectedValue(int x, int y) { return static_cast<uint8_t>(x * 3 + y * 7); }
+
+  ConstTile::Ptr createTile()
+  {
+    std::shared_ptr<uint8_t> const data(new uint8_t[size * size], std::default_delete<uint8_t[]>());
+    for(int y = 0; y < size; y++)
+    {
+      for(int x = 0; x < size; x++)
+      {
+        data.get()[y * size + x] = expectedValue(x, y);
+      }
+    }
+    return ConstTile::create(size, size, 8, data);
+  }
+
+  /** Counts the chunks that become ready */
+  class ChunkCounter : public TileLoadingObserver
+  {
+  public:
+    using Ptr = std::shared_ptr<ChunkCounter>;
+
+    Scroom::Semaphore loaded;
+
+  public:
+    void tileLoaded(ConstTile::Ptr /*tile*/) override { loaded.V(); }
+  };
+
+  /**
+   * Draw @p tileArea of @p chunks at the given @p zoom, on a throwaway surface
+   *
+   * @return The areas of the chunks that weren't ready, and were drawn using DrawMissing
+   */
+  std::vector<DrawCall> draw(const TileChunks::Ptr& chunks, Rectangle<double> tileArea, Rectangle<double> viewArea, int zoom)
+  {
+    std::vector<DrawCall> missing;
+    cairo_surface_t*      surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t*              cr      = cairo_create(surface);
+    chunks->draw(cr,
+                 tileArea,
+                 viewArea,
+                 zoom,
+                 0,
+                 [&missing](Rectangle<double> chunkArea, Rectangle<double> chunkViewArea)
+                 { missing.push_back({nullptr, chunkArea, chunkViewArea}); });
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    return missing;
+  }
+
+  /** Draw once to get the visible chunks converted, and wait for @p count of them to be ready */
+  void convert(const TileChunks::Ptr& chunks, Rectangle<double> tileArea, Rectangle<double> viewArea, int zoom, int count)
+  {
+    ChunkCounter::Ptr const          counter = std::make_shared<ChunkCounter>();
+    Scroom::Bookkeeping::Token const token   = chunks->registerObserver(counter);
+
+    draw(chunks, tileArea, viewArea, zoom);
+    for(int n = 0; n < count; n++)
+    {
+      BOOST_REQUIRE(counter->loaded.P(boost::posix_time::seconds(10)));
+    }
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TileChunks_Tests)
+
+BOOST_AUTO_TEST_CASE(chunks_are_converted_in_the_background)
+{
+  RecordingLayerOperations::Ptr const lo      = RecordingLayerOperations::create();
+  TileChunks::Ptr const               chunks  = TileChunks::create(createTile(), lo, chunkSize);
+  ChunkCounter::Ptr const             counter = std::make_shared<ChunkCounter>();
+  Scroom::Bookkeeping::Token const    token   = chunks->registerObserver(counter);
+
+  const std::vector<DrawCall> missing =
+    draw(chunks, Rectangle<double>(200, 0, 112, 10), Rectangle<double>(50, 0, 224, 20), 1);
+  BOOST_CHECK(lo->drawCalls.empty());
+  BOOST_REQUIRE_EQUAL(2U, missing.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(200, 0, 56, 10), missing[0].tileArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(50, 0, 112, 20), missing[0].viewArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(256, 0, 56, 10), missing[1].tileArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(162, 0, 112, 20), missing[1].viewArea);
+
+  // Observers are told when the chunks are ready
+  BOOST_REQUIRE(counter->loaded.P(boost::posix_time::seconds(10)));
+  BOOST_REQUIRE(counter->loaded.P(boost::posix_time::seconds(10)));
+  BOOST_CHECK_EQUAL(2, chunks->getCachedChunkCount());
+
+  BOOST_CHECK(draw(chunks, Rectangle<double>(200, 0, 112, 10), Rectangle<double>(50, 0, 224, 20), 1).empty());
+  BOOST_CHECK_EQUAL(2U, lo->drawCalls.size());
+}
+
+BOOST_AUTO_TEST_CASE(only_visible_chunks_are_cached)
+{
+  RecordingLayerOperations::Ptr const lo     = RecordingLayerOperations::create();
+  ConstTile::Ptr const                tile   = createTile();
+  TileChunks::Ptr const               chunks = TileChunks::create(tile, lo, chunkSize);
+
+  BOOST_CHECK_EQUAL(0, chunks->getCachedChunkCount());
+
+  convert(chunks, Rectangle<double>(100, 100, 200, 50), Rectangle<double>(0, 0, 200, 50), 0, 2);
+  BOOST_CHECK_EQUAL(2, chunks->getCachedChunkCount());
+  BOOST_CHECK_EQUAL(2, lo->cacheCount.load());
+
+  // Drawing the same area again reuses the caches
+  BOOST_CHECK(draw(chunks, Rectangle<double>(100, 100, 200, 50), Rectangle<double>(0, 0, 200, 50), 0).empty());
+  BOOST_CHECK_EQUAL(2, lo->cacheCount.load());
+}
+
+BOOST_AUTO_TEST_CASE(chunks_contain_the_pixels_of_their_area)
+{
+  RecordingLayerOperations::Ptr const lo     = RecordingLayerOperations::create();
+  TileChunks::Ptr const               chunks = TileChunks::create(createTile(), lo, chunkSize);
+
+  convert(chunks, Rectangle<double>(600, 300, 10, 10), Rectangle<double>(0, 0, 10, 10), 0, 1);
+  draw(chunks, Rectangle<double>(600, 300, 10, 10), Rectangle<double>(0, 0, 10, 10), 0);
+  BOOST_REQUIRE_EQUAL(1U, lo->drawCalls.size());
+
+  const ConstTile::Ptr& chunk = lo->drawCalls[0].tile;
+  BOOST_REQUIRE_EQUAL(chunkSize, chunk->width);
+  BOOST_REQUIRE_EQUAL(chunkSize, chunk->height);
+  for(int y = 0; y < chunkSize; y++)
+  {
+    for(int x = 0; x < chunkSize; x++)
+    {
+      if(chunk->data.get()[y * chunkSize + x] != expectedValue(2 * chunkSize + x, chunkSize + y))
+      {
+        BOOST_FAIL("Unexpected pixel value at " << x << ", " << y);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(chunks_are_drawn_where_their_part_of_the_tile_area_is_shown)
+{
+  RecordingLayerOperations::Ptr const lo     = RecordingLayerOperations::create();
+  TileChunks::Ptr const               chunks = TileChunks::create(createTile(), lo, chunkSize);
+
+  convert(chunks, Rectangle<double>(200, 0, 112, 10), Rectangle<double>(50, 0, 224, 20), 1, 2);
+  draw(chunks, Rectangle<double>(200, 0, 112, 10), Rectangle<double>(50, 0, 224, 20), 1);
+  BOOST_REQUIRE_EQUAL(2U, lo->drawCalls.size());
+  BOOST_CHECK_EQUAL(Rectangle<double>(200, 0, 56, 10), lo->drawCalls[0].tileArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(50, 0, 112, 20), lo->drawCalls[0].viewArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(0, 0, 56, 10), lo->drawCalls[1].tileArea);
+  BOOST_CHECK_EQUAL(Rectangle<double>(162, 0, 112, 20), lo->drawCalls[1].viewArea);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_size_is_a_power_of_two)
+{
+  const int original = getRenderChunkSize();
+
+  setRenderChunkSize(300);
+  BOOST_CHECK_EQUAL(256, getRenderChunkSize());
+  setRenderChunkSize(1);
+  BOOST_CHECK_EQUAL(64, getRenderChunkSize());
+  setRenderChunkSize(1 << 20);
+  BOOST_CHECK_EQUAL(TILESIZE, getRenderChunkSize());
+
+  setRenderChunkSize(original);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/memorybudget.hh>
+#include <scroom/tiledbitmapinterface.hh>
+
+#include "tilecaches.hh"
+
+//////////////////////////////////////////////////////////////
+
+namespace
+{
+  class NullLayerOperations : public LayerOperations
+  {
+  public:
+    static Ptr create() { return Ptr(new NullLayerOperations()); }
+
+    int  getBpp() override { return 8; }
+    void initializeCairo(cairo_t* /*cr*/) override {}
+    void draw(cairo_t* /*cr*/,
+              const ConstTile::Ptr& /*tile*/,
+              Scroom::Utils::Rectangle<double> /*tileArea*/,
+              Scroom::Utils::Rectangle<double> /*viewArea*/,
+              int /*zoom*/,
+              Scroom::Utils::Stuff /*cache*/) override
+    {
+    }
+    void drawState(cairo_t* /*cr*/, TileState /*s*/, Scroom::Utils::Rectangle<double> /*viewArea*/) override {}
+    void reduce(Tile::Ptr /*target*/, const ConstTile::Ptr /*source*/, int /*x*/, int /*y*/) override {}
+  };
+
+  ConstTile::Ptr createTile() { return ConstTile::create(16, 16, 8, nullptr); }
+
+  TileCaches::Cache createCache()
+  {
+    TileCaches::Cache result;
+    result.stuff = std::make_shared<int>(42);
+    result.entry = Scroom::Utils::MemoryBudget::create(1024)->retain(result.stuff, 4);
+    return result;
+  }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TileCaches_Tests)
+
+BOOST_AUTO_TEST_CASE(stored_caches_are_found)
+{
+  TileCaches::Ptr const      caches = TileCaches::create();
+  LayerOperations::Ptr const lo     = NullLayerOperations::create();
+  ConstTile::Ptr const       tile   = createTile();
+
+  BOOST_CHECK(!caches->find(lo, -2, tile).stuff);
+
+  TileCaches::Cache const cache = caches->store(lo, -2, tile, createCache());
+  BOOST_CHECK(caches->find(lo, -2, tile).stuff == cache.stuff);
+  BOOST_CHECK(caches->find(lo, -2, tile).entry == cache.entry);
+}
+
+BOOST_AUTO_TEST_CASE(caches_are_specific_to_tile_zoom_and_operations)
+{
+  TileCaches::Ptr const      caches = TileCaches::create();
+  LayerOperations::Ptr const lo     = NullLayerOperations::create();
+  ConstTile::Ptr const       tile   = createTile();
+
+  TileCaches::Cache const cache = caches->store(lo, -2, tile, createCache());
+  BOOST_CHECK(!caches->find(lo, -1, tile).stuff);
+  BOOST_CHECK(!caches->find(lo, TileCaches::BASE, tile).stuff);
+  BOOST_CHECK(!caches->find(NullLayerOperations::create(), -2, tile).stuff);
+  BOOST_CHECK(!caches->find(lo, -2, createTile()).stuff);
+}
+
+BOOST_AUTO_TEST_CASE(first_stored_cache_wins)
+{
+  TileCaches::Ptr const      caches = TileCaches::create();
+  LayerOperations::Ptr const lo     = NullLayerOperations::create();
+  ConstTile::Ptr const       tile   = createTile();
+
+  TileCaches::Cache const first  = caches->store(lo, 0, tile, createCache());
+  TileCaches::Cache const second = caches->store(lo, 0, tile, createCache());
+  BOOST_CHECK(second.stuff == first.stuff);
+  BOOST_CHECK(second.entry == first.entry);
+}
+
+BOOST_AUTO_TEST_CASE(unused_caches_are_forgotten)
+{
+  TileCaches::Ptr const      caches = TileCaches::create();
+  LayerOperations::Ptr const lo     = NullLayerOperations::create();
+  ConstTile::Ptr const       tile   = createTile();
+
+  caches->store(lo, 0, tile, createCache());
+  BOOST_CHECK(!caches->find(lo, 0, tile).stuff);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
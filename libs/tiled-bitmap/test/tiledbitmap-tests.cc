@@ -5,10 +5,24 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <atomic>
+#include <map>
+#include <vector>
+
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <scroom/rectangle.hh>
+#include <scroom/semaphore.hh>
+#include <scroom/threadpool.hh>
 #include <scroom/tiledbitmapinterface.hh>
+#include <scroom/tiledbitmaplayer.hh>
+#include <scroom/viewinterface.hh>
+
+#include "tiled-bitmap.hh"
+#include "tilecaches.hh"
+#include "tiledbitmapviewdata.hh"
+#include "tileviewstate.hh"
 
 //////////////////////////////////////////////////////////////
 
@@ -31,6 +45,144 @@ public:
   void reduce(Tile::Ptr /*target*/, const ConstTile::Ptr /*source*/, int /*x*/, int /*y*/) override {}
 };
 
+/** Records where it is asked to draw. Only used on the thread that calls redraw() */
+class RecordingLayerOperations : public DummyLayerOperations
+{
+public:
+  using Ptr = std::shared_ptr<RecordingLayerOperations>;
+
+  struct DrawCall
+  {
+    Scroom::Utils::Rectangle<double> tileArea;
+    Scroom::Utils::Rectangle<double> viewArea;
+  };
+
+  std::vector<DrawCall> drawCalls;
+
+public:
+  static Ptr create() { return Ptr(new RecordingLayerOperations()); }
+
+  void draw(cairo_t* /*cr*/,
+            const ConstTile::Ptr& /*tile*/,
+            Scroom::Utils::Rectangle<double> tileArea,
+            Scroom::Utils::Rectangle<double> viewArea,
+            int /*zoom*/,
+            Scroom::Utils::Stuff /*cache*/) override
+  {
+    drawCalls.push_back({tileArea, viewArea});
+  }
+
+  Scroom::Utils::Stuff cache(const ConstTile::Ptr& /*tile*/) override { return std::make_shared<int>(42); }
+
+  Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& /*tile*/, int /*zoom*/, Scroom::Utils::Stuff& cache) override
+  {
+    return cache;
+  }
+};
+
+/** Like the 24bpp operations, whose cacheZoom() needs the base cache to be there */
+class BaseCheckingLayerOperations : public DummyLayerOperations
+{
+public:
+  using Ptr = std::shared_ptr<BaseCheckingLayerOperations>;
+
+  std::atomic<int> missingBaseCount{0};
+
+public:
+  static Ptr create() { return Ptr(new BaseCheckingLayerOperations()); }
+
+  int getBpp() override { return 24; }
+
+  Scroom::Utils::Stuff cache(const ConstTile::Ptr& /*tile*/) override { return std::make_shared<int>(42); }
+
+  Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& /*tile*/, int /*zoom*/, Scroom::Utils::Stuff& cache) override
+  {
+    if(!cache)
+    {
+      missingBaseCount++;
+    }
+    return std::make_shared<int>(43);
+  }
+};
+
+class DummyView : public ViewInterface
+{
+public:
+  static Ptr create() { return Ptr(new DummyView()); }
+
+  void                                   invalidate() override {}
+  ProgressInterface::Ptr                 getProgressInterface() override { return {}; }
+  void                                   addSideWidget(std::string /*title*/, GtkWidget* /*w*/) override {}
+  void                                   removeSideWidget(GtkWidget* /*w*/) override {}
+  void                                   addToToolbar(GtkToolItem* /*ti*/) override {}
+  void                                   removeFromToolbar(GtkToolItem* /*ti*/) override {}
+  void                                   registerSelectionListener(SelectionListener::Ptr /*unused*/) override {}
+  void                                   registerPostRenderer(PostRenderer::Ptr /*unused*/) override {}
+  void                                   setStatusMessage(const std::string& /*unused*/) override {}
+  std::shared_ptr<PresentationInterface> getCurrentPresentation() override { return {}; }
+  void addToolButton(GtkToggleButton* /*unused*/, ToolStateListener::Ptr /*unused*/) override {}
+};
+
+class CountingSource : public SourcePresentation
+{
+public:
+  using Ptr = std::shared_ptr<CountingSource>;
+
+  boost::mutex       mut;
+  std::map<int, int> fillCount;
+  int                doneCount{0};
+  bool               concurrent;
+
+private:
+  explicit CountingSource(bool concurrent_)
+    : concurrent(concurrent_)
+  {
+  }
+
+public:
+  static Ptr create(bool concurrent) { return Ptr(new CountingSource(concurrent)); }
+
+  void fillTiles(int startLine,
+                 int /*lineCount*/,
+                 int /*tileWidth*/,
+                 int /*firstTile*/,
+                 std::vector<Tile::Ptr>& /*tiles*/) override
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    fillCount[startLine]++;
+  }
+
+  void done() override
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    doneCount++;
+  }
+
+  std::string getName() override { return "CountingSource"; }
+
+  bool supportsConcurrentFillTiles() override { return concurrent; }
+};
+
+void verifyAllRowsFetchedOnce(bool concurrent)
+{
+  const int                 rows   = 7;
+  const Layer::Ptr          layer  = Layer::create(100, rows * TILESIZE - 10, 1);
+  const CountingSource::Ptr source = CountingSource::create(concurrent);
+  auto                      queue  = ThreadPool::Queue::createAsync();
+  Scroom::Semaphore         finished;
+
+  layer->fetchData(source, queue->getWeak(), [&finished] { finished.V(); });
+  finished.P();
+
+  boost::mutex::scoped_lock const lock(source->mut);
+  BOOST_CHECK_EQUAL(1, source->doneCount);
+  BOOST_REQUIRE_EQUAL(rows, static_cast<int>(source->fillCount.size()));
+  for(int row = 0; row < rows; row++)
+  {
+    BOOST_CHECK_EQUAL(1, source->fillCount[row * TILESIZE]);
+  }
+}
+
 //////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE(TiledBitmap_Tests)
@@ -48,4 +200,92 @@ BOOST_AUTO_TEST_CASE(tiledbitmap_can_be_deleted)
   BOOST_CHECK(!weak.lock());
 }
 
+BOOST_AUTO_TEST_CASE(sequential_source_is_fetched_row_by_row) { verifyAllRowsFetchedOnce(false); }
+
+BOOST_AUTO_TEST_CASE(concurrent_source_is_fetched_in_parallel)
+{
+  const int originalConcurrency = getLoadConcurrency();
+  setLoadConcurrency(4);
+  verifyAllRowsFetchedOnce(true);
+  setLoadConcurrency(originalConcurrency);
+}
+
+BOOST_AUTO_TEST_CASE(tiles_that_are_not_loaded_are_drawn_from_the_parent_layer)
+{
+  const RecordingLayerOperations::Ptr bottomLo = RecordingLayerOperations::create();
+  const RecordingLayerOperations::Ptr parentLo = RecordingLayerOperations::create();
+  const LayerSpec                     ls{bottomLo, parentLo};
+
+  // Wide enough to have a parent layer
+  const TiledBitmap::Ptr bitmap = TiledBitmap::create(2 * TILESIZE + 8, 8, ls);
+
+  // The bottom layer is never loaded, but the parent layer is
+  bitmap->getLayer(1)->getTile(0, 0)->initializeUniform({0x80});
+
+  const ViewInterface::Ptr view    = DummyView::create();
+  cairo_surface_t*         surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+  cairo_t*                 cr      = cairo_create(surface);
+  bitmap->open(view);
+
+  // Loading the parent tile happens in the background
+  const Scroom::Utils::Rectangle<double> presentationArea(0, 0, 800, 8);
+  for(int attempt = 0; attempt < 100 && parentLo->drawCalls.empty(); attempt++)
+  {
+    bitmap->redraw(view, cr, presentationArea, 0);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+  }
+
+  BOOST_CHECK(bottomLo->drawCalls.empty());
+  BOOST_REQUIRE_EQUAL(1U, parentLo->drawCalls.size());
+  BOOST_CHECK_EQUAL(Scroom::Utils::Rectangle<double>(0, 0, 100, 1), parentLo->drawCalls[0].tileArea);
+  BOOST_CHECK_EQUAL(presentationArea, parentLo->drawCalls[0].viewArea);
+
+  bitmap->close(view);
+  cairo_destroy(cr);
+  cairo_surface_destroy(surface);
+}
+
+BOOST_AUTO_TEST_CASE(zooming_out_while_chunks_are_being_computed_computes_the_base_first)
+{
+  const BaseCheckingLayerOperations::Ptr lo = BaseCheckingLayerOperations::create();
+
+  // A loaded tile that isn't uniform, such that zoom level 0 is drawn in chunks
+  const Layer::Ptr          layer  = Layer::create(TILESIZE, TILESIZE, lo->getBpp());
+  const CompressedTile::Ptr tile   = layer->getTile(0, 0);
+  const Tile::Ptr           pixels = tile->initialize();
+  pixels->data.get()[0]            = 1;
+  tile->reportFinished();
+  const ConstTile::Ptr loaded = tile->getConstTileSync();
+
+  const ViewInterface::Ptr       view     = DummyView::create();
+  const TiledBitmapViewData::Ptr viewData = TiledBitmapViewData::create(view);
+
+  // Chunks are computed in the background. Vary the delay before zooming
+  // out, such that it sometimes happens while computeChunks() is running.
+  for(int attempt = 0; attempt < 200; attempt++)
+  {
+    const TileViewState::Ptr tileViewState = TileViewState::create(tile, TileCaches::create());
+    tileViewState->setViewData(viewData);
+    tileViewState->setZoom(lo, 0);
+    boost::this_thread::sleep_for(boost::chrono::microseconds(attempt % 50));
+    tileViewState->setZoom(lo, -1);
+
+    for(int wait = 0; wait < 10000 && !tileViewState->isDone(); wait++)
+    {
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+    BOOST_REQUIRE(tileViewState->isDone());
+  }
+
+  BOOST_CHECK_EQUAL(0, lo->missingBaseCount.load());
+}
+
+BOOST_AUTO_TEST_CASE(load_concurrency_is_at_least_one)
+{
+  const int originalConcurrency = getLoadConcurrency();
+  setLoadConcurrency(0);
+  BOOST_CHECK_EQUAL(1, getLoadConcurrency());
+  setLoadConcurrency(originalConcurrency);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "uniform-tiles.hh"
+
+//////////////////////////////////////////////////////////////
+
+using namespace Scroom::TiledBitmap::Detail;
+
+using Bytes = std::vector<uint8_t>;
+
+BOOST_AUTO_TEST_SUITE(UniformTiles_Tests)
+
+BOOST_AUTO_TEST_CASE(identical_pixels_are_detected)
+{
+  const Bytes grey(1024, 0x80);
+  BOOST_CHECK(detectUniform(grey.data(), grey.size(), 8) == Bytes{0x80});
+
+  Bytes rgb(3 * 256);
+  fillPattern(rgb.data(), rgb.size(), {1, 2, 3});
+  BOOST_CHECK(detectUniform(rgb.data(), rgb.size(), 24) == (Bytes{1, 2, 3}));
+
+  const Bytes black(128, 0xFF);
+  BOOST_CHECK(detectUniform(black.data(), black.size(), 1) == Bytes{0xFF});
+}
+
+BOOST_AUTO_TEST_CASE(different_pixels_are_detected)
+{
+  Bytes grey(1024, 0x80);
+  grey.back() = 0x81;
+  BOOST_CHECK(detectUniform(grey.data(), grey.size(), 8).empty());
+
+  Bytes rgb(3 * 256);
+  fillPattern(rgb.data(), rgb.size(), {1, 2, 3});
+  BOOST_CHECK(detectUniform(rgb.data(), rgb.size(), 8).empty());
+
+  // Every byte is the same, but pixels alternate
+  const Bytes stripes(128, 0x55);
+  BOOST_CHECK(detectUniform(stripes.data(), stripes.size(), 1).empty());
+  BOOST_CHECK(detectUniform(stripes.data(), stripes.size(), 2) == Bytes{0x55});
+}
+
+BOOST_AUTO_TEST_CASE(uniform_tiles_share_their_data)
+{
+  ConstTile::Ptr const first  = createUniformTile(256, 256, 24, {1, 2, 3});
+  ConstTile::Ptr const second = createUniformTile(256, 256, 24, {1, 2, 3});
+  ConstTile::Ptr const other  = createUniformTile(256, 256, 24, {3, 2, 1});
+
+  BOOST_CHECK(first->data == second->data);
+  BOOST_CHECK(first->data != other->data);
+  BOOST_CHECK(detectUniform(first->data.get(), 256 * 256 * 3, 24) == (Bytes{1, 2, 3}));
+
+  BOOST_REQUIRE(first->uniform);
+  BOOST_CHECK_EQUAL(UNIFORM_SAMPLE_SIZE, first->uniform->width);
+  BOOST_CHECK(detectUniform(first->uniform->data.get(), UNIFORM_SAMPLE_SIZE * UNIFORM_SAMPLE_SIZE * 3, 24)
+              == (Bytes{1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
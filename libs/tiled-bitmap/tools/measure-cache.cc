@@ -0,0 +1,116 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "argb-kernels.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
+namespace
+{
+  const size_t TILESIZE    = 4096;
+  const size_t PIXELS      = TILESIZE * TILESIZE;
+  const int    REPETITIONS = 10;
+
+  using Kernel = std::function<void(const ArgbKernels&, const uint8_t* in, uint32_t* out)>;
+
+  struct Format
+  {
+    std::string name;
+    size_t      sourceBitsPerPixel;
+    Kernel      kernel;
+  };
+
+  std::vector<uint32_t> randomTable(size_t size)
+  {
+    std::mt19937          generator(1); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint32_t> table(size);
+    for(uint32_t& value: table)
+    {
+      value = generator();
+    }
+    return table;
+  }
+
+  /** @return The time it takes to convert one TILESIZE x TILESIZE tile to ARGB, in seconds */
+  double measure(const Format& format, InstructionSet instructionSet, std::vector<uint32_t>& target)
+  {
+    std::mt19937         generator(0); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> source(PIXELS * format.sourceBitsPerPixel / 8);
+    for(uint8_t& value: source)
+    {
+      value = static_cast<uint8_t>(generator());
+    }
+    target.assign(PIXELS, 0);
+
+    const ArgbKernels& kernels = getArgbKernels(instructionSet);
+    const auto         start   = std::chrono::steady_clock::now();
+    for(int i = 0; i < REPETITIONS; i++)
+    {
+      for(size_t j = 0; j < TILESIZE; j++)
+      {
+        format.kernel(kernels,
+                      source.data() + j * TILESIZE * format.sourceBitsPerPixel / 8,
+                      target.data() + j * TILESIZE);
+      }
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / REPETITIONS;
+  }
+} // namespace
+
+int main()
+{
+  const std::vector<uint32_t> table1bpp  = createExpansionTable(1, [](unsigned int v) { return v * 0xFFFFFF; });
+  const std::vector<uint32_t> table4bpp  = createExpansionTable(4, [](unsigned int v) { return v * 0x111111; });
+  const std::vector<uint32_t> table8bpp  = randomTable(256);
+  const std::vector<uint32_t> table16bpp = randomTable(1 << 16);
+  const std::vector<Format>   formats    = {
+    {"1bpp", 1, [&](const ArgbKernels&, const uint8_t* in, uint32_t* out) { expandBytes(in, out, TILESIZE, table1bpp.data(), 1); }},
+    {"4bpp", 4, [&](const ArgbKernels&, const uint8_t* in, uint32_t* out) { expandBytes(in, out, TILESIZE, table4bpp.data(), 4); }},
+    {"8bpp", 8, [&](const ArgbKernels& k, const uint8_t* in, uint32_t* out) { k.lookup8(in, out, TILESIZE, table8bpp.data()); }},
+    {"16bpp",
+     16,
+     [&](const ArgbKernels& k, const uint8_t* in, uint32_t* out) {
+       k.lookup16(reinterpret_cast<const uint16_t*>(in), out, TILESIZE, table16bpp.data());
+     }},
+    {"24bpp", 24, [](const ArgbKernels& k, const uint8_t* in, uint32_t* out) { k.rgb24(in, out, TILESIZE); }},
+    {"CMYK32", 32, [](const ArgbKernels& k, const uint8_t* in, uint32_t* out) { k.cmyk32(in, out, TILESIZE); }},
+  };
+
+  fmt::print("{:7} {:7} {:>10} {:>8} {:>9}\n", "Format", "Kernel", "ms/tile", "Speedup", "Identical");
+  for(const Format& format: formats)
+  {
+    std::vector<uint32_t> expected;
+    const double          scalarTime = measure(format, InstructionSet::SCALAR, expected);
+
+    for(const InstructionSet instructionSet: {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2})
+    {
+      if(isAvailable(instructionSet))
+      {
+        std::vector<uint32_t> actual;
+        const double          time = measure(format, instructionSet, actual);
+        fmt::print("{:7} {:7} {:10.2f} {:8.2f} {:>9}\n",
+                   format.name,
+                   to_string(instructionSet),
+                   time * 1000,
+                   scalarTime / time,
+                   actual == expected ? "yes" : "NO");
+      }
+    }
+  }
+
+  return 0;
+}
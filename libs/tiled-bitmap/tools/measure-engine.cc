@@ -0,0 +1,497 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+/*
+ * Measures the tiled bitmap engine without a display
+ *
+ * Unlike measure_framerate and measure_load_performance, this doesn't
+ * open a window. Work the engine posts to the UI thread is handled by
+ * iterating the default main context by hand. Loading, reducing,
+ * compressing, caching and drawing are timed separately, and reported
+ * as JSON on stdout, such that results can be compared between
+ * commits.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <getopt.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <glib.h>
+
+#include <scroom/cairo-helpers.hh>
+#include <scroom/layeroperations.hh>
+#include <scroom/memoryblobs.hh>
+#include <scroom/threadpool.hh>
+#include <scroom/tiledbitmapinterface.hh>
+#include <scroom/tiledbitmaplayer.hh>
+
+#include "measure-framerate-stubs.hh"
+#include "test-helpers.hh"
+
+using Scroom::MemoryBlobs::Blob;
+using Scroom::MemoryBlobs::PageProvider;
+
+namespace
+{
+  const int VIEW_WIDTH       = 1920;
+  const int VIEW_HEIGHT      = 1080;
+  const int PAN_PIXELS       = 64;
+  const int COMPRESS_SAMPLES = 16;
+
+  using Clock = std::chrono::steady_clock;
+
+  /** Durations of one kind of operation, in seconds. Thread safe. */
+  class Samples
+  {
+  private:
+    boost::mutex        mut;
+    std::vector<double> values;
+
+  public:
+    void add(double seconds)
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      values.push_back(seconds);
+    }
+
+    std::vector<double> get()
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      return values;
+    }
+  };
+
+  /** Samples for each kind of operation, by name */
+  class Measurements
+  {
+  public:
+    using Ptr = std::shared_ptr<Measurements>;
+
+  private:
+    boost::mutex                   mut;
+    std::map<std::string, Samples> samples;
+
+  public:
+    static Ptr create() { return std::make_shared<Measurements>(); }
+
+    Samples& operator[](const std::string& name)
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      return samples[name];
+    }
+
+    template <typename F>
+    auto time(const std::string& name, F f)
+    {
+      Samples&   s     = (*this)[name];
+      const auto start = Clock::now();
+      if constexpr(std::is_void_v<decltype(f())>)
+      {
+        f();
+        s.add(std::chrono::duration<double>(Clock::now() - start).count());
+      }
+      else
+      {
+        auto result = f();
+        s.add(std::chrono::duration<double>(Clock::now() - start).count());
+        return result;
+      }
+    }
+
+    std::map<std::string, std::vector<double>> get()
+    {
+      boost::mutex::scoped_lock const            lock(mut);
+      std::map<std::string, std::vector<double>> result;
+      for(auto& [name, s]: samples)
+      {
+        result[name] = s.get();
+      }
+      return result;
+    }
+  };
+
+  /** Forwards to another LayerOperations, timing reduce(), cache() and draw() */
+  class TimingLayerOperations : public LayerOperations
+  {
+  private:
+    LayerOperations::Ptr lo;
+    Measurements::Ptr    measurements;
+
+  public:
+    TimingLayerOperations(LayerOperations::Ptr lo_, Measurements::Ptr measurements_)
+      : lo(std::move(lo_))
+      , measurements(std::move(measurements_))
+    {
+    }
+
+    int  getBpp() override { return lo->getBpp(); }
+    void initializeCairo(cairo_t* cr) override { lo->initializeCairo(cr); }
+    void drawState(cairo_t* cr, TileState s, Scroom::Utils::Rectangle<double> viewArea) override
+    {
+      lo->drawState(cr, s, viewArea);
+    }
+
+    void draw(cairo_t*                         cr,
+              const ConstTile::Ptr&            tile,
+              Scroom::Utils::Rectangle<double> tileArea,
+              Scroom::Utils::Rectangle<double> viewArea,
+              int                              zoom,
+              Scroom::Utils::Stuff             cache) override
+    {
+      measurements->time("draw", [&] { lo->draw(cr, tile, tileArea, viewArea, zoom, cache); });
+    }
+
+    Scroom::Utils::Stuff cache(const ConstTile::Ptr& tile) override
+    {
+      return measurements->time("cache", [&] { return lo->cache(tile); });
+    }
+
+    Scroom::Utils::Stuff cacheZoom(const ConstTile::Ptr& tile, int zoom, Scroom::Utils::Stuff& cache) override
+    {
+      return measurements->time("cacheZoom", [&] { return lo->cacheZoom(tile, zoom, cache); });
+    }
+
+    void reduce(Tile::Ptr target, ConstTile::Ptr source, int x, int y) override
+    {
+      measurements->time("reduce", [&] { lo->reduce(std::move(target), std::move(source), x, y); });
+    }
+  };
+
+  /** Forwards to another SourcePresentation, timing fillTiles() */
+  class TimingSource : public SourcePresentation
+  {
+  private:
+    SourcePresentation::Ptr sp;
+    Measurements::Ptr       measurements;
+
+  public:
+    TimingSource(SourcePresentation::Ptr sp_, Measurements::Ptr measurements_)
+      : sp(std::move(sp_))
+      , measurements(std::move(measurements_))
+    {
+    }
+
+    void fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override
+    {
+      measurements->time("load", [&] { sp->fillTiles(startLine, lineCount, tileWidth, firstTile, tiles); });
+    }
+
+    void        done() override { sp->done(); }
+    std::string getName() override { return sp->getName(); }
+    bool        supportsConcurrentFillTiles() override { return sp->supportsConcurrentFillTiles(); }
+  };
+
+  struct Scenario
+  {
+    std::string                                            name;
+    std::function<LayerSpec(const ColormapProvider::Ptr&)> createLayerSpec;
+    std::function<SourcePresentation::Ptr()>               createSource;
+    int                                                    colors; /**< Size of the colormap */
+  };
+
+  /** Handle everything the engine posted to the UI thread, until @p done returns true */
+  void iterateUntil(const std::function<bool()>& done)
+  {
+    while(!done())
+    {
+      if(!g_main_context_iteration(nullptr, FALSE))
+      {
+        g_usleep(1000);
+      }
+    }
+  }
+
+  /** Handle everything the engine posted to the UI thread so far */
+  void iteratePending()
+  {
+    while(g_main_context_iteration(nullptr, FALSE))
+    {
+    }
+  }
+
+  /** Wait until all work scheduled so far on @p pool is done */
+  void drain(const ThreadPool::Ptr& pool)
+  {
+    std::atomic<bool> done{false};
+    pool->schedule([&done] { done = true; }, PRIO_LOWEST);
+    iterateUntil([&done] { return done.load(); });
+  }
+
+  /** Time compressing a sample of the tiles of @p layer, as if they were just loaded */
+  void measureCompression(const Layer::Ptr& layer, Measurements& measurements)
+  {
+    PageProvider::Ptr const provider = PageProvider::create(1024, 4096);
+    const int               count    = layer->getHorTileCount() * layer->getVerTileCount();
+    const int               step     = std::max(1, count / COMPRESS_SAMPLES);
+
+    for(int k = 0; k < count; k += step)
+    {
+      const int            i    = k % layer->getHorTileCount();
+      const int            j    = k / layer->getHorTileCount();
+      ConstTile::Ptr const tile = layer->getTile(i, j)->getConstTileSync();
+      const size_t         size = static_cast<size_t>(tile->width * tile->height) * static_cast<size_t>(tile->bpp) / 8;
+
+      // While someone holds the raw data, getCompressed() compresses it every time
+      Blob::Ptr const                             blob = Blob::create(provider, size);
+      Scroom::MemoryBlobs::RawPageData::Ptr const data = blob->get();
+      memcpy(data.get(), tile->data.get(), size);
+
+      measurements.time("compress", [&] { return blob->getCompressed(); });
+    }
+  }
+
+  void measureFrames(const TiledBitmapInterface::Ptr& tbi,
+                     const Layer::Ptr&                layer,
+                     int                              zoom,
+                     int                              frames,
+                     Measurements&                    measurements)
+  {
+    ProgressInterfaceStub::Ptr const pi = ProgressInterfaceStub::create();
+    ViewInterface::Ptr const         vi = ViewInterfaceStub::create(pi);
+    tbi->open(vi);
+
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, VIEW_WIDTH, VIEW_HEIGHT);
+    cairo_t*         cr      = cairo_create(surface);
+
+    const double                       pixelSize = pixelSizeFromZoom(zoom);
+    const Scroom::Utils::Point<double> viewSize  = Scroom::Utils::make_point<double>(VIEW_WIDTH, VIEW_HEIGHT) / pixelSize;
+    const double                       range     = std::max(1.0, layer->getWidth() - viewSize.x);
+    const std::string                  name      = fmt::format("frame@{}", zoom);
+
+    for(int frame = 0; frame < frames; frame++)
+    {
+      iteratePending();
+
+      const Scroom::Utils::Point<double> position(std::fmod(frame * PAN_PIXELS / pixelSize, range), 0);
+      measurements.time(name, [&] { tbi->redraw(vi, cr, Scroom::Utils::make_rect(position, viewSize), zoom); });
+    }
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    tbi->close(vi);
+    drain(CpuBound());
+  }
+
+  std::string toJson(const std::string& name, std::vector<double> samples)
+  {
+    std::sort(samples.begin(), samples.end());
+
+    const auto percentile = [&samples](double p)
+    {
+      const size_t index = static_cast<size_t>(std::ceil(p / 100 * static_cast<double>(samples.size())));
+      return samples[std::min(samples.size(), std::max<size_t>(index, 1)) - 1] * 1000;
+    };
+
+    double total = 0;
+    for(const double s: samples)
+    {
+      total += s;
+    }
+
+    return fmt::format(R"("{}": {{"count": {}, "total_ms": {:.3f}, "mean_ms": {:.4f}, )"
+                       R"("p50_ms": {:.4f}, "p90_ms": {:.4f}, "p99_ms": {:.4f}, "max_ms": {:.4f}}})",
+                       name,
+                       samples.size(),
+                       total * 1000,
+                       total * 1000 / static_cast<double>(samples.size()),
+                       percentile(50),
+                       percentile(90),
+                       percentile(99),
+                       samples.back() * 1000);
+  }
+
+  std::string run(const Scenario& scenario, int size, const std::vector<int>& zooms, int frames)
+  {
+    Measurements::Ptr const          measurements     = Measurements::create();
+    DummyColormapProvider::Ptr const colormapProvider = DummyColormapProvider::create(Colormap::createDefault(scenario.colors));
+
+    LayerSpec ls;
+    for(const LayerOperations::Ptr& lo: scenario.createLayerSpec(colormapProvider))
+    {
+      ls.push_back(std::make_shared<TimingLayerOperations>(lo, measurements));
+    }
+
+    resetLayerTimings();
+
+    TiledBitmapInterface::Ptr const tbi = createTiledBitmap(size, size, ls);
+
+    // The view is told when the entire pyramid is finished
+    {
+      ProgressInterfaceStub::Ptr const pi = ProgressInterfaceStub::create();
+      ViewInterface::Ptr const         vi = ViewInterfaceStub::create(pi);
+      tbi->open(vi);
+
+      const auto start = Clock::now();
+      tbi->setSource(std::make_shared<TimingSource>(scenario.createSource(), measurements));
+      iterateUntil([&pi] { return pi->isFinished(); });
+      drain(Sequentially());
+      (*measurements)["pyramid"].add(std::chrono::duration<double>(Clock::now() - start).count());
+      tbi->close(vi);
+    }
+
+    const Layer::Ptr layer = tbi->getBottomLayer();
+    measureCompression(layer, *measurements);
+    for(const int zoom: zooms)
+    {
+      measureFrames(tbi, layer, zoom, frames, *measurements);
+    }
+
+    std::vector<std::string> timings;
+    for(const auto& [name, samples]: measurements->get())
+    {
+      if(!samples.empty())
+      {
+        timings.push_back(toJson(name, samples));
+      }
+    }
+
+    std::vector<std::string>       layers;
+    const std::vector<LayerTiming> layerTimings = getLayerTimings();
+    for(size_t depth = 0; depth < layerTimings.size(); depth++)
+    {
+      layers.push_back(fmt::format(R"({{"depth": {}, "tiles": {}, "seconds": {:.4f}}})",
+                                   depth,
+                                   layerTimings[depth].tiles,
+                                   layerTimings[depth].seconds));
+    }
+
+    return fmt::format(R"({{"name": "{}", "width": {}, "height": {}, "timings": {{{}}}, "layers": [{}]}})",
+                       scenario.name,
+                       size,
+                       size,
+                       fmt::join(timings, ", "),
+                       fmt::join(layers, ", "));
+  }
+
+  void usage(const std::string& me, const std::string& message = std::string())
+  {
+    if(message.length() != 0)
+    {
+      spdlog::error("{}", message);
+    }
+
+    fmt::print(stderr, "Usage: {} [options]\n\n", me);
+    fmt::print(stderr, "Options:\n");
+    fmt::print(stderr, " -h            : Show this help\n");
+    fmt::print(stderr, " -s <size>     : Width and height of the bitmaps, in pixels (default: 16384)\n");
+    fmt::print(stderr, " -f <frames>   : Number of frames drawn per zoom level (default: 100)\n");
+    fmt::print(stderr, " -z <zoom>     : Draw at the given zoom level. Can be repeated (default: -2 and 1)\n");
+    exit(-1); // NOLINT(concurrency-mt-unsafe)
+  }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string me = argv[0];
+  char              result;
+  int               size   = 16384;
+  int               frames = 100;
+  std::vector<int>  zooms;
+
+  // Keep stdout for the results
+  spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+
+  while((result = getopt(argc, argv, ":hs:f:z:")) != -1)
+  {
+    try
+    {
+      switch(result)
+      {
+      case 'h':
+        usage(me);
+        break;
+      case 's':
+        size = boost::lexical_cast<int>(optarg);
+        break;
+      case 'f':
+        frames = boost::lexical_cast<int>(optarg);
+        break;
+      case 'z':
+        zooms.push_back(boost::lexical_cast<int>(optarg));
+        break;
+      case '?':
+        usage(me, "Unknown option");
+        break;
+      case ':':
+        usage(me, "Option requires an argument");
+        break;
+      default:
+        usage(me, "This shouldn't be happening");
+        break;
+      }
+    }
+    catch(boost::bad_lexical_cast&)
+    {
+      usage(me, "Arguments should be numbers");
+    }
+  }
+  if(zooms.empty())
+  {
+    zooms = {-2, 1};
+  }
+
+  // The engine runs work on the UI thread using the default main
+  // context. Owning it makes this the UI thread.
+  g_main_context_acquire(g_main_context_default());
+
+  const std::vector<Scenario> scenarios = {
+    {
+      "1bpp",
+      [](const ColormapProvider::Ptr& cp) {
+        return LayerSpec{Operations1bpp::create(cp), Operations8bpp::create(cp)};
+      },
+      [] { return std::make_shared<Source1Bpp>(); },
+      2,
+    },
+    {
+      "8bpp",
+      [](const ColormapProvider::Ptr& cp) { return LayerSpec{Operations8bpp::create(cp)}; },
+      [] { return std::make_shared<Source8Bpp>(); },
+      2,
+    },
+    {
+      "8bpp colormapped",
+      [](const ColormapProvider::Ptr& cp) {
+        return LayerSpec{Operations::create(cp, 8), OperationsColormapped::create(cp, 8)};
+      },
+      [] { return std::make_shared<Source8Bpp>(); },
+      256,
+    },
+  };
+
+  std::vector<std::string> results;
+  for(const Scenario& scenario: scenarios)
+  {
+    spdlog::info("Measuring {}", scenario.name);
+    results.push_back(run(scenario, size, zooms, frames));
+  }
+
+  fmt::print("{{\"scenarios\": [\n  {}\n]}}\n", fmt::join(results, ",\n  "));
+
+  g_main_context_release(g_main_context_default());
+  return 0;
+}
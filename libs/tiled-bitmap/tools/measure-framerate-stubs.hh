@@ -74,6 +74,7 @@ public:
   void        fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override;
   void        done() override{};
   std::string getName() override { return "Source1Bpp"; }
+  bool        supportsConcurrentFillTiles() override { return true; }
 };
 
 class Source2Bpp : public SourcePresentation
@@ -82,6 +83,7 @@ public:
   void        fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override;
   void        done() override{};
   std::string getName() override { return "Source2Bpp"; }
+  bool        supportsConcurrentFillTiles() override { return true; }
 };
 
 class Source4Bpp : public SourcePresentation
@@ -90,6 +92,7 @@ public:
   void        fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override;
   void        done() override{};
   std::string getName() override { return "Source4Bpp"; }
+  bool        supportsConcurrentFillTiles() override { return true; }
 };
 
 class Source8Bpp : public SourcePresentation
@@ -98,4 +101,5 @@ public:
   void        fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override;
   void        done() override{};
   std::string getName() override { return "Source8Bpp"; }
+  bool        supportsConcurrentFillTiles() override { return true; }
 };
@@ -56,6 +56,13 @@ public:
   bool operator()();
 };
 
+class PanningCounter : public BaseCounter
+{
+public:
+  PanningCounter(const std::string& name, unsigned int secs);
+  bool operator()();
+};
+
 ////////////////////////////////////////////////////////////////////////
 
 static bool logSizes()
@@ -146,6 +153,32 @@ bool InvalidatingCounter::operator()()
 
 ////////////////////////////////////////////////////////////////////////
 
+PanningCounter::PanningCounter(const std::string& name_, unsigned int secs_)
+  : BaseCounter(name_, secs_)
+{
+}
+
+bool PanningCounter::operator()()
+{
+  if(testData)
+  {
+    testData->pan({2, 1});
+  }
+  invalidate();
+  return BaseCounter::operator()();
+}
+
+static bool redrawIncrementally()
+{
+  if(testData)
+  {
+    testData->setIncremental(true);
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+
 void init_tests()
 {
   const int          width         = 2 * 4096;
@@ -200,6 +233,17 @@ void init_tests()
   functions.emplace_back(Invalidator(sleepDuration));
   functions.emplace_back(InvalidatingCounter("8bpp, 16:1 zoom, colormapped", testDuration));
 
+  functions.emplace_back([] { return setupTest8bpp(0, width, height); });
+  functions.emplace_back(wait);
+  functions.emplace_back(Invalidator(sleepDuration));
+  functions.emplace_back(PanningCounter("8bpp, 1:1 zoom, panning", testDuration));
+
+  functions.emplace_back([] { return setupTest8bpp(0, width, height); });
+  functions.emplace_back(wait);
+  functions.emplace_back(redrawIncrementally);
+  functions.emplace_back(Invalidator(sleepDuration));
+  functions.emplace_back(PanningCounter("8bpp, 1:1 zoom, panning, incremental", testDuration));
+
   functions.emplace_back(reset);
   functions.emplace_back(quit);
 }
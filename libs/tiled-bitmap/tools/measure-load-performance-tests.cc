@@ -7,13 +7,18 @@
 
 #include "measure-load-performance-tests.hh"
 
+#include <algorithm>
 #include <ctime>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include <fmt/format.h>
 
 #include <scroom/semaphore.hh>
 #include <scroom/threadpool.hh>
+#include <scroom/tiledbitmapinterface.hh>
 
 #include "measure-framerate-callbacks.hh"
 #include "measure-framerate-stubs.hh"
@@ -64,6 +69,7 @@ bool WaitForAsyncOp::operator()()
   if(!started && 0 == clock_gettime(CLOCK_REALTIME, &t))
   {
     started = true;
+    resetLayerTimings();
 
     Sequentially()->schedule([&s = this->s] { s.V(); });
 
@@ -79,12 +85,18 @@ bool WaitForAsyncOp::operator()()
 
     std::cout << name << " took " << duration << "s" << std::endl;
   }
+
+  const std::vector<LayerTiming> timings = getLayerTimings();
+  for(size_t depth = 0; depth < timings.size(); depth++)
+  {
+    std::cout << fmt::format("  layer {}: {} tiles, {:.3f}s", depth, timings[depth].tiles, timings[depth].seconds) << std::endl;
+  }
   return false;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-void init_tests()
+void init_tests(int maxConcurrency)
 {
   const int width  = 240000;
   const int height = 240000;
@@ -112,6 +124,32 @@ void init_tests()
   functions.emplace_back([] { return setupTest8bppColormapped(-2, width, height); });
   functions.emplace_back(WaitForAsyncOp("File load 8bpp colormapped"));
 
+  // Show how loading scales with the number of rows fetched in parallel
+  std::vector<int> concurrencies;
+  for(int concurrency = 1; concurrency < maxConcurrency; concurrency *= 2)
+  {
+    concurrencies.push_back(concurrency);
+  }
+  concurrencies.push_back(std::max(1, maxConcurrency));
+
+  const int defaultConcurrency = getLoadConcurrency();
+  for(const int concurrency: concurrencies)
+  {
+    functions.emplace_back(
+      [concurrency]
+      {
+        setLoadConcurrency(concurrency);
+        return setupTest1bpp(-2, width, height);
+      });
+    functions.emplace_back(WaitForAsyncOp(fmt::format("File load 1bpp, {} rows in parallel", concurrency)));
+  }
+  functions.emplace_back(
+    [defaultConcurrency]
+    {
+      setLoadConcurrency(defaultConcurrency);
+      return false;
+    });
+
   functions.emplace_back(reset);
   functions.emplace_back(quit);
 }
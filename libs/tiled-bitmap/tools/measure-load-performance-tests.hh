@@ -9,4 +9,10 @@
 
 #include <scroom/semaphore.hh>
 
-void init_tests();
+/**
+ * Schedule the load performance measurements
+ *
+ * @param maxConcurrency Loading is repeated with 1, 2, 4, ... up to
+ *    this many tile rows fetched in parallel
+ */
+void init_tests(int maxConcurrency);
@@ -12,8 +12,12 @@
 #include <getopt.h>
 #include <spdlog/spdlog.h>
 
+#include <boost/lexical_cast.hpp>
+
 #include <gtk/gtk.h>
 
+#include <scroom/tiledbitmapinterface.hh>
+
 #include "measure-framerate-callbacks.hh"
 #include "measure-load-performance-tests.hh"
 
@@ -27,6 +31,7 @@ void usage(const std::string& me, const std::string& message = std::string())
   fmt::print("Usage: {} [options] [input files]\n\n", me);
   fmt::print("Options:\n");
   fmt::print(" -h            : Show this help\n");
+  fmt::print(" -j <count>    : Measure loading with up to <count> rows in parallel (default: {})\n", getLoadConcurrency());
   exit(-1); // NOLINT(concurrency-mt-unsafe)
 }
 
@@ -34,14 +39,25 @@ int main(int argc, char* argv[])
 {
   const std::string me = argv[0];
   char              result;
+  int               maxConcurrency = getLoadConcurrency();
 
-  while((result = getopt(argc, argv, ":h")) != -1)
+  while((result = getopt(argc, argv, ":hj:")) != -1)
   {
     switch(result)
     {
     case 'h':
       usage(me);
       break;
+    case 'j':
+      try
+      {
+        maxConcurrency = boost::lexical_cast<int>(optarg);
+      }
+      catch(boost::bad_lexical_cast&)
+      {
+        usage(me, "Concurrency should be a number");
+      }
+      break;
     case '?':
       // show usage -- unknown option
       usage(me, "Unknown option");
@@ -65,7 +81,7 @@ int main(int argc, char* argv[])
   setlocale(LC_ALL, ""); // NOLINT(concurrency-mt-unsafe)
   gtk_init(&argc, &argv);
 
-  init_tests();
+  init_tests(maxConcurrency);
   init();
 
   gtk_main();
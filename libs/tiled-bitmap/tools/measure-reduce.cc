@@ -0,0 +1,93 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "reduce-kernels.hh"
+
+using namespace Scroom::TiledBitmap::Detail;
+
+namespace
+{
+  const size_t TILESIZE    = 4096;
+  const int    REPETITIONS = 10;
+
+  struct Format
+  {
+    std::string                name;
+    ReduceRow ReduceKernels::*kernel;
+    size_t                     sourceBitsPerPixel;
+    size_t                     targetBytesPerPixel;
+  };
+
+  /** @return The time it takes to reduce one TILESIZE x TILESIZE tile, in seconds */
+  double measure(const Format& format, InstructionSet instructionSet, std::vector<uint8_t>& target)
+  {
+    const size_t sourceStride = TILESIZE * format.sourceBitsPerPixel / 8;
+    const size_t targetStride = TILESIZE / 8 * format.targetBytesPerPixel;
+
+    std::mt19937         generator(0); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::vector<uint8_t> source(sourceStride * TILESIZE);
+    for(uint8_t& value: source)
+    {
+      value = static_cast<uint8_t>(generator());
+    }
+    target.assign(targetStride * TILESIZE / 8, 0);
+
+    const ReduceRow reduceRow = getReduceKernels(instructionSet).*format.kernel;
+    const auto      start     = std::chrono::steady_clock::now();
+    for(int i = 0; i < REPETITIONS; i++)
+    {
+      for(size_t j = 0; j < TILESIZE / 8; j++)
+      {
+        reduceRow(source.data() + 8 * j * sourceStride, sourceStride, target.data() + j * targetStride, TILESIZE / 8);
+      }
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / REPETITIONS;
+  }
+} // namespace
+
+int main()
+{
+  const std::vector<Format> formats = {
+    {"1bpp", &ReduceKernels::reduce1bpp, 1, 1},
+    {"8bpp", &ReduceKernels::reduce8bpp, 8, 1},
+    {"24bpp", &ReduceKernels::reduce24bpp, 24, 3},
+    {"CMYK32", &ReduceKernels::reduceCMYK32, 32, 4},
+  };
+
+  fmt::print("{:7} {:7} {:>10} {:>8} {:>9}\n", "Format", "Kernel", "ms/tile", "Speedup", "Identical");
+  for(const Format& format: formats)
+  {
+    std::vector<uint8_t> expected;
+    const double         scalarTime = measure(format, InstructionSet::SCALAR, expected);
+
+    for(const InstructionSet instructionSet: {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2})
+    {
+      if(isAvailable(instructionSet))
+      {
+        std::vector<uint8_t> actual;
+        const double         time = measure(format, instructionSet, actual);
+        fmt::print("{:7} {:7} {:10.2f} {:8.2f} {:>9}\n",
+                   format.name,
+                   to_string(instructionSet),
+                   time * 1000,
+                   scalarTime / time,
+                   actual == expected ? "yes" : "NO");
+      }
+    }
+  }
+
+  return 0;
+}
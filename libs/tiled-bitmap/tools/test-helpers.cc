@@ -81,13 +81,33 @@ void TestData::redraw(cairo_t* cr)
 {
   if(tbi)
   {
-    const auto                          pixelSize = pixelSizeFromZoom(zoom);
-    const Scroom::Utils::Rectangle<int> rect{0, 0, drawingAreaWidth, drawingAreaHeight};
+    const auto                      pixelSize = pixelSizeFromZoom(zoom);
+    const Scroom::Utils::Point<int> size{drawingAreaWidth, drawingAreaHeight};
 
-    tbi->redraw(vi, cr, rect.to<double>() / pixelSize, zoom);
+    if(incremental)
+    {
+      backingStore.redraw(cr,
+                          position,
+                          size,
+                          zoom,
+                          [this](cairo_t* store_cr, Scroom::Utils::Rectangle<double> rect)
+                          { tbi->redraw(vi, store_cr, rect, zoom); });
+    }
+    else
+    {
+      tbi->redraw(vi, cr, Scroom::Utils::make_rect(position, size.to<double>() / pixelSize), zoom);
+    }
   }
 }
 
+void TestData::pan(Scroom::Utils::Point<int> pixels) { position += pixels.to<double>() / pixelSizeFromZoom(zoom); }
+
+void TestData::setIncremental(bool incremental_)
+{
+  incremental = incremental_;
+  backingStore.invalidate();
+}
+
 ////////////////////////////////////////////////////////////////////////
 
 Sleeper::Sleeper(unsigned int secs_)
@@ -11,6 +11,7 @@
 
 #include <gtk/gtk.h>
 
+#include <scroom/backing-store.hh>
 #include <scroom/colormappable.hh>
 #include <scroom/layeroperations.hh>
 
@@ -53,6 +54,10 @@ private:
   SourcePresentation::Ptr    sp;
   int                        zoom;
 
+  Scroom::Utils::Point<double> position;
+  bool                         incremental{false};
+  BackingStore                 backingStore;
+
 private:
   TestData(DummyColormapProvider::Ptr       colormapProvider,
            LayerSpec                        ls,
@@ -76,6 +81,12 @@ public:
 
   void redraw(cairo_t* cr);
   bool wait();
+
+  /** Move the visible area by the given number of pixels */
+  void pan(Scroom::Utils::Point<int> pixels);
+
+  /** Only redraw the parts that became visible, like the View does */
+  void setIncremental(bool incremental_);
 };
 
 extern TestData::Ptr testData;
@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <future>
+#include <memory>
 #include <ostream>
 
 #include <boost/function.hpp>
@@ -68,6 +70,41 @@ namespace Scroom::GtkHelpers
     }
   }
 
+  /**
+   * Run @p f on the UI thread, without waiting for it
+   *
+   * Unlike async_on_ui_thread(), this doesn't add a main loop source for
+   * every call. Functions are collected in a lock-free queue, which the
+   * UI thread drains in one go, in the order in which they were posted.
+   */
+  void post_on_ui_thread(boost::function<void()> f);
+
+  /**
+   * Update of the UI that is posted at most once until it runs
+   *
+   * Workers can call request() as often as they like. However many
+   * requests arrive before the UI thread gets to it, the function runs
+   * only once, so it should read the latest state (e.g. from atomic
+   * counters) rather than have it passed in.
+   */
+  class CoalescedUpdate : public std::enable_shared_from_this<CoalescedUpdate>
+  {
+  public:
+    using Ptr = std::shared_ptr<CoalescedUpdate>;
+
+  private:
+    boost::function<void()> f;
+    std::atomic<bool>       pending{false};
+
+  private:
+    explicit CoalescedUpdate(boost::function<void()> f);
+
+  public:
+    static Ptr create(boost::function<void()> f);
+
+    void request();
+  };
+
   inline cairo_rectangle_int_t createCairoIntRectangle(int x, int y, int width, int height)
   {
     cairo_rectangle_int_t rect;
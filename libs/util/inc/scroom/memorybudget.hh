@@ -0,0 +1,116 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+
+#include <scroom/stuff.hh>
+
+namespace Scroom::Utils
+{
+  /**
+   * Process-wide budget for memory that can be recomputed when needed.
+   *
+   * Items (decompressed tiles, pre-drawn bitmaps, ...) are handed to the
+   * budget using retain(). The budget keeps them alive, and evicts the
+   * least recently used ones once the total size exceeds the limit.
+   *
+   * An item is pinned as long as someone other than the budget holds a
+   * reference to it. Typically, these are the tiles in the viewport of
+   * one of the views. Pinned items are counted, but never evicted.
+   */
+  class MemoryBudget : public std::enable_shared_from_this<MemoryBudget>
+  {
+  public:
+    using Ptr = std::shared_ptr<MemoryBudget>;
+
+    /** Name of the environment variable holding the default limit, in MiB */
+    static const char* const ENVIRONMENT_VARIABLE;
+
+    /** Limit used if the environment variable isn't set */
+    static const size_t DEFAULT_LIMIT;
+
+    struct Usage
+    {
+      size_t pinned{0};
+      size_t cached{0};
+      size_t limit{0};
+
+      [[nodiscard]] size_t total() const { return pinned + cached; }
+    };
+
+    /**
+     * Registration of a single item with the budget.
+     *
+     * Destroying the Entry removes the item from the budget.
+     */
+    class Entry
+    {
+    public:
+      using Ptr = std::shared_ptr<Entry>;
+
+    private:
+      std::weak_ptr<MemoryBudget> budget;
+      Stuff                       item;
+      size_t                      size;
+      std::list<Entry*>::iterator position;
+
+      friend class MemoryBudget;
+
+    private:
+      Entry(std::weak_ptr<MemoryBudget> budget, Stuff item, size_t size);
+
+    public:
+      ~Entry();
+      Entry(const Entry&)            = delete;
+      Entry(Entry&&)                 = delete;
+      Entry& operator=(const Entry&) = delete;
+      Entry& operator=(Entry&&)      = delete;
+
+      /** Mark the item as most recently used */
+      void touch();
+
+      /** @return false if the item has been evicted */
+      bool isResident();
+    };
+
+  private:
+    boost::mutex      mut;
+    size_t            limit;
+    size_t            used{0};
+    std::list<Entry*> entries; ///< Resident items, most recently used first
+
+  private:
+    explicit MemoryBudget(size_t limit);
+
+    /** Drop entries until we're within budget. Evicted items are moved to @p evicted */
+    void evict(StuffList& evicted);
+
+  public:
+    /** The budget shared by all presentations in this process */
+    static Ptr instance();
+
+    static Ptr create(size_t limit);
+
+    void   setLimit(size_t limit);
+    size_t getLimit();
+    Usage  getUsage();
+
+    /**
+     * Keep @p item alive until it is evicted or the returned Entry is
+     * destroyed, whichever comes first.
+     *
+     * @param size estimated number of bytes occupied by @p item
+     */
+    Entry::Ptr retain(Stuff item, size_t size);
+  };
+} // namespace Scroom::Utils
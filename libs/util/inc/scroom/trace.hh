@@ -0,0 +1,109 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+/**
+ * Tracing of where time goes, for viewing in Perfetto or chrome://tracing
+ *
+ * Code of interest is wrapped in a Span. While tracing is enabled,
+ * each Span records when it started and how long it took, on which
+ * thread. While it is disabled, a Span costs a single relaxed atomic
+ * load.
+ *
+ * Set the environment variable named by ENVIRONMENT_VARIABLE to a file
+ * name to trace the entire run. The trace is then written to that file
+ * when the process exits.
+ */
+namespace Scroom::Utils::Trace
+{
+  using Clock = std::chrono::steady_clock;
+
+  /** Name of the environment variable holding the file to write the trace to */
+  extern const char* const ENVIRONMENT_VARIABLE;
+
+  /** What a Span is about. Negative numbers and null pointers are left out of the trace */
+  struct Tags
+  {
+    int         layer{-1};
+    int         x{-1};
+    int         y{-1};
+    const void* view{nullptr};
+  };
+
+  namespace Detail
+  {
+    extern std::atomic<bool> enabled;
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end, const Tags& tags);
+  } // namespace Detail
+
+  inline bool isEnabled() { return Detail::enabled.load(std::memory_order_relaxed); }
+
+  /** Start recording, discarding anything recorded earlier */
+  void start();
+
+  /** Stop recording. What was recorded so far is kept for write() */
+  void stop();
+
+  /** Write everything recorded so far, in the Chrome trace event format */
+  void write(std::ostream& out);
+
+  /**
+   * Record that @p name started at @p start and ended just now
+   *
+   * For periods that don't map to a scope, like the time a job spent
+   * waiting in a queue.
+   */
+  inline void record(const char* name, Clock::time_point start, const Tags& tags = {})
+  {
+    if(isEnabled())
+    {
+      Detail::record(name, start, Clock::now(), tags);
+    }
+  }
+
+  /** Records the time between its construction and destruction, if tracing is enabled */
+  class Span
+  {
+  private:
+    const char*       name;
+    Tags              tags;
+    Clock::time_point begin;
+    bool              active;
+
+  public:
+    /** @param name Must remain valid until the trace is written, e.g. a string literal */
+    explicit Span(const char* name_, const Tags& tags_ = {})
+      : name(name_)
+      , tags(tags_)
+      , active(isEnabled())
+    {
+      if(active)
+      {
+        begin = Clock::now();
+      }
+    }
+
+    ~Span()
+    {
+      if(active)
+      {
+        Detail::record(name, begin, Clock::now(), tags);
+      }
+    }
+
+    Span(const Span&)            = delete;
+    Span(Span&&)                 = delete;
+    Span& operator=(const Span&) = delete;
+    Span& operator=(Span&&)      = delete;
+  };
+} // namespace Scroom::Utils::Trace
@@ -5,6 +5,10 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <atomic>
+#include <memory>
+#include <utility>
+
 #include <boost/thread.hpp>
 
 #include <scroom/assertions.hh>
@@ -12,8 +16,81 @@
 
 namespace Scroom::GtkHelpers
 {
+  namespace
+  {
+    struct PostedTask
+    {
+      boost::function<void()> f;
+      PostedTask*             next{nullptr};
+    };
+
+    /** Most recently posted task first. Pushed by any thread, taken by the UI thread */
+    std::atomic<PostedTask*> postedTasks{nullptr};
+
+    int drainPostedTasks(gpointer /*unused*/)
+    {
+      PostedTask* tasks = postedTasks.exchange(nullptr, std::memory_order_acquire);
+
+      // Restore the order in which the tasks were posted
+      PostedTask* ordered = nullptr;
+      while(tasks != nullptr)
+      {
+        PostedTask* next = tasks->next;
+        tasks->next      = ordered;
+        ordered          = tasks;
+        tasks            = next;
+      }
+
+      while(ordered != nullptr)
+      {
+        std::unique_ptr<PostedTask> const task(ordered);
+        ordered = task->next;
+        task->f();
+      }
+      return false;
+    }
+  } // namespace
+
   bool on_ui_thread() { return g_main_context_is_owner(g_main_context_default()); }
 
+  void post_on_ui_thread(boost::function<void()> f)
+  {
+    auto*       task     = new PostedTask{std::move(f)};
+    PostedTask* previous = postedTasks.load(std::memory_order_relaxed);
+    do
+    {
+      task->next = previous;
+    } while(!postedTasks.compare_exchange_weak(previous, task, std::memory_order_release, std::memory_order_relaxed));
+
+    // Don't touch task anymore, it may already have been executed
+    if(previous == nullptr)
+    {
+      // The queue was empty, so nobody is going to drain it yet
+      gdk_threads_add_idle(drainPostedTasks, nullptr);
+    }
+  }
+
+  CoalescedUpdate::CoalescedUpdate(boost::function<void()> f_)
+    : f(std::move(f_))
+  {
+  }
+
+  CoalescedUpdate::Ptr CoalescedUpdate::create(boost::function<void()> f) { return Ptr(new CoalescedUpdate(std::move(f))); }
+
+  void CoalescedUpdate::request()
+  {
+    if(!pending.exchange(true))
+    {
+      post_on_ui_thread(
+        [me = shared_from_this()]
+        {
+          // Clear the flag first, so requests made while f() runs aren't lost
+          me->pending = false;
+          me->f();
+        });
+    }
+  }
+
   GtkWindow* get_parent_window(GtkWidget* widget)
   {
     auto* topLevel = gtk_widget_get_toplevel(widget);
@@ -0,0 +1,185 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <scroom/memorybudget.hh>
+
+#include <cstdlib>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <scroom/assertions.hh>
+
+namespace Scroom::Utils
+{
+  const char* const MemoryBudget::ENVIRONMENT_VARIABLE = "SCROOM_MEMORY_BUDGET";
+  const size_t      MemoryBudget::DEFAULT_LIMIT        = static_cast<size_t>(1024) * 1024 * 1024;
+
+  namespace
+  {
+    size_t getDefaultLimit()
+    {
+      const char* value = getenv(MemoryBudget::ENVIRONMENT_VARIABLE); // NOLINT(concurrency-mt-unsafe)
+      if(value == nullptr)
+      {
+        return MemoryBudget::DEFAULT_LIMIT;
+      }
+
+      try
+      {
+        return boost::lexical_cast<size_t>(value) * 1024 * 1024;
+      }
+      catch(boost::bad_lexical_cast&)
+      {
+        spdlog::warn("{}: Expected a number of MiB, not {}. Using default", MemoryBudget::ENVIRONMENT_VARIABLE, value);
+        return MemoryBudget::DEFAULT_LIMIT;
+      }
+    }
+  } // namespace
+
+  ////////////////////////////////////////////////////////////////////////
+  // MemoryBudget::Entry
+
+  MemoryBudget::Entry::Entry(std::weak_ptr<MemoryBudget> budget_, Stuff item_, size_t size_)
+    : budget(std::move(budget_))
+    , item(std::move(item_))
+    , size(size_)
+  {
+  }
+
+  MemoryBudget::Entry::~Entry()
+  {
+    MemoryBudget::Ptr const b = budget.lock();
+    if(b)
+    {
+      boost::mutex::scoped_lock const lock(b->mut);
+      if(item)
+      {
+        b->entries.erase(position);
+        b->used -= size;
+      }
+    }
+    // item gets released here, without holding the lock
+  }
+
+  void MemoryBudget::Entry::touch()
+  {
+    MemoryBudget::Ptr const b = budget.lock();
+    if(b)
+    {
+      boost::mutex::scoped_lock const lock(b->mut);
+      if(item)
+      {
+        b->entries.splice(b->entries.begin(), b->entries, position);
+      }
+    }
+  }
+
+  bool MemoryBudget::Entry::isResident()
+  {
+    MemoryBudget::Ptr const b = budget.lock();
+    if(b)
+    {
+      boost::mutex::scoped_lock const lock(b->mut);
+      return item != nullptr;
+    }
+    return false;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // MemoryBudget
+
+  MemoryBudget::Ptr MemoryBudget::instance()
+  {
+    static MemoryBudget::Ptr const me = create(getDefaultLimit());
+    return me;
+  }
+
+  MemoryBudget::Ptr MemoryBudget::create(size_t limit) { return Ptr(new MemoryBudget(limit)); }
+
+  MemoryBudget::MemoryBudget(size_t limit_)
+    : limit(limit_)
+  {
+  }
+
+  void MemoryBudget::setLimit(size_t limit_)
+  {
+    StuffList evicted;
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      limit = limit_;
+      evict(evicted);
+    }
+    // evicted items get released here, without holding the lock
+  }
+
+  size_t MemoryBudget::getLimit()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+    return limit;
+  }
+
+  MemoryBudget::Usage MemoryBudget::getUsage()
+  {
+    boost::mutex::scoped_lock const lock(mut);
+
+    Usage result;
+    result.limit = limit;
+    for(Entry const* e: entries)
+    {
+      if(e->item.use_count() > 1)
+      {
+        result.pinned += e->size;
+      }
+      else
+      {
+        result.cached += e->size;
+      }
+    }
+    return result;
+  }
+
+  MemoryBudget::Entry::Ptr MemoryBudget::retain(Stuff item, size_t size)
+  {
+    require(item);
+
+    Entry::Ptr const result(new Entry(shared_from_this(), std::move(item), size));
+
+    StuffList evicted;
+    {
+      boost::mutex::scoped_lock const lock(mut);
+      entries.push_front(result.get());
+      result->position = entries.begin();
+      used += size;
+      evict(evicted);
+    }
+    // evicted items get released here, without holding the lock
+
+    return result;
+  }
+
+  void MemoryBudget::evict(StuffList& evicted)
+  {
+    auto it = entries.end();
+    while(used > limit && it != entries.begin())
+    {
+      --it;
+      Entry* e = *it;
+
+      // Items referenced by anyone else are pinned. Evicting those
+      // wouldn't free anything anyway.
+      if(e->item.use_count() == 1)
+      {
+        used -= e->size;
+        evicted.push_back(std::move(e->item));
+        it = entries.erase(it);
+      }
+    }
+  }
+} // namespace Scroom::Utils
@@ -0,0 +1,180 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <scroom/trace.hh>
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <boost/thread/mutex.hpp>
+
+namespace Scroom::Utils::Trace
+{
+  const char* const ENVIRONMENT_VARIABLE = "SCROOM_TRACE";
+
+  namespace Detail
+  {
+    std::atomic<bool> enabled{false};
+  } // namespace Detail
+
+  namespace
+  {
+    struct Event
+    {
+      const char*       name;
+      Clock::time_point start;
+      Clock::time_point end;
+      Tags              tags;
+    };
+
+    /** Events of a single thread. Only contended while writing the trace */
+    struct Buffer
+    {
+      boost::mutex       mut;
+      std::vector<Event> events;
+      size_t             tid{0};
+    };
+
+    class Registry
+    {
+    public:
+      boost::mutex                         mut;
+      std::vector<std::shared_ptr<Buffer>> buffers;
+      Clock::time_point                    origin{Clock::now()};
+
+    public:
+      /** Never destroyed, because threads may still be recording while the process exits */
+      static Registry& instance()
+      {
+        static auto* me = new Registry();
+        return *me;
+      }
+    };
+
+    Buffer& threadBuffer()
+    {
+      thread_local std::shared_ptr<Buffer> buffer;
+      if(!buffer)
+      {
+        Registry&                       r = Registry::instance();
+        boost::mutex::scoped_lock const lock(r.mut);
+        buffer      = std::make_shared<Buffer>();
+        buffer->tid = r.buffers.size() + 1;
+        r.buffers.push_back(buffer);
+      }
+      return *buffer;
+    }
+
+    double microseconds(Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); }
+
+    std::string toJson(const Event& e, size_t tid, Clock::time_point origin)
+    {
+      std::string args;
+      const auto  add = [&args](const std::string& arg) { args += (args.empty() ? "" : ", ") + arg; };
+      if(e.tags.layer >= 0)
+      {
+        add(fmt::format(R"("layer": {})", e.tags.layer));
+      }
+      if(e.tags.x >= 0)
+      {
+        add(fmt::format(R"("x": {})", e.tags.x));
+      }
+      if(e.tags.y >= 0)
+      {
+        add(fmt::format(R"("y": {})", e.tags.y));
+      }
+      if(e.tags.view != nullptr)
+      {
+        add(fmt::format(R"("view": "{}")", fmt::ptr(e.tags.view)));
+      }
+
+      return fmt::format(R"({{"name": "{}", "cat": "scroom", "ph": "X", "pid": 1, "tid": {}, )"
+                         R"("ts": {:.3f}, "dur": {:.3f}, "args": {{{}}}}})",
+                         e.name,
+                         tid,
+                         microseconds(e.start - origin),
+                         microseconds(e.end - e.start),
+                         args);
+    }
+
+    void writeAtExit()
+    {
+      stop();
+
+      const char*   filename = getenv(ENVIRONMENT_VARIABLE); // NOLINT(concurrency-mt-unsafe)
+      std::ofstream out(filename, std::ios::trunc);
+      write(out);
+      if(!out)
+      {
+        spdlog::error("Failed to write trace to {}", filename);
+      }
+    }
+
+    bool startFromEnvironment()
+    {
+      const char* filename = getenv(ENVIRONMENT_VARIABLE); // NOLINT(concurrency-mt-unsafe)
+      if(filename == nullptr || *filename == '\0')
+      {
+        return false;
+      }
+
+      spdlog::info("Tracing to {}", filename);
+      start();
+      std::atexit(writeAtExit);
+      return true;
+    }
+
+    [[maybe_unused]] const bool startedFromEnvironment = startFromEnvironment();
+  } // namespace
+
+  void Detail::record(const char* name, Clock::time_point start, Clock::time_point end, const Tags& tags)
+  {
+    Buffer&                         b = threadBuffer();
+    boost::mutex::scoped_lock const lock(b.mut);
+    b.events.push_back({name, start, end, tags});
+  }
+
+  void start()
+  {
+    Registry&                       r = Registry::instance();
+    boost::mutex::scoped_lock const lock(r.mut);
+    for(const auto& b: r.buffers)
+    {
+      boost::mutex::scoped_lock const bufferLock(b->mut);
+      b->events.clear();
+    }
+    r.origin        = Clock::now();
+    Detail::enabled = true;
+  }
+
+  void stop() { Detail::enabled = false; }
+
+  void write(std::ostream& out)
+  {
+    Registry&                       r = Registry::instance();
+    boost::mutex::scoped_lock const lock(r.mut);
+
+    out << "{\"traceEvents\": [";
+    const char* separator = "\n";
+    for(const auto& b: r.buffers)
+    {
+      boost::mutex::scoped_lock const bufferLock(b->mut);
+      for(const Event& e: b->events)
+      {
+        out << separator << toJson(e, b->tid, r.origin);
+        separator = ",\n";
+      }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+  }
+} // namespace Scroom::Utils::Trace
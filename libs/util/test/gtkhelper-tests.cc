@@ -5,7 +5,10 @@
  * SPDX-License-Identifier: LGPL-2.1
  */
 
+#include <atomic>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -60,4 +63,53 @@ BOOST_AUTO_TEST_CASE(on_ui_thread_test)
   sync_on_ui_thread([] { BOOST_CHECK(on_ui_thread()); });
 }
 
+BOOST_AUTO_TEST_CASE(posted_functions_run_on_ui_thread_in_order)
+{
+  Scroom::GtkTestHelpers::GtkMainLoop const mainLoop;
+
+  std::vector<int> expected;
+  std::vector<int> order;
+  for(int i = 0; i < 100; i++)
+  {
+    expected.push_back(i);
+    post_on_ui_thread(
+      [&order, i]
+      {
+        BOOST_CHECK(on_ui_thread());
+        order.push_back(i);
+      });
+  }
+  sync_on_ui_thread([] {});
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), order.begin(), order.end());
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_updates_run_once_per_batch)
+{
+  Scroom::GtkTestHelpers::GtkMainLoop const mainLoop;
+
+  std::atomic<int>               value{0};
+  std::vector<int>               seen;
+  CoalescedUpdate::Ptr const     update = CoalescedUpdate::create([&] { seen.push_back(value); });
+  std::promise<void>             unblock;
+  std::shared_future<void> const release = unblock.get_future().share();
+
+  // Keep the UI thread busy, so all requests arrive before it can act on them
+  post_on_ui_thread([release] { release.wait(); });
+  for(int i = 1; i <= 10; i++)
+  {
+    value = i;
+    update->request();
+  }
+  unblock.set_value();
+  sync_on_ui_thread([] {});
+
+  BOOST_REQUIRE_EQUAL(1U, seen.size());
+  BOOST_CHECK_EQUAL(10, seen.front());
+
+  update->request();
+  sync_on_ui_thread([] {});
+  BOOST_CHECK_EQUAL(2U, seen.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
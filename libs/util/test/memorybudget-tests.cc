@@ -0,0 +1,98 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/memorybudget.hh>
+
+using Scroom::Utils::MemoryBudget;
+using Scroom::Utils::Stuff;
+using Scroom::Utils::StuffWeak;
+
+namespace
+{
+  Stuff createItem() { return std::make_shared<int>(42); }
+} // namespace
+
+//////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(MemoryBudget_Tests)
+
+BOOST_AUTO_TEST_CASE(items_are_retained_within_budget)
+{
+  MemoryBudget::Ptr const  budget = MemoryBudget::create(100);
+  StuffWeak                weak;
+  MemoryBudget::Entry::Ptr e;
+  {
+    Stuff const item = createItem();
+    weak             = item;
+    e                = budget->retain(item, 60);
+  }
+  BOOST_CHECK(!weak.expired());
+  BOOST_CHECK(e->isResident());
+  BOOST_CHECK_EQUAL(0, budget->getUsage().pinned);
+  BOOST_CHECK_EQUAL(60, budget->getUsage().cached);
+
+  e.reset();
+  BOOST_CHECK(weak.expired());
+  BOOST_CHECK_EQUAL(0, budget->getUsage().total());
+}
+
+BOOST_AUTO_TEST_CASE(least_recently_used_is_evicted_first)
+{
+  MemoryBudget::Ptr const        budget = MemoryBudget::create(100);
+  MemoryBudget::Entry::Ptr const a      = budget->retain(createItem(), 40);
+  MemoryBudget::Entry::Ptr const b      = budget->retain(createItem(), 40);
+  a->touch();
+  MemoryBudget::Entry::Ptr const c = budget->retain(createItem(), 40);
+
+  BOOST_CHECK(a->isResident());
+  BOOST_CHECK(!b->isResident());
+  BOOST_CHECK(c->isResident());
+  BOOST_CHECK_EQUAL(80, budget->getUsage().cached);
+}
+
+BOOST_AUTO_TEST_CASE(referenced_items_are_pinned)
+{
+  MemoryBudget::Ptr const        budget = MemoryBudget::create(100);
+  Stuff const                    pinned = createItem();
+  MemoryBudget::Entry::Ptr const a      = budget->retain(pinned, 80);
+  MemoryBudget::Entry::Ptr const b      = budget->retain(createItem(), 80);
+
+  BOOST_CHECK(a->isResident());
+  BOOST_CHECK(!b->isResident());
+  BOOST_CHECK_EQUAL(80, budget->getUsage().pinned);
+  BOOST_CHECK_EQUAL(0, budget->getUsage().cached);
+}
+
+BOOST_AUTO_TEST_CASE(lowering_the_limit_evicts)
+{
+  MemoryBudget::Ptr const        budget = MemoryBudget::create(100);
+  MemoryBudget::Entry::Ptr const a      = budget->retain(createItem(), 40);
+  MemoryBudget::Entry::Ptr const b      = budget->retain(createItem(), 40);
+
+  budget->setLimit(50);
+  BOOST_CHECK(!a->isResident());
+  BOOST_CHECK(b->isResident());
+  BOOST_CHECK_EQUAL(50, budget->getUsage().limit);
+  BOOST_CHECK_EQUAL(40, budget->getUsage().total());
+}
+
+BOOST_AUTO_TEST_CASE(entries_outlive_their_budget)
+{
+  MemoryBudget::Ptr        budget = MemoryBudget::create(100);
+  MemoryBudget::Entry::Ptr e      = budget->retain(createItem(), 40);
+
+  budget.reset();
+  BOOST_CHECK(!e->isResident());
+  e->touch();
+  e.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <scroom/trace.hh>
+
+namespace Trace = Scroom::Utils::Trace;
+
+namespace
+{
+  std::string written()
+  {
+    std::ostringstream out;
+    Trace::write(out);
+    return out.str();
+  }
+} // namespace
+
+//////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(Trace_Tests)
+
+BOOST_AUTO_TEST_CASE(spans_are_written_with_their_tags)
+{
+  Trace::start();
+  {
+    Trace::Span const span("Tagged", {2, 3, 4, nullptr});
+  }
+  Trace::stop();
+
+  const std::string trace = written();
+  BOOST_CHECK_EQUAL(0, trace.find("{\"traceEvents\": ["));
+  BOOST_CHECK_NE(std::string::npos, trace.find(R"("name": "Tagged")"));
+  BOOST_CHECK_NE(std::string::npos, trace.find(R"("ph": "X")"));
+  BOOST_CHECK_NE(std::string::npos, trace.find(R"("args": {"layer": 2, "x": 3, "y": 4})"));
+}
+
+BOOST_AUTO_TEST_CASE(nothing_is_recorded_while_disabled)
+{
+  Trace::start();
+  Trace::stop();
+  BOOST_CHECK(!Trace::isEnabled());
+
+  {
+    Trace::Span const span("Ignored");
+  }
+  Trace::record("AlsoIgnored", Trace::Clock::now());
+
+  BOOST_CHECK_EQUAL(std::string::npos, written().find("Ignored"));
+}
+
+BOOST_AUTO_TEST_CASE(starting_discards_earlier_spans)
+{
+  Trace::start();
+  {
+    Trace::Span const span("Old");
+  }
+  Trace::start();
+  {
+    Trace::Span const span("New");
+  }
+  Trace::stop();
+
+  const std::string trace = written();
+  BOOST_CHECK_EQUAL(std::string::npos, trace.find("Old"));
+  BOOST_CHECK_NE(std::string::npos, trace.find("New"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -22,6 +22,12 @@
 
 #include "version.h"
 
+namespace
+{
+  /** Half the length of the lines of the crosses marking the ends of the measurement, in pixels */
+  const int CROSS_SIZE = 10;
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////
 // Measure
 ////////////////////////////////////////////////////////////////////////
@@ -77,11 +83,28 @@ void MeasureHandler::displayMeasurement(const ViewInterface::Ptr& view)
 
 void MeasureHandler::drawCross(cairo_t* cr, Scroom::Utils::Point<double> p)
 {
-  static const int size = 10;
-  cairo_move_to(cr, p.x - size, p.y);
-  cairo_line_to(cr, p.x + size, p.y);
-  cairo_move_to(cr, p.x, p.y - size);
-  cairo_line_to(cr, p.x, p.y + size);
+  cairo_move_to(cr, p.x - CROSS_SIZE, p.y);
+  cairo_line_to(cr, p.x + CROSS_SIZE, p.y);
+  cairo_move_to(cr, p.x, p.y - CROSS_SIZE);
+  cairo_line_to(cr, p.x, p.y + CROSS_SIZE);
+}
+
+void MeasureHandler::updateSelection(Selection s, const ViewInterface::Ptr& view)
+{
+  const std::optional<Selection> previous = selection;
+  selection                               = s;
+  displayMeasurement(view);
+
+  // The crosses extend beyond the selection, by a number of screen pixels
+  const double margin = (CROSS_SIZE + 1) / pixelSize;
+  for(const auto& changed: {previous, selection})
+  {
+    if(changed)
+    {
+      const auto box = changed->boundingBox();
+      view->invalidateArea({box.x() - margin, box.y() - margin, box.width() + 2 * margin, box.height() + 2 * margin});
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -94,8 +117,7 @@ void MeasureHandler::onSelectionUpdate(Selection s, ViewInterface::Ptr view)
 {
   if(enabled)
   {
-    selection = s;
-    displayMeasurement(view);
+    updateSelection(s, view);
   }
 }
 
@@ -103,8 +125,7 @@ void MeasureHandler::onSelectionEnd(Selection s, ViewInterface::Ptr view)
 {
   if(enabled)
   {
-    selection = s;
-    displayMeasurement(view);
+    updateSelection(s, view);
   }
 }
 
@@ -117,11 +138,12 @@ void MeasureHandler::render(ViewInterface::Ptr const& /*vi*/,
                             Scroom::Utils::Rectangle<double> presentationArea,
                             int                              zoom)
 {
+  pixelSize = pixelSizeFromZoom(zoom);
+
   if(selection)
   {
-    const auto pixelSize = pixelSizeFromZoom(zoom);
-    const auto start     = (selection->start - presentationArea.getTopLeft()) * pixelSize;
-    const auto end       = (selection->end - presentationArea.getTopLeft()) * pixelSize;
+    const auto start = (selection->start - presentationArea.getTopLeft()) * pixelSize;
+    const auto end   = (selection->end - presentationArea.getTopLeft()) * pixelSize;
 
     cairo_set_line_width(cr, 1);
     cairo_set_source_rgb(cr, 0.75, 0, 0); // Dark Red
@@ -26,6 +26,7 @@ public:
 private:
   std::optional<Selection> selection;
   bool                     enabled{false};
+  double                   pixelSize{1}; /**< As used by the most recent render() */
 
 public:
   static Ptr create();
@@ -53,6 +54,7 @@ public:
 private:
   virtual void displayMeasurement(const ViewInterface::Ptr& view);
   virtual void drawCross(cairo_t* cr, Scroom::Utils::Point<double> p);
+  void         updateSelection(Selection s, const ViewInterface::Ptr& view);
 };
 
 class Measure
@@ -62,7 +62,7 @@ void PipetteHandler::computeValues(const ViewInterface::Ptr& view, Scroom::Utils
 {
   jobMutex.lock();
 
-  Scroom::GtkHelpers::sync_on_ui_thread([=] { view->setStatusMessage("Computing color values..."); });
+  Scroom::GtkHelpers::post_on_ui_thread([=] { view->setStatusMessage("Computing color values..."); });
 
   // Get the average color within the rectangle
   PresentationInterface::Ptr const presentation = view->getCurrentPresentation();
@@ -70,7 +70,7 @@ void PipetteHandler::computeValues(const ViewInterface::Ptr& view, Scroom::Utils
   if(pipette == nullptr || !presentation->isPropertyDefined(PIPETTE_PROPERTY_NAME))
   {
     spdlog::error("Presentation does not implement PipetteViewInterface!");
-    Scroom::GtkHelpers::sync_on_ui_thread([=] { view->setStatusMessage("Pipette is not supported for this presentation."); });
+    Scroom::GtkHelpers::post_on_ui_thread([=] { view->setStatusMessage("Pipette is not supported for this presentation."); });
     jobMutex.unlock();
     return;
   }
@@ -111,7 +111,7 @@ void PipetteHandler::displayValues(const ViewInterface::Ptr&                   v
     }
   }
 
-  Scroom::GtkHelpers::sync_on_ui_thread([view, status = info.str()] { view->setStatusMessage(status); });
+  Scroom::GtkHelpers::post_on_ui_thread([view, status = info.str()] { view->setStatusMessage(status); });
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -122,11 +122,31 @@ std::string PipetteHandler::getSelectionType() { return SelectionType::PIXEL; }
 
 void PipetteHandler::onSelectionStart(Selection /*selection*/, ViewInterface::Ptr /*view*/) {}
 
-void PipetteHandler::onSelectionUpdate(Selection s, ViewInterface::Ptr /*view*/)
+void PipetteHandler::updateSelection(Selection s, const ViewInterface::Ptr& view)
+{
+  const std::optional<Selection> previous = selection;
+  selection                               = s;
+
+  if(view)
+  {
+    // Leave room for the line width
+    const double margin = 2 / pixelSize;
+    for(const auto& changed: {previous, selection})
+    {
+      if(changed)
+      {
+        const auto box = changed->boundingBox();
+        view->invalidateArea({box.x() - margin, box.y() - margin, box.width() + 2 * margin, box.height() + 2 * margin});
+      }
+    }
+  }
+}
+
+void PipetteHandler::onSelectionUpdate(Selection s, ViewInterface::Ptr view)
 {
   if(enabled && jobMutex.try_lock())
   {
-    selection = s;
+    updateSelection(s, view);
     jobMutex.unlock();
   }
 }
@@ -135,7 +155,7 @@ void PipetteHandler::onSelectionEnd(Selection s, ViewInterface::Ptr view)
 {
   if(enabled && jobMutex.try_lock())
   {
-    selection = s;
+    updateSelection(s, view);
 
     // Get the selection rectangle
     const auto sel_rect = Scroom::Utils::make_rect_from_start_end(selection->start, selection->end);
@@ -154,11 +174,12 @@ void PipetteHandler::render(ViewInterface::Ptr const& /*vi*/,
                             Scroom::Utils::Rectangle<double> presentationArea,
                             int                              zoom)
 {
+  pixelSize = pixelSizeFromZoom(zoom);
+
   if(selection)
   {
-    const auto pixelSize = pixelSizeFromZoom(zoom);
-    const auto start     = (selection->start - presentationArea.getTopLeft()) * pixelSize;
-    const auto end       = (selection->end - presentationArea.getTopLeft()) * pixelSize;
+    const auto start = (selection->start - presentationArea.getTopLeft()) * pixelSize;
+    const auto end   = (selection->end - presentationArea.getTopLeft()) * pixelSize;
 
     cairo_set_line_width(cr, 1);
     cairo_set_source_rgb(cr, 0, 0, 1); // Blue
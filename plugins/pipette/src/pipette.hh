@@ -32,6 +32,7 @@ private:
   std::atomic_flag         wasDisabled = ATOMIC_FLAG_INIT;
   std::mutex               jobMutex;
   ThreadPool::Queue::Ptr   currentJob{ThreadPool::Queue::createAsync()};
+  double                   pixelSize{1}; /**< As used by the most recent render() */
 
 public:
   static Ptr create();
@@ -63,6 +64,8 @@ public:
                              Scroom::Utils::Rectangle<double>            rect,
                              const PipetteLayerOperations::PipetteColor& colors);
 
+  void updateSelection(Selection s, const ViewInterface::Ptr& view);
+
   ////////////////////////////////////////////////////////////////////////
   // Testing
 
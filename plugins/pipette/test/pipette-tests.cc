@@ -8,6 +8,7 @@
 #include <memory>
 #include <stack>
 #include <thread>
+#include <vector>
 
 #include <boost/dll.hpp>
 #include <boost/test/unit_test.hpp>
@@ -58,6 +59,7 @@ public:
   }
 
   void                   invalidate() override {}
+  void                   invalidateArea(Scroom::Utils::Rectangle<double> area) override { invalidatedAreas.push_back(area); }
   ProgressInterface::Ptr getProgressInterface() override { return nullptr; }
   void                   addSideWidget(std::string /*title*/, GtkWidget* /*w*/) override {}
   void                   removeSideWidget(GtkWidget* /*w*/) override {}
@@ -90,6 +92,8 @@ public:
   int                        tool_btn = 0;
   PresentationInterface::Ptr presentation;
 
+  std::vector<Scroom::Utils::Rectangle<double>> invalidatedAreas;
+
   boost::mutex              mut;
   boost::condition_variable cond;
   std::list<std::string>    statusMessages;
@@ -169,6 +173,27 @@ BOOST_AUTO_TEST_CASE(pipette_selection_update)
   handler->render(vi, cr, {0, 0, 0, 0}, 1);
 }
 
+BOOST_AUTO_TEST_CASE(pipette_selection_update_invalidates_old_and_new_selection)
+{
+  PipetteHandler::Ptr const handler = PipetteHandler::create();
+  DummyView::Ptr const      view    = DummyView::createWithPresentation();
+
+  const Selection first({10, 11}, {20, 30});
+  const Selection second({50, 40}, {45, 35});
+
+  handler->onEnable();
+  handler->onSelectionUpdate(first, view);
+  BOOST_REQUIRE_EQUAL(1U, view->invalidatedAreas.size());
+  BOOST_CHECK(view->invalidatedAreas[0].contains(first.boundingBox()));
+
+  view->invalidatedAreas.clear();
+  handler->onSelectionUpdate(second, view);
+  BOOST_REQUIRE_EQUAL(2U, view->invalidatedAreas.size());
+  BOOST_CHECK(view->invalidatedAreas[0].contains(first.boundingBox()));
+  BOOST_CHECK(view->invalidatedAreas[1].contains(second.boundingBox()));
+  BOOST_CHECK(!view->invalidatedAreas[1].contains(first.boundingBox()));
+}
+
 BOOST_AUTO_TEST_CASE(pipette_enable_disable)
 {
   PipetteHandler::Ptr const handler = PipetteHandler::create();
@@ -7,6 +7,8 @@
 
 #include "tiffsource.hh"
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 
 #include <spdlog/spdlog.h>
@@ -56,6 +58,69 @@ namespace
       TIFFClose(tif);
     }
   }
+
+  /**
+   * Copy the part of a decoded strip or tile that overlaps the band into the tiles
+   *
+   * @param src Decoded data, covering @c region
+   * @param srcStride Number of bytes per line in @c src
+   * @param region Area of the bitmap covered by @c src
+   * @param band Area of the bitmap covered by @c tiles
+   */
+  void copyRegion(const byte*                   src,
+                  size_t                        srcStride,
+                  Scroom::Utils::Rectangle<int> region,
+                  Scroom::Utils::Rectangle<int> band,
+                  int                           tileWidth,
+                  size_t                        bitsPerPixel,
+                  std::vector<Tile::Ptr>&       tiles)
+  {
+    const auto overlap    = region.intersection(band);
+    const auto tileStride = static_cast<size_t>(tileWidth) * bitsPerPixel / 8;
+
+    // Horizontal positions are multiples of 16 (tiff tiles) or of the
+    // tile width, so they always start at a byte boundary
+    for(int left = overlap.getLeft(); left < overlap.getRight();)
+    {
+      const auto tile     = static_cast<size_t>((left - band.getLeft()) / tileWidth);
+      const int  tileLeft = band.getLeft() + static_cast<int>(tile) * tileWidth;
+      const int  right    = std::min(overlap.getRight(), tileLeft + tileWidth);
+      const auto count    = (static_cast<size_t>(right - left) * bitsPerPixel + 7) / 8;
+
+      const byte* from = src + static_cast<size_t>(overlap.getTop() - region.getTop()) * srcStride
+                         + static_cast<size_t>(left - region.getLeft()) * bitsPerPixel / 8;
+      byte* to = tiles[tile]->data.get() + static_cast<size_t>(overlap.getTop() - band.getTop()) * tileStride
+                 + static_cast<size_t>(left - tileLeft) * bitsPerPixel / 8;
+
+      for(int y = overlap.getTop(); y < overlap.getBottom(); y++)
+      {
+        memcpy(to, from, count);
+        from += srcStride;
+        to += tileStride;
+      }
+
+      left = right;
+    }
+  }
+
+  /**
+   * Merge one line of a single color plane into a line of interleaved pixels
+   *
+   * @param plane One line of samples of color plane @c sample
+   * @param line Line of interleaved pixels, initialized to zero
+   */
+  void interleaveSample(const byte* plane, byte* line, int width, size_t spp, size_t bps, size_t sample)
+  {
+    const auto mask = static_cast<unsigned>((1U << bps) - 1);
+
+    for(size_t x = 0; x < static_cast<size_t>(width); x++)
+    {
+      const size_t   from  = x * bps;
+      const size_t   to    = (x * spp + sample) * bps;
+      const unsigned value = (static_cast<unsigned>(plane[from / 8]) >> (8 - bps - from % 8)) & mask;
+      line[to / 8] |= static_cast<byte>(value << (8 - bps - to % 8));
+    }
+  }
 } // namespace
 
 #define TT(x) TagInfo((x), #x)
@@ -259,19 +324,73 @@ namespace Scroom::Tiff
     }
     ensure(tif);
 
+    const auto planarConfig = TIFFGetFieldCheckedOr<uint16_t>(tif, TT(TIFFTAG_PLANARCONFIG), PLANARCONFIG_CONTIG);
+    if(bmd.samplesPerPixel > 1 && planarConfig == PLANARCONFIG_SEPARATE)
+    {
+      layout = Layout::SCANLINES;
+    }
+    else if(TIFFIsTiled(tif.get()))
+    {
+      layout = Layout::TILES;
+    }
+    else
+    {
+      layout = Layout::STRIPS;
+    }
+
+    boost::mutex::scoped_lock const lock(readersMutex);
+    readers.clear();
+    if(layout != Layout::SCANLINES)
+    {
+      auto reader = std::make_unique<Reader>();
+      reader->tif = tif;
+      readers.push_back(std::move(reader));
+    }
+
     return true;
   }
 
   void Source::fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles)
+  {
+    if(layout == Layout::SCANLINES)
+    {
+      fillTilesFromScanlines(startLine, lineCount, tileWidth, firstTile, tiles);
+      return;
+    }
+
+    Reader::Ptr reader = acquireReader();
+    if(reader)
+    {
+      fillTilesFromChunks(*reader, startLine, lineCount, tileWidth, firstTile, tiles);
+      releaseReader(std::move(reader));
+    }
+  }
+
+  void Source::fillTilesFromScanlines(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles)
   {
     auto spp = bmd.samplesPerPixel;
     auto bps = bmd.bitsPerSample;
 
-    const auto        startLine_   = static_cast<uint32_t>(startLine);
-    const auto        firstTile_   = static_cast<size_t>(firstTile);
-    const auto        scanLineSize = static_cast<size_t>(TIFFScanlineSize(tif.get()));
-    const auto        tileStride   = static_cast<size_t>(tileWidth * spp * bps / 8);
-    std::vector<byte> row(scanLineSize);
+    const auto   startLine_  = static_cast<uint32_t>(startLine);
+    const auto   firstTile_  = static_cast<size_t>(firstTile);
+    const auto   planeSize   = static_cast<size_t>(TIFFScanlineSize(tif.get()));
+    const auto   rowSize     = (static_cast<size_t>(bmd.rect.getWidth()) * spp * bps + 7) / 8;
+    const auto   tileStride  = static_cast<size_t>(tileWidth * spp * bps / 8);
+    const auto   lineCount_  = static_cast<size_t>(lineCount);
+    const size_t sampleCount = spp;
+
+    // Color planes are stored one after the other, so read the band one
+    // plane at a time, to avoid seeking back and forth in the file
+    std::vector<byte> plane(planeSize);
+    std::vector<byte> rows(rowSize * lineCount_);
+    for(size_t sample = 0; sample < sampleCount; sample++)
+    {
+      for(size_t i = 0; i < lineCount_; i++)
+      {
+        TIFFReadScanline(tif.get(), plane.data(), static_cast<uint32_t>(i) + startLine_, static_cast<uint16_t>(sample));
+        interleaveSample(plane.data(), rows.data() + i * rowSize, bmd.rect.getWidth(), sampleCount, bps, sample);
+      }
+    }
 
     const size_t tileCount = tiles.size();
     auto         dataPtr   = std::vector<byte*>(tileCount);
@@ -280,22 +399,142 @@ namespace Scroom::Tiff
       dataPtr[tile] = tiles[tile]->data.get();
     }
 
-    for(size_t i = 0; i < static_cast<size_t>(lineCount); i++)
+    for(size_t i = 0; i < lineCount_; i++)
     {
-      TIFFReadScanline(tif.get(), row.data(), static_cast<uint32_t>(i) + startLine_);
+      const byte* row = rows.data() + i * rowSize;
 
       for(size_t tile = 0; tile < tileCount - 1; tile++)
       {
-        memcpy(dataPtr[tile], row.data() + (firstTile_ + tile) * tileStride, tileStride);
+        memcpy(dataPtr[tile], row + (firstTile_ + tile) * tileStride, tileStride);
         dataPtr[tile] += tileStride;
       }
       memcpy(dataPtr[tileCount - 1],
-             row.data() + (firstTile_ + tileCount - 1) * tileStride,
-             scanLineSize - (firstTile_ + tileCount - 1) * tileStride);
+             row + (firstTile_ + tileCount - 1) * tileStride,
+             rowSize - (firstTile_ + tileCount - 1) * tileStride);
       dataPtr[tileCount - 1] += tileStride;
     }
   }
 
-  void Source::done() { tif.reset(); }
+  void Source::fillTilesFromChunks(Reader&                 reader,
+                                   int                     startLine,
+                                   int                     lineCount,
+                                   int                     tileWidth,
+                                   int                     firstTile,
+                                   std::vector<Tile::Ptr>& tiles)
+  {
+    TIFF* const  t            = reader.tif.get();
+    const auto   bitsPerPixel = static_cast<size_t>(bmd.samplesPerPixel * bmd.bitsPerSample);
+    const int    imageWidth   = bmd.rect.getWidth();
+    const int    imageHeight  = bmd.rect.getHeight();
+    const int    bandLeft     = firstTile * tileWidth;
+    const int    bandWidth    = static_cast<int>(tiles.size()) * tileWidth;
+    const auto   band         = Scroom::Utils::make_rect(bandLeft, startLine, bandWidth, lineCount).intersection(bmd.rect);
+
+    const bool isTiled = layout == Layout::TILES;
+    int        chunkWidth{};
+    int        chunkHeight{};
+    size_t     chunkStride{};
+    size_t     chunkSize{};
+
+    if(isTiled)
+    {
+      chunkWidth  = static_cast<int>(TIFFGetFieldCheckedOr<uint32_t>(reader.tif, TT(TIFFTAG_TILEWIDTH), imageWidth));
+      chunkHeight = static_cast<int>(TIFFGetFieldCheckedOr<uint32_t>(reader.tif, TT(TIFFTAG_TILELENGTH), imageHeight));
+      chunkStride = static_cast<size_t>(TIFFTileRowSize(t));
+      chunkSize   = static_cast<size_t>(TIFFTileSize(t));
+    }
+    else
+    {
+      const auto rowsPerStrip = TIFFGetFieldCheckedOr<uint32_t>(reader.tif, TT(TIFFTAG_ROWSPERSTRIP), imageHeight);
+      chunkWidth              = imageWidth;
+      chunkHeight             = static_cast<int>(std::min<uint32_t>(rowsPerStrip, imageHeight));
+      chunkStride             = static_cast<size_t>(TIFFScanlineSize(t));
+      chunkSize               = static_cast<size_t>(TIFFStripSize(t));
+    }
+
+    // If tiff tiles are as wide as our tiles, and a whole number of them
+    // stack up to the height of our tiles, decode straight into our tiles
+    const auto tileStride    = static_cast<size_t>(tileWidth) * bitsPerPixel / 8;
+    const auto fitsInTile    = [&](const Tile::Ptr& tile)
+    { return tile->height % chunkHeight == 0 && chunkSize <= static_cast<size_t>(chunkHeight) * tileStride; };
+    const bool decodeInPlace = isTiled && chunkWidth == tileWidth && startLine % chunkHeight == 0
+                               && std::all_of(tiles.begin(), tiles.end(), fitsInTile);
+
+    reader.buffer.resize(chunkSize);
+
+    for(int top = band.getTop() / chunkHeight * chunkHeight; top < band.getBottom(); top += chunkHeight)
+    {
+      for(int left = band.getLeft() / chunkWidth * chunkWidth; left < band.getRight(); left += chunkWidth)
+      {
+        const uint32_t chunk = isTiled ? TIFFComputeTile(t, left, top, 0, 0) : TIFFComputeStrip(t, top, 0);
+
+        if(decodeInPlace)
+        {
+          byte* target = tiles[(left - band.getLeft()) / tileWidth]->data.get()
+                         + static_cast<size_t>(top - band.getTop()) * tileStride;
+          if(-1 == TIFFReadEncodedTile(t, chunk, target, static_cast<tmsize_t>(chunkSize)))
+          {
+            spdlog::error("Failed to decode tile {} of {}", chunk, fileName);
+          }
+          continue;
+        }
+
+        if(reader.bufferedChunk != chunk)
+        {
+          reader.bufferedChunk = Reader::NO_CHUNK;
+
+          const auto     size    = static_cast<tmsize_t>(chunkSize);
+          const tmsize_t decoded = isTiled ? TIFFReadEncodedTile(t, chunk, reader.buffer.data(), size)
+                                           : TIFFReadEncodedStrip(t, chunk, reader.buffer.data(), size);
+          if(decoded == -1)
+          {
+            spdlog::error("Failed to decode {} {} of {}", isTiled ? "tile" : "strip", chunk, fileName);
+            continue;
+          }
+          reader.bufferedChunk = chunk;
+        }
+
+        const auto region = Scroom::Utils::make_rect(left, top, chunkWidth, chunkHeight);
+        copyRegion(reader.buffer.data(), chunkStride, region, band, tileWidth, bitsPerPixel, tiles);
+      }
+    }
+  }
+
+  Source::Reader::Ptr Source::acquireReader()
+  {
+    {
+      boost::mutex::scoped_lock const lock(readersMutex);
+      if(!readers.empty())
+      {
+        Reader::Ptr reader = std::move(readers.back());
+        readers.pop_back();
+        return reader;
+      }
+    }
+
+    // All readers are in use. Open the file again, for concurrent access
+    auto reader = std::make_unique<Reader>();
+    reader->tif = TIFFPtr(TIFFOpen(fileName.c_str(), "r"), &TIFFCloseUnlessNull);
+    if(!reader->tif)
+    {
+      spdlog::error("Failed to reopen file {}", fileName);
+      return nullptr;
+    }
+    return reader;
+  }
+
+  void Source::releaseReader(Reader::Ptr reader)
+  {
+    boost::mutex::scoped_lock const lock(readersMutex);
+    readers.push_back(std::move(reader));
+  }
+
+  void Source::done()
+  {
+    tif.reset();
+
+    boost::mutex::scoped_lock const lock(readersMutex);
+    readers.clear();
+  }
 
 } // namespace Scroom::Tiff
@@ -9,11 +9,15 @@
 
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <tiffio.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include <scroom/colormappable.hh>
 #include <scroom/observable.hh>
 #include <scroom/opentiledbitmapinterface.hh>
@@ -31,13 +35,51 @@ namespace Scroom::Tiff
 
   boost::optional<std::tuple<Scroom::TiledBitmap::BitmapMetaData, TIFFPtr>> open(const std::string& fileName);
 
+  /**
+   * Provide the data of a tiff file to a TiledBitmap
+   *
+   * Striped and tiled files are decoded a strip or tile at a time,
+   * using random access, such that any band of tiles can be filled
+   * without reading the rest of the file. This also allows fillTiles()
+   * to be called concurrently; each concurrent call uses its own
+   * handle to the file.
+   *
+   * Files with separate color planes are read one scanline at a time,
+   * and the color planes are interleaved into the tiles.
+   */
   class Source : public SourcePresentation
   {
+  private:
+    enum class Layout
+    {
+      SCANLINES,
+      STRIPS,
+      TILES
+    };
+
+    /**
+     * An open tiff file, plus the most recently decoded strip or tile
+     */
+    struct Reader
+    {
+      using Ptr = std::unique_ptr<Reader>;
+
+      static constexpr uint32_t NO_CHUNK = static_cast<uint32_t>(-1);
+
+      TIFFPtr           tif;
+      std::vector<byte> buffer;
+      uint32_t          bufferedChunk{NO_CHUNK};
+    };
+
   private:
     std::string    fileName;
     TIFFPtr        preOpenedTif;
     TIFFPtr        tif;
     BitmapMetaData bmd;
+    Layout         layout{Layout::SCANLINES};
+
+    boost::mutex             readersMutex;
+    std::vector<Reader::Ptr> readers;
 
   public:
     using Ptr = std::shared_ptr<Source>;
@@ -50,8 +92,20 @@ namespace Scroom::Tiff
     void        fillTiles(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles) override;
     void        done() override;
     std::string getName() override { return fileName; }
+    bool        supportsConcurrentFillTiles() override { return layout != Layout::SCANLINES; }
 
   private:
     Source(std::string fileName, TIFFPtr tif, BitmapMetaData bmd);
+
+    void fillTilesFromScanlines(int startLine, int lineCount, int tileWidth, int firstTile, std::vector<Tile::Ptr>& tiles);
+    void fillTilesFromChunks(Reader&                 reader,
+                             int                     startLine,
+                             int                     lineCount,
+                             int                     tileWidth,
+                             int                     firstTile,
+                             std::vector<Tile::Ptr>& tiles);
+
+    Reader::Ptr acquireReader();
+    void        releaseReader(Reader::Ptr reader);
   };
 } // namespace Scroom::Tiff
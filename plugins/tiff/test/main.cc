@@ -0,0 +1,9 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#define BOOST_TEST_MODULE Tiff tests
+#include <boost/test/unit_test.hpp>
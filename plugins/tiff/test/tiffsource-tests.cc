@@ -0,0 +1,299 @@
+/*
+ * Scroom - Generic viewer for 2D data
+ * Copyright (C) 2009-2022 Kees-Jan Dijkzeul
+ *
+ * SPDX-License-Identifier: LGPL-2.1
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tiffio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "tiffsource.hh"
+
+using namespace Scroom::Tiff;
+
+//////////////////////////////////////////////////////////////
+
+namespace
+{
+  const int WIDTH  = 200;
+  const int HEIGHT = 150;
+
+  // Small tiles, so the tiff layouts below don't need huge images to
+  // exercise all edge cases. Only the width and height of the tiles
+  // matter to the Source.
+  const int TILE_SIZE = 64;
+
+  uint8_t expectedValue(int x, int y, int sample) { return static_cast<uint8_t>(x * 7 + y * 13 + sample * 101); }
+
+  enum class Layout
+  {
+    STRIPS,
+    TILES,
+    SEPARATE_PLANES
+  };
+
+  /** A tiff file in a temporary directory, that is removed when it goes out of scope */
+  class TemporaryTiff
+  {
+  public:
+    const boost::filesystem::path directory;
+    const std::string             fileName;
+
+    TemporaryTiff(Layout layout, uint32_t chunkWidth, uint32_t chunkHeight, uint16_t spp = 1)
+      : directory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+      , fileName((directory / "image.tif").string())
+    {
+      boost::filesystem::create_directories(directory);
+      write(layout, chunkWidth, chunkHeight, spp);
+    }
+
+    TemporaryTiff(const TemporaryTiff&)            = delete;
+    TemporaryTiff(TemporaryTiff&&)                 = delete;
+    TemporaryTiff& operator=(const TemporaryTiff&) = delete;
+    TemporaryTiff& operator=(TemporaryTiff&&)      = delete;
+
+    ~TemporaryTiff() { boost::filesystem::remove_all(directory); }
+
+  private:
+    void write(Layout layout, uint32_t chunkWidth, uint32_t chunkHeight, uint16_t spp) const
+    {
+      TIFF* tif = TIFFOpen(fileName.c_str(), "w");
+      BOOST_REQUIRE(tif);
+
+      TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(WIDTH));
+      TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(HEIGHT));
+      TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, static_cast<uint16_t>(8));
+      TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, spp);
+      TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, spp == 1 ? PHOTOMETRIC_MINISBLACK : PHOTOMETRIC_RGB);
+      TIFFSetField(tif, TIFFTAG_PLANARCONFIG, layout == Layout::SEPARATE_PLANES ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG);
+
+      switch(layout)
+      {
+      case Layout::STRIPS:
+        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, chunkHeight);
+        writeScanlines(tif, spp, 0, 0);
+        break;
+
+      case Layout::SEPARATE_PLANES:
+        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, chunkHeight);
+        for(uint16_t sample = 0; sample < spp; sample++)
+        {
+          writeScanlines(tif, 1, sample, sample);
+        }
+        break;
+
+      case Layout::TILES:
+        TIFFSetField(tif, TIFFTAG_TILEWIDTH, chunkWidth);
+        TIFFSetField(tif, TIFFTAG_TILELENGTH, chunkHeight);
+        writeTiles(tif, chunkWidth, chunkHeight, spp);
+        break;
+      }
+
+      TIFFClose(tif);
+    }
+
+    /** Write all scanlines of @c plane, containing @c spp samples per pixel, starting at sample @c firstSample */
+    static void writeScanlines(TIFF* tif, uint16_t spp, uint16_t firstSample, uint16_t plane)
+    {
+      std::vector<uint8_t> row(static_cast<size_t>(WIDTH) * spp);
+      for(int y = 0; y < HEIGHT; y++)
+      {
+        for(int x = 0; x < WIDTH; x++)
+        {
+          for(int s = 0; s < spp; s++)
+          {
+            row[static_cast<size_t>(x * spp + s)] = expectedValue(x, y, firstSample + s);
+          }
+        }
+        BOOST_REQUIRE_NE(-1, TIFFWriteScanline(tif, row.data(), static_cast<uint32_t>(y), plane));
+      }
+    }
+
+    static void writeTiles(TIFF* tif, uint32_t chunkWidth, uint32_t chunkHeight, uint16_t spp)
+    {
+      std::vector<uint8_t> data(static_cast<size_t>(chunkWidth) * chunkHeight * spp);
+      for(uint32_t top = 0; top < HEIGHT; top += chunkHeight)
+      {
+        for(uint32_t left = 0; left < WIDTH; left += chunkWidth)
+        {
+          size_t offset = 0;
+          for(uint32_t y = top; y < top + chunkHeight; y++)
+          {
+            for(uint32_t x = left; x < left + chunkWidth; x++)
+            {
+              for(int s = 0; s < spp; s++)
+              {
+                data[offset++] = expectedValue(static_cast<int>(x), static_cast<int>(y), s);
+              }
+            }
+          }
+          BOOST_REQUIRE_NE(-1, TIFFWriteTile(tif, data.data(), left, top, 0, 0));
+        }
+      }
+    }
+  };
+
+  Source::Ptr openSource(const TemporaryTiff& file)
+  {
+    auto r = Scroom::Tiff::open(file.fileName);
+    BOOST_REQUIRE(r);
+
+    Source::Ptr source = Source::create(file.fileName, std::get<1>(*r), std::get<0>(*r));
+    BOOST_REQUIRE(source->reset());
+    return source;
+  }
+
+  std::vector<Tile::Ptr> createTiles(int spp)
+  {
+    const int              count = (WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    const auto             size  = static_cast<size_t>(TILE_SIZE * TILE_SIZE * spp);
+    std::vector<Tile::Ptr> tiles;
+    for(int i = 0; i < count; i++)
+    {
+      std::shared_ptr<uint8_t> const data(new uint8_t[size](), std::default_delete<uint8_t[]>());
+      tiles.push_back(Tile::create(TILE_SIZE, TILE_SIZE, 8 * spp, data));
+    }
+    return tiles;
+  }
+
+  void checkTiles(const std::vector<Tile::Ptr>& tiles, int startLine, int lineCount, int spp)
+  {
+    for(size_t i = 0; i < tiles.size(); i++)
+    {
+      const uint8_t* data = tiles[i]->data.get();
+      for(int y = 0; y < lineCount; y++)
+      {
+        for(int x = 0; x < TILE_SIZE && static_cast<int>(i) * TILE_SIZE + x < WIDTH; x++)
+        {
+          for(int s = 0; s < spp; s++)
+          {
+            const uint8_t actual   = data[(y * TILE_SIZE + x) * spp + s];
+            const uint8_t expected = expectedValue(static_cast<int>(i) * TILE_SIZE + x, startLine + y, s);
+            if(actual != expected)
+            {
+              BOOST_FAIL("Tile " << i << " line " << startLine + y << " pixel " << x << " sample " << s << ": expected "
+                                 << static_cast<int>(expected) << ", got " << static_cast<int>(actual));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /** Fill every band of tiles, and verify the result */
+  void checkAllBands(const Source::Ptr& source, int spp)
+  {
+    for(int startLine = 0; startLine < HEIGHT; startLine += TILE_SIZE)
+    {
+      const int              lineCount = std::min(TILE_SIZE, HEIGHT - startLine);
+      std::vector<Tile::Ptr> tiles     = createTiles(spp);
+      source->fillTiles(startLine, lineCount, TILE_SIZE, 0, tiles);
+      checkTiles(tiles, startLine, lineCount, spp);
+    }
+  }
+} // namespace
+
+//////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE(TiffSource_Tests)
+
+BOOST_AUTO_TEST_CASE(strips_are_copied_into_tiles)
+{
+  const TemporaryTiff file(Layout::STRIPS, WIDTH, 7);
+  const Source::Ptr   source = openSource(file);
+
+  BOOST_CHECK(source->supportsConcurrentFillTiles());
+  checkAllBands(source, 1);
+}
+
+BOOST_AUTO_TEST_CASE(rgb_strips_are_copied_into_tiles)
+{
+  const TemporaryTiff file(Layout::STRIPS, WIDTH, 5, 3);
+  checkAllBands(openSource(file), 3);
+}
+
+BOOST_AUTO_TEST_CASE(tiles_matching_our_tiles_are_decoded_in_place)
+{
+  const TemporaryTiff file(Layout::TILES, TILE_SIZE, TILE_SIZE);
+  const Source::Ptr   source = openSource(file);
+
+  BOOST_CHECK(source->supportsConcurrentFillTiles());
+  checkAllBands(source, 1);
+}
+
+BOOST_AUTO_TEST_CASE(tiles_lower_than_our_tiles_are_stacked_in_place)
+{
+  const TemporaryTiff file(Layout::TILES, TILE_SIZE, 16);
+  checkAllBands(openSource(file), 1);
+}
+
+BOOST_AUTO_TEST_CASE(tiles_higher_than_our_tiles_are_copied)
+{
+  const TemporaryTiff file(Layout::TILES, TILE_SIZE, 2 * TILE_SIZE);
+  checkAllBands(openSource(file), 1);
+}
+
+BOOST_AUTO_TEST_CASE(narrow_tiles_are_copied)
+{
+  const TemporaryTiff file(Layout::TILES, 48, 32);
+  checkAllBands(openSource(file), 1);
+}
+
+BOOST_AUTO_TEST_CASE(rgb_tiles_are_decoded_in_place)
+{
+  const TemporaryTiff file(Layout::TILES, TILE_SIZE, 32, 3);
+  checkAllBands(openSource(file), 3);
+}
+
+BOOST_AUTO_TEST_CASE(separate_planes_are_read_per_scanline)
+{
+  const TemporaryTiff file(Layout::SEPARATE_PLANES, WIDTH, 8, 3);
+  const Source::Ptr   source = openSource(file);
+
+  BOOST_CHECK(!source->supportsConcurrentFillTiles());
+  checkAllBands(source, 3);
+}
+
+BOOST_AUTO_TEST_CASE(bands_can_be_filled_concurrently)
+{
+  const TemporaryTiff file(Layout::TILES, TILE_SIZE, 16);
+  const Source::Ptr   source = openSource(file);
+
+  const int                           bandCount = (HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+  std::vector<std::vector<Tile::Ptr>> bands(bandCount);
+  for(int round = 0; round < 10; round++)
+  {
+    std::vector<std::thread> threads;
+    for(int band = 0; band < bandCount; band++)
+    {
+      bands[band] = createTiles(1);
+      threads.emplace_back(
+        [&, band]
+        {
+          const int startLine = band * TILE_SIZE;
+          source->fillTiles(startLine, std::min(TILE_SIZE, HEIGHT - startLine), TILE_SIZE, 0, bands[band]);
+        });
+    }
+    for(std::thread& t: threads)
+    {
+      t.join();
+    }
+
+    for(int band = 0; band < bandCount; band++)
+    {
+      const int startLine = band * TILE_SIZE;
+      checkTiles(bands[band], startLine, std::min(TILE_SIZE, HEIGHT - startLine), 1);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()